@@ -65,6 +65,8 @@ static void announce_and_cleanup(int fake)
 	udc_disconnect();
 #endif
 
+	/* devices still probing in the background must not be left running */
+	dm_probe_wait_all();
 	board_quiesce_devices();
 
 	printf("\nStarting kernel ...%s\n\n", fake ?
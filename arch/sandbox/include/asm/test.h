@@ -119,6 +119,27 @@ long sandbox_i2c_rtc_get_set_base_time(struct udevice *dev, long base_time);
 
 int sandbox_usb_keyb_add_string(struct udevice *dev, const char *str);
 
+/**
+ * sandbox_flash_refuse_uas() - Stop a USB flash stick from offering UAS
+ *
+ * This makes the stick refuse to select its UAS alternate setting, so that
+ * the host has to fall back to Bulk-Only Transport. It must be called before
+ * the stick is set up by the host.
+ *
+ * @dev:	USB flash-stick emulator
+ * @refuse:	true to refuse UAS, false to allow it
+ */
+void sandbox_flash_refuse_uas(struct udevice *dev, bool refuse);
+
+/**
+ * sandbox_flash_get_uas_depth() - Get the UAS queue depth seen by a stick
+ *
+ * @dev:	USB flash-stick emulator
+ * Return: most UAS commands that were outstanding at once, or 0 if the stick
+ *	is not using UAS
+ */
+int sandbox_flash_get_uas_depth(struct udevice *dev);
+
 /**
  * sandbox_osd_get_mem() - get the internal memory of a sandbox OSD
  *
@@ -239,6 +260,33 @@ uint sandbox_spi_get_speed(struct udevice *dev);
  */
 uint sandbox_spi_get_mode(struct udevice *dev);
 
+/**
+ * sandbox_spi_get_dirmap_reads() - Get the number of direct-mapped reads
+ *
+ * @dev: Device to check
+ * Return: number of reads done through a direct mapping on the bus
+ */
+uint sandbox_spi_get_dirmap_reads(struct udevice *dev);
+
+/**
+ * sandbox_mmc_get_cmd_count() - Get the number of times a command was sent
+ *
+ * @dev: MMC device to check
+ * @cmdidx: Command index, e.g. MMC_CMD_STOP_TRANSMISSION
+ * Return: number of times the command was received
+ */
+uint sandbox_mmc_get_cmd_count(struct udevice *dev, uint cmdidx);
+
+/**
+ * sandbox_scsi_set_spinup() - Set how long emulated disks take to spin up
+ *
+ * The controller finishes probing only once this time has passed, so that it
+ * can be used to emulate a slow device which is probed in the background
+ *
+ * @ms: Spin-up time in milliseconds, 0 for none
+ */
+void sandbox_scsi_set_spinup(uint ms);
+
 /**
  * sandbox_get_pch_spi_protect() - Get the PCI SPI protection status
  *
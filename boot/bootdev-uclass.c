@@ -31,8 +31,28 @@ enum {
 
 	/* Maximum supported length of the "boot_targets" env string */
 	BOOT_TARGETS_MAX_LEN	= 100,
+
+	/* Maximum number of hunters, limited by bootstd_priv->hunters_used */
+	MAX_HUNTERS		= 32,
 };
 
+/**
+ * struct bootdev_bg_hunt - state for starting hunters ahead of the scan
+ *
+ * @active: true if hunters are being started ahead of the scan
+ * @order: Hunters to start, in order, as indices into the linker list
+ * @count: Number of hunters in @order
+ * @started: Bitmask of hunters which have been started
+ * @show: true to show information from the hunters
+ */
+static struct bootdev_bg_hunt {
+	bool active;
+	u8 order[MAX_HUNTERS];
+	int count;
+	uint started;
+	bool show;
+} bg_hunt;
+
 int bootdev_add_bootflow(struct bootflow *bflow)
 {
 	struct bootstd_priv *std;
@@ -752,6 +772,15 @@ int bootdev_setup_iter(struct bootflow_iter *iter, const char *label,
 		*method_flagsp = method_flags;
 	*devp = dev;
 
+	/* with a single device there is nothing to hunt for in advance */
+	if (IS_ENABLED(CONFIG_BOOTSTD_BG_HUNT) && !label &&
+	    (iter->flags & BOOTFLOWIF_HUNT) &&
+	    (iter->flags & BOOTFLOWIF_BG_HUNT)) {
+		ret = bootdev_hunt_bg_start(iter);
+		if (ret)
+			log_warning("Cannot hunt in background (err=%d)\n", ret);
+	}
+
 	return 0;
 }
 
@@ -782,36 +811,52 @@ static int bootdev_hunt_drv(struct bootdev_hunter *info, uint seq, bool show)
 	return 0;
 }
 
+/**
+ * bootdev_hunter_matches() - Check if a hunter can find bootdevs for a spec
+ *
+ * @info: Hunter to check
+ * @spec: Spec to match, e.g. "mmc0", or NULL for any
+ * Return: true if the hunter should be used for @spec
+ */
+static bool bootdev_hunter_matches(struct bootdev_hunter *info,
+				   const char *spec)
+{
+	const char *name = uclass_get_name(info->uclass);
+	const char *end;
+	size_t len;
+
+	if (!spec)
+		return true;
+
+	/* ignore any trailing number */
+	trailing_strtoln_end(spec, NULL, &end);
+	len = end - spec;
+
+	log_debug("looking at %.*s for %s\n",
+		  (int)max(strlen(name), len), spec, name);
+	if (!strncmp(spec, name, max(strlen(name), len)))
+		return true;
+
+	return info->uclass == UCLASS_ETH &&
+		(!strcmp("dhcp", spec) || !strcmp("pxe", spec));
+}
+
 int bootdev_hunt(const char *spec, bool show)
 {
 	struct bootdev_hunter *start;
-	const char *end;
 	int n_ent, i;
 	int result;
-	size_t len;
 
 	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
 	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
 	result = 0;
 
-	len = SIZE_MAX;
-	if (spec) {
-		trailing_strtoln_end(spec, NULL, &end);
-		len = end - spec;
-	}
-
 	for (i = 0; i < n_ent; i++) {
 		struct bootdev_hunter *info = start + i;
-		const char *name = uclass_get_name(info->uclass);
 		int ret;
 
-		log_debug("looking at %.*s for %s\n",
-			  (int)max(strlen(name), len), spec, name);
-		if (spec && strncmp(spec, name, max(strlen(name), len))) {
-			if (info->uclass != UCLASS_ETH ||
-			    (strcmp("dhcp", spec) && strcmp("pxe", spec)))
-				continue;
-		}
+		if (!bootdev_hunter_matches(info, spec))
+			continue;
 		ret = bootdev_hunt_drv(info, i, show);
 		if (ret)
 			result = ret;
@@ -847,6 +892,101 @@ int bootdev_hunt_prio(enum bootdev_prio_t prio, bool show)
 	return result;
 }
 
+/**
+ * bootdev_hunt_bg_add() - Add hunters to the order for starting them
+ *
+ * Only hunters which can be started without waiting are added
+ *
+ * @spec: Spec to match, e.g. "mmc0", or NULL for any
+ * @prio: Priority to match, or BOOTDEVP_0_NONE for any
+ */
+static void bootdev_hunt_bg_add(const char *spec, enum bootdev_prio_t prio)
+{
+	struct bootdev_hunter *start;
+	int n_ent, i, j;
+
+	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
+	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
+	for (i = 0; i < min(n_ent, MAX_HUNTERS); i++) {
+		struct bootdev_hunter *info = start + i;
+
+		if (!info->start)
+			continue;
+		if (prio != BOOTDEVP_0_NONE && info->prio != prio)
+			continue;
+		if (!bootdev_hunter_matches(info, spec))
+			continue;
+		for (j = 0; j < bg_hunt.count; j++) {
+			if (bg_hunt.order[j] == i)
+				break;
+		}
+		if (j == bg_hunt.count)
+			bg_hunt.order[bg_hunt.count++] = i;
+	}
+}
+
+int bootdev_hunt_bg_start(struct bootflow_iter *iter)
+{
+	int i;
+
+	bootdev_hunt_bg_stop();
+	if (!IS_ENABLED(CONFIG_BOOTSTD_BG_HUNT))
+		return -ENOSYS;
+
+	bg_hunt.count = 0;
+	bg_hunt.started = 0;
+	bg_hunt.show = iter->flags & BOOTFLOWIF_SHOW;
+
+	/* start hunters in the order which the scan will use them */
+	if (iter->labels) {
+		for (i = 0; iter->labels[i]; i++)
+			bootdev_hunt_bg_add(iter->labels[i], BOOTDEVP_0_NONE);
+	} else {
+		for (i = BOOTDEVP_2_INTERNAL_FAST; i < BOOTDEVP_COUNT; i++)
+			bootdev_hunt_bg_add(NULL, i);
+	}
+	bg_hunt.active = true;
+
+	return 0;
+}
+
+void bootdev_hunt_bg_step(void)
+{
+	struct bootdev_hunter *start;
+	struct bootstd_priv *std;
+	int i;
+
+	if (!bg_hunt.active || bootstd_get_priv(&std))
+		return;
+	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
+
+	for (i = 0; i < bg_hunt.count; i++) {
+		int seq = bg_hunt.order[i];
+		struct bootdev_hunter *info = start + seq;
+		int ret;
+
+		/* a hunter which has already run needs no head start */
+		if ((std->hunters_used | bg_hunt.started) & BIT(seq))
+			continue;
+
+		if (bg_hunt.show)
+			printf("Starting hunter: %s\n",
+			       uclass_get_name(info->uclass));
+		log_debug("Starting hunter: %s\n",
+			  uclass_get_name(info->uclass));
+		bg_hunt.started |= BIT(seq);
+		ret = info->start(info, bg_hunt.show);
+		if (ret)
+			log_debug("  - start result %d\n", ret);
+		return;
+	}
+}
+
+void bootdev_hunt_bg_stop(void)
+{
+	bg_hunt.active = false;
+}
+
 void bootdev_list_hunters(struct bootstd_priv *std)
 {
 	struct bootdev_hunter *orig, *start;
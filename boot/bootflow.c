@@ -10,6 +10,7 @@
 #include <bootdev.h>
 #include <bootflow.h>
 #include <bootmeth.h>
+#include <bootstage.h>
 #include <bootstd.h>
 #include <dm.h>
 #include <env_internal.h>
@@ -97,6 +98,8 @@ void bootflow_iter_init(struct bootflow_iter *iter, int flags)
 
 void bootflow_iter_uninit(struct bootflow_iter *iter)
 {
+	if (iter->flags & BOOTFLOWIF_BG_HUNT)
+		bootdev_hunt_bg_stop();
 	free(iter->method_order);
 }
 
@@ -312,6 +315,10 @@ static int bootflow_check(struct bootflow_iter *iter, struct bootflow *bflow)
 		return 0;
 	}
 
+	/* give the next hunter a head start while this bootdev is read */
+	if (iter->flags & BOOTFLOWIF_BG_HUNT)
+		bootdev_hunt_bg_step();
+
 	dev = iter->dev;
 	ret = bootdev_get_bootflow(dev, iter, bflow);
 
@@ -339,9 +346,12 @@ static int bootflow_check(struct bootflow_iter *iter, struct bootflow *bflow)
 	return 0;
 }
 
-int bootflow_scan_first(struct udevice *dev, const char *label,
-			struct bootflow_iter *iter, int flags,
-			struct bootflow *bflow)
+static int _bootflow_scan_next(struct bootflow_iter *iter,
+			       struct bootflow *bflow);
+
+static int _bootflow_scan_first(struct udevice *dev, const char *label,
+				struct bootflow_iter *iter, int flags,
+				struct bootflow *bflow)
 {
 	int ret;
 
@@ -379,7 +389,7 @@ int bootflow_scan_first(struct udevice *dev, const char *label,
 				return log_msg_ret("all", ret);
 		}
 		iter->err = ret;
-		ret = bootflow_scan_next(iter, bflow);
+		ret = _bootflow_scan_next(iter, bflow);
 		if (ret)
 			return log_msg_ret("get", ret);
 	}
@@ -387,15 +397,32 @@ int bootflow_scan_first(struct udevice *dev, const char *label,
 	return 0;
 }
 
-int bootflow_scan_next(struct bootflow_iter *iter, struct bootflow *bflow)
+int bootflow_scan_first(struct udevice *dev, const char *label,
+			struct bootflow_iter *iter, int flags,
+			struct bootflow *bflow)
+{
+	int ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_BOOTFLOW_SCAN, "bootflow_scan");
+	ret = _bootflow_scan_first(dev, label, iter, flags, bflow);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_BOOTFLOW_SCAN);
+
+	return ret;
+}
+
+static int _bootflow_scan_next(struct bootflow_iter *iter,
+			       struct bootflow *bflow)
 {
 	int ret;
 
 	do {
 		ret = iter_incr(iter);
 		log_debug("iter_incr: ret=%d\n", ret);
-		if (ret == BF_NO_MORE_DEVICES)
+		if (ret == BF_NO_MORE_DEVICES) {
+			if (iter->flags & BOOTFLOWIF_BG_HUNT)
+				bootdev_hunt_bg_stop();
 			return log_msg_ret("done", ret);
+		}
 
 		if (!ret) {
 			ret = bootflow_check(iter, bflow);
@@ -415,6 +442,17 @@ int bootflow_scan_next(struct bootflow_iter *iter, struct bootflow *bflow)
 	} while (1);
 }
 
+int bootflow_scan_next(struct bootflow_iter *iter, struct bootflow *bflow)
+{
+	int ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_BOOTFLOW_SCAN, "bootflow_scan");
+	ret = _bootflow_scan_next(iter, bflow);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_BOOTFLOW_SCAN);
+
+	return ret;
+}
+
 void bootflow_init(struct bootflow *bflow, struct udevice *bootdev,
 		   struct udevice *meth)
 {
@@ -451,6 +489,9 @@ int bootflow_boot(struct bootflow *bflow)
 	if (bflow->state != BOOTFLOWST_READY)
 		return log_msg_ret("load", -EPROTO);
 
+	/* don't start up any more devices while booting */
+	bootdev_hunt_bg_stop();
+
 	ret = bootmeth_boot(bflow->method, bflow);
 	if (ret)
 		return log_msg_ret("boot", ret);
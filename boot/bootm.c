@@ -806,9 +806,13 @@ int do_bootm_states(struct cmd_tbl *cmdtp, int flag, int argc,
 	}
 
 	/* Now run the OS! We hope this doesn't return */
-	if (!ret && (states & BOOTM_STATE_OS_GO))
+	if (!ret && (states & BOOTM_STATE_OS_GO)) {
+		if (IS_ENABLED(CONFIG_BOOTSTAGE_TRACE_BLOBLIST) &&
+		    bootstage_trace_bloblist())
+			puts("bootstage: Failed to add trace to bloblist\n");
 		ret = boot_selected_os(argc, argv, BOOTM_STATE_OS_GO,
 				images, boot_fn);
+	}
 
 	/* Deal with any fallout */
 err:
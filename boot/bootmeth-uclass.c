@@ -11,6 +11,7 @@
 #include <bootflow.h>
 #include <bootmeth.h>
 #include <bootstd.h>
+#include <bootstage.h>
 #include <dm.h>
 #include <env_internal.h>
 #include <fs.h>
@@ -43,11 +44,16 @@ int bootmeth_check(struct udevice *dev, struct bootflow_iter *iter)
 int bootmeth_read_bootflow(struct udevice *dev, struct bootflow *bflow)
 {
 	const struct bootmeth_ops *ops = bootmeth_get_ops(dev);
+	int span, ret;
 
 	if (!ops->read_bootflow)
 		return -ENOSYS;
 
-	return ops->read_bootflow(dev, bflow);
+	span = bootstage_span_begin(BOOTSTAGE_SPAN_BOOTMETH, dev->name);
+	ret = ops->read_bootflow(dev, bflow);
+	bootstage_span_end(span);
+
+	return ret;
 }
 
 int bootmeth_set_bootflow(struct udevice *dev, struct bootflow *bflow,
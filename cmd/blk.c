@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Commands which work with any block device
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <getopt.h>
+#include <part.h>
+#include <linux/math64.h>
+
+static int do_blk_bench(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct blk_bench_params params = {
+		.xfer		= 8,
+		.duration_ms	= 1000,
+	};
+	struct blk_bench_result res;
+	struct getopt_state gs;
+	struct blk_desc *desc;
+	u64 mbps, iops;
+	int opt, ret;
+
+	getopt_init_state(&gs);
+	while ((opt = getopt(&gs, argc, argv, "wrb:t:n:")) > 0) {
+		switch (opt) {
+		case 'w':
+			params.write = true;
+			break;
+		case 'r':
+			params.random = true;
+			break;
+		case 'b':
+			params.xfer = dectoul(gs.arg, NULL);
+			break;
+		case 't':
+			params.duration_ms = dectoul(gs.arg, NULL);
+			break;
+		case 'n':
+			params.max_ops = dectoul(gs.arg, NULL);
+			break;
+		default:
+			return CMD_RET_USAGE;
+		}
+	}
+	argc -= gs.index;
+	argv += gs.index;
+	/* writing destroys data, so the region must be given */
+	if (argc != 4 && (argc != 2 || params.write))
+		return CMD_RET_USAGE;
+
+	if (blk_get_device_by_str(argv[0], argv[1], &desc) < 0)
+		return CMD_RET_FAILURE;
+	if (argc == 4) {
+		params.start = hextoul(argv[2], NULL);
+		params.count = hextoul(argv[3], NULL);
+	} else {
+		params.count = desc->lba;
+	}
+
+	printf("%s %s: %s %s, " LBAFU " blocks of %lu bytes per transfer\n",
+	       argv[0], argv[1], params.random ? "random" : "sequential",
+	       params.write ? "write" : "read", params.xfer, desc->blksz);
+	ret = blk_bench(desc, &params, &res);
+	if (ret == -EINVAL) {
+		printf("Invalid region or transfer size\n");
+		return CMD_RET_FAILURE;
+	}
+	if (!res.ops) {
+		printf("Failed (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	mbps = div_u64(res.bytes * 100, max(res.elapsed_us, 1UL));
+	iops = div_u64((u64)res.ops * 1000000, max(res.elapsed_us, 1UL));
+	printf("%lu transfers, %llu bytes in %lu us\n", res.ops, res.bytes,
+	       res.elapsed_us);
+	printf("%llu.%02llu MB/s, %llu IOPS\n", mbps / 100, mbps % 100, iops);
+	printf("latency (us): min %lu avg %lu p50 %lu p90 %lu p99 %lu max %lu\n",
+	       res.lat_min, res.lat_avg, res.lat_p50, res.lat_p90, res.lat_p99,
+	       res.lat_max);
+	if (ret) {
+		printf("Failed (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_SYS_LONGHELP
+static char blk_help_text[] =
+	"bench [-w] [-r] [-b <blocks>] [-t <ms>] [-n <count>] <interface> <dev[.hwpart]> [<blk#> <cnt>]\n"
+	"    - measure throughput and latency of a block device\n"
+	"      -w: write instead of read (destroys data, needs blk# and cnt)\n"
+	"      -r: random instead of sequential offsets\n"
+	"      -b: blocks per transfer (default 8)\n"
+	"      -t: time to run for in ms (default 1000)\n"
+	"      -n: stop after this many transfers";
+#endif
+
+U_BOOT_CMD_WITH_SUBCMDS(blk, "Block devices", blk_help_text,
+	U_BOOT_SUBCMD_MKENT(bench, 15, 0, do_blk_bench));
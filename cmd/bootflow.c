@@ -96,7 +96,7 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 	struct udevice *dev = NULL;
 	struct bootflow bflow;
 	bool all = false, boot = false, errors = false, no_global = false;
-	bool list = false, no_hunter = false;
+	bool list = false, no_hunter = false, bg_hunt = false;
 	int num_valid = 0;
 	const char *label = NULL;
 	bool has_args;
@@ -116,6 +116,7 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 			no_global = strchr(argv[1], 'G');
 			list = strchr(argv[1], 'l');
 			no_hunter = strchr(argv[1], 'H');
+			bg_hunt = strchr(argv[1], 'B');
 			argc--;
 			argv++;
 		}
@@ -142,6 +143,8 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 		flags |= BOOTFLOWIF_SKIP_GLOBAL;
 	if (!no_hunter)
 		flags |= BOOTFLOWIF_HUNT;
+	if (bg_hunt)
+		flags |= BOOTFLOWIF_BG_HUNT;
 
 	/*
 	 * If we have a device, just scan for bootflows attached to that device
@@ -170,6 +173,7 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 		ret = bootdev_add_bootflow(&bflow);
 		if (ret) {
 			printf("Out of memory\n");
+			bootflow_iter_uninit(&iter);
 			return CMD_RET_FAILURE;
 		}
 		if (list)
@@ -505,7 +509,7 @@ static int do_bootflow_cmdline(struct cmd_tbl *cmdtp, int flag, int argc,
 #ifdef CONFIG_SYS_LONGHELP
 static char bootflow_help_text[] =
 #ifdef CONFIG_CMD_BOOTFLOW_FULL
-	"scan [-abeGl] [bdev]  - scan for valid bootflows (-l list, -a all, -e errors, -b boot, -G no global)\n"
+	"scan [-abeGlB] [bdev] - scan for valid bootflows (-l list, -a all, -e errors, -b boot, -G no global, -B hunt in background)\n"
 	"bootflow list [-e]             - list scanned bootflows (-e errors)\n"
 	"bootflow select [<num>|<name>] - select a bootflow\n"
 	"bootflow info [-d]             - show info on current bootflow (-d dump bootflow)\n"
@@ -6,6 +6,9 @@
 #include <common.h>
 #include <bootstage.h>
 #include <command.h>
+#include <env.h>
+#include <malloc.h>
+#include <mapmem.h>
 
 static int do_bootstage_report(struct cmd_tbl *cmdtp, int flag, int argc,
 			       char *const argv[])
@@ -59,10 +62,64 @@ static int do_bootstage_stash(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+static int do_bootstage_spans(struct cmd_tbl *cmdtp, int flag, int argc,
+			      char *const argv[])
+{
+	uint min_us = 0;
+
+	if (argc > 1)
+		min_us = dectoul(argv[1], NULL);
+	bootstage_span_report(min_us);
+
+	return 0;
+}
+
+static int do_bootstage_trace(struct cmd_tbl *cmdtp, int flag, int argc,
+			      char *const argv[])
+{
+	ulong size;
+	char *buf;
+	int len;
+
+	if (argc == 2)
+		return CMD_RET_USAGE;
+	if (argc < 3) {
+		len = bootstage_trace_json(NULL, 0);
+		buf = malloc(len + 1);
+		if (!buf) {
+			printf("Out of memory\n");
+			return CMD_RET_FAILURE;
+		}
+		bootstage_trace_json(buf, len + 1);
+		puts(buf);
+		free(buf);
+
+		return 0;
+	}
+
+	size = hextoul(argv[2], NULL);
+	buf = map_sysmem(hextoul(argv[1], NULL), size);
+	len = bootstage_trace_json(buf, size);
+	unmap_sysmem(buf);
+	if (len >= size) {
+		printf("Error: truncated (%#x bytes needed)\n", len + 1);
+		return CMD_RET_FAILURE;
+	}
+	env_set_hex("filesize", len);
+
+	return 0;
+}
+#endif
+
 static struct cmd_tbl cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	U_BOOT_CMD_MKENT(spans, 2, 1, do_bootstage_spans, "", ""),
+	U_BOOT_CMD_MKENT(trace, 3, 1, do_bootstage_trace, "", ""),
+#endif
 };
 
 /*
@@ -93,4 +150,8 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
 	"unstash [<start> [<size>]]  - Unstash data from memory"
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	"\nspans [<min_us>]            - Show spans taking at least min_us\n"
+	"trace [<addr> <size>]       - Show / write Chrome trace JSON"
+#endif
 );
@@ -8,6 +8,8 @@
 
 #include <common.h>
 #include <command.h>
+#include <of_live.h>
+#include <dm/of.h>
 #include <dm/root.h>
 #include <dm/util.h>
 
@@ -35,6 +37,24 @@ static int do_dm_dump_drivers(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+static int do_dm_livetree(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	struct of_live_stats stats;
+
+	if (!of_live_active() || of_live_get_stats(gd_of_root(), &stats)) {
+		printf("Live tree is not in use\n");
+		return CMD_RET_FAILURE;
+	}
+	printf("Nodes created: %u of %u (%u%%)\n", stats.nodes,
+	       stats.total_nodes, stats.nodes * 100 / stats.total_nodes);
+	printf("Memory used:   %lx (%lu)\n", stats.size, stats.size);
+
+	return 0;
+}
+#endif /* OF_LIVE_LAZY */
+
 #if CONFIG_IS_ENABLED(DM_STATS)
 static int do_dm_dump_mem(struct cmd_tbl *cmdtp, int flag, int argc,
 			  char *const argv[])
@@ -48,6 +68,26 @@ static int do_dm_dump_mem(struct cmd_tbl *cmdtp, int flag, int argc,
 }
 #endif /* DM_STATS */
 
+#if CONFIG_IS_ENABLED(DM_TIMING)
+static int do_dm_timing(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	bool bootstage = false;
+	int count = 20;
+
+	if (argc > 1 && !strcmp(argv[1], "-b")) {
+		bootstage = true;
+		argc--;
+		argv++;
+	}
+	if (argc > 1)
+		count = dectoul(argv[1], NULL);
+	dm_dump_timing(count, bootstage);
+
+	return 0;
+}
+#endif /* DM_TIMING */
+
 static int do_dm_dump_static_driver_info(struct cmd_tbl *cmdtp, int flag,
 					 int argc, char * const argv[])
 {
@@ -76,6 +116,14 @@ static int do_dm_dump_uclass(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+#define DM_LIVETREE_HELP	"dm livetree      Show how much of the live tree has been created\n"
+#define DM_LIVETREE	U_BOOT_SUBCMD_MKENT(livetree, 1, 1, do_dm_livetree),
+#else
+#define DM_LIVETREE_HELP
+#define DM_LIVETREE
+#endif
+
 #if CONFIG_IS_ENABLED(DM_STATS)
 #define DM_MEM_HELP	"dm mem           Provide a summary of memory usage\n"
 #define DM_MEM		U_BOOT_SUBCMD_MKENT(mem, 1, 1, do_dm_dump_mem),
@@ -84,13 +132,23 @@ static int do_dm_dump_uclass(struct cmd_tbl *cmdtp, int flag, int argc,
 #define DM_MEM
 #endif
 
+#if CONFIG_IS_ENABLED(DM_TIMING)
+#define DM_TIMING_HELP	"dm timing [-b] [<n>] Show the n slowest devices to probe (-b=add to bootstage)\n"
+#define DM_TIMING	U_BOOT_SUBCMD_MKENT(timing, 3, 1, do_dm_timing),
+#else
+#define DM_TIMING_HELP
+#define DM_TIMING
+#endif
+
 #if IS_ENABLED(CONFIG_SYS_LONGHELP)
 static char dm_help_text[] =
 	"compat        Dump list of drivers with compatibility strings\n"
 	"dm devres        Dump list of device resources for each device\n"
 	"dm drivers       Dump list of drivers with uclass and instances\n"
+	DM_LIVETREE_HELP
 	DM_MEM_HELP
 	"dm static        Dump list of drivers with static platform data\n"
+	DM_TIMING_HELP
 	"dm tree [-s]     Dump tree of driver model devices (-s=sort)\n"
 	"dm uclass        Dump list of instances for each uclass"
 	;
@@ -100,7 +158,9 @@ U_BOOT_CMD_WITH_SUBCMDS(dm, "Driver model low level access", dm_help_text,
 	U_BOOT_SUBCMD_MKENT(compat, 1, 1, do_dm_dump_driver_compat),
 	U_BOOT_SUBCMD_MKENT(devres, 1, 1, do_dm_dump_devres),
 	U_BOOT_SUBCMD_MKENT(drivers, 1, 1, do_dm_dump_drivers),
+	DM_LIVETREE
 	DM_MEM
 	U_BOOT_SUBCMD_MKENT(static, 1, 1, do_dm_dump_static_driver_info),
+	DM_TIMING
 	U_BOOT_SUBCMD_MKENT(tree, 2, 1, do_dm_dump_tree),
 	U_BOOT_SUBCMD_MKENT(uclass, 1, 1, do_dm_dump_uclass));
@@ -16,18 +16,13 @@
 
 static LIST_HEAD(extension_list);
 
-static int extension_apply(struct extension *extension)
+static int extension_load(struct extension *extension,
+			  struct fdt_header **blobp, ulong *sizep)
 {
 	char *overlay_cmd;
 	ulong extrasize, overlay_addr;
 	struct fdt_header *blob;
 
-	if (!working_fdt) {
-		printf("No FDT memory address configured. Please configure\n"
-		       "the FDT address via \"fdt addr <address>\" command.\n");
-		return CMD_RET_FAILURE;
-	}
-
 	overlay_cmd = env_get("extension_overlay_cmd");
 	if (!overlay_cmd) {
 		printf("Environment extension_overlay_cmd is missing\n");
@@ -48,11 +43,32 @@ static int extension_apply(struct extension *extension)
 	if (!extrasize)
 		return CMD_RET_FAILURE;
 
-	fdt_shrink_to_minimum(working_fdt, extrasize);
-
 	blob = map_sysmem(overlay_addr, 0);
 	if (!fdt_valid(&blob))
 		return CMD_RET_FAILURE;
+	*blobp = blob;
+	*sizep = extrasize;
+
+	return CMD_RET_SUCCESS;
+}
+
+static int extension_apply(struct extension *extension)
+{
+	struct fdt_header *blob;
+	ulong extrasize;
+	int ret;
+
+	if (!working_fdt) {
+		printf("No FDT memory address configured. Please configure\n"
+		       "the FDT address via \"fdt addr <address>\" command.\n");
+		return CMD_RET_FAILURE;
+	}
+
+	ret = extension_load(extension, &blob, &extrasize);
+	if (ret)
+		return ret;
+
+	fdt_shrink_to_minimum(working_fdt, extrasize);
 
 	/* apply method prints messages on error */
 	if (fdt_overlay_apply_verbose(working_fdt, blob))
@@ -61,6 +77,62 @@ static int extension_apply(struct extension *extension)
 	return CMD_RET_SUCCESS;
 }
 
+/*
+ * Load the overlays for all extensions, which all use the same address, and
+ * apply them together
+ */
+static int extension_apply_all(void)
+{
+	struct extension *extension;
+	struct fdt_header *blob;
+	ulong size, extrasize = 0;
+	int count = 0, ret, i;
+	void **blobs;
+
+	if (!working_fdt) {
+		printf("No FDT memory address configured. Please configure\n"
+		       "the FDT address via \"fdt addr <address>\" command.\n");
+		return CMD_RET_FAILURE;
+	}
+
+	list_for_each_entry(extension, &extension_list, list)
+		count++;
+	if (!count)
+		return CMD_RET_FAILURE;
+	blobs = calloc(count, sizeof(*blobs));
+	if (!blobs)
+		return CMD_RET_FAILURE;
+
+	i = 0;
+	ret = CMD_RET_SUCCESS;
+	list_for_each_entry(extension, &extension_list, list) {
+		ret = extension_load(extension, &blob, &size);
+		if (ret)
+			break;
+		blobs[i] = malloc(fdt_totalsize(blob));
+		if (!blobs[i]) {
+			ret = CMD_RET_FAILURE;
+			break;
+		}
+		memcpy(blobs[i++], blob, fdt_totalsize(blob));
+		extrasize += size;
+	}
+
+	if (!ret) {
+		fdt_shrink_to_minimum(working_fdt, extrasize);
+
+		/* this prints messages on error */
+		if (fdt_overlay_apply_stack(working_fdt, blobs, count))
+			ret = CMD_RET_FAILURE;
+	}
+
+	while (i)
+		free(blobs[--i]);
+	free(blobs);
+
+	return ret;
+}
+
 static int do_extension_list(struct cmd_tbl *cmdtp, int flag,
 			     int argc, char *const argv[])
 {
@@ -122,7 +194,10 @@ static int do_extension_apply(struct cmd_tbl *cmdtp, int flag,
 	if (argc < 2)
 		return CMD_RET_USAGE;
 
-	if (strcmp(argv[1], "all") == 0) {
+	if (strcmp(argv[1], "all") == 0 &&
+	    IS_ENABLED(CONFIG_OF_LIBFDT_OVERLAY_STACK)) {
+		ret = extension_apply_all();
+	} else if (strcmp(argv[1], "all") == 0) {
 		ret = CMD_RET_FAILURE;
 		list_for_each_entry(extension, &extension_list, list) {
 			ret = extension_apply(extension);
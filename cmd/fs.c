@@ -6,6 +6,7 @@
  */
 
 #include <common.h>
+#include <btrfs.h>
 #include <command.h>
 #include <fs.h>
 
@@ -111,3 +112,56 @@ U_BOOT_CMD(
 	fstypes, 1, 1, do_fstypes_wrapper,
 	"List supported filesystem types", ""
 );
+
+#if CONFIG_IS_ENABLED(FS_LOOKUP_CACHE)
+static int do_fscache(struct cmd_tbl *cmdtp, int flag, int argc,
+		      char *const argv[])
+{
+	struct fs_lookup_stats stats;
+	struct fs_mount_stats mstats;
+	struct btrfs_decomp_stats bstats;
+
+	if (argc == 2 && !strcmp(argv[1], "flush")) {
+		fs_lookup_cache_invalidate_dev(NULL);
+		fs_mount_release();
+		return 0;
+	}
+	if (argc != 1)
+		return CMD_RET_USAGE;
+
+	fs_lookup_cache_stats(&stats);
+	printf("hits: %u\n"
+	       "misses: %u\n"
+	       "entries: %u\n"
+	       "max entries: %u\n"
+	       "invalidations: %u\n",
+	       stats.hits, stats.misses, stats.entries, stats.max_entries,
+	       stats.invalidations);
+
+	if (CONFIG_IS_ENABLED(FS_MOUNT_CACHE)) {
+		fs_mount_stats(&mstats);
+		printf("mounts: %u\n"
+		       "mount reuses: %u\n"
+		       "unmounts: %u\n",
+		       mstats.probes, mstats.reuses, mstats.releases);
+	}
+
+	if (IS_ENABLED(CONFIG_FS_BTRFS)) {
+		btrfs_decomp_stats(&bstats);
+		printf("btrfs extent hits: %u\n"
+		       "btrfs extent misses: %u\n",
+		       bstats.hits, bstats.misses);
+	}
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	fscache, 2, 1, do_fscache,
+	"Show filesystem path lookup cache statistics",
+	"\n"
+	"    - show statistics\n"
+	"fscache flush\n"
+	"    - discard all cached paths and unmount the filesystem kept mounted"
+);
+#endif
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show the time taken by initcalls
+ */
+
+#include <common.h>
+#include <command.h>
+#include <initcall.h>
+
+/* Number of initcalls shown by 'initcall stats' by default */
+#define INITCALL_SHOW_COUNT	20
+
+static int do_initcall_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			     char *const argv[])
+{
+	int count = INITCALL_SHOW_COUNT;
+	bool bootstage = false;
+
+	if (argc > 1 && !strcmp(argv[1], "-b")) {
+		bootstage = true;
+		argc--;
+		argv++;
+	}
+	if (argc > 1)
+		count = dectoul(argv[1], NULL);
+	initcall_stats_show(count, bootstage);
+
+	return 0;
+}
+
+#ifdef CONFIG_SYS_LONGHELP
+static char initcall_help_text[] =
+	"stats [-b] [<count>]  - show the slowest initcalls (-b add to bootstage)";
+#endif
+
+U_BOOT_CMD_WITH_SUBCMDS(initcall, "initcall timing", initcall_help_text,
+	U_BOOT_SUBCMD_MKENT(stats, 3, 1, do_initcall_stats));
@@ -22,6 +22,7 @@
 #endif
 #include <hash.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <rand.h>
 #include <watchdog.h>
@@ -1389,6 +1390,8 @@ static int do_mem_info(struct cmd_tbl *cmdtp, int flag, int argc,
 {
 	puts("DRAM:  ");
 	print_size(gd->ram_size, "\n");
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB))
+		malloc_slab_info();
 
 	return 0;
 }
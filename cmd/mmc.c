@@ -9,11 +9,14 @@
 #include <command.h>
 #include <console.h>
 #include <display_options.h>
+#include <div64.h>
+#include <mapmem.h>
 #include <memalign.h>
 #include <mmc.h>
 #include <part.h>
 #include <sparse_format.h>
 #include <image-sparse.h>
+#include <time.h>
 
 static int curr_device = -1;
 
@@ -371,6 +374,63 @@ static int do_mmc_read(struct cmd_tbl *cmdtp, int flag,
 	return (n == cnt) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
 }
 
+#if CONFIG_IS_ENABLED(CMD_MMC_BENCH)
+static int do_mmc_bench(struct cmd_tbl *cmdtp, int flag,
+			int argc, char *const argv[])
+{
+	struct blk_desc *desc;
+	struct mmc *mmc;
+	u32 blk, cnt, size, done, n;
+	ulong start, us;
+	u64 kbps;
+	void *addr;
+	int ret = CMD_RET_SUCCESS;
+
+	if (argc != 4)
+		return CMD_RET_USAGE;
+
+	blk = hextoul(argv[2], NULL);
+	cnt = hextoul(argv[3], NULL);
+	if (!cnt)
+		return CMD_RET_USAGE;
+
+	mmc = init_mmc_device(curr_device, false);
+	if (!mmc)
+		return CMD_RET_FAILURE;
+	desc = mmc_get_blk_desc(mmc);
+	addr = map_sysmem(hextoul(argv[1], NULL), (ulong)cnt * desc->blksz);
+
+	printf("Reading %d blocks from block %d in transfers of:\n", cnt, blk);
+	printf("%10s %12s %12s\n", "blocks", "time (us)", "KiB/s");
+	/* double the transfer size each time, finishing with all blocks */
+	for (size = 1; ; size = min(size * 2, cnt)) {
+		start = timer_get_us();
+		for (done = 0; done < cnt; done += n) {
+			n = min(cnt - done, size);
+			if (blk_dread(desc, blk + done, n,
+				      addr + done * desc->blksz) != n) {
+				printf("Read failed at block %d\n", blk + done);
+				ret = CMD_RET_FAILURE;
+				goto out;
+			}
+			if (ctrlc()) {
+				ret = CMD_RET_FAILURE;
+				goto out;
+			}
+		}
+		us = max(timer_get_us() - start, 1UL);
+		kbps = lldiv((u64)cnt * desc->blksz * 1000000 / 1024, us);
+		printf("%10d %12lu %12llu\n", size, us, kbps);
+		if (size == cnt)
+			break;
+	}
+out:
+	unmap_sysmem(addr);
+
+	return ret;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(CMD_MMC_SWRITE)
 static lbaint_t mmc_sparse_write(struct sparse_storage *info, lbaint_t blk,
 				 lbaint_t blkcnt, const void *buffer)
@@ -1113,6 +1173,9 @@ static int do_mmc_boot_wp(struct cmd_tbl *cmdtp, int flag,
 static struct cmd_tbl cmd_mmc[] = {
 	U_BOOT_CMD_MKENT(info, 1, 0, do_mmcinfo, "", ""),
 	U_BOOT_CMD_MKENT(read, 4, 1, do_mmc_read, "", ""),
+#if CONFIG_IS_ENABLED(CMD_MMC_BENCH)
+	U_BOOT_CMD_MKENT(bench, 4, 1, do_mmc_bench, "", ""),
+#endif
 	U_BOOT_CMD_MKENT(wp, 2, 0, do_mmc_boot_wp, "", ""),
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 	U_BOOT_CMD_MKENT(write, 4, 0, do_mmc_write, "", ""),
@@ -1176,6 +1239,9 @@ U_BOOT_CMD(
 	"MMC sub system",
 	"info - display info of the current MMC device\n"
 	"mmc read addr blk# cnt\n"
+#if CONFIG_IS_ENABLED(CMD_MMC_BENCH)
+	"mmc bench addr blk# cnt - time reads using increasing transfer sizes\n"
+#endif
 	"mmc write addr blk# cnt\n"
 #if CONFIG_IS_ENABLED(CMD_MMC_SWRITE)
 	"mmc swrite addr blk#\n"
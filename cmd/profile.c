@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Control of the sampling profiler
+ */
+
+#include <common.h>
+#include <command.h>
+#include <env.h>
+#include <mapmem.h>
+#include <profile.h>
+
+/* Number of call stacks shown by 'profile stats' by default */
+#define PROFILE_SHOW_STACKS	10
+
+static int do_profile_start(struct cmd_tbl *cmdtp, int flag, int argc,
+			    char *const argv[])
+{
+	uint interval_us = 0;
+	int ret;
+
+	if (argc > 1)
+		interval_us = dectoul(argv[1], NULL);
+	ret = profile_start(interval_us);
+	if (ret) {
+		printf("Cannot start profiling (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static int do_profile_stop(struct cmd_tbl *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	profile_stop();
+
+	return 0;
+}
+
+static int do_profile_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			    char *const argv[])
+{
+	int count = PROFILE_SHOW_STACKS;
+
+	if (argc > 1)
+		count = dectoul(argv[1], NULL);
+	profile_print_stats(count);
+
+	return 0;
+}
+
+/*
+ * This uses the same buffer as the 'trace' command, so that the samples can be
+ * written after the function-call records and read by proftool in one file
+ */
+static int do_profile_dump(struct cmd_tbl *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	size_t buff_size, avail, buff_ptr, needed, used;
+	char *buff;
+	int ret;
+
+	if (argc > 1 && argc < 3)
+		return CMD_RET_USAGE;
+	if (argc < 3) {
+		buff_size = env_get_ulong("profsize", 16, 0);
+		buff = map_sysmem(env_get_ulong("profbase", 16, 0), buff_size);
+		buff_ptr = env_get_ulong("profoffset", 16, 0);
+	} else {
+		buff_size = hextoul(argv[2], NULL);
+		buff = map_sysmem(hextoul(argv[1], NULL), buff_size);
+		buff_ptr = 0;
+	}
+	if (!buff_size || buff_ptr > buff_size) {
+		printf("No buffer\n");
+		return CMD_RET_FAILURE;
+	}
+
+	avail = buff_size - buff_ptr;
+	ret = profile_list_samples(buff + buff_ptr, avail, &needed);
+	if (ret == -ENOENT) {
+		printf("Profiling has not been started\n");
+		return CMD_RET_FAILURE;
+	} else if (ret) {
+		printf("Error: truncated (%#zx bytes needed)\n", needed);
+	}
+	used = min(avail, needed);
+	printf("Samples dumped to %08lx, size %#zx\n",
+	       (ulong)map_to_sysmem(buff + buff_ptr), used);
+
+	env_set_hex("profbase", map_to_sysmem(buff));
+	env_set_hex("profsize", buff_size);
+	env_set_hex("profoffset", buff_ptr + used);
+
+	return 0;
+}
+
+#ifdef CONFIG_SYS_LONGHELP
+static char profile_help_text[] =
+	"start [<interval_us>]        - start sampling, discarding old samples\n"
+	"profile stop                 - stop sampling\n"
+	"profile stats [<count>]      - show the busiest call stacks\n"
+	"profile dump [<addr> <size>] - write samples into buffer for proftool";
+#endif
+
+U_BOOT_CMD_WITH_SUBCMDS(profile, "sampling profiler", profile_help_text,
+	U_BOOT_SUBCMD_MKENT(start, 2, 1, do_profile_start),
+	U_BOOT_SUBCMD_MKENT(stop, 1, 1, do_profile_stop),
+	U_BOOT_SUBCMD_MKENT(stats, 2, 1, do_profile_stats),
+	U_BOOT_SUBCMD_MKENT(dump, 3, 1, do_profile_dump));
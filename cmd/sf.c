@@ -13,6 +13,7 @@
 #include <log.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <mtd.h>
 #include <spi.h>
 #include <spi_flash.h>
 #include <asm/cache.h>
@@ -24,6 +25,9 @@
 
 #include "legacy-mtd-utils.h"
 
+/* Number of sectors 'sf update' hands to the MTD layer at once */
+#define SF_UPDATE_SECTORS	16
+
 static struct spi_flash *flash;
 
 /*
@@ -209,6 +213,24 @@ static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
 	return NULL;
 }
 
+/*
+ * Update a run of sectors through the MTD layer, which also avoids erasing
+ * sectors that can be programmed directly and merges neighbouring writes
+ */
+static const char *spi_flash_update_run(struct spi_flash *flash, u32 offset,
+					size_t len, const char *buf,
+					size_t *skipped)
+{
+	struct mtd_update_stats stats;
+
+	if (mtd_update(&flash->mtd, offset, len, 0, (const u_char *)buf, 0,
+		       &stats))
+		return "update";
+	*skipped += stats.skipped;
+
+	return NULL;
+}
+
 /**
  * Update an area of SPI flash by erasing and writing any blocks which need
  * to change. Existing blocks with the correct data are left unchanged.
@@ -226,6 +248,7 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 	char *cmp_buf;
 	const char *end = buf + len;
 	size_t todo;		/* number of bytes to do in this pass */
+	size_t step;		/* maximum bytes in each pass */
 	size_t skipped = 0;	/* statistics */
 	const ulong start_time = get_timer(0);
 	size_t scale = 1;
@@ -234,14 +257,15 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 
 	if (end - buf >= 200)
 		scale = (end - buf) / 100;
+	step = flash->sector_size;
+	if (IS_ENABLED(CONFIG_MTD))
+		step *= SF_UPDATE_SECTORS;
 	cmp_buf = memalign(ARCH_DMA_MINALIGN, flash->sector_size);
 	if (cmp_buf) {
 		ulong last_update = get_timer(0);
 
 		for (; buf < end && !err_oper; buf += todo, offset += todo) {
-			todo = min_t(size_t, end - buf, flash->sector_size);
-			todo = min_t(size_t, end - buf,
-				     flash->sector_size - (offset % flash->sector_size));
+			todo = min_t(size_t, end - buf, step - (offset % step));
 			if (get_timer(last_update) > 100) {
 				printf("   \rUpdating, %zu%% %lu B/s",
 				       100 - (end - buf) / scale,
@@ -249,8 +273,12 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 							 start_time));
 				last_update = get_timer(0);
 			}
-			err_oper = spi_flash_update_block(flash, offset, todo,
-					buf, cmp_buf, &skipped);
+			if (IS_ENABLED(CONFIG_MTD))
+				err_oper = spi_flash_update_run(flash, offset,
+						todo, buf, &skipped);
+			else
+				err_oper = spi_flash_update_block(flash, offset,
+						todo, buf, cmp_buf, &skipped);
 		}
 	} else {
 		err_oper = "malloc";
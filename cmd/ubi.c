@@ -502,7 +502,8 @@ int ubi_volume_read(char *volume, char *buf, size_t size)
 	return err;
 }
 
-static int ubi_dev_scan(struct mtd_info *info, const char *vid_header_offset)
+static int ubi_dev_scan(struct mtd_info *info, const char *vid_header_offset,
+			bool force_scan)
 {
 	char ubi_mtd_param_buffer[80];
 	int err;
@@ -517,7 +518,9 @@ static int ubi_dev_scan(struct mtd_info *info, const char *vid_header_offset)
 	if (err)
 		return -err;
 
+	ubi_force_scan = force_scan;
 	err = ubi_init();
+	ubi_force_scan = false;
 	if (err)
 		return -err;
 
@@ -571,12 +574,43 @@ static int ubi_detach(void)
 	return 0;
 }
 
-int ubi_part(char *part_name, const char *vid_header_offset)
+#ifdef CONFIG_MTD_UBI_FASTMAP
+static int ubi_write_fastmap(void)
+{
+	int err;
+
+	if (ubi->ro_mode) {
+		printf("UBI device is read-only\n");
+		return 1;
+	}
+
+	if ((int)mtd_div_by_eb(ubi->mtd->size, ubi->mtd) <= UBI_FM_MAX_START) {
+		printf("More than %d PEBs are needed for fastmap\n",
+		       UBI_FM_MAX_START);
+		return 1;
+	}
+
+	/* Keep the fastmap up to date from now on, as fm_autoconvert does */
+	ubi->fm_disabled = 0;
+	err = ubi_update_fastmap(ubi);
+	if (err || !ubi->fm) {
+		printf("Failed to write fastmap, err %d\n", err);
+		return 1;
+	}
+	printf("Fastmap written, anchor at PEB %d\n", ubi->fm->e[0]->pnum);
+
+	return 0;
+}
+#endif
+
+static int __ubi_part(char *part_name, const char *vid_header_offset,
+		      bool force_scan)
 {
 	struct mtd_info *mtd;
 	int err = 0;
 
-	if (ubi && ubi->mtd && !strcmp(ubi->mtd->name, part_name)) {
+	if (!force_scan && ubi && ubi->mtd &&
+	    !strcmp(ubi->mtd->name, part_name)) {
 		printf("UBI partition '%s' already selected\n", part_name);
 		return 0;
 	}
@@ -591,7 +625,7 @@ int ubi_part(char *part_name, const char *vid_header_offset)
 	}
 	put_mtd_device(mtd);
 
-	err = ubi_dev_scan(mtd, vid_header_offset);
+	err = ubi_dev_scan(mtd, vid_header_offset, force_scan);
 	if (err) {
 		printf("UBI init error %d\n", err);
 		printf("Please check, if the correct MTD partition is used (size big enough?)\n");
@@ -603,6 +637,11 @@ int ubi_part(char *part_name, const char *vid_header_offset)
 	return 0;
 }
 
+int ubi_part(char *part_name, const char *vid_header_offset)
+{
+	return __ubi_part(part_name, vid_header_offset, false);
+}
+
 static int do_ubi(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 {
 	int64_t size = 0;
@@ -617,6 +656,7 @@ static int do_ubi(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 
 	if (strcmp(argv[1], "part") == 0) {
 		const char *vid_header_offset = NULL;
+		bool force_scan = false;
 
 		/* Print current partition */
 		if (argc == 2) {
@@ -633,10 +673,15 @@ static int do_ubi(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 		if (argc < 3)
 			return CMD_RET_USAGE;
 
+		if (argc > 3 && !strcmp(argv[argc - 1], "--scan")) {
+			force_scan = true;
+			argc--;
+		}
+
 		if (argc > 3)
 			vid_header_offset = argv[3];
 
-		return ubi_part(argv[2], vid_header_offset);
+		return __ubi_part(argv[2], vid_header_offset, force_scan);
 	}
 
 	if ((strcmp(argv[1], "part") != 0) && !ubi) {
@@ -666,6 +711,11 @@ static int do_ubi(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 		return ubi_list(argv[numeric ? 3 : 2], numeric);
 	}
 
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	if (strcmp(argv[1], "fastmap") == 0)
+		return ubi_write_fastmap();
+#endif
+
 	if (strcmp(argv[1], "check") == 0) {
 		if (argc > 2)
 			return ubi_check(argv[2]);
@@ -800,9 +850,9 @@ U_BOOT_CMD(
 	"ubi commands",
 	"detach"
 		" - detach ubi from a mtd partition\n"
-	"ubi part [part] [offset]\n"
+	"ubi part [part] [offset] [--scan]\n"
 		" - Show or set current partition (with optional VID"
-		" header offset)\n"
+		" header offset, --scan to scan even if not needed)\n"
 	"ubi info [l[ayout]]"
 		" - Display volume and ubi layout information\n"
 	"ubi list [flags]"
@@ -812,6 +862,10 @@ U_BOOT_CMD(
 		" (flags can be -numeric)\n"
 	"ubi check volumename"
 		" - check if volumename exists\n"
+#ifdef CONFIG_MTD_UBI_FASTMAP
+	"ubi fastmap"
+		" - write a fastmap now and keep it up to date\n"
+#endif
 	"ubi create[vol] volume [size] [type] [id] [--skipcheck]\n"
 		" - create volume name with size ('-' for maximum"
 		" available size)\n"
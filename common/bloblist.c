@@ -52,6 +52,7 @@ static struct tag_name {
 	/* BLOBLISTT_PROJECT_AREA */
 	{ BLOBLISTT_U_BOOT_SPL_HANDOFF, "SPL hand-off" },
 	{ BLOBLISTT_U_BOOT_VIDEO, "SPL video handoff" },
+	{ BLOBLISTT_U_BOOT_BOOTSTAGE_TRACE, "Bootstage trace" },
 
 	/* BLOBLISTT_VENDOR_AREA */
 };
@@ -574,6 +574,20 @@ static int reserve_bootstage(void)
 	return 0;
 }
 
+static int reserve_initcall_stats(void)
+{
+#ifdef CONFIG_INITCALL_STATS
+	int size = initcall_stats_get_size();
+
+	gd->start_addr_sp = reserve_stack_aligned(size);
+	gd->new_initcall_stats = map_sysmem(gd->start_addr_sp, size);
+	debug("Reserving %#x Bytes for initcall stats at: %08lx\n", size,
+	      gd->start_addr_sp);
+#endif
+
+	return 0;
+}
+
 __weak int arch_reserve_stacks(void)
 {
 	return 0;
@@ -651,6 +665,21 @@ static int reloc_fdt(void)
 	return 0;
 }
 
+static int reloc_initcall_stats(void)
+{
+#ifdef CONFIG_INITCALL_STATS
+	if (gd->flags & GD_FLG_SKIP_RELOC)
+		return 0;
+	if (gd->initcall_stats && gd->new_initcall_stats) {
+		memcpy(gd->new_initcall_stats, gd->initcall_stats,
+		       initcall_stats_get_size());
+		gd->initcall_stats = gd->new_initcall_stats;
+	}
+#endif
+
+	return 0;
+}
+
 static int reloc_bootstage(void)
 {
 #ifdef CONFIG_BOOTSTAGE
@@ -772,6 +801,17 @@ static int jump_to_copy(void)
 }
 #endif
 
+#ifdef CONFIG_INITCALL_STATS
+static int initf_initcall_stats(void)
+{
+	/* initcalls can run without being recorded */
+	if (initcall_stats_init())
+		log_warning("No space to record initcalls\n");
+
+	return 0;
+}
+#endif
+
 /* Record the board_init_f() bootstage (after arch_cpu_init()) */
 static int initf_bootstage(void)
 {
@@ -842,13 +882,16 @@ static int misc_init_f(void)
 
 static const init_fnc_t init_sequence_f[] = {
 	setup_mon_len,
+	initf_malloc,		/* fdtdec_setup() may allocate an FDT index */
+#ifdef CONFIG_INITCALL_STATS
+	initf_initcall_stats,
+#endif
 #ifdef CONFIG_OF_CONTROL
 	fdtdec_setup,
 #endif
 #ifdef CONFIG_TRACE_EARLY
 	trace_early_init,
 #endif
-	initf_malloc,
 	log_init,
 	initf_bootstage,	/* uses its own timer, so does not need DM */
 	event_init,
@@ -950,6 +993,7 @@ static const init_fnc_t init_sequence_f[] = {
 	reserve_global_data,
 	reserve_fdt,
 	reserve_bootstage,
+	reserve_initcall_stats,
 	reserve_bloblist,
 	reserve_arch,
 	reserve_stacks,
@@ -961,6 +1005,7 @@ static const init_fnc_t init_sequence_f[] = {
 	INIT_FUNC_WATCHDOG_RESET
 	reloc_fdt,
 	reloc_bootstage,
+	reloc_initcall_stats,
 	reloc_bloblist,
 	setup_reloc,
 #if defined(CONFIG_X86) || defined(CONFIG_ARC)
@@ -58,6 +58,7 @@
 #include <xen.h>
 #include <asm/sections.h>
 #include <dm/root.h>
+#include <dm/of_access.h>
 #include <dm/ofnode.h>
 #include <linux/compiler.h>
 #include <linux/err.h>
@@ -222,6 +223,15 @@ static int initr_of_live(void)
 		bootstage_start(BOOTSTAGE_ID_ACCUM_OF_LIVE, "of_live");
 		ret = of_live_build(gd->fdt_blob,
 				    (struct device_node **)gd_of_root_ptr());
+		/*
+		 * Only the control tree has a phandle table. Lookups still work
+		 * without it, just more slowly. A lazy tree looks up phandles
+		 * in the flat tree instead, since building the table would
+		 * create every node.
+		 */
+		if (!ret && !CONFIG_IS_ENABLED(OF_LIVE_LAZY) &&
+		    of_phandle_table_build(gd_of_root()))
+			debug("Failed to build phandle table\n");
 		bootstage_accum(BOOTSTAGE_ID_ACCUM_OF_LIVE);
 		if (ret)
 			return ret;
@@ -279,7 +289,12 @@ static int initr_dm_devices(void)
 
 static int initr_bootstage(void)
 {
+	int ret;
+
 	bootstage_mark_name(BOOTSTAGE_ID_START_UBOOT_R, "board_init_r");
+	ret = bootstage_span_init_r();
+	if (ret)
+		log_warning("Cannot allocate bootstage spans (err=%d)\n", ret);
 
 	return 0;
 }
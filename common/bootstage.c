@@ -12,8 +12,10 @@
 #define LOG_CATEGORY	LOGC_BOOT
 
 #include <common.h>
+#include <bloblist.h>
 #include <bootstage.h>
 #include <hang.h>
+#include <kallsyms.h>
 #include <log.h>
 #include <malloc.h>
 #include <sort.h>
@@ -26,6 +28,9 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
+
+	/* Number of entries in the index, kept well above the record count */
+	RECORD_INDEX_SIZE = RECORD_COUNT * 2,
 };
 
 struct bootstage_record {
@@ -36,10 +41,35 @@ struct bootstage_record {
 	enum bootstage_id id;
 };
 
+/**
+ * struct bootstage_data - bootstage records
+ *
+ * @rec_count: Number of records used
+ * @next_id: Next ID to allocate with BOOTSTAGE_ID_ALLOC
+ * @record: Records, in the order they were added unless sorted for a report
+ * @index: Hash table to find a record by ID, with each entry holding the
+ *	record number plus one, or 0 if unused. Entries start at the position
+ *	given by the ID modulo RECORD_INDEX_SIZE, moving up on a collision
+ * @span: Spans recorded, either @span_f or a larger area after relocation
+ * @span_count: Number of spans used
+ * @span_max: Number of spans available in @span
+ * @span_cur: Current (innermost open) span number plus one, or 0 if none
+ * @spans_dropped: Number of spans not recorded since @span was full
+ * @span_f: Space for spans before relocation
+ */
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
 	struct bootstage_record record[RECORD_COUNT];
+	u16 index[RECORD_INDEX_SIZE];
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	struct bootstage_span *span;
+	uint span_count;
+	uint span_max;
+	uint span_cur;
+	ulong spans_dropped;
+	struct bootstage_span span_f[CONFIG_BOOTSTAGE_SPAN_COUNT_F];
+#endif
 };
 
 enum {
@@ -78,17 +108,53 @@ int bootstage_relocate(void)
 		ptr += strlen(ptr) + 1;
 	}
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	/* Spans are only moved out of this struct after relocation */
+	data->span = data->span_f;
+#endif
+
 	return 0;
 }
 
+/**
+ * index_add() - Add a record to the index
+ *
+ * @data: Bootstage data
+ * @recnum: Record number to add
+ */
+static void index_add(struct bootstage_data *data, uint recnum)
+{
+	uint pos = (uint)data->record[recnum].id % RECORD_INDEX_SIZE;
+
+	while (data->index[pos])
+		pos = (pos + 1) % RECORD_INDEX_SIZE;
+	data->index[pos] = recnum + 1;
+}
+
+/**
+ * index_rebuild() - Rebuild the index after the records have been changed
+ *
+ * @data: Bootstage data
+ */
+static void index_rebuild(struct bootstage_data *data)
+{
+	uint i;
+
+	memset(data->index, '\0', sizeof(data->index));
+	for (i = 0; i < data->rec_count; i++)
+		index_add(data, i);
+}
+
 struct bootstage_record *find_id(struct bootstage_data *data,
 				 enum bootstage_id id)
 {
-	struct bootstage_record *rec;
-	struct bootstage_record *end;
+	uint pos;
+
+	for (pos = (uint)id % RECORD_INDEX_SIZE; data->index[pos];
+	     pos = (pos + 1) % RECORD_INDEX_SIZE) {
+		struct bootstage_record *rec;
 
-	for (rec = data->record, end = rec + data->rec_count; rec < end;
-	     rec++) {
+		rec = &data->record[data->index[pos] - 1];
 		if (rec->id == id)
 			return rec;
 	}
@@ -103,8 +169,9 @@ struct bootstage_record *ensure_id(struct bootstage_data *data,
 
 	rec = find_id(data, id);
 	if (!rec && data->rec_count < RECORD_COUNT) {
-		rec = &data->record[data->rec_count++];
+		rec = &data->record[data->rec_count];
 		rec->id = id;
+		index_add(data, data->rec_count++);
 		return rec;
 	}
 
@@ -131,11 +198,12 @@ ulong bootstage_add_record(enum bootstage_id id, const char *name,
 	rec = find_id(data, id);
 	if (!rec) {
 		if (data->rec_count < RECORD_COUNT) {
-			rec = &data->record[data->rec_count++];
+			rec = &data->record[data->rec_count];
 			rec->time_us = mark;
 			rec->name = name;
 			rec->flags = flags;
 			rec->id = id;
+			index_add(data, data->rec_count++);
 		} else {
 			log_warning("Bootstage space exhasuted\n");
 		}
@@ -218,6 +286,37 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+int bootstage_add_time(const char *name, ulong time_us)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	int i;
+
+	if (!data)
+		return -ENOENT;
+	for (i = 0; i < data->rec_count; i++) {
+		rec = &data->record[i];
+		if ((rec->flags & BOOTSTAGEF_TIME) && !strcmp(rec->name, name)) {
+			rec->time_us = time_us;
+			return 0;
+		}
+	}
+	if (data->rec_count == RECORD_COUNT)
+		return -ENOSPC;
+	name = strdup(name);
+	if (!name)
+		return -ENOMEM;
+	rec = ensure_id(data, data->next_id++);
+	rec->time_us = time_us;
+	rec->name = name;
+	rec->flags = BOOTSTAGEF_TIME;
+
+	/* A start time marks this as accumulated time, not a mark */
+	rec->start_us = timer_get_boot_us() ?: 1;
+
+	return 0;
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -342,6 +441,7 @@ void bootstage_report(void)
 
 	/* Sort records by increasing time */
 	qsort(data->record, data->rec_count, sizeof(*rec), h_compare_record);
+	index_rebuild(data);
 
 	for (i = 1, rec++; i < data->rec_count; i++, rec++) {
 		if (rec->id && !rec->start_us)
@@ -497,6 +597,7 @@ int bootstage_unstash(const void *base, int size)
 	/* Mark the records as read */
 	data->rec_count += hdr->count;
 	data->next_id = hdr->next_id;
+	index_rebuild(data);
 	debug("Unstashed %d records\n", hdr->count);
 
 	return 0;
@@ -527,6 +628,10 @@ int bootstage_init(bool first)
 		return -ENOMEM;
 	data = gd->bootstage;
 	memset(data, '\0', size);
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	data->span = data->span_f;
+	data->span_max = CONFIG_BOOTSTAGE_SPAN_COUNT_F;
+#endif
 	if (first) {
 		data->next_id = BOOTSTAGE_ID_USER;
 		bootstage_add_record(BOOTSTAGE_ID_AWAKE, "reset", 0, 0);
@@ -534,3 +639,265 @@ int bootstage_init(bool first)
 
 	return 0;
 }
+
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+static const char *const span_cat_name[] = {
+	[BOOTSTAGE_SPAN_OTHER]		= "other",
+	[BOOTSTAGE_SPAN_INITCALL]	= "initcall",
+	[BOOTSTAGE_SPAN_PROBE]		= "probe",
+	[BOOTSTAGE_SPAN_BOOTMETH]	= "bootmeth",
+};
+
+static int span_add(enum bootstage_span_cat cat, const char *name, ulong func)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_span *span;
+
+	if (!data)
+		return -ENOENT;
+	if (data->span_count == data->span_max) {
+		data->spans_dropped++;
+		return -ENOSPC;
+	}
+	span = &data->span[data->span_count];
+	span->parent = data->span_cur;
+	span->cat = cat;
+	span->flags = BOOTSTAGE_SPANF_OPEN;
+	span->func = func;
+	strlcpy(span->name, name, sizeof(span->name));
+	data->span_cur = ++data->span_count;
+	span->start_us = timer_get_boot_us();
+	span->end_us = span->start_us;
+
+	return data->span_count - 1;
+}
+
+int bootstage_span_begin(enum bootstage_span_cat cat, const char *name)
+{
+	return span_add(cat, name, 0);
+}
+
+int bootstage_span_begin_func(enum bootstage_span_cat cat, const void *func)
+{
+	return span_add(cat, "", code_offset((ulong)func));
+}
+
+void bootstage_span_end(int spannum)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_span *span;
+	uint cur;
+
+	if (!data || spannum < 0 || spannum >= data->span_count)
+		return;
+	span = &data->span[spannum];
+	if (!(span->flags & BOOTSTAGE_SPANF_OPEN))
+		return;
+	span->end_us = timer_get_boot_us();
+	span->flags &= ~BOOTSTAGE_SPANF_OPEN;
+
+	/*
+	 * If this span contains the current one, its parent becomes current.
+	 * Any spans inside it which were not ended are left open.
+	 */
+	for (cur = data->span_cur; cur; cur = data->span[cur - 1].parent) {
+		if (cur == spannum + 1) {
+			data->span_cur = span->parent;
+			break;
+		}
+	}
+}
+
+const struct bootstage_span *bootstage_get_span(int spannum)
+{
+	struct bootstage_data *data = gd->bootstage;
+
+	if (!data || spannum < 0 || spannum >= data->span_count)
+		return NULL;
+
+	return &data->span[spannum];
+}
+
+int bootstage_span_init_r(void)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_span *span;
+	uint max;
+
+	if (!data || data->span != data->span_f)
+		return 0;
+	max = max_t(uint, CONFIG_BOOTSTAGE_SPAN_COUNT, data->span_count);
+	span = calloc(max, sizeof(*span));
+	if (!span)
+		return -ENOMEM;
+	memcpy(span, data->span, data->span_count * sizeof(*span));
+	data->span = span;
+	data->span_max = max;
+
+	return 0;
+}
+
+/**
+ * get_span_name() - Get the name of a span as a printable string
+ *
+ * @span: Span to check
+ * @buf: Buffer to use if the name must be worked out
+ * @size: Size of @buf
+ * Return: name of span, either from the span or in @buf
+ */
+static const char *get_span_name(const struct bootstage_span *span, char *buf,
+				 int size)
+{
+	if (*span->name)
+		return span->name;
+
+	return symbol_name_offset(span->func, buf, size);
+}
+
+/* Get the time taken by a span, using the current time if it is still open */
+static uint span_time(const struct bootstage_span *span)
+{
+	if (span->flags & BOOTSTAGE_SPANF_OPEN)
+		return (uint32_t)timer_get_boot_us() - span->start_us;
+
+	return span->end_us - span->start_us;
+}
+
+void bootstage_span_report(uint min_us)
+{
+	struct bootstage_data *data = gd->bootstage;
+	char buf[20];
+	uint i;
+
+	printf("Spans in microseconds (%d spans, %lu dropped):\n",
+	       data->span_count, data->spans_dropped);
+	printf("%11s%11s  %s\n", "Start", "Time", "Span");
+	for (i = 0; i < data->span_count; i++) {
+		const struct bootstage_span *span = &data->span[i];
+		bool show = true;
+		int depth = 0;
+		uint parent;
+
+		/* Skip short spans, along with everything inside them */
+		for (parent = i + 1; parent;
+		     parent = data->span[parent - 1].parent, depth++) {
+			if (span_time(&data->span[parent - 1]) < min_us)
+				show = false;
+		}
+		if (!show)
+			continue;
+		print_grouped_ull(span->start_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(span_time(span), BOOTSTAGE_DIGITS);
+		printf("  %*s%s%s\n", (depth - 1) * 2, "",
+		       get_span_name(span, buf, sizeof(buf)),
+		       span->flags & BOOTSTAGE_SPANF_OPEN ? " (open)" : "");
+	}
+}
+
+/**
+ * struct trace_json - output buffer for bootstage_trace_json()
+ *
+ * @buf: Buffer to write to, or NULL if none
+ * @size: Size of @buf
+ * @len: Length of the output so far, which may be larger than @size
+ */
+struct trace_json {
+	char *buf;
+	int size;
+	int len;
+};
+
+static void json_printf(struct trace_json *js, const char *fmt, ...)
+{
+	bool space = js->buf && js->len < js->size;
+	va_list args;
+
+	va_start(args, fmt);
+	js->len += vsnprintf(space ? js->buf + js->len : NULL,
+			     space ? js->size - js->len : 0, fmt, args);
+	va_end(args);
+}
+
+/* Write a string, escaping characters as needed by JSON */
+static void json_str(struct trace_json *js, const char *str)
+{
+	json_printf(js, "\"");
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			json_printf(js, "\\%c", *str);
+		else if ((uchar)*str < ' ')
+			json_printf(js, "\\u%04x", *str);
+		else
+			json_printf(js, "%c", *str);
+	}
+	json_printf(js, "\"");
+}
+
+int bootstage_trace_json(char *buf, int size)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct trace_json js = { buf, size };
+	const char *sep = "";
+	char name[20];
+	uint i;
+
+	json_printf(&js, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (i = 0; data && i < data->rec_count; i++) {
+		const struct bootstage_record *rec = &data->record[i];
+
+		/* Accumulated records have no particular time */
+		if (rec->start_us)
+			continue;
+		json_printf(&js, "%s\n{\"name\":", sep);
+		json_str(&js, get_record_name(name, sizeof(name), rec));
+		json_printf(&js, ",\"cat\":\"bootstage\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%lu,\"pid\":0,\"tid\":0,\"args\":{\"id\":%d}}",
+			    rec->time_us, rec->id);
+		sep = ",";
+	}
+
+	/* Open spans are given no duration, so the length stays the same */
+	for (i = 0; data && i < data->span_count; i++) {
+		const struct bootstage_span *span = &data->span[i];
+		bool open = span->flags & BOOTSTAGE_SPANF_OPEN;
+
+		json_printf(&js, "%s\n{\"name\":", sep);
+		json_str(&js, get_span_name(span, name, sizeof(name)));
+		json_printf(&js, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%u,\"dur\":%u,\"pid\":0,\"tid\":0,\"args\":{\"span\":%u,\"parent\":%d%s}}",
+			    span->cat < ARRAY_SIZE(span_cat_name) ?
+			    span_cat_name[span->cat] : "other",
+			    span->start_us,
+			    open ? 0 : span->end_us - span->start_us, i,
+			    span->parent - 1, open ? ",\"open\":true" : "");
+		sep = ",";
+	}
+	json_printf(&js, "\n]}\n");
+
+	return js.len;
+}
+
+int bootstage_trace_bloblist(void)
+{
+	int len, size, ret;
+	void *buf;
+
+	if (!IS_ENABLED(CONFIG_BLOBLIST))
+		return -ENOSYS;
+	len = bootstage_trace_json(NULL, 0);
+	size = len + 1;
+	ret = bloblist_ensure_size_ret(BLOBLISTT_U_BOOT_BOOTSTAGE_TRACE, &size,
+				       &buf);
+	if (ret)
+		return log_msg_ret("btr", ret);
+
+	/* Replace any output from an earlier boot attempt */
+	if (size != len + 1) {
+		ret = bloblist_resize(BLOBLISTT_U_BOOT_BOOTSTAGE_TRACE, len + 1);
+		if (ret)
+			return log_msg_ret("btz", ret);
+		buf = bloblist_find(BLOBLISTT_U_BOOT_BOOTSTAGE_TRACE, len + 1);
+	}
+	bootstage_trace_json(buf, len + 1);
+
+	return 0;
+}
+#endif
@@ -11,6 +11,7 @@
 #include <cyclic.h>
 #include <log.h>
 #include <malloc.h>
+#include <profile.h>
 #include <time.h>
 #include <linux/errno.h>
 #include <linux/list.h>
@@ -111,6 +112,11 @@ void schedule(void)
 	 */
 	if (gd)
 		cyclic_run();
+
+	/* Sample the caller of this function, if profiling */
+	if (CONFIG_IS_ENABLED(PROFILE))
+		profile_sample(__builtin_return_address(0),
+			       __builtin_frame_address(0));
 }
 
 int cyclic_unregister_all(void)
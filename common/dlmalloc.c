@@ -17,6 +17,7 @@
 #endif
 
 #include <malloc.h>
+#include <mapmem.h>
 #include <asm/io.h>
 #include <valgrind/memcheck.h>
 
@@ -599,6 +600,14 @@ ulong mem_malloc_brk = 0;
 static bool malloc_testing;	/* enable test mode */
 static int malloc_max_allocs;	/* return NULL after this many calls to malloc() */
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+static bool malloc_slab_bypass;	/* don't serve requests from the slab */
+static bool malloc_slab_refill;	/* the slab is taking memory for itself */
+#else
+#define malloc_slab_bypass	true
+#define malloc_slab_refill	false
+#endif
+
 void *sbrk(ptrdiff_t increment)
 {
 	ulong old = mem_malloc_brk;
@@ -635,6 +644,77 @@ void mem_malloc_init(ulong start, ulong size)
 	memset((void *)mem_malloc_start, 0x0, size);
 #endif
 	malloc_bin_reloc();
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	malloc_slab_reset();
+#endif
+}
+
+ulong malloc_heap_used(void)
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return gd->malloc_ptr;
+#endif
+
+	return mem_malloc_brk - mem_malloc_start;
+}
+
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+/*
+ * malloc_simple_size() - Check for a block allocated before relocation
+ *
+ * Blocks handed out by malloc_simple() stay where they are once the full
+ * allocator is running, since there is no way to update the pointers to them.
+ * This recognises them, so that free() and realloc() can cope.
+ *
+ * Returns the number of bytes from @mem to the end of the pre-relocation
+ * area's used space, or 0 if @mem is not in that area.
+ */
+static size_t malloc_simple_size(Void_t *mem)
+{
+	char *start, *end;
+
+	if ((ulong)mem >= mem_malloc_start && (ulong)mem < mem_malloc_end)
+		return 0;
+	start = map_sysmem(gd->malloc_base, gd->malloc_ptr);
+	end = start + gd->malloc_ptr;
+	if ((char *)mem < start || (char *)mem >= end)
+		return 0;
+
+	return end - (char *)mem;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+void *malloc_slab_get_mem(size_t align, size_t bytes)
+{
+	void *ptr;
+
+	malloc_slab_bypass = true;
+	malloc_slab_refill = true;
+	ptr = mEMALIGn(align, bytes);
+	malloc_slab_refill = false;
+	malloc_slab_bypass = false;
+
+	return ptr;
+}
+#endif
+
+/* Allocate a block which is never a slab object, for use by memalign() */
+static Void_t *malloc_no_slab(size_t bytes)
+{
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	bool old = malloc_slab_bypass;
+	Void_t *mem;
+
+	malloc_slab_bypass = true;
+	mem = mALLOc(bytes);
+	malloc_slab_bypass = old;
+
+	return mem;
+#else
+	return mALLOc(bytes);
+#endif
 }
 
 /* field-extraction macros */
@@ -1310,7 +1390,7 @@ Void_t* mALLOc(bytes) size_t bytes;
 		return malloc_simple(bytes);
 #endif
 
-  if (CONFIG_IS_ENABLED(UNIT_TEST) && malloc_testing) {
+  if (CONFIG_IS_ENABLED(UNIT_TEST) && malloc_testing && !malloc_slab_refill) {
     if (--malloc_max_allocs < 0)
       return NULL;
   }
@@ -1321,6 +1401,16 @@ Void_t* mALLOc(bytes) size_t bytes;
     return NULL;
   }
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  /* Small requests come from the slab if possible */
+  if (bytes <= MALLOC_SLAB_MAX && !malloc_slab_bypass) {
+    Void_t *mem = malloc_slab_alloc(bytes);
+
+    if (mem)
+      return mem;
+  }
+#endif
+
   if ((long)bytes < 0) return NULL;
 
   nb = request2size(bytes);  /* padded request size; */
@@ -1597,6 +1687,16 @@ void fREe(mem) Void_t* mem;
   if (mem == NULL)                              /* free(0) has no effect */
     return;
 
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+  /* blocks from before relocation are never freed */
+  if (malloc_simple_size(mem))
+    return;
+#endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  if (malloc_slab_free(mem))
+    return;
+#endif
+
   p = mem2chunk(mem);
   hd = p->size;
 
@@ -1754,6 +1854,28 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 		/* This is harder to support and should not be needed */
 		panic("pre-reloc realloc() is not supported");
 	}
+
+	/* Move a block allocated before relocation into the heap */
+	oldsize = malloc_simple_size(oldmem);
+	if (oldsize) {
+		newmem = mALLOc(bytes);
+		if (newmem)
+			MALLOC_COPY(newmem, oldmem, min((size_t)oldsize, bytes));
+		return newmem;
+	}
+#endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	oldsize = malloc_slab_size(oldmem);
+	if (oldsize) {
+		if (bytes <= oldsize)
+			return oldmem;
+		newmem = mALLOc(bytes);
+		if (newmem) {
+			MALLOC_COPY(newmem, oldmem, oldsize);
+			fREe(oldmem);
+		}
+		return newmem;
+	}
 #endif
 
   newp    = oldp    = mem2chunk(oldmem);
@@ -1988,7 +2110,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
   /* Call malloc with worst case padding to hit alignment. */
 
   nb = request2size(bytes);
-  m  = (char*)(mALLOc(nb + alignment + MINSIZE));
+  m  = (char*)(malloc_no_slab(nb + alignment + MINSIZE));
 
   /*
   * The attempt to over-allocate (with a size large enough to guarantee the
@@ -2004,7 +2126,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
      * Use bytes not nb, since mALLOc internally calls request2size too, and
      * each call increases the size to allocate, to account for the header.
      */
-    m  = (char*)(mALLOc(bytes));
+    m  = (char*)(malloc_no_slab(bytes));
     /* Aligned -> return it */
     if ((((unsigned long)(m)) % alignment) == 0)
       return m;
@@ -2172,6 +2294,12 @@ Void_t* cALLOc(n, elem_size) size_t n; size_t elem_size;
 		memset(mem, 0, sz);
 		return mem;
 	}
+#endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+    if (malloc_slab_size(mem)) {
+      memset(mem, 0, sz);
+      return mem;
+    }
 #endif
     p = mem2chunk(mem);
 
@@ -2321,6 +2449,10 @@ size_t malloc_usable_size(mem) Void_t* mem;
   mchunkptr p;
   if (mem == NULL)
     return 0;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  else if (malloc_slab_size(mem))
+    return malloc_slab_size(mem);
+#endif
   else
   {
     p = mem2chunk(mem);
@@ -2369,6 +2501,11 @@ static void malloc_update_mallinfo(void)
     }
   }
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  /* free objects in slab pages are not in use */
+  avail += malloc_slab_unused();
+#endif
+
   current_mallinfo.ordblks = navail;
   current_mallinfo.uordblks = sbrked_mem - avail;
   current_mallinfo.fordblks = avail;
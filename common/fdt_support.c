@@ -10,8 +10,10 @@
 #include <abuf.h>
 #include <env.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <net.h>
+#include <of_live.h>
 #include <stdio_dev.h>
 #include <dm/ofnode.h>
 #include <linux/ctype.h>
@@ -716,6 +718,90 @@ int fdt_shrink_to_minimum(void *blob, uint extrasize)
 	return actualsize;
 }
 
+int fdt_batch_start(struct fdt_batch *batch, void *fdt)
+{
+	batch->fdt = fdt;
+	batch->size = fdt_totalsize(fdt);
+	batch->tree = oftree_from_fdt(fdt);
+	if (!oftree_valid(batch->tree))
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * fdt_replace() - Replace a flat tree with another, keeping its reservations
+ *
+ * The boot CPU in the header is kept too, since a flattened live tree does not
+ * record it
+ *
+ * @fdt: Tree to replace
+ * @size: Space available for @fdt, in bytes
+ * @buf: New tree, which has no memory reservations
+ * Return: 0 if OK, -ENOSPC if the new tree does not fit, -ENOMEM if out of
+ *	memory, -EINVAL if the tree could not be written
+ */
+static int fdt_replace(void *fdt, int size, const struct abuf *buf)
+{
+	struct {
+		u64 addr;
+		u64 size;
+	} *rsv = NULL;
+	int num, i, ret;
+	u32 boot_cpu;
+
+	boot_cpu = fdt_boot_cpuid_phys(fdt);
+	num = fdt_num_mem_rsv(fdt);
+	if (num < 0)
+		return -EINVAL;
+	if (abuf_size(buf) + num * sizeof(struct fdt_reserve_entry) > size)
+		return -ENOSPC;
+	if (num) {
+		rsv = malloc(num * sizeof(*rsv));
+		if (!rsv)
+			return -ENOMEM;
+		for (i = 0; i < num; i++)
+			fdt_get_mem_rsv(fdt, i, &rsv[i].addr, &rsv[i].size);
+	}
+
+	ret = fdt_open_into(abuf_data(buf), fdt, size);
+	for (i = 0; !ret && i < num; i++)
+		ret = fdt_add_mem_rsv(fdt, rsv[i].addr, rsv[i].size);
+	free(rsv);
+	if (ret) {
+		log_debug("Failed to write tree (err=%d)\n", ret);
+		return -EINVAL;
+	}
+	fdt_set_boot_cpuid_phys(fdt, boot_cpu);
+
+	return 0;
+}
+
+int fdt_batch_finish(struct fdt_batch *batch)
+{
+	struct abuf buf;
+	int ret;
+
+	/* changes were made to the flat tree directly */
+	if (!of_live_active())
+		return 0;
+
+	ret = oftree_to_fdt(batch->tree, &buf);
+	if (!ret) {
+		ret = fdt_replace(batch->fdt, batch->size, &buf);
+		abuf_uninit(&buf);
+	}
+	oftree_dispose(batch->tree);
+
+	return ret;
+}
+
+void fdt_batch_abort(struct fdt_batch *batch)
+{
+	if (of_live_active())
+		oftree_dispose(batch->tree);
+}
+
 /**
  * fdt_delete_disabled_nodes: Delete all nodes with status == "disabled"
  *
@@ -2101,6 +2187,34 @@ int fdt_overlay_apply_verbose(void *fdt, void *fdto)
 	}
 	return err;
 }
+
+#if CONFIG_IS_ENABLED(OF_LIBFDT_OVERLAY_STACK)
+int fdt_overlay_apply_stack(void *fdt, void *const fdtos[], int count)
+{
+	struct abuf buf;
+	int err;
+
+	err = of_overlay_apply_stack(fdt, fdtos, count, &buf);
+	if (err < 0) {
+		printf("failed on of_overlay_apply_stack(): %s\n",
+		       fdt_strerror(err));
+		if (fdt_path_offset(fdt, "/__symbols__") < 0) {
+			printf("base fdt did not have a /__symbols__ node\n");
+			printf("make sure you've compiled with -@\n");
+		}
+		return err;
+	}
+
+	err = fdt_replace(fdt, fdt_totalsize(fdt), &buf);
+	abuf_uninit(&buf);
+	if (err) {
+		printf("failed to write fdt after overlays: %d\n", err);
+		return err == -ENOSPC ? -FDT_ERR_NOSPACE : -FDT_ERR_INTERNAL;
+	}
+
+	return 0;
+}
+#endif
 #endif
 
 /**
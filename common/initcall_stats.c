@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Timing of each initcall
+ *
+ * The time taken by each function in init_sequence_f and init_sequence_r is
+ * recorded, along with its effect on the heap, so that slow ones can be found
+ * without a special build. Records are kept in the pre-relocation malloc()
+ * pool, then copied to space reserved by board_init_f(), as with bootstage.
+ */
+
+#include <common.h>
+#include <bootstage.h>
+#include <initcall.h>
+#include <kallsyms.h>
+#include <malloc.h>
+#include <sort.h>
+#include <time.h>
+#include <asm/global_data.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * struct initcall_stats - records of the time taken by initcalls
+ *
+ * @count: Number of records
+ * @dropped: Number of records dropped since there was no space
+ * @stat: Records, in the order they were made
+ */
+struct initcall_stats {
+	uint count;
+	uint dropped;
+	struct initcall_stat stat[CONFIG_INITCALL_STATS_COUNT];
+};
+
+int initcall_stats_init(void)
+{
+	gd->initcall_stats = calloc(1, sizeof(struct initcall_stats));
+	if (!gd->initcall_stats)
+		return -ENOMEM;
+
+	return 0;
+}
+
+int initcall_stats_get_size(void)
+{
+	return sizeof(struct initcall_stats);
+}
+
+void initcall_stats_start(struct initcall_timing *timing)
+{
+	timing->flags = gd->flags;
+	timing->heap = malloc_heap_used();
+	timing->start_us = timer_get_us();
+}
+
+void initcall_stats_end(const struct initcall_timing *timing, init_fnc_t func,
+			int ret)
+{
+	ulong time_us = timer_get_us() - timing->start_us;
+	struct initcall_stats *data = gd->initcall_stats;
+	struct initcall_stat *stat;
+
+	if (!data)
+		return;
+	if (data->count == CONFIG_INITCALL_STATS_COUNT) {
+		data->dropped++;
+		return;
+	}
+	stat = &data->stat[data->count++];
+	stat->func = code_offset((ulong)func);
+	stat->time_us = time_us;
+	stat->ret = ret;
+
+	/* The heap changes completely when malloc() is set up */
+	stat->heap = 0;
+	if (!((timing->flags ^ gd->flags) & GD_FLG_FULL_MALLOC_INIT))
+		stat->heap = malloc_heap_used() - timing->heap;
+}
+
+int initcall_stats_get(const struct initcall_stat **statsp, uint *droppedp)
+{
+	struct initcall_stats *data = gd->initcall_stats;
+
+	if (!data) {
+		*statsp = NULL;
+		*droppedp = 0;
+		return 0;
+	}
+	*statsp = data->stat;
+	*droppedp = data->dropped;
+
+	return data->count;
+}
+
+static int h_cmp_time(const void *v1, const void *v2)
+{
+	const struct initcall_stat *s1 = *(struct initcall_stat **)v1;
+	const struct initcall_stat *s2 = *(struct initcall_stat **)v2;
+
+	if (s1->time_us != s2->time_us)
+		return s1->time_us < s2->time_us ? 1 : -1;
+
+	return 0;
+}
+
+void initcall_stats_show(int count, bool bootstage)
+{
+	const struct initcall_stat **list, *stats;
+	ulong total_us = 0;
+	uint i, num, dropped;
+	char buf[20];
+
+	num = initcall_stats_get(&stats, &dropped);
+	for (i = 0; i < num; i++)
+		total_us += stats[i].time_us;
+	printf("%u initcalls, %u dropped, total time %lu us\n", num, dropped,
+	       total_us);
+	if (!num || count <= 0)
+		return;
+
+	list = malloc(num * sizeof(*list));
+	if (!list) {
+		printf("Out of memory\n");
+		return;
+	}
+	for (i = 0; i < num; i++)
+		list[i] = &stats[i];
+	qsort(list, num, sizeof(*list), h_cmp_time);
+
+	printf("\n%11s %10s %5s  %-8s  %s\n", "Time (us)", "Heap", "Ret",
+	       "Offset", "Function");
+	for (i = 0; i < min((uint)count, num); i++) {
+		const struct initcall_stat *stat = list[i];
+		const char *name = symbol_name_offset(stat->func, buf,
+						      sizeof(buf));
+
+		print_grouped_ull(stat->time_us, 9);
+		printf(" %+10d %5d  %08x  %s\n", stat->heap, stat->ret,
+		       stat->func, name);
+		if (bootstage && bootstage_add_time(name, stat->time_us)) {
+			printf("No space to add to bootstage\n");
+			bootstage = false;
+		}
+	}
+	free(list);
+}
@@ -6,6 +6,7 @@
  */
 
 #include <common.h>
+#include <kallsyms.h>
 
 /* We need the weak marking as this symbol is provided specially */
 extern const char system_map[] __attribute__((weak));
@@ -42,3 +43,37 @@ const char *symbol_lookup(unsigned long addr, unsigned long *caddr)
 
 	return csym;
 }
+
+/*
+ * As symbol_lookup(), but with an address given as an offset from the first
+ * symbol, which is taken to be the start of the code. This allows a symbol to
+ * be found when the code is not running at the address it was linked for, e.g.
+ * after relocation. The offset of the symbol is stored in cofs.
+ */
+const char *symbol_lookup_offset(unsigned long offset, unsigned long *cofs)
+{
+	const char *sym;
+	unsigned long start;
+
+	if (!*system_map)
+		return NULL;
+	start = hextoul(system_map, NULL);
+	sym = symbol_lookup(start + offset, cofs);
+	if (sym)
+		*cofs -= start;
+
+	return sym;
+}
+
+const char *symbol_name_offset(unsigned long offset, char *buf, int size)
+{
+	const char *name;
+	unsigned long cofs;
+
+	name = symbol_lookup_offset(offset, &cofs);
+	if (name && cofs == offset)
+		return name;
+	snprintf(buf, size, "func_%lx", offset);
+
+	return buf;
+}
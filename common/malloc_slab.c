@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Size-class slab allocator in front of dlmalloc
+ *
+ * Driver model allocates a great many small objects of a handful of sizes.
+ * Serving these from dlmalloc's bins costs a chunk header each and leaves
+ * the heap fragmented once devices are removed. Here small requests are
+ * rounded up to a size class and carved from page-sized slabs instead, so
+ * that allocating and freeing is a simple free-list operation.
+ *
+ * Slab pages are themselves allocated from dlmalloc, aligned to their size,
+ * so the page holding an object is found by masking its address. A bitmap
+ * covering the malloc() area records which pages are slabs, which is how
+ * free() tells slab objects from ordinary chunks.
+ */
+
+#define LOG_CATEGORY LOGC_ALLOC
+
+#include <common.h>
+#include <log.h>
+#include <malloc.h>
+#include <linux/bitops.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+
+#define SLAB_PAGE_SIZE		4096
+
+/**
+ * struct slab_page - header at the start of each slab page
+ *
+ * @sibling: Node in the class's list of pages with free objects
+ * @free: First free object in this page, NULL if the page is full. Each free
+ *	object holds a pointer to the next one
+ * @cls: Size class of the objects in this page
+ * @in_use: Number of objects allocated from this page
+ */
+struct slab_page {
+	struct list_head sibling;
+	void *free;
+	u16 cls;
+	u16 in_use;
+};
+
+#define SLAB_OBJ_START		ALIGN(sizeof(struct slab_page), 16)
+
+static const u16 slab_sizes[] = { 16, 32, 48, 64, 96, 128, 192, 256 };
+
+#define SLAB_CLASSES		ARRAY_SIZE(slab_sizes)
+
+/**
+ * struct slab_class - a size class
+ *
+ * @partial: Pages of this class which have at least one free object
+ * @stats: Statistics for this class
+ */
+struct slab_class {
+	struct list_head partial;
+	struct malloc_slab_stats stats;
+};
+
+/**
+ * struct slab_info - slab allocator state
+ *
+ * @enabled: true to serve new allocations from the slab
+ * @ready: true once @map and @cls are set up
+ * @base: Address of the first page covered by @map
+ * @held: Number of bytes in all slab pages
+ * @used: Number of bytes in all allocated objects
+ * @map: Bitmap with one bit for each page in the malloc() area, set if the
+ *	page is a slab
+ * @cls: Size classes
+ * @lookup: Size class for each multiple of 16 bytes, up to MALLOC_SLAB_MAX
+ */
+static struct slab_info {
+	bool enabled;
+	bool ready;
+	ulong base;
+	size_t held;
+	size_t used;
+	ulong *map;
+	struct slab_class cls[SLAB_CLASSES];
+	u8 lookup[MALLOC_SLAB_MAX / 16 + 1];
+} slab = {
+	.enabled = true,
+};
+
+static int slab_setup(void)
+{
+	ulong pages;
+	size_t size;
+	int i, j;
+
+	slab.base = ALIGN_DOWN(mem_malloc_start, SLAB_PAGE_SIZE);
+	pages = DIV_ROUND_UP(mem_malloc_end - slab.base, SLAB_PAGE_SIZE);
+	size = BITS_TO_LONGS(pages) * sizeof(ulong);
+	slab.map = malloc_slab_get_mem(sizeof(ulong), size);
+	if (!slab.map)
+		return -ENOMEM;
+	memset(slab.map, '\0', size);
+
+	for (i = 0, j = 0; i < ARRAY_SIZE(slab.lookup); i++) {
+		if (i * 16 > slab_sizes[j])
+			j++;
+		slab.lookup[i] = j;
+	}
+	for (i = 0; i < SLAB_CLASSES; i++) {
+		struct slab_class *cls = &slab.cls[i];
+
+		INIT_LIST_HEAD(&cls->partial);
+		memset(&cls->stats, '\0', sizeof(cls->stats));
+		cls->stats.size = slab_sizes[i];
+		cls->stats.objs_per_page = (SLAB_PAGE_SIZE - SLAB_OBJ_START) /
+			slab_sizes[i];
+	}
+	slab.ready = true;
+
+	return 0;
+}
+
+static ulong slab_page_idx(const void *ptr)
+{
+	return ((ulong)ptr - slab.base) / SLAB_PAGE_SIZE;
+}
+
+static struct slab_page *slab_page_of(const void *ptr)
+{
+	ulong addr = (ulong)ptr;
+	ulong idx;
+
+	if (!slab.ready || addr < mem_malloc_start || addr >= mem_malloc_end)
+		return NULL;
+	idx = slab_page_idx(ptr);
+	if (!(slab.map[BIT_WORD(idx)] & BIT_MASK(idx)))
+		return NULL;
+
+	return (struct slab_page *)ALIGN_DOWN(addr, SLAB_PAGE_SIZE);
+}
+
+static struct slab_page *slab_new_page(int cls_idx)
+{
+	struct slab_class *cls = &slab.cls[cls_idx];
+	struct slab_page *page;
+	ulong idx;
+	char *obj, *end;
+	void **link;
+
+	page = malloc_slab_get_mem(SLAB_PAGE_SIZE, SLAB_PAGE_SIZE);
+	if (!page)
+		return NULL;
+	page->cls = cls_idx;
+	page->in_use = 0;
+
+	/* thread all objects onto the free list, in address order */
+	link = &page->free;
+	obj = (char *)page + SLAB_OBJ_START;
+	end = obj + cls->stats.objs_per_page * cls->stats.size;
+	for (; obj < end; obj += cls->stats.size) {
+		*link = obj;
+		link = (void **)obj;
+	}
+	*link = NULL;
+
+	/*
+	 * Count the whole chunk, including its size field, so mallinfo() sees
+	 * just the objects. This must come before the page is marked as a slab
+	 */
+	slab.held += malloc_usable_size(page) + sizeof(size_t);
+	idx = slab_page_idx(page);
+	slab.map[BIT_WORD(idx)] |= BIT_MASK(idx);
+	list_add(&page->sibling, &cls->partial);
+	cls->stats.pages++;
+
+	return page;
+}
+
+void *malloc_slab_alloc(size_t bytes)
+{
+	struct slab_class *cls;
+	struct slab_page *page;
+	int cls_idx;
+	void *obj;
+
+	if (!slab.enabled || bytes > MALLOC_SLAB_MAX)
+		return NULL;
+	if (!slab.ready && slab_setup())
+		return NULL;
+
+	cls_idx = slab.lookup[(bytes + 15) / 16];
+	cls = &slab.cls[cls_idx];
+	if (list_empty(&cls->partial)) {
+		page = slab_new_page(cls_idx);
+		if (!page)
+			return NULL;
+	} else {
+		page = list_first_entry(&cls->partial, struct slab_page,
+					sibling);
+	}
+
+	obj = page->free;
+	page->free = *(void **)obj;
+	page->in_use++;
+	if (!page->free)
+		list_del_init(&page->sibling);
+
+	cls->stats.allocs++;
+	cls->stats.in_use++;
+	slab.used += cls->stats.size;
+	cls->stats.peak = max(cls->stats.peak, cls->stats.in_use);
+
+	return obj;
+}
+
+bool malloc_slab_free(void *ptr)
+{
+	struct slab_page *page = slab_page_of(ptr);
+	struct slab_class *cls;
+	ulong idx;
+
+	if (!page)
+		return false;
+	cls = &slab.cls[page->cls];
+	cls->stats.frees++;
+	cls->stats.in_use--;
+	slab.used -= cls->stats.size;
+
+	/* a page which was full has a free object again */
+	if (!page->free)
+		list_add(&page->sibling, &cls->partial);
+	*(void **)ptr = page->free;
+	page->free = ptr;
+
+	/*
+	 * Hand empty pages straight back to dlmalloc, so that freeing all
+	 * objects leaves the heap as it was before they were allocated
+	 */
+	if (!--page->in_use) {
+		list_del(&page->sibling);
+		idx = slab_page_idx(page);
+		slab.map[BIT_WORD(idx)] &= ~BIT_MASK(idx);
+		cls->stats.pages--;
+		slab.held -= malloc_usable_size(page) + sizeof(size_t);
+		free(page);
+	}
+
+	return true;
+}
+
+size_t malloc_slab_size(const void *ptr)
+{
+	struct slab_page *page = slab_page_of(ptr);
+
+	return page ? slab.cls[page->cls].stats.size : 0;
+}
+
+bool malloc_slab_enable(bool enable)
+{
+	bool old = slab.enabled;
+
+	slab.enabled = enable;
+
+	return old;
+}
+
+int malloc_slab_get_stats(struct malloc_slab_stats *stats, int max)
+{
+	int i;
+
+	for (i = 0; i < SLAB_CLASSES && i < max; i++) {
+		if (slab.ready)
+			stats[i] = slab.cls[i].stats;
+		else
+			memset(&stats[i], '\0', sizeof(stats[i]));
+	}
+
+	return SLAB_CLASSES;
+}
+
+size_t malloc_slab_unused(void)
+{
+	return slab.held - slab.used;
+}
+
+void malloc_slab_reset(void)
+{
+	slab.ready = false;
+	slab.map = NULL;
+	slab.held = 0;
+	slab.used = 0;
+}
+
+void malloc_slab_info(void)
+{
+	int i;
+
+	if (!slab.ready) {
+		printf("slab:  not in use\n");
+		return;
+	}
+	printf("slab:  %5s %6s %8s %8s %6s %6s %5s\n", "size", "objs",
+	       "allocs", "frees", "in use", "peak", "pages");
+	for (i = 0; i < SLAB_CLASSES; i++) {
+		struct malloc_slab_stats *st = &slab.cls[i].stats;
+
+		printf("       %5u %6u %8lu %8lu %6u %6u %5u\n", st->size,
+		       st->objs_per_page, st->allocs, st->frees, st->in_use,
+		       st->peak, st->pages);
+	}
+}
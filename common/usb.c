@@ -272,10 +272,27 @@ int usb_control_msg(struct usb_device *dev, unsigned int pipe,
 int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, int len, int *actual_length, int timeout)
 {
+	return usb_bulk_stream_msg(dev, pipe, 0, data, len, actual_length,
+				   timeout);
+}
+
+int usb_bulk_stream_msg(struct usb_device *dev, unsigned int pipe,
+			uint stream_id, void *data, int len,
+			int *actual_length, int timeout)
+{
+	int ret;
+
 	if (len < 0)
 		return -EINVAL;
 	dev->status = USB_ST_NOT_PROC; /*not yet processed */
-	if (submit_bulk_msg(dev, pipe, data, len) < 0)
+	if (stream_id) {
+		ret = submit_bulk_stream_msg(dev, pipe, stream_id, data, len);
+		if (ret == -ENOSYS)
+			return ret;
+	} else {
+		ret = submit_bulk_msg(dev, pipe, data, len);
+	}
+	if (ret < 0)
 		return -EIO;
 	while (timeout--) {
 		if (!((volatile unsigned long)dev->status & USB_ST_NOT_PROC))
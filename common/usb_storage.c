@@ -39,6 +39,7 @@
 #include <dm.h>
 #include <errno.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <memalign.h>
 #include <asm/byteorder.h>
@@ -47,6 +48,7 @@
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <linux/delay.h>
+#include <linux/usb/uas.h>
 
 #include <part.h>
 #include <usb.h>
@@ -67,6 +69,9 @@ static const unsigned char us_direction[256/8] = {
 #define US_DIRECTION(x) ((us_direction[x>>3] >> (x & 7)) & 1)
 
 static struct scsi_cmd usb_ccb __aligned(ARCH_DMA_MINALIGN);
+#if CONFIG_IS_ENABLED(USB_STORAGE_UAS)
+static struct scsi_cmd uas_ccb[CONFIG_USB_STORAGE_UAS_DEPTH];
+#endif
 static __u32 CBWTag;
 
 static int usb_max_devs; /* number of highest available usb device */
@@ -102,6 +107,10 @@ struct us_data {
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
 	unsigned short	max_xfer_blk;		/* maximum transfer blocks */
+	unsigned char	ep_cmd;			/* UAS command endpoint */
+	unsigned char	ep_status;		/* UAS status endpoint */
+	unsigned char	uas_depth;		/* UAS commands to queue */
+	unsigned short	uas_streams;		/* UAS streams, 0 if none */
 };
 
 #if !CONFIG_IS_ENABLED(BLK)
@@ -176,6 +185,10 @@ static unsigned int usb_get_max_lun(struct us_data *us)
 {
 	int len;
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, result, 1);
+
+	/* UAS has no such request; only LUN 0 is supported there */
+	if (us->protocol == US_PR_UAS)
+		return 0;
 	len = usb_control_msg(us->pusb_dev,
 			      usb_rcvctrlpipe(us->pusb_dev, 0),
 			      US_BBB_GET_MAX_LUN,
@@ -955,6 +968,193 @@ do_retry:
 	return USB_STOR_TRANSPORT_FAILED;
 }
 
+#if CONFIG_IS_ENABLED(USB_STORAGE_UAS)
+/*
+ * USB Attached SCSI (UAS)
+ *
+ * Each command is wrapped in an information unit (IU) sent on the command
+ * pipe and carries a tag, so that several commands can be outstanding at
+ * once. The device reports completion with a Sense IU on the status pipe.
+ * With USB 3 streams each tag has its own stream on the data and status
+ * pipes. Without them the device instead sends a Read Ready or Write Ready
+ * IU on the status pipe to say which command it wants to move data for.
+ *
+ * USB transfers are synchronous here, so a batch of commands is sent and
+ * then the commands are completed one at a time, in whatever order the
+ * device picks when it can pick.
+ */
+
+static int usb_stor_uas_reset(struct us_data *us)
+{
+	struct usb_device *udev = us->pusb_dev;
+
+	debug("UAS reset\n");
+	usb_clear_halt(udev, usb_sndbulkpipe(udev, us->ep_cmd));
+	usb_clear_halt(udev, usb_rcvbulkpipe(udev, us->ep_status));
+	usb_clear_halt(udev, usb_rcvbulkpipe(udev, us->ep_in));
+	usb_clear_halt(udev, usb_sndbulkpipe(udev, us->ep_out));
+
+	return 0;
+}
+
+static int uas_send_cmd(struct us_data *us, struct scsi_cmd *srb, uint tag)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct command_iu, iu, 1);
+	int actlen, ret;
+
+	memset(iu, '\0', sizeof(*iu));
+	iu->iu_id = IU_ID_COMMAND;
+	iu->tag = cpu_to_be16(tag);
+	iu->prio_attr = UAS_SIMPLE_TAG;
+	iu->lun[1] = srb->lun;
+	memcpy(iu->cdb, srb->cmd, min_t(uint, srb->cmdlen, sizeof(iu->cdb)));
+	ret = usb_bulk_msg(us->pusb_dev,
+			   usb_sndbulkpipe(us->pusb_dev, us->ep_cmd), iu,
+			   sizeof(*iu), &actlen, USB_CNTL_TIMEOUT * 5);
+	if (ret)
+		debug("UAS: command %02x, tag %u failed\n", srb->cmd[0], tag);
+
+	return ret;
+}
+
+/* Move the data for a command, using the given stream (0 for none) */
+static int uas_data(struct us_data *us, struct scsi_cmd *srb, uint stream)
+{
+	struct usb_device *udev = us->pusb_dev;
+	int actlen, ret;
+	uint pipe;
+
+	if (US_DIRECTION(srb->cmd[0]))
+		pipe = usb_rcvbulkpipe(udev, us->ep_in);
+	else
+		pipe = usb_sndbulkpipe(udev, us->ep_out);
+	ret = usb_bulk_stream_msg(udev, pipe, stream, srb->pdata, srb->datalen,
+				  &actlen, USB_CNTL_TIMEOUT * 5);
+	if (ret)
+		return ret;
+	srb->trans_bytes = actlen;
+
+	return 0;
+}
+
+/* Read an IU from the status pipe, using the given stream (0 for none) */
+static int uas_get_status(struct us_data *us, struct sense_iu *iu,
+			  uint stream)
+{
+	struct usb_device *udev = us->pusb_dev;
+	int actlen, ret;
+
+	ret = usb_bulk_stream_msg(udev, usb_rcvbulkpipe(udev, us->ep_status),
+				  stream, iu, sizeof(*iu), &actlen,
+				  USB_CNTL_TIMEOUT * 5);
+	if (ret)
+		return ret;
+	if (actlen < sizeof(struct iu))
+		return -EPROTO;
+
+	return 0;
+}
+
+/* Record the status from a Sense IU, returning the transport result */
+static int uas_complete(struct scsi_cmd *srb, struct sense_iu *iu)
+{
+	uint len;
+
+	srb->status = iu->status;
+	if (!iu->status)
+		return USB_STOR_TRANSPORT_GOOD;
+
+	len = min_t(uint, be16_to_cpu(iu->len), sizeof(srb->sense_buf));
+	memset(srb->sense_buf, '\0', sizeof(srb->sense_buf));
+	memcpy(srb->sense_buf, iu->sense, len);
+	debug("UAS: command %02x status %02x sense %02x %02x %02x\n",
+	      srb->cmd[0], iu->status, srb->sense_buf[2], srb->sense_buf[12],
+	      srb->sense_buf[13]);
+
+	return USB_STOR_TRANSPORT_FAILED;
+}
+
+/**
+ * usb_stor_uas_run() - Run a batch of commands on a UAS device
+ *
+ * All the commands are sent before any of them is completed. Command i uses
+ * tag i + 1, which is also its stream if the device uses streams. If the
+ * device does not follow the protocol, its pipes are reset.
+ *
+ * @us: Device to use
+ * @srbs: Commands to run
+ * @count: Number of commands, at most @us->uas_depth
+ * Return: USB_STOR_TRANSPORT_GOOD if all the commands succeeded, else
+ *	USB_STOR_TRANSPORT_FAILED
+ */
+static int usb_stor_uas_run(struct us_data *us, struct scsi_cmd *srbs,
+			    int count)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct sense_iu, iu, 1);
+	int i, result = USB_STOR_TRANSPORT_GOOD;
+	u32 pending = 0;
+	uint tag;
+
+	for (i = 0; i < count; i++) {
+		srbs[i].trans_bytes = 0;
+		if (uas_send_cmd(us, &srbs[i], i + 1))
+			goto err;
+		pending |= BIT(i);
+	}
+
+	while (pending) {
+		if (us->uas_streams) {
+			/*
+			 * The data and status for each command come on its
+			 * own stream, so take the commands in order
+			 */
+			i = ffs(pending) - 1;
+			if (srbs[i].datalen && uas_data(us, &srbs[i], i + 1))
+				goto err;
+			if (uas_get_status(us, iu, i + 1) ||
+			    be16_to_cpu(iu->tag) != i + 1 ||
+			    iu->iu_id != IU_ID_STATUS)
+				goto err;
+		} else if (uas_get_status(us, iu, 0)) {
+			goto err;
+		}
+
+		tag = be16_to_cpu(iu->tag);
+		if (!tag || tag > count || !(pending & BIT(tag - 1))) {
+			debug("UAS: unexpected tag %u\n", tag);
+			goto err;
+		}
+		i = tag - 1;
+		switch (iu->iu_id) {
+		case IU_ID_READ_READY:
+		case IU_ID_WRITE_READY:
+			if (uas_data(us, &srbs[i], 0))
+				goto err;
+			break;
+		case IU_ID_STATUS:
+			if (uas_complete(&srbs[i], iu))
+				result = USB_STOR_TRANSPORT_FAILED;
+			pending &= ~BIT(i);
+			break;
+		default:
+			debug("UAS: unexpected IU %02x\n", iu->iu_id);
+			goto err;
+		}
+	}
+
+	return result;
+err:
+	usb_stor_uas_reset(us);
+
+	return USB_STOR_TRANSPORT_FAILED;
+}
+
+static int usb_stor_uas_transport(struct scsi_cmd *srb, struct us_data *us)
+{
+	return usb_stor_uas_run(us, srb, 1);
+}
+#endif /* USB_STORAGE_UAS */
+
 static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 				      struct us_data *us)
 {
@@ -973,9 +1173,10 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	 * Tests show that other operating have similar limits with Microsoft
 	 * Windows 7 limiting transfers to 128 sectors for both USB2 and USB3
 	 * and Apple Mac OS X 10.11 limiting transfers to 256 sectors for USB2
-	 * and 2048 for USB3 devices.
+	 * and 2048 for USB3 devices. UAS devices are recent enough to be given
+	 * the larger limit.
 	 */
-	unsigned short blk = 240;
+	unsigned short blk = us->protocol == US_PR_UAS ? 2048 : 240;
 
 #if CONFIG_IS_ENABLED(DM_USB)
 	size_t size;
@@ -1017,6 +1218,9 @@ static int usb_request_sense(struct scsi_cmd *srb, struct us_data *ss)
 {
 	char *ptr;
 
+	/* UAS returns the sense data with the status of the failed command */
+	if (ss->protocol == US_PR_UAS)
+		return 0;
 	ptr = (char *)srb->pdata;
 	memset(&srb->cmd[0], 0, 12);
 	srb->cmd[0] = SCSI_REQ_SENSE;
@@ -1082,11 +1286,11 @@ static int usb_read_capacity(struct scsi_cmd *srb, struct us_data *ss)
 	return -1;
 }
 
-static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
-		       unsigned long start, unsigned short blocks)
+static void usb_setup_rw_10(struct scsi_cmd *srb, unsigned char opcode,
+			    unsigned long start, unsigned short blocks)
 {
 	memset(&srb->cmd[0], 0, 12);
-	srb->cmd[0] = SCSI_READ10;
+	srb->cmd[0] = opcode;
 	srb->cmd[1] = srb->lun << 5;
 	srb->cmd[2] = ((unsigned char) (start >> 24)) & 0xff;
 	srb->cmd[3] = ((unsigned char) (start >> 16)) & 0xff;
@@ -1095,6 +1299,12 @@ static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
 	srb->cmd[7] = ((unsigned char) (blocks >> 8)) & 0xff;
 	srb->cmd[8] = (unsigned char) blocks & 0xff;
 	srb->cmdlen = 12;
+}
+
+static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
+		       unsigned long start, unsigned short blocks)
+{
+	usb_setup_rw_10(srb, SCSI_READ10, start, blocks);
 	debug("read10: start %lx blocks %x\n", start, blocks);
 	return ss->transport(srb, ss);
 }
@@ -1102,20 +1312,60 @@ static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
 static int usb_write_10(struct scsi_cmd *srb, struct us_data *ss,
 			unsigned long start, unsigned short blocks)
 {
-	memset(&srb->cmd[0], 0, 12);
-	srb->cmd[0] = SCSI_WRITE10;
-	srb->cmd[1] = srb->lun << 5;
-	srb->cmd[2] = ((unsigned char) (start >> 24)) & 0xff;
-	srb->cmd[3] = ((unsigned char) (start >> 16)) & 0xff;
-	srb->cmd[4] = ((unsigned char) (start >> 8)) & 0xff;
-	srb->cmd[5] = ((unsigned char) (start)) & 0xff;
-	srb->cmd[7] = ((unsigned char) (blocks >> 8)) & 0xff;
-	srb->cmd[8] = (unsigned char) blocks & 0xff;
-	srb->cmdlen = 12;
+	usb_setup_rw_10(srb, SCSI_WRITE10, start, blocks);
 	debug("write10: start %lx blocks %x\n", start, blocks);
 	return ss->transport(srb, ss);
 }
 
+#if CONFIG_IS_ENABLED(USB_STORAGE_UAS)
+/*
+ * Read or write with up to uas_depth commands outstanding at once. Returns
+ * the number of blocks transferred before any failure
+ */
+static unsigned long usb_stor_uas_rw(struct usb_device *udev,
+				     struct us_data *ss,
+				     struct blk_desc *block_dev,
+				     lbaint_t start, lbaint_t blkcnt,
+				     void *buffer, bool write)
+{
+	lbaint_t done, queued, blks;
+	struct scsi_cmd *srb;
+	int count, retry = 2;
+
+	usb_disable_asynch(1); /* asynch transfer not allowed */
+	usb_lock_async(udev, 1);
+	for (done = 0; done < blkcnt; done += queued) {
+		queued = 0;
+		for (count = 0; count < ss->uas_depth && done + queued < blkcnt;
+		     count++) {
+			blks = min_t(lbaint_t, blkcnt - done - queued,
+				     ss->max_xfer_blk);
+			srb = &uas_ccb[count];
+			srb->lun = block_dev->lun;
+			srb->pdata = buffer + (done + queued) * block_dev->blksz;
+			srb->datalen = blks * block_dev->blksz;
+			usb_setup_rw_10(srb, write ? SCSI_WRITE10 : SCSI_READ10,
+					start + done + queued, blks);
+			queued += blks;
+		}
+		debug("uas %s: start " LBAF " blocks " LBAF " in %d commands\n",
+		      write ? "write" : "read", start + done, queued, count);
+		if (usb_stor_uas_run(ss, uas_ccb, count)) {
+			debug("%s ERROR\n", write ? "Write" : "Read");
+			if (!retry--)
+				break;
+			queued = 0;
+			continue;
+		}
+		usb_show_progress();
+	}
+	usb_lock_async(udev, 0);
+	usb_disable_asynch(0); /* asynch transfer allowed */
+
+	return done;
+}
+#endif
+
 
 #ifdef CONFIG_USB_BIN_FIXUP
 /*
@@ -1175,6 +1425,11 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+#if CONFIG_IS_ENABLED(USB_STORAGE_UAS)
+	if (ss->protocol == US_PR_UAS)
+		return usb_stor_uas_rw(udev, ss, block_dev, blknr, blkcnt,
+				       buffer, false);
+#endif
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	usb_lock_async(udev, 1);
@@ -1259,6 +1514,11 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+#if CONFIG_IS_ENABLED(USB_STORAGE_UAS)
+	if (ss->protocol == US_PR_UAS)
+		return usb_stor_uas_rw(udev, ss, block_dev, blknr, blkcnt,
+				       (void *)buffer, true);
+#endif
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	usb_lock_async(udev, 1);
@@ -1311,6 +1571,129 @@ retry_it:
 
 }
 
+#if CONFIG_IS_ENABLED(USB_STORAGE_UAS)
+/*
+ * Switch to the UAS alternate setting of an interface, if it has one. The
+ * parsed configuration does not keep the pipe-usage descriptors which say
+ * what each endpoint is for, so the raw descriptors are read again.
+ *
+ * Returns 0 if the device now uses UAS, -ve if the transport in alternate
+ * setting 0 should be used
+ */
+static int usb_stor_uas_probe(struct usb_device *dev,
+			      struct usb_interface *iface, struct us_data *ss)
+{
+	unsigned char eps[DATA_OUT_PIPE_ID + 1] = { };
+	int streams[DATA_OUT_PIPE_ID + 1] = { };
+	struct usb_interface_descriptor *alt = NULL;
+	struct usb_endpoint_descriptor *ep = NULL;
+	struct usb_pipe_usage_descriptor *usage;
+	struct usb_descriptor_header *head;
+	int len, ofs, ep_streams = 0, ret;
+	bool in_alt = false;
+	unsigned char *buf;
+
+	if (iface->num_altsetting < 2)
+		return -ENOENT;
+	len = usb_get_configuration_len(dev, dev->configno);
+	if (len < 0)
+		return len;
+	buf = malloc_cache_aligned(len);
+	if (!buf)
+		return -ENOMEM;
+	ret = usb_get_configuration_no(dev, dev->configno, buf, len);
+	if (ret < 0)
+		goto out;
+	len = ret;
+
+	for (ofs = 0; ofs + sizeof(*head) <= len; ofs += head->bLength) {
+		head = (struct usb_descriptor_header *)(buf + ofs);
+		if (!head->bLength || ofs + head->bLength > len)
+			break;
+		switch (head->bDescriptorType) {
+		case USB_DT_INTERFACE: {
+			struct usb_interface_descriptor *desc = (void *)head;
+
+			in_alt = !alt && desc->bInterfaceNumber ==
+				iface->desc.bInterfaceNumber &&
+				desc->bInterfaceProtocol == US_PR_UAS;
+			if (in_alt)
+				alt = desc;
+			ep = NULL;
+			break;
+		}
+		case USB_DT_ENDPOINT:
+			ep = (struct usb_endpoint_descriptor *)head;
+			ep_streams = 0;
+			break;
+		case USB_DT_SS_ENDPOINT_COMP:
+			ep_streams = usb_ss_max_streams((void *)head);
+			break;
+		case USB_DT_PIPE_USAGE:
+			usage = (struct usb_pipe_usage_descriptor *)head;
+			if (!in_alt || !ep || !usage->bPipeID ||
+			    usage->bPipeID > DATA_OUT_PIPE_ID)
+				break;
+			eps[usage->bPipeID] = ep->bEndpointAddress &
+					USB_ENDPOINT_NUMBER_MASK;
+			streams[usage->bPipeID] = ep_streams;
+			break;
+		}
+	}
+	if (!alt || !eps[CMD_PIPE_ID] || !eps[STATUS_PIPE_ID] ||
+	    !eps[DATA_IN_PIPE_ID] || !eps[DATA_OUT_PIPE_ID]) {
+		debug("No UAS setting\n");
+		ret = -ENOENT;
+		goto out;
+	}
+	ret = usb_set_interface(dev, alt->bInterfaceNumber,
+				alt->bAlternateSetting);
+	if (ret) {
+		debug("Cannot select UAS setting (err=%d)\n", ret);
+		goto out;
+	}
+
+	ss->ep_cmd = eps[CMD_PIPE_ID];
+	ss->ep_status = eps[STATUS_PIPE_ID];
+	ss->ep_in = eps[DATA_IN_PIPE_ID];
+	ss->ep_out = eps[DATA_OUT_PIPE_ID];
+	ss->uas_depth = CONFIG_USB_STORAGE_UAS_DEPTH;
+	if (dev->speed >= USB_SPEED_SUPER) {
+		unsigned long pipes[] = {
+			usb_rcvbulkpipe(dev, ss->ep_status),
+			usb_rcvbulkpipe(dev, ss->ep_in),
+			usb_sndbulkpipe(dev, ss->ep_out),
+		};
+		int max = min3(streams[STATUS_PIPE_ID],
+			       streams[DATA_IN_PIPE_ID],
+			       streams[DATA_OUT_PIPE_ID]);
+
+		/* UAS needs streams at SuperSpeed, so use BOT without them */
+		ret = usb_alloc_streams(dev, pipes, ARRAY_SIZE(pipes),
+					min(max, (int)ss->uas_depth));
+		if (ret <= 0) {
+			debug("Cannot allocate UAS streams (err=%d)\n", ret);
+			ret = ret ? ret : -ENOSPC;
+			goto out;
+		}
+		ss->uas_streams = ret;
+		ss->uas_depth = min_t(int, ss->uas_depth, ret);
+	}
+	ss->subclass = alt->bInterfaceSubClass;
+	ss->protocol = US_PR_UAS;
+	ss->transport = usb_stor_uas_transport;
+	ss->transport_reset = usb_stor_uas_reset;
+	debug("UAS: Cmd %d Status %d In %d Out %d, depth %d, streams %d\n",
+	      ss->ep_cmd, ss->ep_status, ss->ep_in, ss->ep_out, ss->uas_depth,
+	      ss->uas_streams);
+	ret = 0;
+out:
+	free(buf);
+
+	return ret;
+}
+#endif
+
 /* Probe to see if a new device is actually a Storage device */
 int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 		      struct us_data *ss)
@@ -1345,6 +1728,14 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 	ss->subclass = iface->desc.bInterfaceSubClass;
 	ss->protocol = iface->desc.bInterfaceProtocol;
 
+#if CONFIG_IS_ENABLED(USB_STORAGE_UAS)
+	if (!usb_stor_uas_probe(dev, iface, ss)) {
+		usb_stor_set_max_xfer_blk(dev, ss);
+		dev->privptr = (void *)ss;
+		return 1;
+	}
+#endif
+
 	/* set the handler pointers based on the protocol */
 	debug("Transport: ");
 	switch (ss->protocol) {
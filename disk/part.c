@@ -9,6 +9,7 @@
 #include <command.h>
 #include <env.h>
 #include <errno.h>
+#include <fs.h>
 #include <ide.h>
 #include <log.h>
 #include <malloc.h>
@@ -255,7 +256,10 @@ void part_init(struct blk_desc *dev_desc)
 	const int n_ents = ll_entry_count(struct part_driver, part_driver);
 	struct part_driver *entry;
 
+	/* the medium may have changed, so forget what was cached from it */
 	blkcache_invalidate(dev_desc->uclass_id, dev_desc->devnum);
+	fs_lookup_cache_invalidate_dev(dev_desc);
+	fs_mount_invalidate_dev(dev_desc);
 
 	dev_desc->part_type = PART_TYPE_UNKNOWN;
 	for (entry = drv; entry != drv + n_ents; entry++) {
@@ -9,6 +9,7 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
@@ -474,6 +475,8 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	fs_lookup_cache_invalidate_dev(desc);
+	fs_mount_invalidate_dev(desc);
 
 	return ops->write(dev, start, blkcnt, buf);
 }
@@ -487,6 +490,8 @@ long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	fs_lookup_cache_invalidate_dev(desc);
+	fs_mount_invalidate_dev(desc);
 
 	return ops->erase(dev, start, blkcnt);
 }
@@ -781,9 +786,19 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	/* The device may come back with different contents */
+	fs_lookup_cache_invalidate_dev(dev_get_uclass_plat(dev));
+	fs_mount_invalidate_dev(dev_get_uclass_plat(dev));
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Measure the throughput and latency of a block device
+ *
+ * Transfers of a fixed size are issued back to back, sequentially or at random
+ * offsets within a region, until the requested time has passed. Every
+ * transfer is timed; since a long run can do far more transfers than there is
+ * room to record, the latencies used for percentiles are a uniform random
+ * sample of all of them.
+ */
+
+#define LOG_CATEGORY UCLASS_BLK
+
+#include <common.h>
+#include <blk.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <sort.h>
+#include <time.h>
+#include <linux/math64.h>
+
+/* Number of latencies kept for working out percentiles */
+#define BENCH_SAMPLES	4096
+
+/**
+ * struct bench_ctx - state of a benchmark run
+ *
+ * @params: What to measure
+ * @seed: State of the random-number generator
+ * @next: Next block for sequential transfers, relative to the region start
+ * @samples: Latencies kept for percentiles, in microseconds
+ * @nsamples: Number of entries in @samples
+ */
+struct bench_ctx {
+	const struct blk_bench_params *params;
+	u32 seed;
+	lbaint_t next;
+	u32 *samples;
+	uint nsamples;
+};
+
+/* xorshift32, which is plenty for picking offsets */
+static u32 bench_rand(struct bench_ctx *ctx)
+{
+	u32 x = ctx->seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	ctx->seed = x;
+
+	return x;
+}
+
+static lbaint_t bench_next_blk(struct bench_ctx *ctx)
+{
+	const struct blk_bench_params *params = ctx->params;
+	lbaint_t slots = params->count / params->xfer;
+	lbaint_t blk;
+
+	if (params->random) {
+		blk = ((u64)bench_rand(ctx) * slots >> 32) * params->xfer;
+	} else {
+		blk = ctx->next;
+		ctx->next += params->xfer;
+		if (ctx->next + params->xfer > params->count)
+			ctx->next = 0;
+	}
+
+	return params->start + blk;
+}
+
+/* Keep a latency so that all of them are equally likely to be kept */
+static void bench_sample(struct bench_ctx *ctx, ulong ops, u32 us)
+{
+	ulong slot;
+
+	if (ctx->nsamples < BENCH_SAMPLES) {
+		ctx->samples[ctx->nsamples++] = us;
+		return;
+	}
+	slot = (u64)bench_rand(ctx) * ops >> 32;
+	if (slot < BENCH_SAMPLES)
+		ctx->samples[slot] = us;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static ulong bench_percentile(struct bench_ctx *ctx, uint pct)
+{
+	return ctx->samples[(ctx->nsamples - 1) * pct / 100];
+}
+
+int blk_bench(struct blk_desc *desc, const struct blk_bench_params *params,
+	      struct blk_bench_result *res)
+{
+	struct bench_ctx ctx = {
+		.params	= params,
+	};
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+	struct block_cache_stats cache;
+#endif
+	ulong start, before, us, n;
+	u64 total_us = 0;
+	void *buf;
+	int ret = 0;
+
+	memset(res, '\0', sizeof(*res));
+	if (!params->xfer || params->xfer > params->count ||
+	    params->start + params->count > desc->lba)
+		return -EINVAL;
+
+	buf = malloc_cache_aligned(params->xfer * desc->blksz);
+	ctx.samples = malloc(BENCH_SAMPLES * sizeof(*ctx.samples));
+	if (!buf || !ctx.samples) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	if (params->write)
+		memset(buf, 0xa5, params->xfer * desc->blksz);
+	ctx.seed = timer_get_us() | 1;
+
+	/* measure the device, not the cache */
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+	blkcache_stats(&cache);
+	blkcache_configure(cache.max_blocks_per_entry, 0);
+#endif
+
+	start = timer_get_us();
+	res->lat_min = ~0UL;
+	do {
+		lbaint_t blk = bench_next_blk(&ctx);
+
+		before = timer_get_us();
+		if (params->write)
+			n = blk_dwrite(desc, blk, params->xfer, buf);
+		else
+			n = blk_dread(desc, blk, params->xfer, buf);
+		us = timer_get_us() - before;
+		if (n != params->xfer) {
+			log_err("Transfer at block " LBAFU " failed\n", blk);
+			ret = -EIO;
+			break;
+		}
+		res->ops++;
+		total_us += us;
+		res->lat_min = min(res->lat_min, us);
+		res->lat_max = max(res->lat_max, us);
+		bench_sample(&ctx, res->ops, us);
+		res->elapsed_us = timer_get_us() - start;
+	} while (res->elapsed_us < params->duration_ms * 1000ULL &&
+		 (!params->max_ops || res->ops < params->max_ops));
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+	blkcache_configure(cache.max_blocks_per_entry, cache.max_entries);
+#endif
+
+	res->bytes = (u64)res->ops * params->xfer * desc->blksz;
+	if (res->ops) {
+		res->lat_avg = div_u64(total_us, res->ops);
+		qsort(ctx.samples, ctx.nsamples, sizeof(*ctx.samples),
+		      bench_cmp);
+		res->lat_p50 = bench_percentile(&ctx, 50);
+		res->lat_p90 = bench_percentile(&ctx, 90);
+		res->lat_p99 = bench_percentile(&ctx, 99);
+	} else {
+		res->lat_min = 0;
+	}
+	log_debug("%lu ops in %lu us\n", res->ops, res->elapsed_us);
+out:
+	free(ctx.samples);
+	free(buf);
+
+	return ret;
+}
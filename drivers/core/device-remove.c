@@ -76,6 +76,9 @@ int device_unbind(struct udevice *dev)
 	if (!dev)
 		return log_msg_ret("dev", -EINVAL);
 
+	if (dev_get_flags(dev) & DM_FLAG_PROBE_PENDING)
+		device_probe_cancel(dev);
+
 	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
 		return log_msg_ret("active", -EINVAL);
 
@@ -204,6 +207,9 @@ int device_remove(struct udevice *dev, uint flags)
 	if (!dev)
 		return -EINVAL;
 
+	if (dev_get_flags(dev) & DM_FLAG_PROBE_PENDING)
+		device_probe_cancel(dev);
+
 	if (!(dev_get_flags(dev) & DM_FLAG_ACTIVATED))
 		return 0;
 
@@ -9,7 +9,9 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <cpu_func.h>
+#include <cyclic.h>
 #include <event.h>
 #include <log.h>
 #include <asm/global_data.h>
@@ -33,6 +35,7 @@
 #include <linux/err.h>
 #include <linux/list.h>
 #include <power-domain.h>
+#include <time.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -477,16 +480,158 @@ static int device_get_dma_constraints(struct udevice *dev)
 	return 0;
 }
 
-int device_probe(struct udevice *dev)
+/**
+ * struct probe_timing - information kept while part of a probe runs
+ *
+ * @start_us: Time when this part started
+ * @heap: Heap use when this part started
+ * @inner_us: Time taken by probes nested inside this one (e.g. of parents)
+ * @inner_heap: Heap used by probes nested inside this one
+ * @outer: Timing of the probe which this one is nested inside, if any
+ */
+struct probe_timing {
+	ulong start_us;
+	ulong heap;
+	uint inner_us;
+	int inner_heap;
+	struct probe_timing *outer;
+};
+
+#if CONFIG_IS_ENABLED(DM_TIMING)
+/**
+ * probe_timing_start() - Start timing part of a device's probe
+ *
+ * The probe is timed in parts, since with CONFIG_DM_ASYNC_PROBE it may finish
+ * from the cyclic function. The innermost part being timed is kept in gd, so
+ * that this works before relocation.
+ *
+ * @dev: Device being probed
+ * @pt: Returns the information needed by probe_timing_end()
+ * @first: true if the probe is starting, to drop the time of any earlier one
+ */
+static void probe_timing_start(struct udevice *dev, struct probe_timing *pt,
+			       bool first)
 {
-	const struct driver *drv;
+	if (first) {
+		dev->probe_us = 0;
+		dev->probe_heap = 0;
+	}
+	pt->inner_us = 0;
+	pt->inner_heap = 0;
+	pt->outer = gd->dm_probe_timing;
+	gd->dm_probe_timing = pt;
+	pt->heap = malloc_heap_used();
+	pt->start_us = timer_get_us();
+}
+
+/* Add the time and heap used to the device, less those of nested probes */
+static void probe_timing_end(struct udevice *dev, struct probe_timing *pt)
+{
+	uint time_us = timer_get_us() - pt->start_us;
+	int heap = malloc_heap_used() - pt->heap;
+
+	dev->probe_us += time_us - pt->inner_us;
+	dev->probe_heap += heap - pt->inner_heap;
+	gd->dm_probe_timing = pt->outer;
+	if (pt->outer) {
+		pt->outer->inner_us += time_us;
+		pt->outer->inner_heap += heap;
+	}
+}
+#else
+static inline void probe_timing_start(struct udevice *dev,
+				      struct probe_timing *pt, bool first)
+{
+}
+
+static inline void probe_timing_end(struct udevice *dev,
+				    struct probe_timing *pt)
+{
+}
+#endif
+
+/**
+ * device_probe_done() - Finish probing a device
+ *
+ * This is device_probe_finish() without the timing, for use when the probe is
+ * already being timed
+ *
+ * @dev: Device being probed
+ * @ret: Result of probing the device in the driver
+ * Return: 0 if OK, -ve on error
+ */
+static int device_probe_done(struct udevice *dev, int ret)
+{
+	if (ret)
+		goto fail;
+	dev_or_flags(dev, DM_FLAG_ACTIVATED);
+
+	ret = uclass_post_probe_device(dev);
+	if (ret)
+		goto fail_uclass;
+
+	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL) {
+		ret = pinctrl_select_state(dev, "default");
+		if (ret && ret != -ENOSYS)
+			log_debug("Device '%s' failed to configure default pinctrl: %d (%s)\n",
+				  dev->name, ret, errno_str(ret));
+	}
+
+	ret = device_notify(dev, EVT_DM_POST_PROBE);
+	if (ret)
+		return ret;
+
+	return 0;
+fail_uclass:
+	if (device_remove(dev, DM_REMOVE_NORMAL)) {
+		dm_warn("%s: Device '%s' failed to remove on error path\n",
+			__func__, dev->name);
+	}
+fail:
+	dev_bic_flags(dev, DM_FLAG_ACTIVATED);
+
+	device_free(dev);
+
+	return ret;
+}
+
+int device_probe_finish(struct udevice *dev, int ret)
+{
+	struct probe_timing timing;
+	int span;
+
+	span = bootstage_span_begin(BOOTSTAGE_SPAN_PROBE, dev->name);
+	probe_timing_start(dev, &timing, false);
+	ret = device_probe_done(dev, ret);
+	probe_timing_end(dev, &timing);
+	bootstage_span_end(span);
+
+	return ret;
+}
+
+int device_probe_poll(struct udevice *dev)
+{
+	struct probe_timing timing;
 	int ret;
 
-	if (!dev)
-		return -EINVAL;
+	probe_timing_start(dev, &timing, false);
+	ret = dev->driver->probe_poll(dev);
+	probe_timing_end(dev, &timing);
 
-	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
-		return 0;
+	return ret;
+}
+
+/**
+ * device_probe_run() - Probe a device whose parents are not probing
+ *
+ * @dev: Device to probe
+ * Return: 0 if OK (the device may still be probing in the background, in
+ *	which case DM_FLAG_PROBE_PENDING is set), -ve on error
+ */
+static int device_probe_run(struct udevice *dev)
+{
+	const struct driver *drv;
+	int ret;
 
 	ret = device_notify(dev, EVT_DM_PRE_PROBE);
 	if (ret)
@@ -581,39 +726,71 @@ int device_probe(struct udevice *dev)
 
 	if (drv->probe) {
 		ret = drv->probe(dev);
-		if (ret)
-			goto fail;
+		if (ret == -EINPROGRESS && drv->probe_poll) {
+			/* finish the probe in the background if possible */
+			if (!device_probe_queue(dev, true)) {
+				/* not active until device_probe_finish() */
+				dev_bic_flags(dev, DM_FLAG_ACTIVATED);
+				return 0;
+			}
+			while ((ret = drv->probe_poll(dev)) == -EAGAIN)
+				schedule();
+		}
 	}
 
-	ret = uclass_post_probe_device(dev);
-	if (ret)
-		goto fail_uclass;
+fail:
+	return device_probe_done(dev, ret);
+}
 
-	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL) {
-		ret = pinctrl_select_state(dev, "default");
-		if (ret && ret != -ENOSYS)
-			log_debug("Device '%s' failed to configure default pinctrl: %d (%s)\n",
-				  dev->name, ret, errno_str(ret));
-	}
+static int device_probe_common(struct udevice *dev, bool async)
+{
+	struct probe_timing timing;
+	int span, ret;
 
-	ret = device_notify(dev, EVT_DM_POST_PROBE);
-	if (ret)
-		return ret;
+	if (!dev)
+		return -EINVAL;
 
-	return 0;
-fail_uclass:
-	if (device_remove(dev, DM_REMOVE_NORMAL)) {
-		dm_warn("%s: Device '%s' failed to remove on error path\n",
-			__func__, dev->name);
+	if (dev_get_flags(dev) & DM_FLAG_PROBE_PENDING)
+		return async ? 0 : device_probe_wait(dev);
+
+	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
+		return 0;
+
+	/*
+	 * If the parent is still being probed in the background, wait for it
+	 * there too, rather than here
+	 */
+	if (async && dev->parent) {
+		ret = device_probe_common(dev->parent, true);
+		if (ret)
+			return ret;
+		if (dev_get_flags(dev->parent) & DM_FLAG_PROBE_PENDING)
+			return device_probe_queue(dev, false);
+		if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
+			return 0;
 	}
-fail:
-	dev_bic_flags(dev, DM_FLAG_ACTIVATED);
 
-	device_free(dev);
+	span = bootstage_span_begin(BOOTSTAGE_SPAN_PROBE, dev->name);
+	probe_timing_start(dev, &timing, true);
+	ret = device_probe_run(dev);
+	probe_timing_end(dev, &timing);
+	bootstage_span_end(span);
+	if (!ret && !async && (dev_get_flags(dev) & DM_FLAG_PROBE_PENDING))
+		ret = device_probe_wait(dev);
 
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+	return device_probe_common(dev, false);
+}
+
+int device_probe_async(struct udevice *dev)
+{
+	return device_probe_common(dev, true);
+}
+
 void *dev_get_plat(const struct udevice *dev)
 {
 	if (!dev) {
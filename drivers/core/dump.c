@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <dm.h>
 #include <malloc.h>
 #include <mapmem.h>
@@ -298,3 +299,71 @@ void dm_dump_mem(struct dm_stats *stats)
 	printf("Drop device name (not SRAM): %x (%d)\n", stats->dev_name_size,
 	       stats->dev_name_size);
 }
+
+#if CONFIG_IS_ENABLED(DM_TIMING)
+static int collect_probed(struct udevice *dev, struct udevice **devs, int upto)
+{
+	struct udevice *child;
+
+	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
+		devs[upto++] = dev;
+	device_foreach_child(child, dev)
+		upto = collect_probed(child, devs, upto);
+
+	return upto;
+}
+
+static int h_cmp_probe_time(const void *d1, const void *d2)
+{
+	const struct udevice *dev1 = *(struct udevice **)d1;
+	const struct udevice *dev2 = *(struct udevice **)d2;
+
+	if (dev1->probe_us != dev2->probe_us)
+		return dev1->probe_us < dev2->probe_us ? 1 : -1;
+
+	return 0;
+}
+
+void dm_dump_timing(int count, bool bootstage)
+{
+	int dev_count, uclasses, num, i;
+	struct udevice **devs;
+	ulong total_us = 0;
+	long total_heap = 0;
+
+	if (!dm_root())
+		return;
+	dm_get_stats(&dev_count, &uclasses);
+	devs = calloc(dev_count + 1, sizeof(struct udevice *));
+	if (!devs) {
+		printf("(out of memory)\n");
+		return;
+	}
+	num = collect_probed(dm_root(), devs, 0);
+	for (i = 0; i < num; i++) {
+		total_us += devs[i]->probe_us;
+		total_heap += devs[i]->probe_heap;
+	}
+	printf("%d devices probed, total time %lu us, heap %ld bytes\n", num,
+	       total_us, total_heap);
+	if (count <= 0)
+		goto done;
+	qsort(devs, num, sizeof(struct udevice *), h_cmp_probe_time);
+
+	printf("\n%11s %10s  %-12s  %-20s  %s\n", "Time (us)", "Heap", "Uclass",
+	       "Driver", "Name");
+	for (i = 0; i < min(count, num); i++) {
+		struct udevice *dev = devs[i];
+
+		print_grouped_ull(dev->probe_us, 9);
+		printf(" %+10d  %-12.12s  %-20.20s  %s\n", dev->probe_heap,
+		       dev->uclass->uc_drv->name, dev->driver->name, dev->name);
+		if (bootstage && bootstage_add_time(dev->name, dev->probe_us)) {
+			printf("No space to add to bootstage\n");
+			bootstage = false;
+		}
+	}
+done:
+	free(devs);
+}
+#endif
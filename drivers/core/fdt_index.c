@@ -0,0 +1,404 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Index of the nodes in a flat device tree
+ *
+ * Nodes are recorded in the order they appear in the tree, along with their
+ * parent, the end of their subtree and a hash of their name. Compatible
+ * strings and phandles are kept in separate arrays, also in tree order. This
+ * lets path, subnode, compatible, phandle and parent lookups avoid walking
+ * the structure block. Any hash match is checked against the tree itself, so
+ * collisions cannot give a wrong result.
+ */
+
+#define LOG_CATEGORY	LOGC_DT
+
+#include <common.h>
+#include <log.h>
+#include <malloc.h>
+#include <asm/global_data.h>
+#include <dm/fdt_index.h>
+#include <linux/string.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Deepest nesting of nodes which can be indexed */
+#define FDT_INDEX_MAX_DEPTH	32
+
+/**
+ * struct fdt_index_node - information about a node
+ *
+ * @offset: Offset of the node in the tree
+ * @parent: Index of the parent node, -1 for the root
+ * @end: Index of the first node after this node's subtree
+ * @name_hash: Hash of the node name, excluding any unit address
+ */
+struct fdt_index_node {
+	int offset;
+	int parent;
+	int end;
+	u32 name_hash;
+};
+
+/**
+ * struct fdt_index_ref - reference to a node from a compatible or phandle
+ *
+ * @key: Hash of the compatible string, or the phandle
+ * @node: Index of the node
+ */
+struct fdt_index_ref {
+	u32 key;
+	int node;
+};
+
+/**
+ * struct fdt_index - index of a flat tree
+ *
+ * @fdt: Indexed tree, NULL if none
+ * @reloc: true if built after relocation
+ * @struct_size: Size of the structure block when the index was built
+ * @count: Number of nodes
+ * @nodes: Node information, in tree order
+ * @compat_count: Number of compatible strings
+ * @compats: Compatible strings, in tree order
+ * @phandle_count: Number of phandles
+ * @phandles: Phandles, in tree order
+ */
+static struct fdt_index {
+	const void *fdt;
+	bool reloc;
+	int struct_size;
+	int count;
+	struct fdt_index_node *nodes;
+	int compat_count;
+	struct fdt_index_ref *compats;
+	int phandle_count;
+	struct fdt_index_ref *phandles;
+} fdt_idx;
+
+/* FNV-1a hash of a string, stopping at @len bytes or a '@' */
+static u32 fdt_index_hash(const char *str, int len, bool unit)
+{
+	u32 hash = 0x811c9dc5;
+	int i;
+
+	for (i = 0; i < len && str[i] && (unit || str[i] != '@'); i++)
+		hash = (hash ^ (u8)str[i]) * 0x01000193;
+
+	return hash;
+}
+
+bool fdt_index_active(const void *fdt)
+{
+	if (!fdt || fdt != fdt_idx.fdt)
+		return false;
+	if (fdt_idx.reloc != !!(gd->flags & GD_FLG_RELOC) ||
+	    fdt_size_dt_struct(fdt) != fdt_idx.struct_size) {
+		fdt_index_drop(fdt);
+		return false;
+	}
+
+	return true;
+}
+
+void fdt_index_drop(const void *fdt)
+{
+	if (!fdt || fdt != fdt_idx.fdt)
+		return;
+	/* memory from before relocation cannot be freed afterwards */
+	if (fdt_idx.reloc == !!(gd->flags & GD_FLG_RELOC))
+		free(fdt_idx.nodes);
+	fdt_idx.fdt = NULL;
+	fdt_idx.nodes = NULL;
+}
+
+/* Count the nodes, compatible strings and phandles */
+static int fdt_index_count(const void *fdt, int *compatsp, int *phandlesp)
+{
+	int ofs, depth, len, n, count = 0;
+	const char *compat;
+
+	*compatsp = 0;
+	*phandlesp = 0;
+	for (ofs = 0, depth = 0; ofs >= 0 && depth >= 0;
+	     ofs = fdt_next_node(fdt, ofs, &depth)) {
+		if (depth >= FDT_INDEX_MAX_DEPTH)
+			return -E2BIG;
+		count++;
+		compat = fdt_getprop(fdt, ofs, "compatible", &len);
+		for (; compat && len > 0; compat += n, len -= n) {
+			n = strnlen(compat, len) + 1;
+			(*compatsp)++;
+		}
+		if (fdt_get_phandle(fdt, ofs))
+			(*phandlesp)++;
+	}
+	if (ofs < 0 && ofs != -FDT_ERR_NOTFOUND)
+		return ofs;
+
+	return count;
+}
+
+int fdt_index_build(const void *fdt)
+{
+	int stack[FDT_INDEX_MAX_DEPTH];
+	int ofs, depth, top, len, i, n;
+	int count, ncompats, nphandles;
+	struct fdt_index_node *nodes;
+	struct fdt_index idx = {};
+	const char *compat, *name;
+	u32 phandle;
+	ulong size;
+
+	fdt_index_drop(fdt_idx.fdt);
+	count = fdt_index_count(fdt, &ncompats, &nphandles);
+	if (count < 0)
+		return count;
+	size = count * sizeof(*nodes) +
+		(ncompats + nphandles) * sizeof(struct fdt_index_ref);
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	/* leave most of the early malloc() pool for devices */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    size > (gd->malloc_limit - gd->malloc_ptr) / 2) {
+		log_debug("Not enough space for index (%lx bytes)\n", size);
+		return -ENOSPC;
+	}
+#endif
+	nodes = malloc(size);
+	if (!nodes)
+		return -ENOMEM;
+	idx.nodes = nodes;
+	idx.compats = (struct fdt_index_ref *)(nodes + count);
+	idx.phandles = idx.compats + ncompats;
+
+	top = -1;
+	for (ofs = 0, depth = 0, i = 0; i < count;
+	     ofs = fdt_next_node(fdt, ofs, &depth), i++) {
+		/* nodes at this depth or deeper have no more subnodes */
+		for (; top >= depth; top--)
+			nodes[stack[top]].end = i;
+		stack[++top] = i;
+
+		nodes[i].offset = ofs;
+		nodes[i].parent = depth ? stack[depth - 1] : -1;
+		name = fdt_get_name(fdt, ofs, &len);
+		nodes[i].name_hash = fdt_index_hash(name, len, false);
+
+		compat = fdt_getprop(fdt, ofs, "compatible", &len);
+		for (; compat && len > 0; compat += n, len -= n) {
+			n = strnlen(compat, len) + 1;
+			idx.compats[idx.compat_count].key =
+				fdt_index_hash(compat, n, true);
+			idx.compats[idx.compat_count++].node = i;
+		}
+		phandle = fdt_get_phandle(fdt, ofs);
+		if (phandle) {
+			idx.phandles[idx.phandle_count].key = phandle;
+			idx.phandles[idx.phandle_count++].node = i;
+		}
+	}
+	for (; top >= 0; top--)
+		nodes[stack[top]].end = count;
+
+	idx.fdt = fdt;
+	idx.reloc = gd->flags & GD_FLG_RELOC;
+	idx.struct_size = fdt_size_dt_struct(fdt);
+	idx.count = count;
+	fdt_idx = idx;
+	log_debug("Indexed %d nodes, %d compatible strings, %d phandles\n",
+		  count, idx.compat_count, idx.phandle_count);
+
+	return 0;
+}
+
+/* Find the index of the node at @offset, -1 if none */
+static int fdt_index_find(int offset)
+{
+	int lo = 0, hi = fdt_idx.count;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (fdt_idx.nodes[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < fdt_idx.count && fdt_idx.nodes[lo].offset == offset)
+		return lo;
+
+	return -1;
+}
+
+/* Same as libfdt's fdt_nodename_eq_() */
+static bool fdt_index_name_eq(const void *fdt, int offset, const char *s,
+			      int len)
+{
+	const char *p;
+	int olen;
+
+	p = fdt_get_name(fdt, offset, &olen);
+	if (!p || olen < len || memcmp(p, s, len))
+		return false;
+
+	return !p[len] || (!memchr(s, '@', len) && p[len] == '@');
+}
+
+static int fdt_index_subnode_namelen(const void *fdt, int parent,
+				     const char *name, int namelen)
+{
+	u32 hash = fdt_index_hash(name, namelen, false);
+	const struct fdt_index_node *node;
+	int i;
+
+	for (i = parent + 1; i < fdt_idx.nodes[parent].end;
+	     i = fdt_idx.nodes[i].end) {
+		node = &fdt_idx.nodes[i];
+		if (node->name_hash == hash &&
+		    fdt_index_name_eq(fdt, node->offset, name, namelen))
+			return i;
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+int fdt_index_subnode_offset(const void *fdt, int parentoffset,
+			     const char *name)
+{
+	int parent, i;
+
+	if (!fdt_index_active(fdt))
+		return fdt_subnode_offset(fdt, parentoffset, name);
+	parent = fdt_index_find(parentoffset);
+	if (parent < 0)
+		return fdt_subnode_offset(fdt, parentoffset, name);
+	i = fdt_index_subnode_namelen(fdt, parent, name, strlen(name));
+
+	return i < 0 ? i : fdt_idx.nodes[i].offset;
+}
+
+/* Same as fdt_path_offset_namelen() but returning a node index */
+static int fdt_index_path(const void *fdt, const char *path, int len)
+{
+	const char *end = path + len, *p = path, *q;
+	int i = 0;
+
+	if (*path != '/') {
+		q = memchr(path, '/', len);
+		if (!q)
+			q = end;
+		i = fdt_index_subnode_namelen(fdt, 0, "aliases", 7);
+		if (i < 0)
+			return -FDT_ERR_BADPATH;
+		p = fdt_getprop_namelen(fdt, fdt_idx.nodes[i].offset, path,
+					q - path, NULL);
+		if (!p || *p != '/')
+			return -FDT_ERR_BADPATH;
+		i = fdt_index_path(fdt, p, strlen(p));
+		if (i < 0)
+			return i;
+		p = q;
+	}
+
+	while (p < end) {
+		while (*p == '/') {
+			if (++p == end)
+				return i;
+		}
+		q = memchr(p, '/', end - p);
+		if (!q)
+			q = end;
+		i = fdt_index_subnode_namelen(fdt, i, p, q - p);
+		if (i < 0)
+			return i;
+		p = q;
+	}
+
+	return i;
+}
+
+int fdt_index_path_offset(const void *fdt, const char *path)
+{
+	int i;
+
+	if (!fdt_index_active(fdt))
+		return fdt_path_offset(fdt, path);
+	i = fdt_index_path(fdt, path, strlen(path));
+
+	return i < 0 ? i : fdt_idx.nodes[i].offset;
+}
+
+int fdt_index_node_offset_by_compatible(const void *fdt, int startoffset,
+					const char *compatible)
+{
+	u32 hash = fdt_index_hash(compatible, INT_MAX, true);
+	const struct fdt_index_ref *ref;
+	int start = 0, lo, hi, ofs;
+
+	if (!fdt_index_active(fdt))
+		return fdt_node_offset_by_compatible(fdt, startoffset,
+						     compatible);
+	if (startoffset >= 0) {
+		start = fdt_index_find(startoffset);
+		if (start < 0)
+			return fdt_node_offset_by_compatible(fdt, startoffset,
+							     compatible);
+		start++;
+	}
+
+	/* find the first compatible string after the start node */
+	lo = 0;
+	hi = fdt_idx.compat_count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (fdt_idx.compats[mid].node < start)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (ref = &fdt_idx.compats[lo];
+	     ref < fdt_idx.compats + fdt_idx.compat_count; ref++) {
+		if (ref->key != hash)
+			continue;
+		ofs = fdt_idx.nodes[ref->node].offset;
+		if (!fdt_node_check_compatible(fdt, ofs, compatible))
+			return ofs;
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+int fdt_index_node_offset_by_phandle(const void *fdt, uint32_t phandle)
+{
+	const struct fdt_index_ref *ref;
+	int ofs;
+
+	if (!fdt_index_active(fdt) || !phandle || phandle == (uint32_t)-1)
+		return fdt_node_offset_by_phandle(fdt, phandle);
+	for (ref = fdt_idx.phandles;
+	     ref < fdt_idx.phandles + fdt_idx.phandle_count; ref++) {
+		if (ref->key != phandle)
+			continue;
+		ofs = fdt_idx.nodes[ref->node].offset;
+		if (fdt_get_phandle(fdt, ofs) == phandle)
+			return ofs;
+	}
+
+	/* the phandle may have been changed in place */
+	return fdt_node_offset_by_phandle(fdt, phandle);
+}
+
+int fdt_index_parent_offset(const void *fdt, int nodeoffset)
+{
+	int i;
+
+	if (!fdt_index_active(fdt))
+		return fdt_parent_offset(fdt, nodeoffset);
+	i = fdt_index_find(nodeoffset);
+	if (i < 0)
+		return fdt_parent_offset(fdt, nodeoffset);
+	if (fdt_idx.nodes[i].parent < 0)
+		return -FDT_ERR_NOTFOUND;
+
+	return fdt_idx.nodes[fdt_idx.nodes[i].parent].offset;
+}
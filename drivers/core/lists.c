@@ -18,7 +18,12 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
+#include <asm/global_data.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -181,11 +186,158 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   struct driver *drv, bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/**
+ * struct compat_slot - entry in the compatible-string index
+ *
+ * @id: Entry in the driver's of_match table, NULL if the slot is empty
+ * @hash: Hash of the compatible string
+ * @drv: Position of the driver in the linker list
+ */
+struct compat_slot {
+	const struct udevice_id *id;
+	uint hash;
+	uint drv;
+};
+
+/**
+ * struct compat_index - hash table of all compatible strings of all drivers
+ *
+ * The table uses linear probing and is filled in linker-list order, so the
+ * first match along a chain is the one a search of all drivers would find.
+ *
+ * @slots: Hash table, NULL if not built yet
+ * @mask: Number of slots minus one
+ * @disabled: true to search all drivers instead
+ */
+struct compat_index {
+	struct compat_slot *slots;
+	uint mask;
+	bool disabled;
+};
+
+static struct compat_index compat_index;
+
+static uint compat_hash(const char *str)
+{
+	uint hash = 0;
+
+	while (*str)
+		hash = hash * 31 + *str++;
+
+	return hash;
+}
+
+static int compat_index_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct compat_slot *slots;
+	uint count = 0, size, i, pos;
+
+	for (i = 0; i < n_ents; i++) {
+		for (id = driver[i].of_match; id && id->compatible; id++)
+			count++;
+	}
+
+	/* keep the table no more than half full so that chains stay short */
+	size = roundup_pow_of_two(max(count * 2, 16U));
+	slots = calloc(size, sizeof(*slots));
+	if (!slots)
+		return log_msg_ret("idx", -ENOMEM);
+
+	for (i = 0; i < n_ents; i++) {
+		for (id = driver[i].of_match; id && id->compatible; id++) {
+			uint hash = compat_hash(id->compatible);
+
+			for (pos = hash & (size - 1); slots[pos].id;
+			     pos = (pos + 1) & (size - 1))
+				;
+			slots[pos].id = id;
+			slots[pos].hash = hash;
+			slots[pos].drv = i;
+		}
+	}
+	compat_index.slots = slots;
+	compat_index.mask = size - 1;
+	log_debug("indexed %u compatible strings in %u slots\n", count, size);
+
+	return 0;
+}
+
+/*
+ * The index is built on first use after relocation, when there is enough
+ * memory for it and before the full device tree is scanned
+ */
+static bool compat_index_ready(void)
+{
+	if (compat_index.disabled)
+		return false;
+	if (compat_index.slots)
+		return true;
+	if (!(gd->flags & GD_FLG_RELOC))
+		return false;
+	if (compat_index_build()) {
+		compat_index.disabled = true;
+		return false;
+	}
+
+	return true;
+}
+
+static struct driver *compat_index_lookup(const char *compat,
+					  const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	uint hash = compat_hash(compat);
+	struct compat_slot *slot;
+	uint pos;
+
+	for (pos = hash & compat_index.mask; compat_index.slots[pos].id;
+	     pos = (pos + 1) & compat_index.mask) {
+		slot = &compat_index.slots[pos];
+		if (slot->hash == hash && !strcmp(slot->id->compatible, compat)) {
+			*idp = slot->id;
+			return driver + slot->drv;
+		}
+	}
+
+	return NULL;
+}
+
+bool lists_compat_index_set_enabled(bool enable)
+{
+	bool old = !compat_index.disabled;
+
+	compat_index.disabled = !enable;
+
+	return old;
+}
+#endif
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	if (compat_index_ready())
+		return compat_index_lookup(compat, idp);
+#endif
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   struct driver *drv, bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -223,20 +375,16 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 			  compat);
 
 		id = NULL;
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			if (drv) {
-				if (drv != entry)
-					continue;
-				if (!entry->of_match)
-					break;
-			}
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
+		if (drv) {
+			if (drv->of_match &&
+			    driver_check_compatible(drv->of_match, &id, compat))
+				continue;
+			entry = drv;
+		} else {
+			entry = lists_driver_lookup_compat(compat, &id);
+			if (!entry)
+				continue;
 		}
-		if (entry == driver + n_ents)
-			continue;
 
 		if (pre_reloc_only) {
 			if (!ofnode_pre_reloc(node) &&
@@ -22,6 +22,7 @@
 #include <common.h>
 #include <log.h>
 #include <malloc.h>
+#include <of_live.h>
 #include <asm/global_data.h>
 #include <linux/bug.h>
 #include <linux/libfdt.h>
@@ -150,7 +151,7 @@ struct device_node *of_find_all_nodes(struct device_node *prev)
 
 	if (!prev) {
 		np = gd->of_root;
-	} else if (prev->child) {
+	} else if (of_node_child(prev)) {
 		np = prev->child;
 	} else {
 		/*
@@ -302,7 +303,7 @@ static struct device_node *__of_get_next_child(const struct device_node *node,
 	if (!node)
 		return NULL;
 
-	next = prev ? prev->sibling : node->child;
+	next = prev ? prev->sibling : of_node_child(node);
 	/*
 	 * coverity[dead_error_line : FALSE]
 	 * Dead code here since our current implementation of of_node_get()
@@ -404,11 +405,60 @@ struct device_node *of_find_node_opts_by_path(struct device_node *root,
 	return np;
 }
 
+/**
+ * struct lazy_compat - what to find when searching a lazy tree by compatible
+ *
+ * @type: Device type to match, or NULL for any
+ * @compatible: Compatible string to match
+ */
+struct lazy_compat {
+	const char *type;
+	const char *compatible;
+};
+
+/* Same as of_device_is_compatible() but for a node in either tree */
+static bool lazy_match_compat(const void *fdt, int offset,
+			      const struct device_node *np, const void *priv)
+{
+	const struct lazy_compat *lc = priv;
+	const char *cp, *type;
+	int len, n;
+
+	if (np)
+		return of_device_is_compatible(np, lc->compatible, lc->type,
+					       NULL);
+
+	if (lc->compatible && lc->compatible[0]) {
+		cp = fdt_getprop(fdt, offset, "compatible", &len);
+		for (; cp && len > 0; cp += n, len -= n) {
+			n = strnlen(cp, len) + 1;
+			if (!of_compat_cmp(cp, lc->compatible,
+					   strlen(lc->compatible)))
+				break;
+		}
+		if (!cp || len <= 0)
+			return false;
+	}
+	if (lc->type && lc->type[0]) {
+		type = fdt_getprop(fdt, offset, "device_type", NULL);
+		if (!type || of_node_cmp(lc->type, type))
+			return false;
+	}
+
+	return true;
+}
+
 struct device_node *of_find_compatible_node(struct device_node *from,
 		const char *type, const char *compatible)
 {
 	struct device_node *np;
 
+	if (of_live_is_lazy(from ? from : gd_of_root())) {
+		struct lazy_compat lc = { type, compatible };
+
+		return of_live_find(from, lazy_match_compat, &lc);
+	}
+
 	for_each_of_allnodes_from(from, np)
 		if (of_device_is_compatible(np, compatible, type, NULL) &&
 		    of_node_get(np))
@@ -429,12 +479,45 @@ static int of_device_has_prop_value(const struct device_node *device,
 	return !memcmp(prop->value, propval, proplen);
 }
 
+/**
+ * struct lazy_prop - what to find when searching a lazy tree by property
+ *
+ * @name: Property name
+ * @val: Property value
+ * @len: Length of @val in bytes
+ */
+struct lazy_prop {
+	const char *name;
+	const void *val;
+	int len;
+};
+
+static bool lazy_match_prop(const void *fdt, int offset,
+			    const struct device_node *np, const void *priv)
+{
+	const struct lazy_prop *lp = priv;
+	const void *val;
+	int len;
+
+	if (np)
+		return of_device_has_prop_value(np, lp->name, lp->val, lp->len);
+	val = fdt_getprop(fdt, offset, lp->name, &len);
+
+	return val && len == lp->len && !memcmp(val, lp->val, len);
+}
+
 struct device_node *of_find_node_by_prop_value(struct device_node *from,
 					       const char *propname,
 					       const void *propval, int proplen)
 {
 	struct device_node *np;
 
+	if (of_live_is_lazy(from ? from : gd_of_root())) {
+		struct lazy_prop lp = { propname, propval, proplen };
+
+		return of_live_find(from, lazy_match_prop, &lp);
+	}
+
 	for_each_of_allnodes_from(from, np) {
 		if (of_device_has_prop_value(np, propname, propval, proplen) &&
 		    of_node_get(np))
@@ -445,6 +528,60 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 	return np;
 }
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+/* Largest phandle for which a table is built, to bound the memory used */
+#define PHANDLE_TABLE_MAX	0x10000
+
+/**
+ * struct phandle_table - nodes of a live tree, indexed by phandle
+ *
+ * @root: Root of the tree the table belongs to, NULL if none
+ * @nodes: Node for each phandle, NULL if there is none
+ * @max: Largest phandle in the table
+ */
+static struct phandle_table {
+	struct device_node *root;
+	struct device_node **nodes;
+	phandle max;
+} phandle_table;
+
+int of_phandle_table_build(struct device_node *root)
+{
+	struct device_node *np, **nodes;
+	phandle max = 0;
+
+	for_each_of_allnodes_from(root, np)
+		max = max(max, np->phandle);
+	if (max > PHANDLE_TABLE_MAX)
+		return -E2BIG;
+	nodes = calloc(max + 1, sizeof(*nodes));
+	if (!nodes)
+		return -ENOMEM;
+	for_each_of_allnodes_from(root, np) {
+		if (np->phandle && !nodes[np->phandle])
+			nodes[np->phandle] = np;
+	}
+
+	of_phandle_table_free(phandle_table.root);
+	phandle_table.root = root;
+	phandle_table.nodes = nodes;
+	phandle_table.max = max;
+	debug("%s: max phandle %u\n", __func__, max);
+
+	return 0;
+}
+
+void of_phandle_table_free(struct device_node *root)
+{
+	if (!root || root != phandle_table.root)
+		return;
+	free(phandle_table.nodes);
+	phandle_table.root = NULL;
+	phandle_table.nodes = NULL;
+	phandle_table.max = 0;
+}
+#endif
+
 struct device_node *of_find_node_by_phandle(struct device_node *root,
 					    phandle handle)
 {
@@ -453,6 +590,17 @@ struct device_node *of_find_node_by_phandle(struct device_node *root,
 	if (!handle)
 		return NULL;
 
+	if (of_live_is_lazy(root ?: gd_of_root()))
+		return of_live_find_phandle(root ?: gd_of_root(), handle);
+
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+	/* phandles are only set when unflattening, so the table stays valid */
+	if (phandle_table.root && phandle_table.root == (root ?: gd_of_root())) {
+		if (handle > phandle_table.max)
+			return NULL;
+		return of_node_get(phandle_table.nodes[handle]);
+	}
+#endif
 	for_each_of_allnodes_from(root, np)
 		if (np->phandle == handle)
 			break;
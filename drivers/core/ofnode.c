@@ -6,6 +6,7 @@
 
 #define LOG_CATEGORY	LOGC_DT
 
+#include <abuf.h>
 #include <common.h>
 #include <dm.h>
 #include <fdtdec.h>
@@ -14,6 +15,7 @@
 #include <malloc.h>
 #include <of_live.h>
 #include <linux/libfdt.h>
+#include <dm/fdt_index.h>
 #include <dm/of_access.h>
 #include <dm/of_addr.h>
 #include <dm/ofnode.h>
@@ -98,6 +100,23 @@ void oftree_dispose(oftree tree)
 		of_live_free(tree.np);
 }
 
+int oftree_to_fdt(oftree tree, struct abuf *buf)
+{
+	void *fdt;
+	int ret;
+
+	if (of_live_active()) {
+		ret = of_live_flatten(ofnode_to_np(oftree_root(tree)), buf);
+		if (ret)
+			return log_msg_ret("flt", ret);
+	} else {
+		fdt = oftree_lookup_fdt(tree);
+		abuf_init_set(buf, fdt, fdt_totalsize(fdt));
+	}
+
+	return 0;
+}
+
 void *ofnode_lookup_fdt(ofnode node)
 {
 	if (gd->flags & GD_FLG_RELOC) {
@@ -477,13 +496,13 @@ ofnode ofnode_find_subnode(ofnode node, const char *subnode_name)
 	if (ofnode_is_np(node)) {
 		struct device_node *np = ofnode_to_np(node);
 
-		for (np = np->child; np; np = np->sibling) {
+		for (np = of_node_child(np); np; np = np->sibling) {
 			if (!strcmp(subnode_name, np->name))
 				break;
 		}
 		subnode = np_to_ofnode(np);
 	} else {
-		int ooffset = fdt_subnode_offset(ofnode_to_fdt(node),
+		int ooffset = fdt_index_subnode_offset(ofnode_to_fdt(node),
 				ofnode_to_offset(node), subnode_name);
 		subnode = noffset_to_ofnode(node, ooffset);
 	}
@@ -535,7 +554,7 @@ ofnode ofnode_first_subnode(ofnode node)
 {
 	assert(ofnode_valid(node));
 	if (ofnode_is_np(node))
-		return np_to_ofnode(node.np->child);
+		return np_to_ofnode(of_node_child(node.np));
 
 	return noffset_to_ofnode(node,
 		fdt_first_subnode(ofnode_to_fdt(node), ofnode_to_offset(node)));
@@ -560,8 +579,8 @@ ofnode ofnode_get_parent(ofnode node)
 	if (ofnode_is_np(node))
 		parent = np_to_ofnode(of_get_parent(ofnode_to_np(node)));
 	else
-		parent.of_offset = fdt_parent_offset(ofnode_to_fdt(node),
-						     ofnode_to_offset(node));
+		parent.of_offset = fdt_index_parent_offset(
+			ofnode_to_fdt(node), ofnode_to_offset(node));
 
 	return parent;
 }
@@ -611,8 +630,8 @@ ofnode ofnode_get_by_phandle(uint phandle)
 	if (of_live_active())
 		node = np_to_ofnode(of_find_node_by_phandle(NULL, phandle));
 	else
-		node.of_offset = fdt_node_offset_by_phandle(gd->fdt_blob,
-							    phandle);
+		node.of_offset = fdtdec_node_offset_by_phandle(gd->fdt_blob,
+							       phandle);
 
 	return node;
 }
@@ -625,8 +644,8 @@ ofnode oftree_get_by_phandle(oftree tree, uint phandle)
 		node = np_to_ofnode(of_find_node_by_phandle(tree.np, phandle));
 	else
 		node = ofnode_from_tree_offset(tree,
-			fdt_node_offset_by_phandle(oftree_lookup_fdt(tree),
-						   phandle));
+			fdtdec_node_offset_by_phandle(oftree_lookup_fdt(tree),
+						      phandle));
 
 	return node;
 }
@@ -844,7 +863,8 @@ ofnode ofnode_path(const char *path)
 	if (of_live_active())
 		return np_to_ofnode(of_find_node_by_path(path));
 	else
-		return offset_to_ofnode(fdt_path_offset(gd->fdt_blob, path));
+		return offset_to_ofnode(fdt_index_path_offset(gd->fdt_blob,
+							      path));
 }
 
 ofnode oftree_root(oftree tree)
@@ -864,7 +884,7 @@ ofnode oftree_path(oftree tree, const char *path)
 	} else if (*path != '/' && tree.fdt != gd->fdt_blob) {
 		return ofnode_null();  /* Aliases only on control FDT */
 	} else {
-		int offset = fdt_path_offset(tree.fdt, path);
+		int offset = fdt_index_path_offset(tree.fdt, path);
 
 		return ofnode_from_tree_offset(tree, offset);
 	}
@@ -1296,8 +1316,8 @@ int ofnode_read_addr_cells(ofnode node)
 	if (ofnode_is_np(node)) {
 		return of_n_addr_cells(ofnode_to_np(node));
 	} else {
-		int parent = fdt_parent_offset(ofnode_to_fdt(node),
-					       ofnode_to_offset(node));
+		int parent = fdt_index_parent_offset(ofnode_to_fdt(node),
+						     ofnode_to_offset(node));
 
 		return fdt_address_cells(ofnode_to_fdt(node), parent);
 	}
@@ -1308,8 +1328,8 @@ int ofnode_read_size_cells(ofnode node)
 	if (ofnode_is_np(node)) {
 		return of_n_size_cells(ofnode_to_np(node));
 	} else {
-		int parent = fdt_parent_offset(ofnode_to_fdt(node),
-					       ofnode_to_offset(node));
+		int parent = fdt_index_parent_offset(ofnode_to_fdt(node),
+						     ofnode_to_offset(node));
 
 		return fdt_size_cells(ofnode_to_fdt(node), parent);
 	}
@@ -1451,7 +1471,7 @@ ofnode ofnode_by_compatible(ofnode from, const char *compat)
 			compat));
 	} else {
 		return noffset_to_ofnode(from,
-			fdt_node_offset_by_compatible(ofnode_to_fdt(from),
+			fdt_index_node_offset_by_compatible(ofnode_to_fdt(from),
 					ofnode_to_offset(from), compat));
 	}
 }
@@ -1490,6 +1510,8 @@ int ofnode_write_prop(ofnode node, const char *propname, const void *value,
 			free(newval);
 		return ret;
 	} else {
+		/* the index cannot tell if a property is rewritten in place */
+		fdt_index_drop(ofnode_to_fdt(node));
 		return fdt_setprop(ofnode_to_fdt(node), ofnode_to_offset(node),
 				   propname, value, len);
 	}
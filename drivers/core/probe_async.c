@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Probing devices in the background
+ *
+ * A driver with a probe_poll() method can return -EINPROGRESS from probe() to
+ * say that the hardware has been started but is not ready yet, e.g. while a
+ * link trains or a hub powers up. The device is then polled from a cyclic
+ * function, so that several slow devices can come up at once. Children of such
+ * a device are queued until it is ready. Anything which needs the device calls
+ * device_probe() as usual, which waits for just that device.
+ */
+
+#define LOG_CATEGORY	LOGC_DM
+
+#include <common.h>
+#include <cyclic.h>
+#include <log.h>
+#include <malloc.h>
+#include <asm/global_data.h>
+#include <dm/device.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/util.h>
+#include <linux/list.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* How often to poll devices which are being probed */
+#define PROBE_POLL_US	1000
+
+/**
+ * struct probe_pending - A device which is being probed in the background
+ *
+ * @sibling: Node in probe_list
+ * @dev: Device being probed
+ * @started: true if the driver's probe() method has been called, false if the
+ *	device is waiting for its parent
+ * @busy: true while the device's probe_poll() method is running
+ * @waited: true if device_probe_wait() is waiting for this device, so that
+ *	it is not polled by anything else
+ */
+struct probe_pending {
+	struct list_head sibling;
+	struct udevice *dev;
+	bool started;
+	bool busy;
+	bool waited;
+};
+
+/* Devices being probed; this is only used after relocation */
+static LIST_HEAD(probe_list);
+
+static void probe_cyclic(void *ctx);
+
+static struct cyclic_info *probe_find_cyclic(void)
+{
+	struct cyclic_info *cyclic;
+
+	hlist_for_each_entry(cyclic, cyclic_get_list(), list) {
+		if (cyclic->func == probe_cyclic)
+			return cyclic;
+	}
+
+	return NULL;
+}
+
+static struct probe_pending *probe_find(struct udevice *dev)
+{
+	struct probe_pending *pp;
+
+	list_for_each_entry(pp, &probe_list, sibling) {
+		if (pp->dev == dev)
+			return pp;
+	}
+
+	return NULL;
+}
+
+static void probe_drop(struct probe_pending *pp)
+{
+	dev_bic_flags(pp->dev, DM_FLAG_PROBE_PENDING);
+	list_del(&pp->sibling);
+	free(pp);
+}
+
+/**
+ * probe_step() - Make progress on probing a device
+ *
+ * @pp: Device to probe, which is freed if probing finishes
+ * Return: -EAGAIN if the device is still not ready, else the result of
+ *	probing it
+ */
+static int probe_step(struct probe_pending *pp)
+{
+	struct udevice *dev = pp->dev;
+	int ret;
+
+	if (pp->started) {
+		pp->busy = true;
+		ret = device_probe_poll(dev);
+		pp->busy = false;
+		if (ret == -EAGAIN)
+			return ret;
+		probe_drop(pp);
+		ret = device_probe_finish(dev, ret);
+	} else {
+		if (dev_get_flags(dev->parent) & DM_FLAG_PROBE_PENDING)
+			return -EAGAIN;
+		probe_drop(pp);
+		ret = device_probe_async(dev);
+	}
+	if (ret)
+		dm_warn("Device '%s' failed to probe: %d\n", dev->name, ret);
+
+	return ret;
+}
+
+/**
+ * probe_run() - Poll each device once
+ *
+ * Return: true if a device finished, so that the list has changed
+ */
+static bool probe_run(void)
+{
+	struct probe_pending *pp;
+
+	list_for_each_entry(pp, &probe_list, sibling) {
+		if (pp->busy || pp->waited)
+			continue;
+		if (probe_step(pp) != -EAGAIN)
+			return true;
+	}
+
+	return false;
+}
+
+static void probe_cyclic(void *ctx)
+{
+	while (probe_run())
+		;
+}
+
+int device_probe_queue(struct udevice *dev, bool started)
+{
+	struct probe_pending *pp;
+
+	if (!(gd->flags & GD_FLG_RELOC))
+		return -ENOSYS;
+	if (!probe_find_cyclic() &&
+	    !cyclic_register(probe_cyclic, PROBE_POLL_US, "dm_probe", NULL))
+		return -ENOMEM;
+
+	pp = calloc(1, sizeof(*pp));
+	if (!pp)
+		return -ENOMEM;
+	pp->dev = dev;
+	pp->started = started;
+	list_add_tail(&pp->sibling, &probe_list);
+	dev_or_flags(dev, DM_FLAG_PROBE_PENDING);
+	log_debug("Device '%s' %s\n", dev->name,
+		  started ? "probing" : "waiting for parent");
+
+	return 0;
+}
+
+int device_probe_wait(struct udevice *dev)
+{
+	struct probe_pending *pp, *parent;
+	int ret = 0;
+
+	/* the entry changes if the device starts probing after its parent */
+	while ((pp = probe_find(dev))) {
+		parent = pp->started ? NULL : probe_find(dev->parent);
+		if (pp->busy || (parent && parent->busy))
+			return -EDEADLK;
+		pp->waited = true;
+		ret = probe_step(pp);
+		if (ret == -EAGAIN) {
+			probe_run();
+			schedule();
+		}
+	}
+
+	/* another caller waited for the same device and finished it */
+	if (ret == -EAGAIN)
+		ret = device_active(dev) ? 0 : -EIO;
+
+	return ret;
+}
+
+int device_probe_cancel(struct udevice *dev)
+{
+	struct probe_pending *pp;
+
+	pp = probe_find(dev);
+	if (pp && !pp->started) {
+		probe_drop(pp);
+		return 0;
+	}
+
+	return device_probe_wait(dev);
+}
+
+int dm_probe_wait_all(void)
+{
+	struct probe_pending *pp;
+	struct cyclic_info *cyclic;
+	int ret;
+
+	while (!list_empty(&probe_list)) {
+		pp = list_first_entry(&probe_list, struct probe_pending,
+				      sibling);
+		ret = device_probe_wait(pp->dev);
+		if (ret == -EDEADLK)
+			return ret;
+	}
+
+	/* the cyclic function cannot be unregistered while it is running */
+	cyclic = probe_find_cyclic();
+	if (cyclic && !(gd->flags & GD_FLG_CYCLIC_RUNNING))
+		cyclic_unregister(cyclic);
+
+	return 0;
+}
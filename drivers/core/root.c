@@ -212,6 +212,8 @@ int dm_init(bool of_live)
 
 int dm_uninit(void)
 {
+	dm_probe_wait_all();
+
 	/* Remove non-vital devices first */
 	device_remove(dm_root(), DM_REMOVE_NON_VITAL);
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
@@ -224,6 +226,7 @@ int dm_uninit(void)
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 int dm_remove_devices_flags(uint flags)
 {
+	dm_probe_wait_all();
 	device_remove(dm_root(), flags);
 
 	return 0;
@@ -373,7 +376,7 @@ static int dm_probe_devices(struct udevice *dev, bool pre_reloc_only)
 		goto probe_children;
 
 	if (dev_get_flags(dev) & DM_FLAG_PROBE_AFTER_BIND) {
-		ret = device_probe(dev);
+		ret = device_probe_async(dev);
 		if (ret)
 			return ret;
 	}
@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <div64.h>
 #include <dfu.h>
+#include <mtd.h>
 #include <spi.h>
 #include <spi_flash.h>
 #include <jffs2/load_kernel.h>
@@ -49,6 +50,12 @@ static int dfu_write_medium_sf(struct dfu_entity *dfu,
 {
 	int ret;
 
+	/* only touch the sectors which change */
+	if (IS_ENABLED(CONFIG_MTD))
+		return mtd_update(&dfu->data.sf.dev->mtd,
+				  dfu->data.sf.start + offset, *len, 0, buf, 0,
+				  NULL);
+
 	ret = spi_flash_erase(dfu->data.sf.dev,
 			      find_sector(dfu, dfu->data.sf.start, offset),
 			      dfu->data.sf.dev->sector_size);
@@ -76,6 +83,9 @@ static int dfu_flush_medium_sf(struct dfu_entity *dfu)
 	if (off != dfu->data.sf.start + dfu->offset)
 		off += dfu->data.sf.dev->sector_size;
 	length = dfu->data.sf.start + dfu->data.sf.size - off;
+	if (length && IS_ENABLED(CONFIG_MTD))
+		return mtd_update(&dfu->data.sf.dev->mtd, off, length, 0, NULL,
+				  0, NULL);
 	if (length)
 		return spi_flash_erase(dfu->data.sf.dev, off, length);
 
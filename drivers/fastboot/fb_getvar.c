@@ -128,7 +128,9 @@ static void getvar_version_bootloader(char *var_parameter, char *response)
 
 static void getvar_downloadsize(char *var_parameter, char *response)
 {
-	fastboot_response("OKAY", response, "0x%08x", fastboot_buf_size);
+	/* a streamed download is not limited by the buffer */
+	fastboot_response("OKAY", response, "0x%08x",
+			  fastboot_stream_armed() ? U32_MAX : fastboot_buf_size);
 }
 
 static void getvar_serialno(char *var_parameter, char *response)
@@ -10,6 +10,7 @@
 
 #include <fastboot.h>
 #include <image-sparse.h>
+#include <mtd.h>
 
 #include <linux/mtd/mtd.h>
 #include <jffs2/jffs2.h>
@@ -92,15 +93,19 @@ static int _fb_nand_write(struct mtd_info *mtd, struct part_info *part,
 			  void *buffer, u32 offset,
 			  size_t length, size_t *written)
 {
-	int flags = WITH_WR_VERIFY;
+	struct mtd_update_stats stats;
+	int ret;
 
-#ifdef CONFIG_FASTBOOT_FLASH_NAND_TRIMFFS
-	flags |= WITH_DROP_FFS;
-#endif
+	/*
+	 * Blocks already holding the data are left alone and erased pages are
+	 * not programmed, so the partition need not be erased beforehand
+	 */
+	ret = mtd_update(mtd, offset, length, part->offset + part->size,
+			 buffer, MTD_UPDATE_VERIFY, &stats);
+	if (written)
+		*written = stats.consumed;
 
-	return nand_write_skip_bad(mtd, offset, &length, written,
-				   part->size - (offset - part->offset),
-				   buffer, flags);
+	return ret;
 }
 
 static lbaint_t fb_nand_sparse_write(struct sparse_storage *info,
@@ -0,0 +1,476 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Write a fastboot download to an MMC partition while it is received
+ *
+ * Normally an image is downloaded into the buffer in full and only written
+ * out by the 'flash' command. With 'oem stream:<partition>' the next download
+ * is instead parsed as it arrives: each time the download buffer fills, the
+ * complete sparse chunks (or blocks of a raw image) in it are written to the
+ * partition and the buffer is reused. The flash command which follows then
+ * just reports the result. This means the write is finished as soon as the
+ * download is, and images larger than the download buffer can be flashed.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <div64.h>
+#include <fastboot.h>
+#include <fastboot-internal.h>
+#include <fb_mmc.h>
+#include <image-sparse.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <part.h>
+#include <sparse_format.h>
+#include <asm/cache.h>
+#include <asm/unaligned.h>
+
+/**
+ * enum stream_state - what the parser expects next in the download
+ *
+ * @STREAM_IDLE: Not streaming
+ * @STREAM_HEADER: Start of the image, which may be a sparse header
+ * @STREAM_CHUNK: Sparse chunk header
+ * @STREAM_RAW: Data of a raw chunk
+ * @STREAM_FILL: Fill value of a fill chunk
+ * @STREAM_SKIP: Data to skip, e.g. a CRC32 value
+ * @STREAM_IMAGE: Data of an image which is not sparse
+ * @STREAM_DONE: All chunks processed
+ */
+enum stream_state {
+	STREAM_IDLE,
+	STREAM_HEADER,
+	STREAM_CHUNK,
+	STREAM_RAW,
+	STREAM_FILL,
+	STREAM_SKIP,
+	STREAM_IMAGE,
+	STREAM_DONE,
+};
+
+/**
+ * struct fb_stream - state of a streamed download
+ *
+ * @armed: true if the next download is to be streamed
+ * @state: Current parser state
+ * @name: Name of the partition being written
+ * @dev_desc: Block device holding the partition
+ * @info: Partition information
+ * @fill: Number of bytes in the download buffer
+ * @hdr: Sparse header, if the image is sparse
+ * @chunks_left: Number of sparse chunks still to come
+ * @left: Number of bytes left in the current chunk
+ * @blk: Next block to write, relative to the start of the partition
+ * @total_blks: Number of sparse blocks covered so far
+ * @fill_buf: Buffer for writing fill chunks
+ * @fill_blks: Size of @fill_buf in blocks
+ * @err: Error message if streaming failed, else NULL
+ * @result: Response to send for the flash command, once streaming is done
+ */
+struct fb_stream {
+	bool armed;
+	enum stream_state state;
+	char name[PART_NAME_LEN];
+	struct blk_desc *dev_desc;
+	struct disk_partition info;
+	u32 fill;
+	sparse_header_t hdr;
+	u32 chunks_left;
+	u64 left;
+	lbaint_t blk;
+	u32 total_blks;
+	u32 *fill_buf;
+	lbaint_t fill_blks;
+	const char *err;
+	char result[FASTBOOT_RESPONSE_LEN];
+};
+
+static struct fb_stream stream;
+
+static int stream_fail(const char *err)
+{
+	if (!stream.err) {
+		pr_err("Streaming to '%s' failed: %s\n", stream.name, err);
+		stream.err = err;
+	}
+
+	return -EIO;
+}
+
+static int stream_write(lbaint_t blkcnt, const void *buf)
+{
+	struct disk_partition *info = &stream.info;
+	lbaint_t done, n;
+
+	if (stream.blk + blkcnt > info->size)
+		return stream_fail("too large for partition");
+	for (done = 0; done < blkcnt; done += n) {
+		n = min_t(lbaint_t, blkcnt - done, FASTBOOT_MAX_BLK_WRITE);
+		if (fastboot_progress_callback)
+			fastboot_progress_callback("writing");
+		if (blk_dwrite(stream.dev_desc, info->start + stream.blk, n,
+			       buf + done * info->blksz) != n)
+			return stream_fail("failed writing to device");
+		stream.blk += n;
+	}
+
+	return 0;
+}
+
+/* Write from @buf, which block devices may need to be aligned */
+static int stream_write_buf(lbaint_t blkcnt, const u8 *buf)
+{
+	u32 blksz = stream.info.blksz;
+	lbaint_t n;
+	int ret;
+
+	if (!((ulong)buf & (ARCH_DMA_MINALIGN - 1)))
+		return stream_write(blkcnt, buf);
+	for (; blkcnt; blkcnt -= n, buf += n * blksz) {
+		n = min(blkcnt, stream.fill_blks);
+		memcpy(stream.fill_buf, buf, n * blksz);
+		ret = stream_write(n, stream.fill_buf);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int stream_fill(lbaint_t blkcnt, u32 val)
+{
+	lbaint_t n;
+	int i, ret;
+
+	for (i = 0; i < stream.fill_blks * stream.info.blksz / sizeof(val); i++)
+		stream.fill_buf[i] = val;
+	for (; blkcnt; blkcnt -= n) {
+		n = min(blkcnt, stream.fill_blks);
+		ret = stream_write(n, stream.fill_buf);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Write as many whole blocks as are available, starting at @buf */
+static int stream_data(u8 **bufp, u32 *availp, bool final)
+{
+	u32 blksz = stream.info.blksz;
+	u8 *buf = *bufp;
+	u64 n;
+	int ret;
+
+	n = *availp;
+	if (stream.state == STREAM_RAW)
+		n = min(n, stream.left);
+	/* the last part of a raw image is padded to a whole block */
+	if (stream.state == STREAM_IMAGE && final && n % blksz) {
+		u32 whole = n - n % blksz;
+
+		if (whole) {
+			ret = stream_write_buf(whole / blksz, buf);
+			if (ret)
+				return ret;
+		}
+		memset(stream.fill_buf, '\0', blksz);
+		memcpy(stream.fill_buf, buf + whole, n % blksz);
+		ret = stream_write(1, stream.fill_buf);
+	} else {
+		n -= n % blksz;
+		if (!n)
+			return 0;
+		ret = stream_write_buf(n / blksz, buf);
+	}
+	if (ret)
+		return ret;
+	*bufp += n;
+	*availp -= n;
+	if (stream.state == STREAM_RAW) {
+		stream.left -= n;
+		if (!stream.left)
+			stream.state = STREAM_CHUNK;
+	}
+
+	return 0;
+}
+
+static int stream_header(const u8 *buf, u32 avail, bool final, u32 *usedp)
+{
+	sparse_header_t *hdr = &stream.hdr;
+
+	*usedp = 0;
+	if (avail < sizeof(*hdr) && !final)
+		return 0;
+	if (avail < sizeof(*hdr) || !is_sparse_image((void *)buf)) {
+		printf("Streaming raw image to '%s'\n", stream.name);
+		stream.state = STREAM_IMAGE;
+		return 0;
+	}
+
+	memcpy(hdr, buf, sizeof(*hdr));
+	if (hdr->file_hdr_sz < sizeof(*hdr) ||
+	    hdr->chunk_hdr_sz < sizeof(chunk_header_t) ||
+	    !hdr->blk_sz || hdr->blk_sz % stream.info.blksz)
+		return stream_fail("sparse image block size issue");
+	if (avail < hdr->file_hdr_sz)
+		return 0;
+
+	printf("Streaming sparse image to '%s'\n", stream.name);
+	stream.chunks_left = hdr->total_chunks;
+	stream.state = STREAM_CHUNK;
+	*usedp = hdr->file_hdr_sz;
+
+	return 0;
+}
+
+static int stream_chunk(const u8 *buf, u32 avail, u32 *usedp)
+{
+	const chunk_header_t *chunk = (const chunk_header_t *)buf;
+	u32 hdr_sz = stream.hdr.chunk_hdr_sz;
+	u64 bytes;
+
+	*usedp = 0;
+	if (!stream.chunks_left) {
+		stream.state = STREAM_DONE;
+		return 0;
+	}
+	if (avail < hdr_sz)
+		return 0;
+
+	bytes = (u64)stream.hdr.blk_sz * chunk->chunk_sz;
+	switch (chunk->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk->total_sz != hdr_sz + bytes)
+			return stream_fail("Bogus chunk size for chunk type Raw");
+		stream.left = bytes;
+		stream.state = bytes ? STREAM_RAW : STREAM_CHUNK;
+		break;
+	case CHUNK_TYPE_FILL:
+		if (chunk->total_sz != hdr_sz + sizeof(u32))
+			return stream_fail("Bogus chunk size for chunk type FILL");
+		stream.left = bytes;
+		stream.state = STREAM_FILL;
+		break;
+	case CHUNK_TYPE_DONT_CARE:
+		stream.blk += lldiv(bytes, stream.info.blksz);
+		if (stream.blk > stream.info.size)
+			return stream_fail("too large for partition");
+		break;
+	case CHUNK_TYPE_CRC32:
+		if (chunk->total_sz < hdr_sz)
+			return stream_fail("Bogus chunk size for chunk type CRC32");
+		stream.left = chunk->total_sz - hdr_sz;
+		stream.state = STREAM_SKIP;
+		break;
+	default:
+		pr_err("Unknown chunk type: %x\n", chunk->chunk_type);
+		return stream_fail("Unknown chunk type");
+	}
+	stream.total_blks += chunk->chunk_sz;
+	stream.chunks_left--;
+	*usedp = hdr_sz;
+
+	return 0;
+}
+
+/**
+ * stream_process() - Write out what is in the download buffer
+ *
+ * Parses the data in the download buffer, writing it to the partition, and
+ * moves anything left over (at most a partial block and a chunk header) to the
+ * start of the buffer.
+ *
+ * @final: true if the download is complete
+ * Return: 0 if OK, -EIO on error
+ */
+static int stream_process(bool final)
+{
+	u8 *buf = fastboot_buf_addr;
+	u32 avail = stream.fill;
+	u32 used;
+	int ret = 0;
+
+	while (!ret && avail) {
+		enum stream_state old = stream.state;
+		u32 old_avail = avail;
+
+		used = 0;
+		switch (stream.state) {
+		case STREAM_HEADER:
+			ret = stream_header(buf, avail, final, &used);
+			break;
+		case STREAM_CHUNK:
+			ret = stream_chunk(buf, avail, &used);
+			break;
+		case STREAM_RAW:
+		case STREAM_IMAGE:
+			ret = stream_data(&buf, &avail, final);
+			break;
+		case STREAM_FILL:
+			if (avail < sizeof(u32))
+				break;
+			ret = stream_fill(lldiv(stream.left, stream.info.blksz),
+					  get_unaligned((u32 *)buf));
+			used = sizeof(u32);
+			stream.state = STREAM_CHUNK;
+			break;
+		case STREAM_SKIP:
+			used = min_t(u64, avail, stream.left);
+			stream.left -= used;
+			if (!stream.left)
+				stream.state = STREAM_CHUNK;
+			break;
+		case STREAM_DONE:
+			/* ignore anything after the last chunk, as before */
+			used = avail;
+			break;
+		case STREAM_IDLE:
+			return stream_fail("not streaming");
+		}
+		buf += used;
+		avail -= used;
+
+		/* stop when more data is needed */
+		if (!ret && stream.state == old && avail == old_avail)
+			break;
+	}
+	if (ret)
+		return ret;
+
+	memmove(fastboot_buf_addr, buf, avail);
+	stream.fill = avail;
+	if (stream.fill == fastboot_buf_size)
+		return stream_fail("download buffer too small");
+
+	return 0;
+}
+
+void fastboot_stream_start(const char *part_name, char *response)
+{
+	struct disk_partition info;
+	struct blk_desc *dev_desc;
+
+	if (!part_name || !*part_name) {
+		stream.armed = false;
+		fastboot_okay(NULL, response);
+		return;
+	}
+	if (fastboot_mmc_get_part_info(part_name, &dev_desc, &info,
+				       response) < 0)
+		return;
+	if (fastboot_buf_size < 4 * info.blksz) {
+		fastboot_fail("download buffer too small", response);
+		return;
+	}
+
+	free(stream.fill_buf);
+	stream.fill_blks = min_t(lbaint_t,
+				 CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info.blksz,
+				 FASTBOOT_MAX_BLK_WRITE);
+	stream.fill_blks = max_t(lbaint_t, stream.fill_blks, 1);
+	stream.fill_buf = malloc_cache_aligned(stream.fill_blks * info.blksz);
+	if (!stream.fill_buf) {
+		fastboot_fail("out of memory", response);
+		return;
+	}
+	strlcpy(stream.name, part_name, sizeof(stream.name));
+	stream.dev_desc = dev_desc;
+	stream.info = info;
+	stream.armed = true;
+	stream.result[0] = '\0';
+	fastboot_okay(NULL, response);
+}
+
+bool fastboot_stream_armed(void)
+{
+	return stream.armed;
+}
+
+int fastboot_stream_begin(void)
+{
+	stream.result[0] = '\0';
+	if (!stream.armed)
+		return -ENOENT;
+	stream.armed = false;
+	stream.state = STREAM_HEADER;
+	stream.fill = 0;
+	stream.blk = 0;
+	stream.total_blks = 0;
+	stream.err = NULL;
+
+	return 0;
+}
+
+bool fastboot_stream_active(void)
+{
+	return stream.state != STREAM_IDLE;
+}
+
+int fastboot_stream_data(const void *data, u32 len)
+{
+	u32 n;
+	int ret;
+
+	if (stream.err)
+		return -EIO;
+	while (len) {
+		n = min(len, fastboot_buf_size - stream.fill);
+		memcpy(fastboot_buf_addr + stream.fill, data, n);
+		stream.fill += n;
+		data += n;
+		len -= n;
+		if (stream.fill == fastboot_buf_size) {
+			ret = stream_process(false);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+int fastboot_stream_finish(char *response)
+{
+	int ret = 0;
+
+	if (!stream.err)
+		ret = stream_process(true);
+	if (!ret && stream.state != STREAM_IMAGE) {
+		if (stream.chunks_left || (stream.state != STREAM_CHUNK &&
+					   stream.state != STREAM_DONE))
+			ret = stream_fail("sparse image is truncated");
+		else if (stream.total_blks != stream.hdr.total_blks)
+			ret = stream_fail("sparse image write failure");
+	}
+	/* a later flash command must not write the partial buffer instead */
+	if (stream.err) {
+		fastboot_fail(stream.err, stream.result);
+		fastboot_fail(stream.err, response);
+	} else {
+		printf("........ wrote " LBAFU " bytes to '%s'\n",
+		       stream.blk * stream.info.blksz, stream.name);
+		fastboot_okay(NULL, stream.result);
+	}
+	stream.state = STREAM_IDLE;
+	free(stream.fill_buf);
+	stream.fill_buf = NULL;
+
+	return stream.err ? -EIO : 0;
+}
+
+bool fastboot_stream_flashed(const char *part_name, char *response)
+{
+	if (!stream.result[0])
+		return false;
+	if (part_name && !strcmp(part_name, stream.name))
+		strlcpy(response, stream.result, FASTBOOT_RESPONSE_LEN);
+	else
+		fastboot_fail("image was streamed to another partition",
+			      response);
+	stream.result[0] = '\0';
+
+	return true;
+}
@@ -17,6 +17,27 @@ int mmc_poll_for_busy(struct mmc *mmc, int timeout);
 
 int mmc_set_blocklen(struct mmc *mmc, int len);
 
+/**
+ * mmc_use_set_block_count() - Check if CMD23 can be used for a transfer
+ *
+ * Multiple-block transfers with a pre-defined block count end by themselves,
+ * so no CMD12 is needed after them
+ *
+ * @mmc: MMC device
+ * @blkcnt: Number of blocks to transfer
+ * Return: true if both host and card support CMD23 and @blkcnt fits in it
+ */
+bool mmc_use_set_block_count(struct mmc *mmc, lbaint_t blkcnt);
+
+/**
+ * mmc_set_block_count() - Send CMD23 to set the length of the next transfer
+ *
+ * @mmc: MMC device
+ * @blkcnt: Number of blocks in the following multiple-block transfer
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt);
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
@@ -31,8 +31,17 @@ struct sandbox_mmc_priv {
 	char *buf;
 	int csize;	/* CSIZE value to report */
 	int size;
+	uint block_count;	/* blocks in next transfer, set by CMD23 */
+	uint cmd_count[64];	/* number of each command received */
 };
 
+uint sandbox_mmc_get_cmd_count(struct udevice *dev, uint cmdidx)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	return priv->cmd_count[cmdidx];
+}
+
 /**
  * sandbox_mmc_send_cmd() - Emulate SD commands
  *
@@ -45,6 +54,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
 	static ulong erase_start, erase_end;
 
+	if (cmd->cmdidx < ARRAY_SIZE(priv->cmd_count))
+		priv->cmd_count[cmd->cmdidx]++;
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
 		memset(cmd->response, '\0', sizeof(cmd->response));
@@ -78,15 +89,24 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 			resp[4] = (cmd->cmdarg & 0xF) << 24;
 		break;
 	}
+	case MMC_CMD_SET_BLOCK_COUNT:
+		priv->block_count = cmd->cmdarg;
+		break;
 	case MMC_CMD_READ_SINGLE_BLOCK:
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
-		memcpy(data->dest, &priv->buf[cmd->cmdarg * data->blocksize],
-		       data->blocks * data->blocksize);
-		break;
 	case MMC_CMD_WRITE_SINGLE_BLOCK:
 	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
-		memcpy(&priv->buf[cmd->cmdarg * data->blocksize], data->src,
-		       data->blocks * data->blocksize);
+		/* a transfer must match any block count set before it */
+		if (priv->block_count && priv->block_count != data->blocks)
+			return -EIO;
+		priv->block_count = 0;
+		if (data->flags == MMC_DATA_READ)
+			memcpy(data->dest,
+			       &priv->buf[cmd->cmdarg * data->blocksize],
+			       data->blocks * data->blocksize);
+		else
+			memcpy(&priv->buf[cmd->cmdarg * data->blocksize],
+			       data->src, data->blocks * data->blocksize);
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
 		break;
@@ -118,7 +138,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3, with CMD23 */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_SCR_CMD23_SUPPORT);
 		break;
 	}
 	default:
@@ -213,7 +234,8 @@ static int sandbox_mmc_bind(struct udevice *dev)
 	struct mmc_config *cfg = &plat->cfg;
 
 	cfg->name = dev->name;
-	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
+	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT |
+			 MMC_CAP_CMD23;
 	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
 	cfg->f_min = 1000000;
 	cfg->f_max = 52000000;
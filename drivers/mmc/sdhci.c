@@ -331,8 +331,7 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 	stat = sdhci_readl(host, SDHCI_INT_STATUS);
 	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
 	if (!ret) {
-		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
-				!is_aligned && (data->flags == MMC_DATA_READ))
+		if (!is_aligned && data->flags == MMC_DATA_READ)
 			memcpy(data->dest, host->align_buffer, trans_bytes);
 		return 0;
 	}
@@ -973,6 +972,9 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	if (SDHCI_GET_VERSION(host) >= SDHCI_SPEC_300) {
 		if (!(caps & SDHCI_CAN_DO_8BIT))
 			cfg->host_caps &= ~MMC_MODE_8BIT;
+		/* let multiple-block transfers end without CMD12 */
+		if (!(host->quirks & SDHCI_QUIRK_NO_CMD23))
+			cfg->host_caps |= MMC_CAP_CMD23;
 	}
 
 	if (host->quirks & SDHCI_QUIRK_BROKEN_HISPD_MODE) {
@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Update a region of flash, erasing and programming only what changed
+ *
+ * Firmware updates mostly rewrite data which is already in the flash.
+ * Reading flash is much faster than erasing and programming it, so each erase
+ * block is read back first and compared with the new data. Unchanged blocks
+ * are skipped, blocks on NOR flash whose changes only clear bits are not
+ * erased, and erases and writes to neighbouring blocks are merged so that
+ * the driver sees as few operations as possible.
+ */
+
+#define LOG_CATEGORY UCLASS_MTD
+
+#include <common.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <mtd.h>
+#include <linux/errno.h>
+#include <linux/mtd/mtd.h>
+#include <linux/string.h>
+
+/**
+ * struct update_ctx - state of an update
+ *
+ * @mtd: MTD device being updated
+ * @flags: Flags (enum mtd_update_flags)
+ * @page: Size of the unit in which blocks are compared and programmed
+ * @old: Buffer holding the current contents of a block
+ * @new: Buffer holding the new contents of a block
+ * @vbuf: Buffer for reading back what was written, if verifying
+ * @erase_start: Offset of the pending erase
+ * @erase_len: Length of the pending erase, 0 if none
+ * @write_start: Offset of the pending write
+ * @write_len: Length of the pending write, 0 if none
+ * @write_buf: Data for the pending write
+ * @stats: Statistics to update
+ */
+struct update_ctx {
+	struct mtd_info *mtd;
+	uint flags;
+	uint page;
+	u_char *old;
+	u_char *new;
+	u_char *vbuf;
+	loff_t erase_start;
+	u64 erase_len;
+	loff_t write_start;
+	size_t write_len;
+	const u_char *write_buf;
+	struct mtd_update_stats *stats;
+};
+
+static bool is_erased(const u_char *buf, size_t len)
+{
+	return !memchr_inv(buf, 0xff, len);
+}
+
+/*
+ * Check whether @new can be programmed over @old without an erase. NOR flash
+ * can clear any bits. Other flash is always erased: a NAND page which reads
+ * back as 0xff may still have programmed OOB/ECC bytes, and NAND pages must be
+ * programmed in order within a block, so reprogramming in place is not safe
+ */
+static bool can_program(struct update_ctx *ctx, const u_char *old,
+			const u_char *new)
+{
+	uint i;
+
+	if (!memcmp(old, new, ctx->page))
+		return true;
+	if (!(ctx->mtd->flags & MTD_BIT_WRITEABLE))
+		return false;
+	for (i = 0; i < ctx->page; i++) {
+		if ((old[i] & new[i]) != new[i])
+			return false;
+	}
+
+	return true;
+}
+
+static int flush_erase(struct update_ctx *ctx)
+{
+	struct erase_info instr = {
+		.mtd	= ctx->mtd,
+		.addr	= ctx->erase_start,
+		.len	= ctx->erase_len,
+	};
+
+	if (!ctx->erase_len)
+		return 0;
+	log_debug("erase %llx+%llx\n", instr.addr, instr.len);
+	ctx->erase_len = 0;
+
+	return mtd_erase(ctx->mtd, &instr);
+}
+
+static int verify(struct update_ctx *ctx)
+{
+	struct mtd_info *mtd = ctx->mtd;
+	size_t done, n, retlen;
+	int ret;
+
+	for (done = 0; done < ctx->write_len; done += n) {
+		n = min_t(size_t, ctx->write_len - done, mtd->erasesize);
+		ret = mtd_read(mtd, ctx->write_start + done, n, &retlen,
+			       ctx->vbuf);
+		if (ret && ret != -EUCLEAN)
+			return ret;
+		if (memcmp(ctx->vbuf, ctx->write_buf + done, n)) {
+			log_err("Verify failed at %llx\n",
+				(u64)ctx->write_start + done);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static int flush_write(struct update_ctx *ctx)
+{
+	size_t retlen;
+	int ret;
+
+	/* any block being written must be erased first */
+	ret = flush_erase(ctx);
+	if (ret || !ctx->write_len)
+		return ret;
+
+	log_debug("write %llx+%zx\n", (u64)ctx->write_start, ctx->write_len);
+	ret = mtd_write(ctx->mtd, ctx->write_start, ctx->write_len, &retlen,
+			ctx->write_buf);
+	if (!ret && retlen != ctx->write_len)
+		ret = -EIO;
+	if (!ret && (ctx->flags & MTD_UPDATE_VERIFY))
+		ret = verify(ctx);
+	ctx->stats->written += ctx->write_len;
+	ctx->write_len = 0;
+
+	return ret;
+}
+
+static int add_erase(struct update_ctx *ctx, loff_t ofs)
+{
+	int ret;
+
+	if (ctx->erase_len && ctx->erase_start + ctx->erase_len == ofs) {
+		ctx->erase_len += ctx->mtd->erasesize;
+		return 0;
+	}
+	ret = flush_erase(ctx);
+	if (ret)
+		return ret;
+	ctx->erase_start = ofs;
+	ctx->erase_len = ctx->mtd->erasesize;
+
+	return 0;
+}
+
+static int add_write(struct update_ctx *ctx, loff_t ofs, const u_char *data)
+{
+	int ret;
+
+	if (ctx->write_len && ctx->write_start + ctx->write_len == ofs &&
+	    ctx->write_buf + ctx->write_len == data) {
+		ctx->write_len += ctx->page;
+		return 0;
+	}
+	ret = flush_write(ctx);
+	if (ret)
+		return ret;
+	ctx->write_start = ofs;
+	ctx->write_buf = data;
+	ctx->write_len = ctx->page;
+
+	return 0;
+}
+
+/**
+ * update_block() - Update part of an erase block
+ *
+ * @ctx: Update context
+ * @blk: Offset of the erase block
+ * @head: Offset of the new data within the block
+ * @len: Number of bytes of new data
+ * @src: New data, or NULL to erase
+ * Return: 0 if OK, -ve on error
+ */
+static int update_block(struct update_ctx *ctx, loff_t blk, uint head,
+			size_t len, const u_char *src)
+{
+	struct mtd_info *mtd = ctx->mtd;
+	bool whole = !head && len == mtd->erasesize;
+	bool unreadable = false, need_erase = false;
+	uint ofs, page = ctx->page;
+	const u_char *data;
+	size_t retlen;
+	int ret;
+
+	ret = mtd_read(mtd, blk, mtd->erasesize, &retlen, ctx->old);
+	/* an uncorrectable block can still be rewritten if none of it is kept */
+	if (ret == -EBADMSG && whole)
+		unreadable = true;
+	else if (ret && ret != -EUCLEAN)
+		return ret;
+
+	if (!unreadable && (src ? !memcmp(ctx->old + head, src, len) :
+			    is_erased(ctx->old + head, len))) {
+		ctx->stats->skipped += len;
+		return 0;
+	}
+
+	memcpy(ctx->new, ctx->old, mtd->erasesize);
+	if (src)
+		memcpy(ctx->new + head, src, len);
+	else
+		memset(ctx->new + head, 0xff, len);
+
+	need_erase = unreadable;
+	for (ofs = 0; ofs < mtd->erasesize && !need_erase; ofs += page) {
+		if (!can_program(ctx, ctx->old + ofs, ctx->new + ofs))
+			need_erase = true;
+	}
+	if (need_erase) {
+		ret = add_erase(ctx, blk);
+		if (ret)
+			return ret;
+		ctx->stats->erased++;
+	} else {
+		ctx->stats->erase_skipped++;
+	}
+
+	for (ofs = 0; ofs < mtd->erasesize; ofs += page) {
+		if (need_erase ? is_erased(ctx->new + ofs, page) :
+		    !memcmp(ctx->old + ofs, ctx->new + ofs, page))
+			continue;
+
+		/*
+		 * Pages wholly inside the new data are written from the
+		 * caller's buffer, so that writes can run on into the next block
+		 */
+		if (src && ofs >= head && ofs + page <= head + len)
+			data = src + ofs - head;
+		else
+			data = ctx->new + ofs;
+		ret = add_write(ctx, blk + ofs, data);
+		if (ret)
+			return ret;
+	}
+
+	/* the block buffer is reused, so any write from it must go out now */
+	if (ctx->write_len && ctx->write_buf >= ctx->new &&
+	    ctx->write_buf < ctx->new + mtd->erasesize)
+		return flush_write(ctx);
+
+	return 0;
+}
+
+int mtd_update(struct mtd_info *mtd, loff_t to, size_t len, loff_t limit,
+	       const u_char *buf, uint flags, struct mtd_update_stats *stats)
+{
+	struct mtd_update_stats dummy;
+	struct update_ctx ctx = {
+		.mtd	= mtd,
+		.flags	= flags,
+		.page	= max(mtd->writesize, mtd->writebufsize),
+	};
+	size_t done, n;
+	loff_t ofs, blk;
+	int ret = 0;
+
+	if (!stats)
+		stats = &dummy;
+	memset(stats, '\0', sizeof(*stats));
+	ctx.stats = stats;
+	if (!limit)
+		limit = mtd->size;
+	if (mtd_mod_by_ws(to, mtd) || limit > mtd->size || to + len > limit)
+		return -EINVAL;
+	if (mtd->erasesize % ctx.page)
+		ctx.page = mtd->writesize;
+
+	ctx.old = malloc_cache_aligned(mtd->erasesize);
+	ctx.new = malloc_cache_aligned(mtd->erasesize);
+	if (flags & MTD_UPDATE_VERIFY)
+		ctx.vbuf = malloc_cache_aligned(mtd->erasesize);
+	if (!ctx.old || !ctx.new ||
+	    ((flags & MTD_UPDATE_VERIFY) && !ctx.vbuf)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (ofs = to, done = 0; done < len; ofs += n, done += n) {
+		uint head = mtd_mod_by_eb(ofs, mtd);
+
+		blk = ofs - head;
+		n = min_t(u64, len - done, mtd->erasesize - head);
+		if (ofs + len - done > limit) {
+			ret = -ENOSPC;
+			break;
+		}
+		if (mtd_can_have_bb(mtd)) {
+			ret = mtd_block_isbad(mtd, blk);
+			if (ret < 0)
+				break;
+			if (ret) {
+				log_debug("skip bad block %llx\n", blk);
+				stats->bad++;
+				ofs = blk + mtd->erasesize;
+				n = 0;
+				ret = 0;
+				continue;
+			}
+		}
+		ret = update_block(&ctx, blk, head, n,
+				   buf ? buf + done : NULL);
+		if (ret)
+			break;
+	}
+	if (!ret)
+		ret = flush_write(&ctx);
+	stats->consumed = ofs - to;
+	log_debug("written %llx, skipped %llx, erased %u, erase skipped %u\n",
+		  stats->written, stats->skipped, stats->erased,
+		  stats->erase_skipped);
+out:
+	free(ctx.vbuf);
+	free(ctx.new);
+	free(ctx.old);
+
+	return ret;
+}
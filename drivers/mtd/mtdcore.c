@@ -169,6 +169,21 @@ bool mtd_dev_list_updated(void)
 	return false;
 }
 
+#if CONFIG_IS_ENABLED(MTD_UBI_ATTACH_CACHE)
+/* Number of erase, write and mark-bad operations on any MTD device */
+static ulong mtd_change_count;
+
+void mtd_note_change(void)
+{
+	mtd_change_count++;
+}
+
+ulong mtd_get_change_count(void)
+{
+	return mtd_change_count;
+}
+#endif
+
 #ifndef __UBOOT__
 static LIST_HEAD(mtd_notifiers);
 
@@ -917,6 +932,7 @@ int mtd_erase(struct mtd_info *mtd, struct erase_info *instr)
 		instr->state = MTD_ERASE_DONE;
 		return 0;
 	}
+	mtd_note_change();
 	return mtd->_erase(mtd, instr);
 }
 EXPORT_SYMBOL_GPL(mtd_erase);
@@ -1020,6 +1036,7 @@ int mtd_write(struct mtd_info *mtd, loff_t to, size_t len, size_t *retlen,
 		return -EROFS;
 	if (!len)
 		return 0;
+	mtd_note_change();
 
 	if (!mtd->_write) {
 		struct mtd_oob_ops ops = {
@@ -1056,6 +1073,7 @@ int mtd_panic_write(struct mtd_info *mtd, loff_t to, size_t len, size_t *retlen,
 		return -EROFS;
 	if (!len)
 		return 0;
+	mtd_note_change();
 	return mtd->_panic_write(mtd, to, len, retlen, buf);
 }
 EXPORT_SYMBOL_GPL(mtd_panic_write);
@@ -1144,6 +1162,7 @@ int mtd_write_oob(struct mtd_info *mtd, loff_t to,
 	if (!mtd->_write_oob && (!mtd->_write || ops->oobbuf))
 		return -EOPNOTSUPP;
 
+	mtd_note_change();
 	if (mtd->_write_oob)
 		return mtd->_write_oob(mtd, to, ops);
 	else
@@ -1660,6 +1679,7 @@ int mtd_block_markbad(struct mtd_info *mtd, loff_t ofs)
 		return -EINVAL;
 	if (!(mtd->flags & MTD_WRITEABLE))
 		return -EROFS;
+	mtd_note_change();
 	return mtd->_block_markbad(mtd, ofs);
 }
 EXPORT_SYMBOL_GPL(mtd_block_markbad);
@@ -180,6 +180,7 @@ static int spi_flash_std_write(struct udevice *dev, u32 offset, size_t len,
 	struct mtd_info *mtd = &flash->mtd;
 	size_t retlen;
 
+	mtd_note_change();
 	return mtd->_write(mtd, offset, len, &retlen, buf);
 }
 
@@ -199,6 +200,7 @@ static int spi_flash_std_erase(struct udevice *dev, u32 offset, size_t len)
 	instr.addr = offset;
 	instr.len = len;
 
+	mtd_note_change();
 	return mtd->_erase(mtd, &instr);
 }
 
@@ -85,6 +85,7 @@
 
 #include <linux/math64.h>
 
+#include <bootstage.h>
 #include <ubi_uboot.h>
 #include "ubi.h"
 
@@ -1241,6 +1242,7 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!vidh)
 		goto out_ech;
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_SCAN, "ubi_scan");
 	for (pnum = start; pnum < ubi->peb_count; pnum++) {
 		cond_resched();
 
@@ -1287,12 +1289,14 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (err)
 		goto out_vidh;
 
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_SCAN);
 	ubi_free_vid_hdr(ubi, vidh);
 	kfree(ech);
 
 	return 0;
 
 out_vidh:
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_SCAN);
 	ubi_free_vid_hdr(ubi, vidh);
 out_ech:
 	kfree(ech);
@@ -1323,6 +1327,288 @@ static struct ubi_attach_info *alloc_ai(void)
 	return ai;
 }
 
+#ifdef CONFIG_MTD_UBI_ATTACH_CACHE
+
+/**
+ * struct ubi_attach_cache - attaching information kept from an earlier scan
+ * @list: link in @attach_cache_list
+ * @ai: copy of the attaching information, as it was after scanning
+ * @name: name of the MTD device which was scanned
+ * @size: size of the MTD device
+ * @offset: offset of the MTD device within its parent
+ * @vid_hdr_offset: VID header offset used for scanning
+ * @image_seq: image sequence number found by scanning
+ * @ro_mode: non-zero if scanning switched the device to read-only mode
+ *
+ * Nothing is written to the flash while U-Boot only reads from UBI volumes, so
+ * attaching the same MTD device again produces the same information. This is
+ * kept for each scanned device and used instead of scanning again, until
+ * anything at all is written to an MTD device.
+ */
+struct ubi_attach_cache {
+	struct list_head list;
+	struct ubi_attach_info *ai;
+	char *name;
+	u64 size;
+	u64 offset;
+	int vid_hdr_offset;
+	int image_seq;
+	int ro_mode;
+};
+
+static LIST_HEAD(attach_cache_list);
+
+/* MTD change count when the entries in @attach_cache_list were added */
+static ulong attach_cache_changes;
+
+/**
+ * append_rb - add a node at the far right of an RB-tree.
+ * @node: node to add
+ * @root: RB-tree to add it to
+ *
+ * Adding the nodes of one tree in order with this function produces a tree
+ * with the same order, whichever way that tree is sorted.
+ */
+static void append_rb(struct rb_node *node, struct rb_root *root)
+{
+	struct rb_node **p = &root->rb_node, *parent = NULL;
+
+	while (*p) {
+		parent = *p;
+		p = &parent->rb_right;
+	}
+	rb_link_node(node, parent, p);
+	rb_insert_color(node, root);
+}
+
+/**
+ * clone_aeb - copy an attaching eraseblock.
+ * @ai: attaching information to allocate the copy for
+ * @aeb: eraseblock to copy
+ *
+ * Returns the copy, or %NULL if out of memory.
+ */
+static struct ubi_ainf_peb *clone_aeb(struct ubi_attach_info *ai,
+				      const struct ubi_ainf_peb *aeb)
+{
+	struct ubi_ainf_peb *new;
+
+	new = kmem_cache_alloc(ai->aeb_slab_cache, GFP_KERNEL);
+	if (new)
+		*new = *aeb;
+
+	return new;
+}
+
+/**
+ * clone_aeb_list - copy a list of attaching eraseblocks.
+ * @ai: attaching information to allocate the copies for
+ * @dst: list to add the copies to
+ * @src: list to copy
+ *
+ * Returns zero in case of success and %-ENOMEM in case of failure.
+ */
+static int clone_aeb_list(struct ubi_attach_info *ai, struct list_head *dst,
+			  struct list_head *src)
+{
+	struct ubi_ainf_peb *aeb, *new;
+
+	list_for_each_entry(aeb, src, u.list) {
+		new = clone_aeb(ai, aeb);
+		if (!new)
+			return -ENOMEM;
+		list_add_tail(&new->u.list, dst);
+	}
+
+	return 0;
+}
+
+/**
+ * clone_ai - make a deep copy of attaching information.
+ * @src: attaching information to copy
+ *
+ * Returns the copy, or %NULL if out of memory.
+ */
+static struct ubi_attach_info *clone_ai(struct ubi_attach_info *src)
+{
+	struct ubi_attach_info *ai;
+	struct ubi_ainf_volume *av, *new_av;
+	struct ubi_ainf_peb *aeb, *new;
+	struct kmem_cache *cache;
+	struct rb_node *rb1, *rb2;
+
+	ai = alloc_ai();
+	if (!ai)
+		return NULL;
+
+	cache = ai->aeb_slab_cache;
+	*ai = *src;
+	ai->aeb_slab_cache = cache;
+	INIT_LIST_HEAD(&ai->corr);
+	INIT_LIST_HEAD(&ai->free);
+	INIT_LIST_HEAD(&ai->erase);
+	INIT_LIST_HEAD(&ai->alien);
+	ai->volumes = RB_ROOT;
+
+	if (clone_aeb_list(ai, &ai->corr, &src->corr) ||
+	    clone_aeb_list(ai, &ai->free, &src->free) ||
+	    clone_aeb_list(ai, &ai->erase, &src->erase) ||
+	    clone_aeb_list(ai, &ai->alien, &src->alien))
+		goto out_ai;
+
+	ubi_rb_for_each_entry(rb1, av, &src->volumes, rb) {
+		new_av = kmalloc(sizeof(struct ubi_ainf_volume), GFP_KERNEL);
+		if (!new_av)
+			goto out_ai;
+		*new_av = *av;
+		new_av->root = RB_ROOT;
+		append_rb(&new_av->rb, &ai->volumes);
+
+		ubi_rb_for_each_entry(rb2, aeb, &av->root, u.rb) {
+			new = clone_aeb(ai, aeb);
+			if (!new)
+				goto out_ai;
+			append_rb(&new->u.rb, &new_av->root);
+		}
+	}
+
+	return ai;
+
+out_ai:
+	destroy_ai(ai);
+	return NULL;
+}
+
+/**
+ * attach_cache_free - free a cache entry.
+ * @ac: entry to free, which must not be in @attach_cache_list
+ */
+static void attach_cache_free(struct ubi_attach_cache *ac)
+{
+	if (ac->ai)
+		destroy_ai(ac->ai);
+	free(ac->name);
+	kfree(ac);
+}
+
+/**
+ * attach_cache_drop - forget all cached attaching information.
+ */
+static void attach_cache_drop(void)
+{
+	struct ubi_attach_cache *ac, *tmp;
+
+	list_for_each_entry_safe(ac, tmp, &attach_cache_list, list) {
+		list_del(&ac->list);
+		attach_cache_free(ac);
+	}
+}
+
+/**
+ * attach_cache_find - find the cache entry for a UBI device.
+ * @ubi: UBI device description object
+ *
+ * Returns the entry, or %NULL if the device has not been scanned or an MTD
+ * device has been changed since it was.
+ */
+static struct ubi_attach_cache *attach_cache_find(struct ubi_device *ubi)
+{
+	struct mtd_info *mtd = ubi->mtd;
+	struct ubi_attach_cache *ac;
+
+	if (attach_cache_changes != mtd_get_change_count()) {
+		attach_cache_drop();
+		attach_cache_changes = mtd_get_change_count();
+		return NULL;
+	}
+
+	list_for_each_entry(ac, &attach_cache_list, list) {
+		if (!strcmp(ac->name, mtd->name) && ac->size == mtd->size &&
+		    ac->offset == mtd->offset &&
+		    ac->vid_hdr_offset == ubi->vid_hdr_offset)
+			return ac;
+	}
+
+	return NULL;
+}
+
+/**
+ * attach_cache_get - get attaching information from the cache.
+ * @ubi: UBI device description object
+ *
+ * Returns a copy of the attaching information found by the last scan of this
+ * device, or %NULL if there is none or it may be out of date.
+ */
+static struct ubi_attach_info *attach_cache_get(struct ubi_device *ubi)
+{
+	struct ubi_attach_cache *ac;
+	struct ubi_attach_info *ai;
+
+	ac = attach_cache_find(ubi);
+	if (!ac)
+		return NULL;
+
+	ai = clone_ai(ac->ai);
+	if (!ai)
+		return NULL;
+	ubi->image_seq = ac->image_seq;
+	if (ac->ro_mode)
+		ubi->ro_mode = 1;
+	ubi_msg(ubi, "attached from cache of earlier scan");
+
+	return ai;
+}
+
+/**
+ * attach_cache_put - add attaching information to the cache.
+ * @ubi: UBI device description object
+ * @ai: attaching information found by scanning
+ *
+ * Failing to allocate memory for the cache is not an error, the device is
+ * just scanned again next time.
+ */
+static void attach_cache_put(struct ubi_device *ubi,
+			     struct ubi_attach_info *ai)
+{
+	struct ubi_attach_cache *ac;
+
+	ac = attach_cache_find(ubi);
+	if (ac) {
+		list_del(&ac->list);
+		attach_cache_free(ac);
+	}
+
+	ac = kzalloc(sizeof(*ac), GFP_KERNEL);
+	if (!ac)
+		return;
+	ac->ai = clone_ai(ai);
+	ac->name = strdup(ubi->mtd->name);
+	if (!ac->ai || !ac->name) {
+		attach_cache_free(ac);
+		return;
+	}
+	ac->size = ubi->mtd->size;
+	ac->offset = ubi->mtd->offset;
+	ac->vid_hdr_offset = ubi->vid_hdr_offset;
+	ac->image_seq = ubi->image_seq;
+	ac->ro_mode = ubi->ro_mode;
+	list_add(&ac->list, &attach_cache_list);
+}
+
+#else
+
+static inline struct ubi_attach_info *attach_cache_get(struct ubi_device *ubi)
+{
+	return NULL;
+}
+
+static inline void attach_cache_put(struct ubi_device *ubi,
+				    struct ubi_attach_info *ai)
+{
+}
+
+#endif
+
 #ifdef CONFIG_MTD_UBI_FASTMAP
 
 /**
@@ -1350,6 +1636,7 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	if (!vidh)
 		goto out_ech;
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_UBI_FASTMAP, "ubi_fastmap");
 	for (pnum = 0; pnum < UBI_FM_MAX_START; pnum++) {
 		int vol_id = -1;
 		unsigned long long sqnum = -1;
@@ -1369,17 +1656,25 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	ubi_free_vid_hdr(ubi, vidh);
 	kfree(ech);
 
-	if (fm_anchor < 0)
+	if (fm_anchor < 0) {
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_FASTMAP);
 		return UBI_NO_FASTMAP;
+	}
 
 	destroy_ai(*ai);
 	*ai = alloc_ai();
-	if (!*ai)
+	if (!*ai) {
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_FASTMAP);
 		return -ENOMEM;
+	}
 
-	return ubi_scan_fastmap(ubi, *ai, fm_anchor);
+	err = ubi_scan_fastmap(ubi, *ai, fm_anchor);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_FASTMAP);
+
+	return err;
 
 out_vidh:
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_UBI_FASTMAP);
 	ubi_free_vid_hdr(ubi, vidh);
 out_ech:
 	kfree(ech);
@@ -1402,9 +1697,8 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	int err;
 	struct ubi_attach_info *ai;
 
-	ai = alloc_ai();
-	if (!ai)
-		return -ENOMEM;
+	/* A scan asked for by the caller must not be answered from the cache */
+	ai = force_scan ? NULL : attach_cache_get(ubi);
 
 #ifdef CONFIG_MTD_UBI_FASTMAP
 	/* On small flash devices we disable fastmap in any case. */
@@ -1412,7 +1706,16 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 		ubi->fm_disabled = 1;
 		force_scan = 1;
 	}
+#endif
+
+	if (ai)
+		goto attached;
+
+	ai = alloc_ai();
+	if (!ai)
+		return -ENOMEM;
 
+#ifdef CONFIG_MTD_UBI_FASTMAP
 	if (force_scan)
 		err = scan_all(ubi, ai, 0);
 	else {
@@ -1436,6 +1739,11 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	if (err)
 		goto out_ai;
 
+	/* A fastmap is quick to read again, so only keep what was scanned */
+	if (!ubi->fm)
+		attach_cache_put(ubi, ai);
+
+attached:
 	ubi->bad_peb_count = ai->bad_peb_count;
 	ubi->good_peb_count = ubi->peb_count - ubi->bad_peb_count;
 	ubi->corr_peb_count = ai->corr_peb_count;
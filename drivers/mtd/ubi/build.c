@@ -78,6 +78,10 @@ static int __initdata mtd_devs;
 
 /* MTD devices specification parameters */
 static struct mtd_dev_param __initdata mtd_dev_param[UBI_MAX_DEVICES];
+#ifdef __UBOOT__
+/* Attach by scanning even if the result of an earlier scan is known */
+bool ubi_force_scan;
+#endif
 #ifndef __UBOOT__
 #ifdef CONFIG_MTD_UBI_FASTMAP
 /* UBI module parameter to enable fastmap automatically on non-fastmap images */
@@ -998,7 +1002,11 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
 	if (!ubi->fm_buf)
 		goto out_free;
 #endif
+#ifndef __UBOOT__
 	err = ubi_attach(ubi, 0);
+#else
+	err = ubi_attach(ubi, ubi_force_scan);
+#endif
 	if (err) {
 		ubi_err(ubi, "failed to attach mtd%d, error %d",
 			mtd->index, err);
@@ -15,6 +15,8 @@
 #include <malloc.h>
 #include <scsi.h>
 #include <scsi_emul.h>
+#include <time.h>
+#include <asm/test.h>
 
 enum {
 	SANDBOX_SCSI_BLOCK_LEN		= 512,
@@ -27,13 +29,23 @@ enum {
  * @eminfo: emulator state
  * @pathanme: Path to the backing file, e.g. 'scsi.img'
  * @fd: File descriptor of backing file
+ * @ready: get_timer() value when the disk has spun up
  */
 struct sandbox_scsi_priv {
 	struct scsi_emul_info eminfo;
 	const char *pathname;
 	int fd;
+	ulong ready;
 };
 
+/* Time taken by the emulated disk to spin up, in milliseconds */
+static uint spinup_ms;
+
+void sandbox_scsi_set_spinup(uint ms)
+{
+	spinup_ms = ms;
+}
+
 static int sandbox_scsi_exec(struct udevice *dev, struct scsi_cmd *req)
 {
 	struct sandbox_scsi_priv *priv = dev_get_priv(dev);
@@ -116,9 +128,22 @@ static int sandbox_scsi_probe(struct udevice *dev)
 	}
 	log_debug("filename: %s, fd %d\n", priv->pathname, priv->fd);
 
+	/* the controller is not ready until the disk has spun up */
+	if (spinup_ms) {
+		priv->ready = get_timer(0) + spinup_ms;
+		return -EINPROGRESS;
+	}
+
 	return 0;
 }
 
+static int sandbox_scsi_probe_poll(struct udevice *dev)
+{
+	struct sandbox_scsi_priv *priv = dev_get_priv(dev);
+
+	return get_timer(0) < priv->ready ? -EAGAIN : 0;
+}
+
 static int sandbox_scsi_remove(struct udevice *dev)
 {
 	struct sandbox_scsi_priv *priv = dev_get_priv(dev);
@@ -146,6 +171,7 @@ U_BOOT_DRIVER(sandbox_scsi) = {
 	.of_match	= sanbox_scsi_ids,
 	.of_to_plat	= sandbox_scsi_of_to_plat,
 	.probe		= sandbox_scsi_probe,
+	.probe_poll	= sandbox_scsi_probe_poll,
 	.remove		= sandbox_scsi_remove,
 	.priv_auto	= sizeof(struct sandbox_scsi_priv),
 };
@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <init.h>
 #include <scsi.h>
+#include <dm/device-internal.h>
 
 static int scsi_bootdev_bind(struct udevice *dev)
 {
@@ -38,6 +39,29 @@ static int scsi_bootdev_hunt(struct bootdev_hunter *info, bool show)
 	return 0;
 }
 
+static int scsi_bootdev_start(struct bootdev_hunter *info, bool show)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	int ret;
+
+	/*
+	 * Start probing controllers which can finish in the background, so
+	 * their disks spin up while other bootdevs are scanned. Other
+	 * controllers, and those on a PCI bus which is not enumerated yet, are
+	 * left to the hunt, since probing them here would block
+	 */
+	uclass_id_foreach_dev(UCLASS_SCSI, dev, uc) {
+		if (!dev->driver->probe_poll)
+			continue;
+		ret = device_probe_async(dev);
+		if (ret)
+			return log_msg_ret("scs", ret);
+	}
+
+	return 0;
+}
+
 struct bootdev_ops scsi_bootdev_ops = {
 };
 
@@ -58,5 +82,6 @@ BOOTDEV_HUNTER(scsi_bootdev_hunter) = {
 	.prio		= BOOTDEVP_4_SCAN_FAST,
 	.uclass		= UCLASS_SCSI,
 	.hunt		= scsi_bootdev_hunt,
+	.start		= scsi_bootdev_start,
 	.drv		= DM_DRIVER_REF(scsi_bootdev),
 };
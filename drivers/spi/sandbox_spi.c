@@ -15,10 +15,12 @@
 #include <log.h>
 #include <malloc.h>
 #include <spi.h>
+#include <spi-mem.h>
 #include <spi_flash.h>
 #include <os.h>
 
 #include <linux/errno.h>
+#include <linux/sizes.h>
 #include <asm/spi.h>
 #include <asm/state.h>
 #include <dm/acpi.h>
@@ -35,12 +37,17 @@
  *
  * @speed:	Current bus speed.
  * @mode:	Current bus mode.
+ * @dirmap_reads: Number of reads done through a direct mapping
  */
 struct sandbox_spi_priv {
 	uint speed;
 	uint mode;
+	uint dirmap_reads;
 };
 
+/* Size of the window the direct mapping reads through */
+#define SANDBOX_SPI_DIRMAP_SIZE		SZ_64K
+
 __weak int sandbox_spi_get_emul(struct sandbox_state *state,
 				struct udevice *bus, struct udevice *slave,
 				struct udevice **emulp)
@@ -62,6 +69,13 @@ uint sandbox_spi_get_mode(struct udevice *dev)
 	return priv->mode;
 }
 
+uint sandbox_spi_get_dirmap_reads(struct udevice *dev)
+{
+	struct sandbox_spi_priv *priv = dev_get_priv(dev);
+
+	return priv->dirmap_reads;
+}
+
 static int sandbox_spi_xfer(struct udevice *slave, unsigned int bitlen,
 			    const void *dout, void *din, unsigned long flags)
 {
@@ -153,12 +167,53 @@ static int sandbox_spi_get_mmap(struct udevice *dev, ulong *map_basep,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+static int sandbox_spi_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	/* Only reads go through the mapping, like most real controllers */
+	if (desc->info.op_tmpl.data.dir != SPI_MEM_DATA_IN)
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+static ssize_t sandbox_spi_dirmap_read(struct spi_mem_dirmap_desc *desc,
+				       u64 offs, size_t len, void *buf)
+{
+	struct sandbox_spi_priv *priv = dev_get_priv(desc->slave->dev->parent);
+	struct spi_mem_op op = desc->info.op_tmpl;
+	u64 addr = desc->info.offset + offs;
+	ulong avail;
+	int ret;
+
+	/* Stop at the end of the window, the caller comes back for the rest */
+	avail = SANDBOX_SPI_DIRMAP_SIZE - (addr & (SANDBOX_SPI_DIRMAP_SIZE - 1));
+	op.addr.val = addr;
+	op.data.buf.in = buf;
+	op.data.nbytes = min_t(ulong, len, avail);
+	ret = spi_mem_exec_op(desc->slave, &op);
+	if (ret)
+		return ret;
+	priv->dirmap_reads++;
+
+	return op.data.nbytes;
+}
+
+static const struct spi_controller_mem_ops sandbox_spi_mem_ops = {
+	.dirmap_create	= sandbox_spi_dirmap_create,
+	.dirmap_read	= sandbox_spi_dirmap_read,
+};
+#endif
+
 static const struct dm_spi_ops sandbox_spi_ops = {
 	.xfer		= sandbox_spi_xfer,
 	.set_speed	= sandbox_spi_set_speed,
 	.set_mode	= sandbox_spi_set_mode,
 	.cs_info	= sandbox_cs_info,
 	.get_mmap	= sandbox_spi_get_mmap,
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+	.mem_ops	= &sandbox_spi_mem_ops,
+#endif
 };
 
 static const struct udevice_id sandbox_spi_ids[] = {
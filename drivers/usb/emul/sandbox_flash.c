@@ -14,18 +14,29 @@
 #include <scsi.h>
 #include <scsi_emul.h>
 #include <usb.h>
+#include <asm/test.h>
+#include <linux/usb/uas.h>
 
 /*
  * This driver emulates a flash stick using the UFI command specification and
  * the BBB (bulk/bulk/bulk) protocol. It supports only a single logical unit
  * number (LUN 0).
+ *
+ * With the "sandbox,uas" property the stick also offers USB Attached SCSI
+ * (UAS) in alternate setting 1. Queued commands are run newest first, so that
+ * the host has to cope with them completing out of order.
  */
 
 enum {
 	SANDBOX_FLASH_EP_OUT		= 1,	/* endpoints */
 	SANDBOX_FLASH_EP_IN		= 2,
+	SANDBOX_FLASH_EP_CMD		= 3,	/* UAS endpoints */
+	SANDBOX_FLASH_EP_STATUS		= 4,
+	SANDBOX_FLASH_EP_DATA_IN	= 5,
+	SANDBOX_FLASH_EP_DATA_OUT	= 6,
 	SANDBOX_FLASH_BLOCK_LEN		= 512,
 	SANDBOX_FLASH_BUF_SIZE		= 512,
+	SANDBOX_FLASH_UAS_DEPTH		= 32,
 };
 
 enum {
@@ -45,6 +56,11 @@ enum {
  * @fd:		File descriptor of backing file
  * @file_size:	Size of file in bytes
  * @status_buff:	Data buffer for outgoing status
+ * @uas:	true if the UAS alternate setting is selected
+ * @uas_cmds:	UAS commands received but not yet started
+ * @uas_count:	Number of commands in @uas_cmds
+ * @uas_depth:	Most UAS commands that have been outstanding at once
+ * @uas_tag:	Tag of the UAS command being run, 0 if none
  */
 struct sandbox_flash_priv {
 	struct scsi_emul_info eminfo;
@@ -52,11 +68,26 @@ struct sandbox_flash_priv {
 	u32 tag;
 	int fd;
 	struct umass_bbb_csw status;
+	bool uas;
+	struct command_iu uas_cmds[SANDBOX_FLASH_UAS_DEPTH];
+	int uas_count;
+	int uas_depth;
+	uint uas_tag;
 };
 
+/**
+ * struct sandbox_flash_plat - platform data for this driver
+ *
+ * @pathname:	Path to the backing file
+ * @flash_strings:	String descriptors
+ * @uas:	true if the stick offers UAS
+ * @refuse_uas:	true to refuse selecting UAS, so the host must use BBB
+ */
 struct sandbox_flash_plat {
 	const char *pathname;
 	struct usb_string flash_strings[STRINGID_COUNT];
+	bool uas;
+	bool refuse_uas;
 };
 
 static struct usb_device_descriptor flash_device_desc = {
@@ -131,10 +162,127 @@ static void *flash_desc_list[] = {
 	NULL,
 };
 
+/* wTotalLength differs from flash_config0, so this needs its own copy */
+static struct usb_config_descriptor flash_config0_uas = {
+	.bLength		= sizeof(flash_config0_uas),
+	.bDescriptorType	= USB_DT_CONFIG,
+
+	/* wTotalLength is set up by usb-emul-uclass */
+	.bNumInterfaces		= 1,
+	.bConfigurationValue	= 0,
+	.iConfiguration		= 0,
+	.bmAttributes		= 1 << 7,
+	.bMaxPower		= 50,
+};
+
+static struct usb_interface_descriptor flash_interface0_uas = {
+	.bLength		= sizeof(flash_interface0_uas),
+	.bDescriptorType	= USB_DT_INTERFACE,
+
+	.bInterfaceNumber	= 0,
+	.bAlternateSetting	= 1,
+	.bNumEndpoints		= 4,
+	.bInterfaceClass	= USB_CLASS_MASS_STORAGE,
+	.bInterfaceSubClass	= US_SC_SCSI,
+	.bInterfaceProtocol	= US_PR_UAS,
+	.iInterface		= 0,
+};
+
+static struct usb_endpoint_descriptor flash_endpoint_cmd = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_FLASH_EP_CMD,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(1024),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor flash_usage_cmd = {
+	.bLength		= sizeof(flash_usage_cmd),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= CMD_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor flash_endpoint_status = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_FLASH_EP_STATUS | USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(1024),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor flash_usage_status = {
+	.bLength		= sizeof(flash_usage_status),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= STATUS_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor flash_endpoint_data_in = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_FLASH_EP_DATA_IN | USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(1024),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor flash_usage_data_in = {
+	.bLength		= sizeof(flash_usage_data_in),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= DATA_IN_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor flash_endpoint_data_out = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_FLASH_EP_DATA_OUT,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(1024),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor flash_usage_data_out = {
+	.bLength		= sizeof(flash_usage_data_out),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= DATA_OUT_PIPE_ID,
+};
+
+/* BBB in alternate setting 0 and UAS in alternate setting 1 */
+static void *flash_uas_desc_list[] = {
+	&flash_device_desc,
+	&flash_config0_uas,
+	&flash_interface0,
+	&flash_endpoint0_out,
+	&flash_endpoint1_in,
+	&flash_interface0_uas,
+	&flash_endpoint_cmd,
+	&flash_usage_cmd,
+	&flash_endpoint_status,
+	&flash_usage_status,
+	&flash_endpoint_data_in,
+	&flash_usage_data_in,
+	&flash_endpoint_data_out,
+	&flash_usage_data_out,
+	NULL,
+};
+
+static void sandbox_flash_uas_reset(struct sandbox_flash_priv *priv)
+{
+	priv->uas_count = 0;
+	priv->uas_tag = 0;
+	priv->eminfo.phase = SCSIPH_START;
+}
+
 static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 				 unsigned long pipe, void *buff, int len,
 				 struct devrequest *setup)
 {
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
 	struct sandbox_flash_priv *priv = dev_get_priv(dev);
 
 	if (pipe == usb_rcvctrlpipe(udev, 0)) {
@@ -149,6 +297,23 @@ static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 			debug("request=%x\n", setup->request);
 			break;
 		}
+	} else if (pipe == usb_sndctrlpipe(udev, 0)) {
+		switch (setup->request) {
+		case USB_REQ_SET_INTERFACE:
+			if (setup->value > 1 ||
+			    (setup->value && (!plat->uas || plat->refuse_uas)))
+				break;
+			priv->uas = setup->value;
+			sandbox_flash_uas_reset(priv);
+			return 0;
+		case USB_REQ_CLEAR_FEATURE:
+			if (priv->uas)
+				sandbox_flash_uas_reset(priv);
+			return 0;
+		default:
+			debug("request=%x\n", setup->request);
+			break;
+		}
 	}
 	debug("pipe=%lx\n", pipe);
 
@@ -208,6 +373,159 @@ static int handle_ufi_command(struct sandbox_flash_priv *priv, const void *buff,
 	return 0;
 }
 
+static int flash_data_out(struct sandbox_flash_priv *priv, const void *buff,
+			  int len)
+{
+	struct scsi_emul_info *info = &priv->eminfo;
+
+	if (!info->write_len)
+		return 0;
+	if (priv->fd != -1) {
+		ulong bytes_written;
+
+		bytes_written = os_write(priv->fd, buff, len);
+		log_debug("bytes_written=%lx", bytes_written);
+		if (bytes_written != len)
+			return -EIO;
+		info->write_len -= len / info->block_size;
+		if (!info->write_len)
+			info->phase = SCSIPH_STATUS;
+	} else {
+		if (info->alloc_len && len > info->alloc_len)
+			len = info->alloc_len;
+		if (len > SANDBOX_FLASH_BUF_SIZE)
+			len = SANDBOX_FLASH_BUF_SIZE;
+		memcpy(info->buff, buff, len);
+		info->phase = SCSIPH_STATUS;
+	}
+
+	return len;
+}
+
+static int flash_data_in(struct sandbox_flash_priv *priv, void *buff, int len)
+{
+	struct scsi_emul_info *info = &priv->eminfo;
+
+	debug("data in, len=%x, alloc_len=%x, info->read_len=%x\n",
+	      len, info->alloc_len, info->read_len);
+	if (info->read_len) {
+		ulong bytes_read;
+
+		if (priv->fd == -1)
+			return -EIO;
+
+		bytes_read = os_read(priv->fd, buff, len);
+		if (bytes_read != len)
+			return -EIO;
+		info->read_len -= len / info->block_size;
+		if (!info->read_len)
+			info->phase = SCSIPH_STATUS;
+	} else {
+		if (info->alloc_len && len > info->alloc_len)
+			len = info->alloc_len;
+		if (len > SANDBOX_FLASH_BUF_SIZE)
+			len = SANDBOX_FLASH_BUF_SIZE;
+		memcpy(buff, info->buff, len);
+		info->phase = SCSIPH_STATUS;
+	}
+
+	return len;
+}
+
+static int uas_queue_cmd(struct sandbox_flash_priv *priv, const void *buff,
+			 int len)
+{
+	const struct command_iu *cmd = buff;
+
+	if (len < sizeof(*cmd) || cmd->iu_id != IU_ID_COMMAND || !cmd->tag ||
+	    priv->uas_count == ARRAY_SIZE(priv->uas_cmds))
+		return -EIO;
+	priv->uas_cmds[priv->uas_count++] = *cmd;
+	priv->uas_depth = max(priv->uas_depth,
+			      priv->uas_count + (priv->uas_tag ? 1 : 0));
+
+	return len;
+}
+
+/*
+ * Send the next IU on the status pipe: a Read Ready or Write Ready IU when
+ * starting a command which has data, else a Sense IU to complete it
+ */
+static int uas_status(struct sandbox_flash_priv *priv, void *buff, int len)
+{
+	struct scsi_emul_info *info = &priv->eminfo;
+	struct sense_iu *iu = buff;
+	struct command_iu *cmd;
+	bool failed;
+
+	if (len < sizeof(*iu))
+		return -EIO;
+	memset(iu, '\0', sizeof(*iu));
+	if (!priv->uas_tag) {
+		if (!priv->uas_count)
+			return -EIO;
+		cmd = &priv->uas_cmds[--priv->uas_count];
+		priv->uas_tag = be16_to_cpu(cmd->tag);
+		info->alloc_len = 0;
+		info->read_len = 0;
+		info->write_len = 0;
+		info->transfer_len = 0;
+		handle_ufi_command(priv, cmd->cdb, sizeof(cmd->cdb));
+		if (priv->status.bCSWStatus == CSWSTATUS_GOOD &&
+		    info->buff_used) {
+			info->phase = SCSIPH_DATA;
+			iu->iu_id = info->write_len ? IU_ID_WRITE_READY :
+				IU_ID_READ_READY;
+			iu->tag = cpu_to_be16(priv->uas_tag);
+			return sizeof(struct iu);
+		}
+		info->phase = SCSIPH_STATUS;
+	}
+	if (info->phase != SCSIPH_STATUS)
+		return -EIO;
+
+	iu->iu_id = IU_ID_STATUS;
+	iu->tag = cpu_to_be16(priv->uas_tag);
+	failed = priv->status.bCSWStatus != CSWSTATUS_GOOD;
+	if (failed) {
+		/* CHECK CONDITION, ILLEGAL REQUEST, INVALID COMMAND OPCODE */
+		iu->status = 0x02;
+		iu->len = cpu_to_be16(18);
+		iu->sense[0] = 0x70;
+		iu->sense[2] = 0x05;
+		iu->sense[7] = 10;
+		iu->sense[12] = 0x20;
+	}
+	priv->uas_tag = 0;
+	info->phase = SCSIPH_START;
+
+	return offsetof(struct sense_iu, sense) + (failed ? 18 : 0);
+}
+
+static int sandbox_flash_uas_bulk(struct sandbox_flash_priv *priv, int ep,
+				  void *buff, int len)
+{
+	struct scsi_emul_info *info = &priv->eminfo;
+
+	switch (ep) {
+	case SANDBOX_FLASH_EP_CMD:
+		return uas_queue_cmd(priv, buff, len);
+	case SANDBOX_FLASH_EP_STATUS:
+		return uas_status(priv, buff, len);
+	case SANDBOX_FLASH_EP_DATA_IN:
+		if (info->phase == SCSIPH_DATA && !info->write_len)
+			return flash_data_in(priv, buff, len);
+		break;
+	case SANDBOX_FLASH_EP_DATA_OUT:
+		if (info->phase == SCSIPH_DATA && info->write_len)
+			return flash_data_out(priv, buff, len);
+		break;
+	}
+	debug("%s: Detected transfer error\n", __func__);
+
+	return -EIO;
+}
+
 static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 			      unsigned long pipe, void *buff, int len)
 {
@@ -218,6 +536,8 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 
 	debug("%s: dev=%s, pipe=%lx, ep=%x, len=%x, phase=%d\n", __func__,
 	      dev->name, pipe, ep, len, info->phase);
+	if (priv->uas)
+		return sandbox_flash_uas_bulk(priv, ep, buff, len);
 	switch (ep) {
 	case SANDBOX_FLASH_EP_OUT:
 		switch (info->phase) {
@@ -242,27 +562,7 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 				  info->write_len);
 			info->transfer_len = cbw->dCBWDataTransferLength;
 			priv->tag = cbw->dCBWTag;
-			if (!info->write_len)
-				return 0;
-			if (priv->fd != -1) {
-				ulong bytes_written;
-
-				bytes_written = os_write(priv->fd, buff, len);
-				log_debug("bytes_written=%lx", bytes_written);
-				if (bytes_written != len)
-					return -EIO;
-				info->write_len -= len / info->block_size;
-				if (!info->write_len)
-					info->phase = SCSIPH_STATUS;
-			} else {
-				if (info->alloc_len && len > info->alloc_len)
-					len = info->alloc_len;
-				if (len > SANDBOX_FLASH_BUF_SIZE)
-					len = SANDBOX_FLASH_BUF_SIZE;
-				memcpy(info->buff, buff, len);
-				info->phase = SCSIPH_STATUS;
-			}
-			return len;
+			return flash_data_out(priv, buff, len);
 		default:
 			break;
 		}
@@ -270,29 +570,7 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 	case SANDBOX_FLASH_EP_IN:
 		switch (info->phase) {
 		case SCSIPH_DATA:
-			debug("data in, len=%x, alloc_len=%x, info->read_len=%x\n",
-			      len, info->alloc_len, info->read_len);
-			if (info->read_len) {
-				ulong bytes_read;
-
-				if (priv->fd == -1)
-					return -EIO;
-
-				bytes_read = os_read(priv->fd, buff, len);
-				if (bytes_read != len)
-					return -EIO;
-				info->read_len -= len / info->block_size;
-				if (!info->read_len)
-					info->phase = SCSIPH_STATUS;
-			} else {
-				if (info->alloc_len && len > info->alloc_len)
-					len = info->alloc_len;
-				if (len > SANDBOX_FLASH_BUF_SIZE)
-					len = SANDBOX_FLASH_BUF_SIZE;
-				memcpy(buff, info->buff, len);
-				info->phase = SCSIPH_STATUS;
-			}
-			return len;
+			return flash_data_in(priv, buff, len);
 		case SCSIPH_STATUS:
 			debug("status in, len=%x\n", len);
 			if (len > sizeof(priv->status))
@@ -315,6 +593,7 @@ static int sandbox_flash_of_to_plat(struct udevice *dev)
 	struct sandbox_flash_plat *plat = dev_get_plat(dev);
 
 	plat->pathname = dev_read_string(dev, "sandbox,filepath");
+	plat->uas = dev_read_bool(dev, "sandbox,uas");
 
 	return 0;
 }
@@ -332,7 +611,9 @@ static int sandbox_flash_bind(struct udevice *dev)
 	fs[2].id = STRINGID_SERIAL;
 	fs[2].s = dev->name;
 
-	return usb_emul_setup_device(dev, plat->flash_strings, flash_desc_list);
+	return usb_emul_setup_device(dev, plat->flash_strings,
+				     dev_read_bool(dev, "sandbox,uas") ?
+				     flash_uas_desc_list : flash_desc_list);
 }
 
 static int sandbox_flash_probe(struct udevice *dev)
@@ -368,6 +649,20 @@ static int sandbox_flash_remove(struct udevice *dev)
 	return 0;
 }
 
+void sandbox_flash_refuse_uas(struct udevice *dev, bool refuse)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+
+	plat->refuse_uas = refuse;
+}
+
+int sandbox_flash_get_uas_depth(struct udevice *dev)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	return priv->uas ? priv->uas_depth : 0;
+}
+
 static const struct dm_usb_ops sandbox_usb_flash_ops = {
 	.control	= sandbox_flash_control,
 	.bulk		= sandbox_flash_bulk,
@@ -98,6 +98,29 @@ static void xhci_ring_free(struct xhci_ctrl *ctrl, struct xhci_ring *ring)
 	free(ring);
 }
 
+/**
+ * frees the stream context array of an endpoint and the ring for each stream
+ *
+ * @param ep	endpoint whose streams are to be freed
+ * Return: none
+ */
+void xhci_free_stream_ctx(struct xhci_ctrl *ctrl, struct xhci_virt_ep *ep)
+{
+	unsigned int i;
+
+	for (i = 1; i < ep->num_streams; i++) {
+		if (ep->stream_rings[i])
+			xhci_ring_free(ctrl, ep->stream_rings[i]);
+	}
+	free(ep->stream_rings);
+	xhci_dma_unmap(ctrl, ep->stream_ctx_dma,
+		       ep->num_streams * sizeof(struct xhci_stream_ctx));
+	free(ep->stream_ctx);
+	ep->stream_ctx = NULL;
+	ep->stream_rings = NULL;
+	ep->num_streams = 0;
+}
+
 /**
  * Free the scratchpad buffer array and scratchpad buffers
  *
@@ -162,9 +185,12 @@ static void xhci_free_virt_devices(struct xhci_ctrl *ctrl)
 
 		ctrl->dcbaa->dev_context_ptrs[slot_id] = 0;
 
-		for (i = 0; i < 31; ++i)
+		for (i = 0; i < 31; ++i) {
 			if (virt_dev->eps[i].ring)
 				xhci_ring_free(ctrl, virt_dev->eps[i].ring);
+			if (virt_dev->eps[i].stream_ctx)
+				xhci_free_stream_ctx(ctrl, &virt_dev->eps[i]);
+		}
 
 		if (virt_dev->in_ctx)
 			xhci_free_container_ctx(ctrl, virt_dev->in_ctx);
@@ -356,6 +382,42 @@ struct xhci_ring *xhci_ring_alloc(struct xhci_ctrl *ctrl, unsigned int num_segs,
 	return ring;
 }
 
+/**
+ * Allocate a linear stream context array for an endpoint, with a ring for
+ * each stream. Stream 0 is reserved, so num_streams - 1 streams can be used.
+ *
+ * @param ctrl		host controller data structure
+ * @param ep		endpoint to set up
+ * @param num_streams	number of stream contexts, a power of two
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int xhci_alloc_stream_ctx(struct xhci_ctrl *ctrl, struct xhci_virt_ep *ep,
+			  unsigned int num_streams)
+{
+	size_t size = num_streams * sizeof(struct xhci_stream_ctx);
+	struct xhci_ring *ring;
+	unsigned int i;
+	u64 deq;
+
+	ep->stream_rings = calloc(num_streams, sizeof(*ep->stream_rings));
+	if (!ep->stream_rings)
+		return -ENOMEM;
+	ep->stream_ctx = xhci_malloc(size);
+	ep->stream_ctx_dma = xhci_dma_map(ctrl, ep->stream_ctx, size);
+	ep->num_streams = num_streams;
+
+	for (i = 1; i < num_streams; i++) {
+		ring = xhci_ring_alloc(ctrl, 1, true);
+		ep->stream_rings[i] = ring;
+		deq = xhci_trb_virt_to_dma(ring->enq_seg, ring->enqueue);
+		ep->stream_ctx[i].stream_ring = cpu_to_le64(deq |
+				SCT_FOR_CTX(SCT_PRI_TR) | ring->cycle_state);
+	}
+	xhci_flush_cache((uintptr_t)ep->stream_ctx, size);
+
+	return 0;
+}
+
 /**
  * Set up the scratchpad buffer array and scratchpad buffers
  *
@@ -36,6 +36,7 @@
 #include <linux/delay.h>
 #include <linux/errno.h>
 #include <linux/iopoll.h>
+#include <linux/log2.h>
 
 static struct descriptor {
 	struct usb_hub_descriptor hub;
@@ -1116,7 +1117,7 @@ static int _xhci_submit_int_msg(struct usb_device *udev, unsigned long pipe,
 	 * (at most) one TD. A TD (comprised of sg list entries) can
 	 * take several service intervals to transmit.
 	 */
-	return xhci_bulk_tx(udev, pipe, length, buffer);
+	return xhci_bulk_tx(udev, pipe, 0, length, buffer);
 }
 
 /**
@@ -1136,7 +1137,7 @@ static int _xhci_submit_bulk_msg(struct usb_device *udev, unsigned long pipe,
 		return -EINVAL;
 	}
 
-	return xhci_bulk_tx(udev, pipe, length, buffer);
+	return xhci_bulk_tx(udev, pipe, 0, length, buffer);
 }
 
 /**
@@ -1291,6 +1292,19 @@ static int xhci_submit_bulk_msg(struct udevice *dev, struct usb_device *udev,
 	return _xhci_submit_bulk_msg(udev, pipe, buffer, length);
 }
 
+static int xhci_submit_bulk_stream_msg(struct udevice *dev,
+				       struct usb_device *udev,
+				       unsigned long pipe, uint stream_id,
+				       void *buffer, int length)
+{
+	debug("%s: dev='%s', udev=%p, stream %u\n", __func__, dev->name, udev,
+	      stream_id);
+	if (usb_pipetype(pipe) != PIPE_BULK)
+		return -EINVAL;
+
+	return xhci_bulk_tx(udev, pipe, stream_id, length, buffer);
+}
+
 static int xhci_submit_int_msg(struct udevice *dev, struct usb_device *udev,
 			       unsigned long pipe, void *buffer, int length,
 			       int interval, bool nonblock)
@@ -1372,6 +1386,89 @@ static int xhci_update_hub_device(struct udevice *dev, struct usb_device *udev)
 	return xhci_configure_endpoints(udev, false);
 }
 
+/**
+ * Set up streams on bulk endpoints, giving each a linear stream context array
+ * and switching it over with a Configure Endpoint command.
+ *
+ * @param dev		xHCI controller
+ * @param udev		USB device owning the endpoints
+ * @param pipes		bulk pipes for the endpoints
+ * @param num_pipes	number of entries in pipes
+ * @param num_streams	number of streams wanted on each endpoint
+ * Return: number of usable streams, or -ve on error
+ */
+static int xhci_alloc_streams(struct udevice *dev, struct usb_device *udev,
+			      const unsigned long *pipes, int num_pipes,
+			      uint num_streams)
+{
+	struct xhci_ctrl *ctrl = dev_get_priv(dev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_container_ctx *in_ctx = virt_dev->in_ctx;
+	struct xhci_container_ctx *out_ctx = virt_dev->out_ctx;
+	struct xhci_input_control_ctx *ctrl_ctx;
+	struct xhci_ep_ctx *ep_ctx;
+	struct xhci_virt_ep *ep;
+	uint max_psa, entries;
+	u32 ep_flags = 0;
+	int i, ep_index, ret;
+
+	if (udev->speed < USB_SPEED_SUPER || !num_streams)
+		return -EINVAL;
+
+	/* stream 0 is reserved and the array must have at least 4 entries */
+	max_psa = HCC_MAX_PSA(xhci_readl(&ctrl->hccr->cr_hccparams));
+	entries = max(__roundup_pow_of_two(num_streams + 1), 4UL);
+	entries = min(entries, max_psa);
+	if (entries < 4)
+		return -ENOSYS;
+
+	for (i = 0; i < num_pipes; i++) {
+		if (usb_pipetype(pipes[i]) != PIPE_BULK)
+			return -EINVAL;
+		ep_index = usb_pipe_ep_index(pipes[i]);
+		if (virt_dev->eps[ep_index].stream_ctx)
+			return -EBUSY;
+		ep_flags |= 1 << (ep_index + 1);
+	}
+
+	xhci_inval_cache((uintptr_t)out_ctx->bytes, out_ctx->size);
+	ctrl_ctx = xhci_get_input_control_ctx(in_ctx);
+	ctrl_ctx->add_flags = cpu_to_le32(SLOT_FLAG | ep_flags);
+	ctrl_ctx->drop_flags = cpu_to_le32(ep_flags);
+	xhci_slot_copy(ctrl, in_ctx, out_ctx);
+
+	for (i = 0; i < num_pipes; i++) {
+		ep_index = usb_pipe_ep_index(pipes[i]);
+		ep = &virt_dev->eps[ep_index];
+		ret = xhci_alloc_stream_ctx(ctrl, ep, entries);
+		if (ret)
+			goto err;
+
+		xhci_endpoint_copy(ctrl, in_ctx, out_ctx, ep_index);
+		ep_ctx = xhci_get_ep_ctx(ctrl, in_ctx, ep_index);
+		ep_ctx->ep_info &= cpu_to_le32(~EP_MAXPSTREAMS_MASK);
+		ep_ctx->ep_info |= cpu_to_le32(EP_MAXPSTREAMS(ilog2(entries) - 1)
+					       | EP_HAS_LSA);
+		ep_ctx->deq = cpu_to_le64(ep->stream_ctx_dma);
+	}
+
+	ret = xhci_configure_endpoints(udev, false);
+	if (ret)
+		goto err;
+	debug("%s: %u streams on %d endpoints\n", __func__, entries - 1,
+	      num_pipes);
+
+	return entries - 1;
+err:
+	for (i = 0; i < num_pipes; i++) {
+		ep = &virt_dev->eps[usb_pipe_ep_index(pipes[i])];
+		if (ep->stream_ctx)
+			xhci_free_stream_ctx(ctrl, ep);
+	}
+
+	return ret;
+}
+
 static int xhci_get_max_xfer_size(struct udevice *dev, size_t *size)
 {
 	/*
@@ -1439,4 +1536,6 @@ struct dm_usb_ops xhci_usb_ops = {
 	.alloc_device = xhci_alloc_device,
 	.update_hub_device = xhci_update_hub_device,
 	.get_max_xfer_size  = xhci_get_max_xfer_size,
+	.alloc_streams = xhci_alloc_streams,
+	.bulk_stream = xhci_submit_bulk_stream_msg,
 };
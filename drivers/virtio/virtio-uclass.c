@@ -24,6 +24,7 @@
 #include <malloc.h>
 #include <virtio_types.h>
 #include <virtio.h>
+#include <virtio_ring.h>
 #include <dm/lists.h>
 #include <linux/bug.h>
 
@@ -334,10 +335,28 @@ static int virtio_uclass_child_pre_probe(struct udevice *vdev)
 	}
 
 	/* Transport features always preserved to pass to finalize_features */
-	for (i = VIRTIO_TRANSPORT_F_START; i < VIRTIO_TRANSPORT_F_END; i++)
-		if ((device_features & (1ULL << i)) &&
-		    (i == VIRTIO_F_VERSION_1 || i == VIRTIO_F_IOMMU_PLATFORM))
+	for (i = VIRTIO_TRANSPORT_F_START; i < VIRTIO_TRANSPORT_F_END; i++) {
+		if (!(device_features & (1ULL << i)))
+			continue;
+		switch (i) {
+		case VIRTIO_F_VERSION_1:
+		case VIRTIO_F_IOMMU_PLATFORM:
+		case VIRTIO_RING_F_INDIRECT_DESC:
+		case VIRTIO_RING_F_EVENT_IDX:
 			__virtio_set_bit(vdev->parent, i);
+			break;
+		case VIRTIO_F_RING_PACKED:
+			/*
+			 * This needs a v1.0 device. Bounce buffers are only
+			 * handled for split virtqueues
+			 */
+			if (IS_ENABLED(CONFIG_VIRTIO_RING_PACKED) &&
+			    !uc_priv->legacy &&
+			    !(device_features & BIT_ULL(VIRTIO_F_IOMMU_PLATFORM)))
+				__virtio_set_bit(vdev->parent, i);
+			break;
+		}
+	}
 
 	debug("(%s) final negotiated features supported %016llx\n",
 	      vdev->name, uc_priv->features);
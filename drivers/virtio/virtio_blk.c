@@ -9,56 +9,159 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
+#include <linux/sizes.h>
 #include "virtio_blk.h"
 
+/* Largest data segment used when the device does not set a limit */
+#define VIRTIO_BLK_SEG_SIZE	SZ_1G
+
+/**
+ * struct virtio_blk_req - a request which can be in flight
+ *
+ * @out_hdr: Request header sent to the device
+ * @status: Status written by the device, VIRTIO_BLK_S_...
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+};
+
+/**
+ * struct virtio_blk_priv - private data for a virtio block device
+ *
+ * @vq: Request queue
+ * @reqs: Requests, one for each request which can be in flight at once
+ * @nreqs: Number of entries in @reqs
+ * @sg: Scatter-gather entries for building a request
+ * @sgs: Pointers to the entries in @sg
+ * @seg_size: Maximum size of each data segment in bytes
+ * @max_segs: Maximum number of data segments in a request
+ * @direct_segs: Maximum number of data segments in a request which does not
+ *	use an indirect descriptor table
+ */
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct virtio_blk_req *reqs;
+	uint nreqs;
+	struct virtio_sg *sg;
+	struct virtio_sg **sgs;
+	u32 seg_size;
+	uint max_segs;
+	uint direct_segs;
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+};
+
+/* Queue a request for @blkcnt blocks, splitting the data into segments */
+static int virtio_blk_add_req(struct udevice *dev, struct virtio_blk_req *req,
+			      u64 sector, lbaint_t blkcnt, void *buffer,
+			      u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
+	unsigned int num_out = 0, num_in = 0, nsegs = 0;
+	size_t left = blkcnt * 512;
+	char *ptr = buffer;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	req->out_hdr.type = cpu_to_virtio32(dev, type);
+	req->out_hdr.ioprio = 0;
+	req->out_hdr.sector = cpu_to_virtio64(dev, sector);
+	req->status = VIRTIO_BLK_S_IOERR;
 
-	sgs[num_out++] = &hdr_sg;
+	priv->sg[nsegs].addr = &req->out_hdr;
+	priv->sg[nsegs++].length = sizeof(req->out_hdr);
+	num_out++;
+	while (left) {
+		size_t len = min_t(size_t, left, priv->seg_size);
 
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
+		priv->sg[nsegs].addr = ptr;
+		priv->sg[nsegs++].length = len;
+		if (type & VIRTIO_BLK_T_OUT)
+			num_out++;
+		else
+			num_in++;
+		ptr += len;
+		left -= len;
+	}
+	priv->sg[nsegs].addr = &req->status;
+	priv->sg[nsegs++].length = sizeof(req->status);
+	num_in++;
+
+	return virtqueue_add(priv->vq, priv->sgs, num_out, num_in);
+}
+
+/*
+ * Requests larger than the device can take in one go are split, and as many
+ * as fit in the queue are submitted before waiting for any of them, so the
+ * device can work on them together
+ */
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	lbaint_t max_blks = (lbaint_t)priv->max_segs * (priv->seg_size / 512);
+	lbaint_t direct_blks = (lbaint_t)priv->direct_segs *
+		(priv->seg_size / 512);
+	lbaint_t done = 0;
+	int ret = 0;
+	uint i, n;
 
-	sgs[num_out + num_in++] = &status_sg;
 	log_debug("dev=%s, active=%d, priv=%p, priv->vq=%p\n", dev->name,
 		  device_active(dev), priv, priv->vq);
+	while (done < blkcnt && !ret) {
+		for (n = 0; done < blkcnt && n < priv->nreqs; n++) {
+			lbaint_t cnt = min(blkcnt - done, max_blks);
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
+			ret = virtio_blk_add_req(dev, &priv->reqs[n],
+						 sector + done, cnt,
+						 buffer + done * 512, type);
+			/*
+			 * With the queue empty this can only mean that there
+			 * was no memory for an indirect table, so send a
+			 * smaller request which fits in the ring directly
+			 */
+			if (ret == -ENOSPC && !n && cnt > direct_blks) {
+				cnt = direct_blks;
+				ret = virtio_blk_add_req(dev, &priv->reqs[n],
+							 sector + done, cnt,
+							 buffer + done * 512,
+							 type);
+			}
+			if (ret == -ENOSPC && n) {
+				/* wait for what we have so far */
+				ret = 0;
+				break;
+			}
+			if (ret)
+				break;
+			done += cnt;
+		}
 
-	virtqueue_kick(priv->vq);
+		virtqueue_kick(priv->vq);
 
-	log_debug("wait...");
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
-	log_debug("done\n");
+		log_debug("wait for %u...", n);
+		for (i = 0; i < n; i++) {
+			while (!virtqueue_get_buf(priv->vq, NULL))
+				;
+		}
+		log_debug("done\n");
+
+		for (i = 0; i < n; i++) {
+			if (priv->reqs[i].status != VIRTIO_BLK_S_OK)
+				return -EIO;
+		}
+	}
+	if (ret)
+		return ret;
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	return blkcnt;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -105,15 +208,28 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    NULL, 0);
 
 	return 0;
 }
 
+static void virtio_blk_free(struct virtio_blk_priv *priv)
+{
+	free(priv->reqs);
+	free(priv->sg);
+	free(priv->sgs);
+	priv->reqs = NULL;
+	priv->sg = NULL;
+	priv->sgs = NULL;
+}
+
 static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	u32 size_max, seg_max;
+	uint num, i;
 	u64 cap;
 	int ret;
 
@@ -126,9 +242,51 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	priv->seg_size = VIRTIO_BLK_SEG_SIZE;
+	if (!virtio_cread_feature(dev, VIRTIO_BLK_F_SIZE_MAX,
+				  struct virtio_blk_config, size_max,
+				  &size_max) && size_max >= 512)
+		priv->seg_size = ALIGN_DOWN(min(size_max, priv->seg_size), 512);
+
+	/*
+	 * Without indirect descriptors each segment takes a ring entry, as do
+	 * the header and status. The queue may not use indirect descriptors
+	 * even if the device offers them, e.g. when bounce buffers are needed
+	 */
+	num = virtqueue_get_vring_size(priv->vq);
+	priv->direct_segs = num - 2;
+	if (!virtio_cread_feature(dev, VIRTIO_BLK_F_SEG_MAX,
+				  struct virtio_blk_config, seg_max,
+				  &seg_max) && seg_max)
+		priv->direct_segs = min(seg_max, num - 2);
+	else
+		seg_max = num - 2;
+	priv->max_segs = priv->vq->indirect ? seg_max : priv->direct_segs;
+	priv->nreqs = num;
+
+	priv->reqs = calloc(priv->nreqs, sizeof(*priv->reqs));
+	priv->sg = calloc(priv->max_segs + 2, sizeof(*priv->sg));
+	priv->sgs = calloc(priv->max_segs + 2, sizeof(*priv->sgs));
+	if (!priv->reqs || !priv->sg || !priv->sgs) {
+		virtio_blk_free(priv);
+		return -ENOMEM;
+	}
+	for (i = 0; i < priv->max_segs + 2; i++)
+		priv->sgs[i] = &priv->sg[i];
+
+	log_debug("%s: %u requests of up to %u segments of %x bytes\n",
+		  dev->name, priv->nreqs, priv->max_segs, priv->seg_size);
+
 	return 0;
 }
 
+static int virtio_blk_remove(struct udevice *dev)
+{
+	virtio_blk_free(dev_get_priv(dev));
+
+	return virtio_reset(dev);
+}
+
 static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
@@ -140,7 +298,7 @@ U_BOOT_DRIVER(virtio_blk) = {
 	.ops	= &virtio_blk_ops,
 	.bind	= virtio_blk_bind,
 	.probe	= virtio_blk_probe,
-	.remove	= virtio_reset,
+	.remove	= virtio_blk_remove,
 	.priv_auto	= sizeof(struct virtio_blk_priv),
 	.flags	= DM_FLAG_ACTIVE_DMA,
 };
@@ -98,15 +98,54 @@ static void virtqueue_detach_desc(struct virtqueue *vq, unsigned int idx)
 	desc->addr = cpu_to_virtio64(vq->vdev, (u64)(uintptr_t)bb->user_buffer);
 }
 
-int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
-		  unsigned int out_sgs, unsigned int in_sgs)
+/*
+ * Put a whole chain into an indirect descriptor table, so that it takes up
+ * just one descriptor in the ring. This lets large scatter-gather lists be
+ * queued without running out of ring space.
+ */
+static struct vring_desc *alloc_indirect_split(struct virtqueue *vq,
+					       struct virtio_sg *sgs[],
+					       unsigned int out_sgs,
+					       unsigned int total)
 {
 	struct vring_desc *desc;
-	unsigned int descs_used = out_sgs + in_sgs;
+	unsigned int i;
+
+	desc = malloc(total * sizeof(*desc));
+	if (!desc)
+		return NULL;
+
+	for (i = 0; i < total; i++) {
+		u16 flags = 0;
+
+		if (i >= out_sgs)
+			flags |= VRING_DESC_F_WRITE;
+		if (i + 1 < total)
+			flags |= VRING_DESC_F_NEXT;
+		desc[i].addr = cpu_to_virtio64(vq->vdev,
+					       (u64)(uintptr_t)sgs[i]->addr);
+		desc[i].len = cpu_to_virtio32(vq->vdev, sgs[i]->length);
+		desc[i].flags = cpu_to_virtio16(vq->vdev, flags);
+		desc[i].next = cpu_to_virtio16(vq->vdev, i + 1);
+	}
+
+	return desc;
+}
+
+static int virtqueue_add_split(struct virtqueue *vq, struct virtio_sg *sgs[],
+			       unsigned int out_sgs, unsigned int in_sgs)
+{
+	struct vring_desc *desc, *indir = NULL;
+	unsigned int total = out_sgs + in_sgs;
+	unsigned int descs_used = total;
 	unsigned int i, n, avail, uninitialized_var(prev);
 	int head;
 
-	WARN_ON(descs_used == 0);
+	if (vq->indirect && total > 1) {
+		indir = alloc_indirect_split(vq, sgs, out_sgs, total);
+		if (indir)
+			descs_used = 1;
+	}
 
 	head = vq->free_head;
 
@@ -116,6 +155,7 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	if (vq->num_free < descs_used) {
 		debug("Can't add buf len %i - avail = %i\n",
 		      descs_used, vq->num_free);
+		free(indir);
 		/*
 		 * FIXME: for historical reasons, we force a notify here if
 		 * there are outgoing parts to the buffer.  Presumably the
@@ -126,13 +166,20 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		return -ENOSPC;
 	}
 
-	for (n = 0; n < descs_used; n++) {
-		u16 flags = VRING_DESC_F_NEXT;
+	if (indir) {
+		struct virtio_sg sg = { indir, total * sizeof(*indir) };
 
-		if (n >= out_sgs)
-			flags |= VRING_DESC_F_WRITE;
 		prev = i;
-		i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		i = virtqueue_attach_desc(vq, i, &sg, VRING_DESC_F_INDIRECT);
+	} else {
+		for (n = 0; n < descs_used; n++) {
+			u16 flags = VRING_DESC_F_NEXT;
+
+			if (n >= out_sgs)
+				flags |= VRING_DESC_F_WRITE;
+			prev = i;
+			i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		}
 	}
 	/* Last one doesn't continue */
 	vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
@@ -146,6 +193,12 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 
 	/* Mark the descriptor as the head of a chain. */
 	vq->vring_desc_shadow[head].chain_head = true;
+	vq->vring_desc_shadow[head].indir = indir;
+	if (indir)
+		vq->vring_desc_shadow[head].data = sgs[0]->addr;
+	else
+		vq->vring_desc_shadow[head].data =
+			(void *)(uintptr_t)vq->vring_desc_shadow[head].addr;
 
 	/*
 	 * Put entry in available array (but don't update avail->idx
@@ -173,11 +226,158 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	return 0;
 }
 
+static struct vring_packed_desc *alloc_indirect_packed(struct virtio_sg *sgs[],
+						       unsigned int out_sgs,
+						       unsigned int total)
+{
+	struct vring_packed_desc *desc;
+	unsigned int i;
+
+	desc = malloc(total * sizeof(*desc));
+	if (!desc)
+		return NULL;
+
+	for (i = 0; i < total; i++) {
+		desc[i].addr = cpu_to_le64((u64)(uintptr_t)sgs[i]->addr);
+		desc[i].len = cpu_to_le32(sgs[i]->length);
+		desc[i].id = 0;
+		desc[i].flags = cpu_to_le16(i >= out_sgs ?
+					    VRING_DESC_F_WRITE : 0);
+	}
+
+	return desc;
+}
+
+static int virtqueue_add_packed(struct virtqueue *vq, struct virtio_sg *sgs[],
+				unsigned int out_sgs, unsigned int in_sgs)
+{
+	struct vring_packed_desc *desc = vq->packed_ring.desc;
+	struct vring_packed_desc *indir = NULL;
+	struct vring_desc_shadow *shadow;
+	unsigned int total = out_sgs + in_sgs;
+	unsigned int descs_used = total;
+	unsigned int i, n, head;
+	u16 id, flags, uninitialized_var(head_flags);
+	bool wrap;
+
+	if (vq->indirect && total > 1) {
+		indir = alloc_indirect_packed(sgs, out_sgs, total);
+		if (indir)
+			descs_used = 1;
+	}
+
+	if (vq->num_free < descs_used) {
+		debug("Can't add buf len %i - avail = %i\n",
+		      descs_used, vq->num_free);
+		free(indir);
+		if (out_sgs)
+			virtio_notify(vq->vdev, vq);
+		return -ENOSPC;
+	}
+
+	id = vq->free_head;
+	head = vq->avail_idx_shadow;
+	wrap = vq->avail_wrap_counter;
+	for (i = head, n = 0; n < descs_used; n++) {
+		u64 addr;
+		u32 len;
+
+		flags = wrap ? BIT(VRING_PACKED_DESC_F_AVAIL) :
+			BIT(VRING_PACKED_DESC_F_USED);
+		if (indir) {
+			addr = (u64)(uintptr_t)indir;
+			len = total * sizeof(*indir);
+			flags |= VRING_DESC_F_INDIRECT;
+		} else {
+			addr = (u64)(uintptr_t)sgs[n]->addr;
+			len = sgs[n]->length;
+			if (n >= out_sgs)
+				flags |= VRING_DESC_F_WRITE;
+			if (n + 1 < descs_used)
+				flags |= VRING_DESC_F_NEXT;
+		}
+		desc[i].addr = cpu_to_le64(addr);
+		desc[i].len = cpu_to_le32(len);
+		desc[i].id = cpu_to_le16(id);
+		if (i == head)
+			head_flags = flags;
+		else
+			desc[i].flags = cpu_to_le16(flags);
+
+		if (++i == vq->vring.num) {
+			i = 0;
+			wrap = !wrap;
+		}
+	}
+
+	shadow = &vq->vring_desc_shadow[id];
+	vq->free_head = shadow->next;
+	shadow->chain_head = true;
+	shadow->num = descs_used;
+	shadow->data = sgs[0]->addr;
+	shadow->indir = indir;
+
+	vq->num_free -= descs_used;
+	vq->avail_idx_shadow = i;
+	vq->avail_wrap_counter = wrap;
+	vq->num_added += descs_used;
+
+	/*
+	 * The rest of the chain must be visible before the head is made
+	 * available, since the device may start on it straight away.
+	 */
+	virtio_wmb();
+	desc[head].flags = cpu_to_le16(head_flags);
+
+	return 0;
+}
+
+int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
+		  unsigned int out_sgs, unsigned int in_sgs)
+{
+	WARN_ON(out_sgs + in_sgs == 0);
+
+	if (vq->packed)
+		return virtqueue_add_packed(vq, sgs, out_sgs, in_sgs);
+
+	return virtqueue_add_split(vq, sgs, out_sgs, in_sgs);
+}
+
+static bool virtqueue_kick_prepare_packed(struct virtqueue *vq)
+{
+	u16 new, old, off_wrap, flags, wrap_counter, event_idx;
+
+	/*
+	 * We need to expose the new flags value before checking notification
+	 * suppressions.
+	 */
+	virtio_mb();
+
+	old = vq->avail_idx_shadow - vq->num_added;
+	new = vq->avail_idx_shadow;
+	vq->num_added = 0;
+
+	off_wrap = le16_to_cpu(vq->packed_ring.device->off_wrap);
+	flags = le16_to_cpu(vq->packed_ring.device->flags);
+	if (flags != VRING_PACKED_EVENT_FLAG_DESC)
+		return flags != VRING_PACKED_EVENT_FLAG_DISABLE;
+
+	wrap_counter = off_wrap >> VRING_PACKED_EVENT_F_WRAP_CTR;
+	event_idx = off_wrap & ~(1 << VRING_PACKED_EVENT_F_WRAP_CTR);
+	if (wrap_counter != vq->avail_wrap_counter)
+		event_idx -= vq->vring.num;
+
+	return vring_need_event(event_idx, new, old);
+}
+
 static bool virtqueue_kick_prepare(struct virtqueue *vq)
 {
 	u16 new, old;
 	bool needs_kick;
 
+	if (vq->packed)
+		return virtqueue_kick_prepare_packed(vq);
+
 	/*
 	 * We need to expose available array entries before checking
 	 * avail event.
@@ -211,6 +411,8 @@ static void detach_buf(struct virtqueue *vq, unsigned int head)
 
 	/* Unmark the descriptor as the head of a chain. */
 	vq->vring_desc_shadow[head].chain_head = false;
+	free(vq->vring_desc_shadow[head].indir);
+	vq->vring_desc_shadow[head].indir = NULL;
 
 	/* Put back on free list: unmap first-level descriptors and find end */
 	i = head;
@@ -235,11 +437,81 @@ static inline bool more_used(const struct virtqueue *vq)
 			vq->vring.used->idx);
 }
 
+static bool is_used_desc_packed(const struct virtqueue *vq, u16 idx,
+				bool used_wrap_counter)
+{
+	u16 flags = le16_to_cpu(vq->packed_ring.desc[idx].flags);
+	bool avail = flags & BIT(VRING_PACKED_DESC_F_AVAIL);
+	bool used = flags & BIT(VRING_PACKED_DESC_F_USED);
+
+	return avail == used && used == used_wrap_counter;
+}
+
+static void *virtqueue_get_buf_packed(struct virtqueue *vq, unsigned int *len)
+{
+	struct vring_packed_desc *desc;
+	struct vring_desc_shadow *shadow;
+	unsigned int last_used;
+	u16 id;
+
+	if (!is_used_desc_packed(vq, vq->last_used_idx,
+				 vq->used_wrap_counter)) {
+		debug("(%s.%d): No more buffers in queue\n",
+		      vq->vdev->name, vq->index);
+		return NULL;
+	}
+
+	/* Only read the descriptor after the flags say it is used */
+	virtio_rmb();
+
+	desc = &vq->packed_ring.desc[vq->last_used_idx];
+	id = le16_to_cpu(desc->id);
+	if (len) {
+		*len = le32_to_cpu(desc->len);
+		debug("(%s.%d): last used idx %u with len %u\n",
+		      vq->vdev->name, vq->index, id, *len);
+	}
+
+	if (unlikely(id >= vq->vring.num)) {
+		printf("(%s.%d): id %u out of range\n",
+		       vq->vdev->name, vq->index, id);
+		return NULL;
+	}
+
+	shadow = &vq->vring_desc_shadow[id];
+	if (unlikely(!shadow->chain_head)) {
+		printf("(%s.%d): id %u is not a head\n",
+		       vq->vdev->name, vq->index, id);
+		return NULL;
+	}
+
+	shadow->chain_head = false;
+	free(shadow->indir);
+	shadow->indir = NULL;
+	vq->num_free += shadow->num;
+
+	/* The device skips the rest of the chain, so we do too */
+	last_used = vq->last_used_idx + shadow->num;
+	if (last_used >= vq->vring.num) {
+		last_used -= vq->vring.num;
+		vq->used_wrap_counter = !vq->used_wrap_counter;
+	}
+	vq->last_used_idx = last_used;
+
+	shadow->next = vq->free_head;
+	vq->free_head = id;
+
+	return shadow->data;
+}
+
 void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 {
 	unsigned int i;
 	u16 last_used;
 
+	if (vq->packed)
+		return virtqueue_get_buf_packed(vq, len);
+
 	if (!more_used(vq)) {
 		debug("(%s.%d): No more buffers in queue\n",
 		      vq->vdev->name, vq->index);
@@ -281,11 +553,12 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)vq->vring_desc_shadow[i].addr;
+	return vq->vring_desc_shadow[i].data;
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 					       struct vring vring,
+					       struct vring_packed *packed,
 					       struct udevice *udev)
 {
 	unsigned int i;
@@ -316,12 +589,27 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	/* Indirect tables are not bounced, so cannot be used with an IOMMU */
+	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
+		!vring.bouncebufs;
+	vq->packed = packed != NULL;
 
 	/* Tell other side not to bother us */
 	vq->avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
-	if (!vq->event)
-		vq->vring.avail->flags = cpu_to_virtio16(vdev,
-				vq->avail_flags_shadow);
+	if (packed) {
+		vq->packed_ring = *packed;
+		vq->avail_wrap_counter = true;
+		vq->used_wrap_counter = true;
+		vq->packed_ring.driver->flags =
+			cpu_to_le16(VRING_PACKED_EVENT_FLAG_DISABLE);
+	} else {
+		memset(&vq->packed_ring, '\0', sizeof(vq->packed_ring));
+		vq->avail_wrap_counter = false;
+		vq->used_wrap_counter = false;
+		if (!vq->event)
+			vq->vring.avail->flags = cpu_to_virtio16(vdev,
+					vq->avail_flags_shadow);
+	}
 
 	/* Put everything in free lists */
 	vq->free_head = 0;
@@ -331,6 +619,47 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	return vq;
 }
 
+static struct virtqueue *vring_create_virtqueue_packed(unsigned int index,
+							unsigned int num,
+							struct udevice *udev)
+{
+	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(udev);
+	struct udevice *vdev = uc_priv->vdev;
+	struct vring_packed packed;
+	struct virtqueue *vq;
+	struct vring vring;
+	void *queue = NULL;
+	size_t size;
+
+	for (; num; num /= 2) {
+		size = vring_packed_size(num);
+		queue = virtio_alloc_pages(vdev, DIV_ROUND_UP(size, PAGE_SIZE));
+		if (queue || size <= PAGE_SIZE)
+			break;
+	}
+	if (!queue)
+		return NULL;
+
+	memset(queue, 0, size);
+	memset(&vring, '\0', sizeof(vring));
+	vring.num = num;
+	vring.size = size;
+	packed.desc = queue;
+	packed.driver = queue + num * sizeof(struct vring_packed_desc);
+	packed.device = packed.driver + 1;
+
+	vq = __vring_new_virtqueue(index, vring, &packed, udev);
+	if (!vq) {
+		virtio_free_pages(vdev, queue, DIV_ROUND_UP(size, PAGE_SIZE));
+		return NULL;
+	}
+
+	debug("(%s): created packed vring @ %p for vq @ %p with num %u\n",
+	      udev->name, queue, vq, num);
+
+	return vq;
+}
+
 struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 					 unsigned int vring_align,
 					 struct udevice *udev)
@@ -348,6 +677,9 @@ struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 		return NULL;
 	}
 
+	if (virtio_has_feature(vdev, VIRTIO_F_RING_PACKED))
+		return vring_create_virtqueue_packed(index, num, udev);
+
 	/* TODO: allocate each queue chunk individually */
 	for (; num && vring_size(num, vring_align) > PAGE_SIZE; num /= 2) {
 		size_t sz = vring_size(num, vring_align);
@@ -377,7 +709,7 @@ struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 
 	vring_init(&vring, num, queue, vring_align, bbs);
 
-	vq = __vring_new_virtqueue(index, vring, udev);
+	vq = __vring_new_virtqueue(index, vring, NULL, udev);
 	if (!vq)
 		goto err_free_bbs;
 
@@ -395,7 +727,12 @@ err_free_queue:
 
 void vring_del_virtqueue(struct virtqueue *vq)
 {
-	virtio_free_pages(vq->vdev, vq->vring.desc,
+	unsigned int i;
+
+	for (i = 0; i < vq->vring.num; i++)
+		free(vq->vring_desc_shadow[i].indir);
+	virtio_free_pages(vq->vdev, vq->packed ? (void *)vq->packed_ring.desc :
+			  (void *)vq->vring.desc,
 			  DIV_ROUND_UP(vq->vring.size, PAGE_SIZE));
 	free(vq->vring_desc_shadow);
 	list_del(&vq->list);
@@ -410,17 +747,26 @@ unsigned int virtqueue_get_vring_size(struct virtqueue *vq)
 
 ulong virtqueue_get_desc_addr(struct virtqueue *vq)
 {
+	if (vq->packed)
+		return (ulong)vq->packed_ring.desc;
+
 	return (ulong)vq->vring.desc;
 }
 
 ulong virtqueue_get_avail_addr(struct virtqueue *vq)
 {
+	if (vq->packed)
+		return (ulong)vq->packed_ring.driver;
+
 	return (ulong)vq->vring.desc +
 	       ((char *)vq->vring.avail - (char *)vq->vring.desc);
 }
 
 ulong virtqueue_get_used_addr(struct virtqueue *vq)
 {
+	if (vq->packed)
+		return (ulong)vq->packed_ring.device;
+
 	return (ulong)vq->vring.desc +
 	       ((char *)vq->vring.used - (char *)vq->vring.desc);
 }
@@ -429,6 +775,11 @@ bool virtqueue_poll(struct virtqueue *vq, u16 last_used_idx)
 {
 	virtio_mb();
 
+	if (vq->packed)
+		return is_used_desc_packed(vq, last_used_idx &
+				~(1 << VRING_PACKED_EVENT_F_WRAP_CTR),
+				last_used_idx >> VRING_PACKED_EVENT_F_WRAP_CTR);
+
 	return last_used_idx != virtio16_to_cpu(vq->vdev, vq->vring.used->idx);
 }
 
@@ -443,6 +794,21 @@ void virtqueue_dump(struct virtqueue *vq)
 	       vq->free_head, vq->num_added, vq->num_free);
 	printf("\tlast_used_idx %u, avail_flags_shadow %u, avail_idx_shadow %u\n",
 	       vq->last_used_idx, vq->avail_flags_shadow, vq->avail_idx_shadow);
+	printf("\tevent %d, indirect %d, packed %d\n", vq->event, vq->indirect,
+	       vq->packed);
+	if (vq->packed) {
+		printf("\tavail_wrap_counter %d, used_wrap_counter %d\n",
+		       vq->avail_wrap_counter, vq->used_wrap_counter);
+		printf("Packed descriptor dump:\n");
+		for (i = 0; i < vq->vring.num; i++) {
+			struct vring_packed_desc *desc = &vq->packed_ring.desc[i];
+
+			printf("\tdesc[%u] = { 0x%llx, len %u, id %u, flags %x }\n",
+			       i, le64_to_cpu(desc->addr), le32_to_cpu(desc->len),
+			       le16_to_cpu(desc->id), le16_to_cpu(desc->flags));
+		}
+		return;
+	}
 
 	printf("Shadow descriptor dump:\n");
 	for (i = 0; i < vq->vring.num; i++) {
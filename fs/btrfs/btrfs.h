@@ -17,6 +17,47 @@ extern struct btrfs_fs_info *current_fs_info;
 /* compression.c */
 u32 btrfs_decompress(u8 type, const char *, u32, char *, u32);
 
+/**
+ * btrfs_decomp_cache_lookup() - find a cached decompressed extent
+ *
+ * @fs_info:	Filesystem the extent belongs to
+ * @disk_bytenr: Logical address of the compressed extent on disk
+ * @dsize:	Size of the extent when decompressed
+ * Return: decompressed data, owned by the cache, or NULL if not cached
+ */
+char *btrfs_decomp_cache_lookup(struct btrfs_fs_info *fs_info,
+				u64 disk_bytenr, u32 dsize);
+
+/**
+ * btrfs_decomp_cache_alloc() - get a cache buffer to decompress an extent to
+ *
+ * This evicts the least recently used extent if the cache is full. If
+ * decompression fails the caller must drop the entry again.
+ *
+ * @fs_info:	Filesystem the extent belongs to
+ * @disk_bytenr: Logical address of the compressed extent on disk
+ * @dsize:	Size of the extent when decompressed
+ * Return: buffer of @dsize bytes owned by the cache, or NULL if the cache is
+ *	disabled or out of memory
+ */
+char *btrfs_decomp_cache_alloc(struct btrfs_fs_info *fs_info,
+			       u64 disk_bytenr, u32 dsize);
+
+/**
+ * btrfs_decomp_cache_drop() - forget a cached extent
+ *
+ * @fs_info:	Filesystem the extent belongs to
+ * @disk_bytenr: Logical address of the compressed extent on disk
+ */
+void btrfs_decomp_cache_drop(struct btrfs_fs_info *fs_info, u64 disk_bytenr);
+
+/**
+ * btrfs_decomp_cache_free() - free all cached extents of a filesystem
+ *
+ * @fs_info:	Filesystem to free the cache of
+ */
+void btrfs_decomp_cache_free(struct btrfs_fs_info *fs_info);
+
 /* inode.c */
 int btrfs_readlink(struct btrfs_root *root, u64 ino, char *target);
 int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
@@ -7,8 +7,10 @@
 
 #include "btrfs.h"
 #include <abuf.h>
+#include <btrfs.h>
 #include <log.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <linux/lzo.h>
 #include <linux/zstd.h>
 #include <linux/compat.h>
@@ -171,3 +173,122 @@ u32 btrfs_decompress(u8 type, const char *c, u32 clen, char *d, u32 dlen)
 		return -1;
 	}
 }
+
+/*
+ * A compressed extent can only be decompressed as a whole, so reads which
+ * each cover part of one (unaligned heads and tails, or a file read in
+ * several pieces) would decompress up to 128KiB again for every piece.
+ * Keep the most recently used decompressed extents, keyed by their logical
+ * disk address.
+ */
+struct btrfs_decomp_entry {
+	u64 disk_bytenr;
+	u32 dsize;
+	u32 last_used;
+	char *buf;
+};
+
+struct btrfs_decomp_cache {
+	struct btrfs_decomp_entry ents[CONFIG_BTRFS_DECOMP_CACHE_ENTRIES];
+	u32 clock;
+};
+
+static struct btrfs_decomp_stats decomp_stats;
+
+char *btrfs_decomp_cache_lookup(struct btrfs_fs_info *fs_info,
+				u64 disk_bytenr, u32 dsize)
+{
+	struct btrfs_decomp_cache *cache = fs_info->decomp_cache;
+	struct btrfs_decomp_entry *ent;
+	int i;
+
+	for (i = 0; cache && i < CONFIG_BTRFS_DECOMP_CACHE_ENTRIES; i++) {
+		ent = &cache->ents[i];
+		if (ent->buf && ent->disk_bytenr == disk_bytenr &&
+		    ent->dsize == dsize) {
+			ent->last_used = ++cache->clock;
+			decomp_stats.hits++;
+			return ent->buf;
+		}
+	}
+	decomp_stats.misses++;
+
+	return NULL;
+}
+
+char *btrfs_decomp_cache_alloc(struct btrfs_fs_info *fs_info,
+			       u64 disk_bytenr, u32 dsize)
+{
+	struct btrfs_decomp_cache *cache = fs_info->decomp_cache;
+	struct btrfs_decomp_entry *ent, *victim = NULL;
+	int i;
+
+	if (!CONFIG_BTRFS_DECOMP_CACHE_ENTRIES)
+		return NULL;
+	if (!cache) {
+		cache = calloc(1, sizeof(*cache));
+		if (!cache)
+			return NULL;
+		fs_info->decomp_cache = cache;
+	}
+
+	/* Prefer a free slot, else the least recently used one */
+	for (i = 0; i < CONFIG_BTRFS_DECOMP_CACHE_ENTRIES; i++) {
+		ent = &cache->ents[i];
+		if (!ent->buf) {
+			victim = ent;
+			break;
+		}
+		if (!victim || ent->last_used < victim->last_used)
+			victim = ent;
+	}
+
+	if (victim->buf && victim->dsize != dsize) {
+		free(victim->buf);
+		victim->buf = NULL;
+	}
+	if (!victim->buf) {
+		victim->buf = malloc_cache_aligned(dsize);
+		if (!victim->buf)
+			return NULL;
+	}
+	victim->disk_bytenr = disk_bytenr;
+	victim->dsize = dsize;
+	victim->last_used = ++cache->clock;
+
+	return victim->buf;
+}
+
+void btrfs_decomp_cache_drop(struct btrfs_fs_info *fs_info, u64 disk_bytenr)
+{
+	struct btrfs_decomp_cache *cache = fs_info->decomp_cache;
+	int i;
+
+	if (!cache)
+		return;
+	for (i = 0; i < CONFIG_BTRFS_DECOMP_CACHE_ENTRIES; i++) {
+		if (cache->ents[i].buf &&
+		    cache->ents[i].disk_bytenr == disk_bytenr) {
+			free(cache->ents[i].buf);
+			cache->ents[i].buf = NULL;
+		}
+	}
+}
+
+void btrfs_decomp_cache_free(struct btrfs_fs_info *fs_info)
+{
+	struct btrfs_decomp_cache *cache = fs_info->decomp_cache;
+	int i;
+
+	if (!cache)
+		return;
+	for (i = 0; i < CONFIG_BTRFS_DECOMP_CACHE_ENTRIES; i++)
+		free(cache->ents[i].buf);
+	free(cache);
+	fs_info->decomp_cache = NULL;
+}
+
+void btrfs_decomp_stats(struct btrfs_decomp_stats *stats)
+{
+	*stats = decomp_stats;
+}
@@ -123,6 +123,9 @@ struct btrfs_fs_info {
 	u32 nodesize;
 	u32 sectorsize;
 	u32 stripesize;
+
+	/* Recently decompressed extents, see btrfs_decomp_cache_lookup() */
+	struct btrfs_decomp_cache *decomp_cache;
 };
 
 static inline u32 BTRFS_MAX_ITEM_SIZE(const struct btrfs_fs_info *info)
@@ -759,6 +759,7 @@ struct btrfs_root *btrfs_read_fs_root(struct btrfs_fs_info *fs_info,
 
 void btrfs_free_fs_info(struct btrfs_fs_info *fs_info)
 {
+	btrfs_decomp_cache_free(fs_info);
 	free(fs_info->tree_root);
 	free(fs_info->chunk_root);
 	free(fs_info->csum_root);
@@ -426,12 +426,14 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	struct btrfs_key key;
 	u64 extent_num_bytes;
 	u64 disk_bytenr;
+	u64 extent_off;
 	u64 read;
 	char *cbuf = NULL;
 	char *dbuf = NULL;
 	u32 csize;
 	u32 dsize;
 	bool finished = false;
+	bool cached = false;
 	int num_copies;
 	int i;
 	int slot = path->slots[0];
@@ -475,13 +477,34 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	csize = btrfs_file_extent_disk_num_bytes(leaf, fi);
 	dsize = btrfs_file_extent_ram_bytes(leaf, fi);
 	disk_bytenr = btrfs_file_extent_disk_bytenr(leaf, fi);
+	extent_off = btrfs_file_extent_offset(leaf, fi) + offset - key.offset;
 	num_copies = btrfs_num_copies(fs_info, disk_bytenr, csize);
 
+	/* Another part of this extent may have been read recently */
+	dbuf = btrfs_decomp_cache_lookup(fs_info, disk_bytenr, dsize);
+	if (dbuf) {
+		memcpy(dest, dbuf + extent_off, len);
+		return len;
+	}
+
 	cbuf = malloc_cache_aligned(csize);
-	dbuf = malloc_cache_aligned(dsize);
-	if (!cbuf || !dbuf) {
-		ret = -ENOMEM;
-		goto out;
+	if (!cbuf)
+		return -ENOMEM;
+
+	if (!extent_off && len == dsize) {
+		/* The whole extent is wanted, so decompress it in place */
+		dbuf = dest;
+	} else {
+		dbuf = btrfs_decomp_cache_alloc(fs_info, disk_bytenr, dsize);
+		if (dbuf) {
+			cached = true;
+		} else {
+			dbuf = malloc_cache_aligned(dsize);
+			if (!dbuf) {
+				ret = -ENOMEM;
+				goto out;
+			}
+		}
 	}
 	/* For compressed extent, we must read the whole on-disk extent */
 	for (i = 1; i <= num_copies; i++) {
@@ -511,13 +534,15 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	if (ret < dsize)
 		memset(dbuf + ret, 0, dsize - ret);
 	/* Then copy the needed part */
-	memcpy(dest,
-	       dbuf + btrfs_file_extent_offset(leaf, fi) + offset - key.offset,
-	       len);
+	if (dbuf != dest)
+		memcpy(dest, dbuf + extent_off, len);
 	ret = len;
 out:
+	if (cached && ret < 0)
+		btrfs_decomp_cache_drop(fs_info, disk_bytenr);
+	else if (!cached && dbuf != dest)
+		free(dbuf);
 	free(cbuf);
-	free(dbuf);
 	return ret;
 }
 
@@ -22,6 +22,7 @@
 #include <blk.h>
 #include <ext_common.h>
 #include <ext4fs.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
 #include <memalign.h>
@@ -47,6 +48,26 @@ int ext4fs_indir3_blkno = -1;
 struct ext2_inode *g_parent_inode;
 static int symlinknest;
 
+/* Longest name (plus terminator) held in the directory lookup cache */
+#define EXT4_DCACHE_NAME_LEN	40
+
+/**
+ * struct ext4_dcache_entry - cached result of looking up a name
+ *
+ * @dir_ino:	Inode number of the directory searched, 0 if slot unused
+ * @ino:	Inode number found, 0 if the name does not exist
+ * @type:	Type of the entry found (FILETYPE_...)
+ * @name:	Name looked up
+ */
+struct ext4_dcache_entry {
+	int dir_ino;
+	int ino;
+	int type;
+	char name[EXT4_DCACHE_NAME_LEN];
+};
+
+static struct ext4_dcache_entry ext4fs_dcache[CONFIG_EXT4_DCACHE_ENTRIES];
+
 #if defined(CONFIG_EXT4_WRITE)
 struct ext2_block_group *ext4fs_get_group_descriptor
 	(const struct ext_filesystem *fs, uint32_t bg_idx)
@@ -2045,6 +2066,66 @@ void ext4fs_close(void)
 	}
 
 	ext4fs_reinit_global();
+	ext4fs_dcache_flush();
+}
+
+/**
+ * ext4fs_dirent_node() - create a node for a directory entry
+ *
+ * @diro:	Directory holding the entry
+ * @ino:	Inode number from the entry
+ * @filetype:	File type from the entry (FILETYPE_...)
+ * @fnode:	Returns the new node, which the caller must free
+ * @ftype:	Returns the type of the node, read from the inode if the entry
+ *		does not record it
+ * Return: 1 if OK, 0 on error
+ */
+static int ext4fs_dirent_node(struct ext2fs_node *diro, int ino, int filetype,
+			      struct ext2fs_node **fnode, int *ftype)
+{
+	struct ext2fs_node *fdiro;
+	int type = FILETYPE_UNKNOWN;
+	int status;
+
+	fdiro = zalloc(sizeof(struct ext2fs_node));
+	if (!fdiro)
+		return 0;
+
+	fdiro->data = diro->data;
+	fdiro->ino = ino;
+
+	if (filetype != FILETYPE_UNKNOWN) {
+		fdiro->inode_read = 0;
+
+		if (filetype == FILETYPE_DIRECTORY)
+			type = FILETYPE_DIRECTORY;
+		else if (filetype == FILETYPE_SYMLINK)
+			type = FILETYPE_SYMLINK;
+		else if (filetype == FILETYPE_REG)
+			type = FILETYPE_REG;
+	} else {
+		status = ext4fs_read_inode(diro->data, ino, &fdiro->inode);
+		if (status == 0) {
+			free(fdiro);
+			return 0;
+		}
+		fdiro->inode_read = 1;
+
+		if ((le16_to_cpu(fdiro->inode.mode) &
+		     FILETYPE_INO_MASK) == FILETYPE_INO_DIRECTORY) {
+			type = FILETYPE_DIRECTORY;
+		} else if ((le16_to_cpu(fdiro->inode.mode)
+			    & FILETYPE_INO_MASK) == FILETYPE_INO_SYMLINK) {
+			type = FILETYPE_SYMLINK;
+		} else if ((le16_to_cpu(fdiro->inode.mode)
+			    & FILETYPE_INO_MASK) == FILETYPE_INO_REG) {
+			type = FILETYPE_REG;
+		}
+	}
+	*fnode = fdiro;
+	*ftype = type;
+
+	return 1;
 }
 
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
@@ -2054,6 +2135,7 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 	int status;
 	loff_t actread;
 	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
+	int namelen = name ? strlen(name) : 0;
 
 #ifdef DEBUG
 	if (name != NULL)
@@ -2079,10 +2161,12 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			return 0;
 		}
 
-		if (dirent.namelen != 0) {
+		/* Names of a different length cannot match */
+		if (dirent.namelen != 0 &&
+		    (name == NULL || dirent.namelen == namelen)) {
 			char filename[dirent.namelen + 1];
 			struct ext2fs_node *fdiro;
-			int type = FILETYPE_UNKNOWN;
+			int type;
 
 			status = ext4fs_read_file(diro,
 						  fpos +
@@ -2092,60 +2176,22 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			if (status < 0)
 				return 0;
 
-			fdiro = zalloc(sizeof(struct ext2fs_node));
-			if (!fdiro)
-				return 0;
-
-			fdiro->data = diro->data;
-			fdiro->ino = le32_to_cpu(dirent.inode);
-
 			filename[dirent.namelen] = '\0';
-
-			if (dirent.filetype != FILETYPE_UNKNOWN) {
-				fdiro->inode_read = 0;
-
-				if (dirent.filetype == FILETYPE_DIRECTORY)
-					type = FILETYPE_DIRECTORY;
-				else if (dirent.filetype == FILETYPE_SYMLINK)
-					type = FILETYPE_SYMLINK;
-				else if (dirent.filetype == FILETYPE_REG)
-					type = FILETYPE_REG;
-			} else {
-				status = ext4fs_read_inode(diro->data,
-							   le32_to_cpu
-							   (dirent.inode),
-							   &fdiro->inode);
-				if (status == 0) {
-					free(fdiro);
-					return 0;
-				}
-				fdiro->inode_read = 1;
-
-				if ((le16_to_cpu(fdiro->inode.mode) &
-				     FILETYPE_INO_MASK) ==
-				    FILETYPE_INO_DIRECTORY) {
-					type = FILETYPE_DIRECTORY;
-				} else if ((le16_to_cpu(fdiro->inode.mode)
-					    & FILETYPE_INO_MASK) ==
-					   FILETYPE_INO_SYMLINK) {
-					type = FILETYPE_SYMLINK;
-				} else if ((le16_to_cpu(fdiro->inode.mode)
-					    & FILETYPE_INO_MASK) ==
-					   FILETYPE_INO_REG) {
-					type = FILETYPE_REG;
-				}
-			}
 #ifdef DEBUG
 			printf("iterate >%s<\n", filename);
 #endif /* of DEBUG */
 			if ((name != NULL) && (fnode != NULL)
 			    && (ftype != NULL)) {
-				if (strcmp(filename, name) == 0) {
-					*ftype = type;
-					*fnode = fdiro;
-					return 1;
-				}
+				if (strcmp(filename, name) == 0)
+					return ext4fs_dirent_node(diro,
+						le32_to_cpu(dirent.inode),
+						dirent.filetype, fnode, ftype);
 			} else {
+				if (!ext4fs_dirent_node(diro,
+							le32_to_cpu(dirent.inode),
+							dirent.filetype, &fdiro,
+							&type))
+					return 0;
 				if (fdiro->inode_read == 0) {
 					status = ext4fs_read_inode(diro->data,
 								 le32_to_cpu(
@@ -2174,14 +2220,108 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 				printf("%10u %s\n",
 				       le32_to_cpu(fdiro->inode.size),
 					filename);
+				free(fdiro);
 			}
-			free(fdiro);
 		}
 		fpos += le16_to_cpu(dirent.direntlen);
 	}
 	return 0;
 }
 
+/**
+ * ext4fs_dcache_slot() - find the cache slot for a directory entry
+ *
+ * @dir_ino:	Inode number of the directory
+ * @name:	Name of the entry
+ * Return: pointer to the slot, or NULL if the name cannot be cached
+ */
+static struct ext4_dcache_entry *ext4fs_dcache_slot(int dir_ino,
+						    const char *name)
+{
+	uint hash = dir_ino;
+	const char *p;
+
+	if (!CONFIG_EXT4_DCACHE_ENTRIES ||
+	    strlen(name) >= EXT4_DCACHE_NAME_LEN)
+		return NULL;
+	for (p = name; *p; p++)
+		hash = hash * 31 + *p;
+
+	return &ext4fs_dcache[hash % CONFIG_EXT4_DCACHE_ENTRIES];
+}
+
+/* Forget all cached lookups, e.g. because the filesystem is changing */
+void ext4fs_dcache_flush(void)
+{
+	memset(ext4fs_dcache, '\0', sizeof(ext4fs_dcache));
+}
+
+static void ext4fs_dcache_add(int dir_ino, const char *name, int ino, int type)
+{
+	struct ext4_dcache_entry *ent = ext4fs_dcache_slot(dir_ino, name);
+
+	if (!ent)
+		return;
+	ent->dir_ino = dir_ino;
+	ent->ino = ino;
+	ent->type = type;
+	strcpy(ent->name, name);
+}
+
+/**
+ * ext4fs_lookup() - look up a single name in a directory
+ *
+ * This uses, in order, the lookup cache, the directory's hash tree index and
+ * finally a linear scan of the directory.
+ *
+ * @dir:	Directory to search
+ * @name:	Name of the entry to find
+ * @fnode:	Returns the node for the entry, which the caller must free
+ * @ftype:	Returns the type of the entry (FILETYPE_...)
+ * Return: 1 if found, 0 if not found or on error
+ */
+static int ext4fs_lookup(struct ext2fs_node *dir, char *name,
+			 struct ext2fs_node **fnode, int *ftype)
+{
+	struct ext4_dcache_entry *ent;
+	int ino, type, found, ret;
+
+	if (!dir->inode_read) {
+		if (!ext4fs_read_inode(dir->data, dir->ino, &dir->inode))
+			return 0;
+		dir->inode_read = 1;
+	}
+
+	ent = ext4fs_dcache_slot(dir->ino, name);
+	if (ent && ent->dir_ino == dir->ino && !strcmp(ent->name, name)) {
+		if (!ent->ino)
+			return 0;
+		return ext4fs_dirent_node(dir, ent->ino, ent->type, fnode,
+					  ftype);
+	}
+
+	if (IS_ENABLED(CONFIG_EXT4_DIR_INDEX)) {
+		ret = ext4fs_htree_lookup(dir, name, &ino, &type);
+		if (ret == -ENOENT) {
+			ext4fs_dcache_add(dir->ino, name, 0, FILETYPE_UNKNOWN);
+			return 0;
+		}
+		if (!ret) {
+			found = ext4fs_dirent_node(dir, ino, type, fnode, ftype);
+			if (found)
+				ext4fs_dcache_add(dir->ino, name, ino, *ftype);
+			return found;
+		}
+		/* Fall back to a linear scan if the index is not usable */
+	}
+
+	found = ext4fs_iterate_dir(dir, name, fnode, ftype);
+	if (found == 1)
+		ext4fs_dcache_add(dir->ino, name, (*fnode)->ino, *ftype);
+
+	return found;
+}
+
 static char *ext4fs_read_symlink(struct ext2fs_node *node)
 {
 	char *symlink;
@@ -2255,8 +2395,8 @@ static int ext4fs_find_file1(const char *currpath,
 
 		oldnode = currnode;
 
-		/* Iterate over the directory. */
-		found = ext4fs_iterate_dir(currnode, name, &currnode, &type);
+		/* Look up the name in the directory. */
+		found = ext4fs_lookup(currnode, name, &currnode, &type);
 		if (found == 0)
 			return 0;
 
@@ -2341,26 +2481,47 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 int ext4fs_open(const char *filename, loff_t *len)
 {
 	struct ext2fs_node *fdiro = NULL;
+	struct fs_lookup_entry ent;
 	int status;
 
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
-	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
-				  FILETYPE_REG);
-	if (status == 0)
-		goto fail;
+	/* The previous file is still open if the filesystem stayed mounted */
+	if (ext4fs_file) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
+	if (!fs_lookup_cache_find(filename, &ent) && ent.ino &&
+	    ent.type == FS_DT_REG) {
+		/* Skip the directory walk, we know the inode already */
+		fdiro = zalloc(sizeof(struct ext2fs_node));
+		if (!fdiro)
+			return -1;
+		fdiro->data = ext4fs_root;
+		fdiro->ino = ent.ino;
+	} else {
+		status = ext4fs_find_file(filename, &ext4fs_root->diropen,
+					  &fdiro, FILETYPE_REG);
+		if (status == 0)
+			goto fail;
+	}
 
 	if (!fdiro->inode_read) {
 		status = ext4fs_read_inode(fdiro->data, fdiro->ino,
 				&fdiro->inode);
 		if (status == 0)
 			goto fail;
+		fdiro->inode_read = 1;
 	}
 	*len = le32_to_cpu(fdiro->inode.size);
 	ext4fs_file = fdiro;
 
+	ent.ino = fdiro->ino;
+	ent.type = FS_DT_REG;
+	ent.size = *len;
+	fs_lookup_cache_add(filename, &ent);
+
 	return 0;
 fail:
 	ext4fs_free_node(fdiro, &ext4fs_root->diropen);
@@ -2411,6 +2572,7 @@ int ext4fs_mount(unsigned part_length)
 	      le32_to_cpu(data->sblock.revision_level),
 	      fs->inodesz, fs->gdsize);
 
+	ext4fs_dcache_flush();
 	data->diropen.data = data;
 	data->diropen.ino = 2;
 	data->diropen.inode_read = 1;
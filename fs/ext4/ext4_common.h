@@ -57,6 +57,20 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node **fnode, int *ftype);
 
+/**
+ * ext4fs_htree_lookup() - look up a name using a directory's hash tree index
+ *
+ * @dir:	Directory to search, with its inode already read
+ * @name:	Name of the entry to find
+ * @inop:	Returns the inode number of the entry
+ * @typep:	Returns the file type stored in the directory entry
+ * Return: 0 if found, -ENOENT if the index shows that there is no such
+ *	entry, other -ve value if the index cannot be used, in which case the
+ *	directory must be searched linearly
+ */
+int ext4fs_htree_lookup(struct ext2fs_node *dir, const char *name,
+			int *inop, int *typep);
+
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n);
 uint16_t ext4fs_checksum_update(unsigned int i);
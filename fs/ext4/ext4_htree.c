@@ -0,0 +1,560 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hashed directory (htree) lookup for ext4
+ *
+ * Directories with the EXT4_INDEX_FL flag keep a b-tree of name hashes in
+ * their first blocks, which lets a single name be resolved by reading the
+ * index blocks and one leaf block instead of every block of the directory.
+ *
+ * The directory hash functions are taken from the Linux kernel
+ * fs/ext4/hash.c:
+ * Copyright (C) 2002 by Theodore Ts'o
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <ext_common.h>
+#include <ext4fs.h>
+#include <log.h>
+#include <malloc.h>
+#include <linux/errno.h>
+#include "ext4_common.h"
+
+#define EXT4_FEATURE_COMPAT_DIR_INDEX	0x0020
+#define EXT4_FEATURE_INCOMPAT_LARGEDIR	0x4000
+#define EXT2_FLAGS_UNSIGNED_HASH	0x0002
+#define EXT4_ENCRYPT_FL			0x00000800
+#define EXT4_CASEFOLD_FL		0x40000000
+
+#define DX_HASH_LEGACY			0
+#define DX_HASH_HALF_MD4		1
+#define DX_HASH_TEA			2
+#define DX_HASH_LEGACY_UNSIGNED		3
+#define DX_HASH_HALF_MD4_UNSIGNED	4
+#define DX_HASH_TEA_UNSIGNED		5
+
+#define EXT4_HTREE_EOF_32BIT		0x7fffffff
+#define EXT2_NAME_LEN			255
+
+/* Root plus up to two levels of index nodes (three with largedir) */
+#define DX_MAX_LEVELS			3
+
+/* Directory entry used to hide the index from code unaware of it */
+struct dx_fake_dirent {
+	__le32 inode;
+	__le16 rec_len;
+	u8 name_len;
+	u8 file_type;
+};
+
+struct dx_countlimit {
+	__le16 limit;
+	__le16 count;
+};
+
+struct dx_entry {
+	__le32 hash;
+	__le32 block;
+};
+
+struct dx_root_info {
+	__le32 reserved_zero;
+	u8 hash_version;
+	u8 info_length;
+	u8 indirect_levels;
+	u8 unused_flags;
+};
+
+struct dx_root {
+	struct dx_fake_dirent dot;
+	char dot_name[4];
+	struct dx_fake_dirent dotdot;
+	char dotdot_name[4];
+	struct dx_root_info info;
+};
+
+struct dx_node {
+	struct dx_fake_dirent fake;
+	struct dx_entry entries[];
+};
+
+struct dx_frame {
+	char *buf;
+	struct dx_entry *entries;
+	struct dx_entry *at;
+	unsigned int count;
+};
+
+#define DELTA 0x9E3779B9
+
+static inline u32 dx_rol32(u32 word, unsigned int shift)
+{
+	return (word << shift) | (word >> (32 - shift));
+}
+
+static void tea_transform(u32 buf[4], const u32 in[])
+{
+	u32 sum = 0;
+	u32 b0 = buf[0], b1 = buf[1];
+	u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+/* F, G and H are basic MD4 functions: selection, majority, parity */
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+
+#define MD4_ROUND(f, a, b, c, d, x, s)	\
+	(a += f(b, c, d) + x, a = dx_rol32(a, s))
+#define K1 0
+#define K2 013240474631UL
+#define K3 015666365641UL
+
+/* Basic cut-down MD4 transform, returns only 32 bits of result */
+static void half_md4_transform(u32 buf[4], const u32 in[8])
+{
+	u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* Round 1 */
+	MD4_ROUND(F, a, b, c, d, in[0] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[1] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[2] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[3] + K1, 19);
+	MD4_ROUND(F, a, b, c, d, in[4] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[5] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[6] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	/* Round 2 */
+	MD4_ROUND(G, a, b, c, d, in[1] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[3] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[5] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[7] + K2, 13);
+	MD4_ROUND(G, a, b, c, d, in[0] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[2] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[4] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	/* Round 3 */
+	MD4_ROUND(H, a, b, c, d, in[3] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[7] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[2] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[6] + K3, 15);
+	MD4_ROUND(H, a, b, c, d, in[1] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[5] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[0] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+#undef MD4_ROUND
+#undef K1
+#undef K2
+#undef K3
+#undef F
+#undef G
+#undef H
+
+/* The old legacy hash */
+static u32 dx_hack_hash_unsigned(const char *name, int len)
+{
+	u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	const unsigned char *ucp = (const unsigned char *)name;
+
+	while (len--) {
+		hash = hash1 + (hash0 ^ (((int)*ucp++) * 7152373));
+
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+
+	return hash0 << 1;
+}
+
+static u32 dx_hack_hash_signed(const char *name, int len)
+{
+	u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	const signed char *scp = (const signed char *)name;
+
+	while (len--) {
+		hash = hash1 + (hash0 ^ (((int)*scp++) * 7152373));
+
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+
+	return hash0 << 1;
+}
+
+static void str2hashbuf_signed(const char *msg, int len, u32 *buf, int num)
+{
+	const signed char *scp = (const signed char *)msg;
+	u32 pad, val;
+	int i;
+
+	pad = (u32)len | ((u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		val = ((int)scp[i]) + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+static void str2hashbuf_unsigned(const char *msg, int len, u32 *buf, int num)
+{
+	const unsigned char *ucp = (const unsigned char *)msg;
+	u32 pad, val;
+	int i;
+
+	pad = (u32)len | ((u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		val = ((int)ucp[i]) + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+/**
+ * ext4fs_dx_hash() - compute the major hash of a directory entry name
+ *
+ * @name:	Name to hash
+ * @len:	Length of @name in bytes
+ * @version:	Hash algorithm (DX_HASH_...), with the unsigned variant
+ *		already selected
+ * @seed:	Hash seed from the superblock (all zeroes for the default)
+ * @hashp:	Returns the hash, with the collision bit cleared
+ * Return: 0 if OK, -EPROTONOSUPPORT if the hash algorithm is unknown
+ */
+static int ext4fs_dx_hash(const char *name, int len, int version,
+			  const __le32 *seed, u32 *hashp)
+{
+	void (*str2hashbuf)(const char *, int, u32 *, int) =
+		str2hashbuf_signed;
+	u32 buf[4], in[8];
+	const char *p;
+	u32 hash;
+	int i;
+
+	/* Initialize the default seed for the hash checksum functions */
+	buf[0] = 0x67452301;
+	buf[1] = 0xefcdab89;
+	buf[2] = 0x98badcfe;
+	buf[3] = 0x10325476;
+
+	/* Check to see if the seed is all zero's */
+	if (seed[0] || seed[1] || seed[2] || seed[3]) {
+		for (i = 0; i < 4; i++)
+			buf[i] = le32_to_cpu(seed[i]);
+	}
+
+	switch (version) {
+	case DX_HASH_LEGACY_UNSIGNED:
+		hash = dx_hack_hash_unsigned(name, len);
+		break;
+	case DX_HASH_LEGACY:
+		hash = dx_hack_hash_signed(name, len);
+		break;
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		str2hashbuf = str2hashbuf_unsigned;
+		fallthrough;
+	case DX_HASH_HALF_MD4:
+		p = name;
+		while (len > 0) {
+			str2hashbuf(p, len, in, 8);
+			half_md4_transform(buf, in);
+			len -= 32;
+			p += 32;
+		}
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA_UNSIGNED:
+		str2hashbuf = str2hashbuf_unsigned;
+		fallthrough;
+	case DX_HASH_TEA:
+		p = name;
+		while (len > 0) {
+			str2hashbuf(p, len, in, 4);
+			tea_transform(buf, in);
+			len -= 16;
+			p += 16;
+		}
+		hash = buf[0];
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	hash &= ~1;
+	if (hash == (EXT4_HTREE_EOF_32BIT << 1))
+		hash = (EXT4_HTREE_EOF_32BIT - 1) << 1;
+	*hashp = hash;
+
+	return 0;
+}
+
+static int dx_read_block(struct ext2fs_node *dir, u32 block, char *buf)
+{
+	u32 blksz = EXT2_BLOCK_SIZE(dir->data);
+	loff_t actread;
+	int ret;
+
+	if ((u64)block * blksz >= le32_to_cpu(dir->inode.size))
+		return -EINVAL;
+	ret = ext4fs_read_file(dir, (loff_t)block * blksz, blksz, buf,
+			       &actread);
+	if (ret < 0 || actread != blksz)
+		return -EIO;
+
+	return 0;
+}
+
+static inline u32 dx_get_block(struct dx_entry *entry)
+{
+	return le32_to_cpu(entry->block) & 0x0fffffff;
+}
+
+/*
+ * Set up @frame for the index block in @frame->buf, whose entries start at
+ * @entries, and select the entry covering @hash
+ */
+static int dx_select(struct dx_frame *frame, struct dx_entry *entries,
+		     u32 blksz, u32 hash)
+{
+	struct dx_countlimit *cl = (struct dx_countlimit *)entries;
+	struct dx_entry *p, *q, *m;
+	unsigned int count, limit;
+
+	count = le16_to_cpu(cl->count);
+	limit = le16_to_cpu(cl->limit);
+	if (!count || count > limit ||
+	    (char *)(entries + limit) > frame->buf + blksz)
+		return -EINVAL;
+
+	/* Find the last entry whose hash is not above the one we want */
+	p = entries + 1;
+	q = entries + count - 1;
+	while (p <= q) {
+		m = p + (q - p) / 2;
+		if (le32_to_cpu(m->hash) > hash)
+			q = m - 1;
+		else
+			p = m + 1;
+	}
+	frame->entries = entries;
+	frame->count = count;
+	frame->at = p - 1;
+
+	return 0;
+}
+
+/*
+ * Move to the next leaf block if the names hashing to @hash may continue
+ * there, which is marked by the collision bit in the next index entry
+ */
+static int dx_next_block(struct ext2fs_node *dir, struct dx_frame *frames,
+			 int levels, u32 hash, u32 *blockp)
+{
+	u32 blksz = EXT2_BLOCK_SIZE(dir->data);
+	struct dx_frame *p = &frames[levels];
+	int num = 0;
+	int ret;
+
+	/* Find the lowest level which still has entries to our right */
+	while (++p->at == p->entries + p->count) {
+		if (p == frames)
+			return -ENOENT;
+		num++;
+		p--;
+	}
+	if ((le32_to_cpu(p->at->hash) & ~1) != hash)
+		return -ENOENT;
+
+	/* Walk back down the leftmost entries to the next leaf */
+	while (num--) {
+		struct dx_node *node;
+
+		u32 block = dx_get_block(p->at);
+
+		p++;
+		ret = dx_read_block(dir, block, p->buf);
+		if (ret)
+			return ret;
+		node = (struct dx_node *)p->buf;
+		ret = dx_select(p, node->entries, blksz, 0);
+		if (ret)
+			return ret;
+		p->at = p->entries;
+	}
+	*blockp = dx_get_block(p->at);
+
+	return 0;
+}
+
+static int dx_search_leaf(struct ext2fs_node *dir, u32 block, char *buf,
+			  const char *name, int namelen, int *inop, int *typep)
+{
+	u32 blksz = EXT2_BLOCK_SIZE(dir->data);
+	struct ext2_dirent *dirent;
+	unsigned int pos, reclen;
+	int ret;
+
+	ret = dx_read_block(dir, block, buf);
+	if (ret)
+		return ret;
+
+	for (pos = 0; pos + sizeof(*dirent) <= blksz; pos += reclen) {
+		dirent = (struct ext2_dirent *)(buf + pos);
+		reclen = le16_to_cpu(dirent->direntlen);
+		/* 64KiB blocks cannot store their record length in 16 bits */
+		if (blksz == EXT2_MAX_BLOCK_SIZE && (!reclen || reclen == 65535))
+			reclen = blksz;
+		if (reclen < sizeof(*dirent) || pos + reclen > blksz)
+			return -EINVAL;
+		if (dirent->inode && dirent->namelen == namelen &&
+		    sizeof(*dirent) + namelen <= reclen &&
+		    !memcmp(buf + pos + sizeof(*dirent), name, namelen)) {
+			*inop = le32_to_cpu(dirent->inode);
+			*typep = dirent->filetype;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int ext4fs_htree_lookup(struct ext2fs_node *dir, const char *name,
+			int *inop, int *typep)
+{
+	struct ext2_data *data = dir->data;
+	struct ext2_sblock *sblock = &data->sblock;
+	u32 blksz = EXT2_BLOCK_SIZE(data);
+	struct dx_frame frames[DX_MAX_LEVELS];
+	int namelen = strlen(name);
+	struct dx_entry *entries;
+	struct dx_root *root;
+	int levels, version;
+	char *leaf = NULL;
+	u32 hash, block;
+	int i, ret;
+
+	if (!(le32_to_cpu(sblock->feature_compatibility) &
+	      EXT4_FEATURE_COMPAT_DIR_INDEX) ||
+	    !(le32_to_cpu(dir->inode.flags) & EXT4_INDEX_FL))
+		return -ENOTSUPP;
+	/* Hashes of these names are not computed from the plain name */
+	if (le32_to_cpu(dir->inode.flags) & (EXT4_ENCRYPT_FL | EXT4_CASEFOLD_FL))
+		return -ENOTSUPP;
+	if (!namelen || namelen > EXT2_NAME_LEN)
+		return -ENOENT;
+
+	memset(frames, '\0', sizeof(frames));
+	for (i = 0; i < DX_MAX_LEVELS; i++) {
+		frames[i].buf = malloc(blksz);
+		if (!frames[i].buf) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+	leaf = malloc(blksz);
+	if (!leaf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = dx_read_block(dir, 0, frames[0].buf);
+	if (ret)
+		goto out;
+	root = (struct dx_root *)frames[0].buf;
+	levels = root->info.indirect_levels;
+	if (root->info.reserved_zero || root->info.info_length < 8 ||
+	    levels >= DX_MAX_LEVELS ||
+	    (levels == DX_MAX_LEVELS - 1 &&
+	     !(le32_to_cpu(sblock->feature_incompat) &
+	       EXT4_FEATURE_INCOMPAT_LARGEDIR))) {
+		log_debug("Unsupported htree root in inode %d\n", dir->ino);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	version = root->info.hash_version;
+	if (version <= DX_HASH_TEA &&
+	    (le32_to_cpu(sblock->flags) & EXT2_FLAGS_UNSIGNED_HASH))
+		version += DX_HASH_LEGACY_UNSIGNED;
+	ret = ext4fs_dx_hash(name, namelen, version, sblock->hash_seed, &hash);
+	if (ret) {
+		log_debug("Unsupported htree hash %d\n", version);
+		goto out;
+	}
+
+	entries = (struct dx_entry *)((char *)&root->info +
+				      root->info.info_length);
+	for (i = 0;; i++) {
+		ret = dx_select(&frames[i], entries, blksz, hash);
+		if (ret)
+			goto out;
+		block = dx_get_block(frames[i].at);
+		if (i == levels)
+			break;
+		ret = dx_read_block(dir, block, frames[i + 1].buf);
+		if (ret)
+			goto out;
+		entries = ((struct dx_node *)frames[i + 1].buf)->entries;
+	}
+
+	do {
+		ret = dx_search_leaf(dir, block, leaf, name, namelen, inop,
+				     typep);
+		if (ret != -ENOENT)
+			break;
+		ret = dx_next_block(dir, frames, levels, hash, &block);
+	} while (!ret);
+
+out:
+	free(leaf);
+	for (i = 0; i < DX_MAX_LEVELS; i++)
+		free(frames[i].buf);
+
+	return ret;
+}
@@ -64,6 +64,9 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, struct disk_partition *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
 
+	/* Unmount whatever the filesystem layer kept mounted */
+	fs_mount_release();
+
 	cur_dev = dev_desc;
 	cur_part_info = *info;
 
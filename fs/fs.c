@@ -182,6 +182,13 @@ struct fstype_info {
 	int (*unlink)(const char *filename);
 	int (*mkdir)(const char *dirname);
 	int (*ln)(const char *filename, const char *target);
+	/*
+	 * Can the filesystem stay mounted after fs_close()? Only set this if
+	 * all of its state is set up by .probe() and freed by .close(), and
+	 * the filesystem calls fs_mount_release() if something outside this
+	 * file may set up that state too.
+	 */
+	bool keep_mounted;
 };
 
 static struct fstype_info fstypes[] = {
@@ -190,6 +197,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_FAT,
 		.name = "fat",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = fat_set_blk_dev,
 		.close = fat_close,
 		.ls = fs_ls_generic,
@@ -218,6 +226,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_EXT,
 		.name = "ext4",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = ext4fs_probe,
 		.close = ext4fs_close,
 		.ls = ext4fs_ls,
@@ -302,6 +311,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_BTRFS,
 		.name = "btrfs",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = btrfs_probe,
 		.close = btrfs_close,
 		.ls = btrfs_ls,
@@ -322,6 +332,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_SQUASHFS,
 		.name = "squashfs",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = sqfs_probe,
 		.opendir = sqfs_opendir,
 		.readdir = sqfs_readdir,
@@ -343,6 +354,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_EROFS,
 		.name = "erofs",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = erofs_probe,
 		.opendir = erofs_opendir,
 		.readdir = erofs_readdir,
@@ -378,6 +390,169 @@ static struct fstype_info fstypes[] = {
 	},
 };
 
+#if CONFIG_IS_ENABLED(FS_LOOKUP_CACHE)
+/* Longest path (plus terminator) held in the lookup cache */
+#define FS_LOOKUP_PATH_LEN	128
+
+/**
+ * struct fs_lookup_slot - a path held in the lookup cache
+ *
+ * @desc:	Block device holding the filesystem, NULL if the slot is unused
+ * @part_start:	First block of the partition holding the filesystem
+ * @fstype:	Filesystem type (FS_TYPE_...)
+ * @hash:	Hash of @path, to speed up searching
+ * @ent:	Information about the file
+ * @path:	Path of the file, without leading slashes
+ */
+struct fs_lookup_slot {
+	struct blk_desc *desc;
+	lbaint_t part_start;
+	int fstype;
+	uint hash;
+	struct fs_lookup_entry ent;
+	char path[FS_LOOKUP_PATH_LEN];
+};
+
+static struct fs_lookup_slot *fs_lookup_slots;
+static uint fs_lookup_next;
+static struct fs_lookup_stats fs_lookup_stats;
+
+static uint fs_lookup_hash(const char *path)
+{
+	uint hash = 0;
+
+	while (*path)
+		hash = hash * 31 + *path++;
+
+	return hash;
+}
+
+/**
+ * fs_lookup_cache_slot() - find the slot holding a path
+ *
+ * @path:	Path to look for, without leading slashes
+ * @hash:	Hash of @path
+ * Return: slot for @path on the current filesystem, or NULL if none
+ */
+static struct fs_lookup_slot *fs_lookup_cache_slot(const char *path, uint hash)
+{
+	struct fs_lookup_slot *slot;
+	int i;
+
+	if (!fs_lookup_slots)
+		return NULL;
+	for (i = 0, slot = fs_lookup_slots; i < CONFIG_FS_LOOKUP_CACHE_ENTRIES;
+	     i++, slot++) {
+		if (slot->desc == fs_dev_desc && slot->hash == hash &&
+		    slot->part_start == fs_partition.start &&
+		    slot->fstype == fs_type && !strcmp(slot->path, path))
+			return slot;
+	}
+
+	return NULL;
+}
+
+/*
+ * Paths are only cached for filesystems on block devices, while one is set up
+ * by fs_set_blk_dev(). Direct users of a filesystem driver, e.g. the
+ * environment, see no cache.
+ */
+static bool fs_lookup_cache_active(void)
+{
+	return fs_dev_desc && fs_type != FS_TYPE_ANY;
+}
+
+int fs_lookup_cache_find(const char *path, struct fs_lookup_entry *ent)
+{
+	struct fs_lookup_slot *slot;
+
+	if (!fs_lookup_cache_active())
+		return -ENOENT;
+	while (*path == '/')
+		path++;
+	slot = fs_lookup_cache_slot(path, fs_lookup_hash(path));
+	if (!slot) {
+		fs_lookup_stats.misses++;
+		return -ENOENT;
+	}
+	fs_lookup_stats.hits++;
+	*ent = slot->ent;
+
+	return 0;
+}
+
+void fs_lookup_cache_add(const char *path, const struct fs_lookup_entry *ent)
+{
+	struct fs_lookup_slot *slot;
+	uint hash;
+	int i;
+
+	if (!fs_lookup_cache_active())
+		return;
+	while (*path == '/')
+		path++;
+	if (strlen(path) >= FS_LOOKUP_PATH_LEN)
+		return;
+	if (!fs_lookup_slots) {
+		fs_lookup_slots = calloc(CONFIG_FS_LOOKUP_CACHE_ENTRIES,
+					 sizeof(*fs_lookup_slots));
+		if (!fs_lookup_slots)
+			return;
+	}
+
+	hash = fs_lookup_hash(path);
+	slot = fs_lookup_cache_slot(path, hash);
+	/* Keep the handle if the filesystem has already supplied one */
+	if (slot && slot->ent.ino && !ent->ino)
+		return;
+	for (i = 0; !slot && i < CONFIG_FS_LOOKUP_CACHE_ENTRIES; i++) {
+		if (!fs_lookup_slots[i].desc)
+			slot = &fs_lookup_slots[i];
+	}
+	if (!slot) {
+		/* Full, so replace the slots in turn */
+		slot = &fs_lookup_slots[fs_lookup_next];
+		fs_lookup_next = (fs_lookup_next + 1) %
+			CONFIG_FS_LOOKUP_CACHE_ENTRIES;
+	}
+	if (!slot->desc)
+		fs_lookup_stats.entries++;
+
+	slot->desc = fs_dev_desc;
+	slot->part_start = fs_partition.start;
+	slot->fstype = fs_type;
+	slot->hash = hash;
+	slot->ent = *ent;
+	strcpy(slot->path, path);
+}
+
+void fs_lookup_cache_invalidate_dev(struct blk_desc *desc)
+{
+	struct fs_lookup_slot *slot;
+	bool found = false;
+	int i;
+
+	if (!fs_lookup_stats.entries)
+		return;
+	for (i = 0, slot = fs_lookup_slots; i < CONFIG_FS_LOOKUP_CACHE_ENTRIES;
+	     i++, slot++) {
+		if (slot->desc && (!desc || slot->desc == desc)) {
+			slot->desc = NULL;
+			fs_lookup_stats.entries--;
+			found = true;
+		}
+	}
+	if (found)
+		fs_lookup_stats.invalidations++;
+}
+
+void fs_lookup_cache_stats(struct fs_lookup_stats *stats)
+{
+	*stats = fs_lookup_stats;
+	stats->max_entries = CONFIG_FS_LOOKUP_CACHE_ENTRIES;
+}
+#endif /* FS_LOOKUP_CACHE */
+
 static struct fstype_info *fs_get_info(int fstype)
 {
 	struct fstype_info *info;
@@ -418,6 +593,131 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * struct fs_mount - the filesystem kept mounted between operations
+ *
+ * Filesystem drivers keep their state in globals, so only one filesystem can
+ * be mounted at a time.
+ *
+ * @fstype:	Type of the mounted filesystem, FS_TYPE_ANY if none
+ * @desc:	Block device holding it
+ * @part:	Partition number
+ * @partition:	Partition information, used to recognise the same partition
+ *		however it is specified
+ * @stale:	true if the device may have changed, so that the filesystem
+ *		must be probed again
+ */
+struct fs_mount {
+	int fstype;
+	struct blk_desc *desc;
+	int part;
+	struct disk_partition partition;
+	bool stale;
+};
+
+static struct fs_mount fs_mount = { .fstype = FS_TYPE_ANY };
+static struct fs_mount_stats fs_mount_stats_data;
+
+/**
+ * fs_mount_reuse() - use the mounted filesystem, if it is the one wanted
+ *
+ * @fstype:	Filesystem type wanted, or FS_TYPE_ANY
+ * Return: true if the filesystem on fs_dev_desc / fs_partition is mounted
+ *	already and is now the current filesystem
+ */
+static bool fs_mount_reuse(int fstype)
+{
+	if (fs_mount.fstype == FS_TYPE_ANY || fs_mount.stale ||
+	    fs_mount.desc != fs_dev_desc ||
+	    fs_mount.partition.start != fs_partition.start ||
+	    fs_mount.partition.size != fs_partition.size ||
+	    (fstype != FS_TYPE_ANY && fstype != fs_mount.fstype))
+		return false;
+
+	fs_type = fs_mount.fstype;
+	fs_dev_part = fs_mount.part;
+	fs_mount_stats_data.reuses++;
+
+	return true;
+}
+
+/**
+ * fs_mount_record() - note which filesystem has just been probed
+ *
+ * @info:	Filesystem which was probed successfully
+ * @part:	Partition number
+ */
+static void fs_mount_record(struct fstype_info *info, int part)
+{
+	fs_mount_stats_data.probes++;
+	if (!info->keep_mounted || !fs_dev_desc)
+		return;
+	fs_mount.fstype = info->fstype;
+	fs_mount.desc = fs_dev_desc;
+	fs_mount.part = part;
+	fs_mount.partition = fs_partition;
+	fs_mount.stale = false;
+}
+
+/**
+ * fs_mount_keep() - check whether the current filesystem can stay mounted
+ *
+ * Return: true to leave it mounted, false to close it
+ */
+static bool fs_mount_keep(void)
+{
+	if (fs_type == FS_TYPE_ANY || fs_mount.fstype != fs_type ||
+	    fs_mount.desc != fs_dev_desc)
+		return false;
+	if (!fs_mount.stale)
+		return true;
+
+	/* The caller closes the filesystem */
+	fs_mount.fstype = FS_TYPE_ANY;
+	fs_mount_stats_data.releases++;
+
+	return false;
+}
+
+void fs_mount_release(void)
+{
+	struct fstype_info *info;
+
+	if (fs_mount.fstype == FS_TYPE_ANY)
+		return;
+	info = fs_get_info(fs_mount.fstype);
+	fs_mount.fstype = FS_TYPE_ANY;
+	fs_mount_stats_data.releases++;
+	info->close();
+}
+
+void fs_mount_invalidate_dev(struct blk_desc *desc)
+{
+	if (fs_mount.fstype != FS_TYPE_ANY && (!desc || fs_mount.desc == desc))
+		fs_mount.stale = true;
+}
+
+void fs_mount_stats(struct fs_mount_stats *stats)
+{
+	*stats = fs_mount_stats_data;
+}
+#else
+static inline bool fs_mount_reuse(int fstype)
+{
+	return false;
+}
+
+static inline void fs_mount_record(struct fstype_info *info, int part)
+{
+}
+
+static inline bool fs_mount_keep(void)
+{
+	return false;
+}
+#endif /* FS_MOUNT_CACHE */
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
@@ -444,6 +744,10 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
+	if (fs_mount_reuse(fstype))
+		return 0;
+	fs_mount_release();
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
 				fstype != info->fstype)
@@ -455,6 +759,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_mount_record(info, part);
 			return 0;
 		}
 	}
@@ -476,10 +781,15 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
+	if (fs_mount_reuse(FS_TYPE_ANY))
+		return 0;
+	fs_mount_release();
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_mount_record(info, part);
 			return 0;
 		}
 	}
@@ -491,7 +801,8 @@ void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	info->close();
+	if (!fs_mount_keep())
+		info->close();
 
 	fs_type = FS_TYPE_ANY;
 }
@@ -521,21 +832,48 @@ int fs_exists(const char *filename)
 	int ret;
 
 	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_lookup_entry ent;
 
-	ret = info->exists(filename);
+	if (!fs_lookup_cache_find(filename, &ent) && ent.type == FS_DT_REG)
+		ret = 1;
+	else
+		ret = info->exists(filename);
 
 	fs_close();
 
 	return ret;
 }
 
+/* Get the size of a file, from the lookup cache if possible */
+static int fs_size_cached(struct fstype_info *info, const char *filename,
+			  loff_t *size)
+{
+	struct fs_lookup_entry ent;
+	int ret;
+
+	if (!fs_lookup_cache_find(filename, &ent) && ent.type == FS_DT_REG) {
+		*size = ent.size;
+		return 0;
+	}
+
+	ret = info->size(filename, size);
+	if (!ret) {
+		ent.ino = 0;
+		ent.type = FS_DT_REG;
+		ent.size = *size;
+		fs_lookup_cache_add(filename, &ent);
+	}
+
+	return ret;
+}
+
 int fs_size(const char *filename, loff_t *size)
 {
 	int ret;
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->size(filename, size);
+	ret = fs_size_cached(info, filename, size);
 
 	fs_close();
 
@@ -553,7 +891,7 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	loff_t read_len;
 
 	/* get the actual size of the file */
-	ret = info->size(filename, &size);
+	ret = fs_size_cached(info, filename, &size);
 	if (ret)
 		return ret;
 	if (offset >= size) {
@@ -621,6 +959,8 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	void *buf;
 	int ret;
 
+	fs_lookup_cache_invalidate_dev(fs_dev_desc);
+	fs_mount_invalidate_dev(fs_dev_desc);
 	buf = map_sysmem(addr, len);
 	ret = info->write(filename, buf, offset, len, actwrite);
 	unmap_sysmem(buf);
@@ -692,6 +1032,8 @@ int fs_unlink(const char *filename)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	fs_lookup_cache_invalidate_dev(fs_dev_desc);
+	fs_mount_invalidate_dev(fs_dev_desc);
 	ret = info->unlink(filename);
 
 	fs_close();
@@ -705,6 +1047,8 @@ int fs_mkdir(const char *dirname)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	fs_lookup_cache_invalidate_dev(fs_dev_desc);
+	fs_mount_invalidate_dev(fs_dev_desc);
 	ret = info->mkdir(dirname);
 
 	fs_close();
@@ -717,6 +1061,8 @@ int fs_ln(const char *fname, const char *target)
 	struct fstype_info *info = fs_get_info(fs_type);
 	int ret;
 
+	fs_lookup_cache_invalidate_dev(fs_dev_desc);
+	fs_mount_invalidate_dev(fs_dev_desc);
 	ret = info->ln(fname, target);
 
 	if (ret < 0) {
@@ -231,6 +231,13 @@ struct global_data {
 	 */
 	void *dm_priv_base;
 # endif
+# if CONFIG_IS_ENABLED(DM_TIMING)
+	/**
+	 * @dm_probe_timing: innermost part of a device probe being timed, or
+	 * NULL if none
+	 */
+	struct probe_timing *dm_probe_timing;
+# endif
 #endif
 #ifdef CONFIG_TIMER
 	/**
@@ -385,6 +392,16 @@ struct global_data {
 	 */
 	struct bootstage_data *new_bootstage;
 #endif
+#if CONFIG_IS_ENABLED(INITCALL_STATS)
+	/**
+	 * @initcall_stats: time taken by each initcall
+	 */
+	struct initcall_stats *initcall_stats;
+	/**
+	 * @new_initcall_stats: relocated initcall times
+	 */
+	struct initcall_stats *new_initcall_stats;
+#endif
 #ifdef CONFIG_LOG
 	/**
 	 * @log_drop_count: number of dropped log messages
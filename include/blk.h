@@ -763,6 +763,72 @@ const char *blk_get_uclass_name(enum uclass_id uclass_id);
 int blk_common_cmd(int argc, char *const argv[], enum uclass_id uclass_id,
 		   int *cur_devnump);
 
+/**
+ * struct blk_bench_params - what blk_bench() should measure
+ *
+ * @start: First block of the region to use
+ * @count: Number of blocks in the region
+ * @xfer: Number of blocks in each transfer
+ * @duration_ms: Time to run for, in milliseconds
+ * @max_ops: Maximum number of transfers, or 0 for no limit
+ * @write: true to write (destroying the region's contents), false to read
+ * @random: true to use random offsets in the region, false to go through it
+ *	in order
+ */
+struct blk_bench_params {
+	lbaint_t start;
+	lbaint_t count;
+	lbaint_t xfer;
+	uint duration_ms;
+	ulong max_ops;
+	bool write;
+	bool random;
+};
+
+/**
+ * struct blk_bench_result - results from blk_bench()
+ *
+ * Latencies are in microseconds
+ *
+ * @ops: Number of transfers done
+ * @bytes: Number of bytes transferred
+ * @elapsed_us: Total time taken, in microseconds
+ * @lat_min: Lowest latency
+ * @lat_avg: Average latency
+ * @lat_p50: Median latency
+ * @lat_p90: 90th-percentile latency
+ * @lat_p99: 99th-percentile latency
+ * @lat_max: Highest latency
+ */
+struct blk_bench_result {
+	ulong ops;
+	u64 bytes;
+	ulong elapsed_us;
+	ulong lat_min;
+	ulong lat_avg;
+	ulong lat_p50;
+	ulong lat_p90;
+	ulong lat_p99;
+	ulong lat_max;
+};
+
+/**
+ * blk_bench() - Measure the performance of a block device
+ *
+ * Issues transfers of @params->xfer blocks one after another until the time
+ * or number of transfers given in @params is reached. The block cache is
+ * bypassed while this runs. There is no support for queueing, so each
+ * transfer finishes before the next starts.
+ *
+ * @desc: Block device to measure
+ * @params: What to measure
+ * @res: Returns the results
+ * Return: 0 if OK, -EINVAL if @params is invalid, -ENOMEM if out of memory,
+ * -EIO if a transfer failed
+ */
+int blk_bench(struct blk_desc *desc, const struct blk_bench_params *params,
+	      struct blk_bench_result *res);
+
 enum blk_flag_t {
 	BLKF_FIXED	= 1 << 0,
 	BLKF_REMOVABLE	= 1 << 1,
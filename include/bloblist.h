@@ -114,6 +114,7 @@ enum bloblist_tag_t {
 	BLOBLISTT_U_BOOT_SPL_HANDOFF = 0x8000, /* Hand-off info from SPL */
 	BLOBLISTT_VBE		= 0x8001,	/* VBE per-phase state */
 	BLOBLISTT_U_BOOT_VIDEO = 0x8002, /* Video information from SPL */
+	BLOBLISTT_U_BOOT_BOOTSTAGE_TRACE = 0x8003, /* Boot timing as JSON */
 
 	/*
 	 * Vendor-specific tags are permitted here. Projects can be open source
@@ -76,6 +76,10 @@ typedef int (*bootdev_hunter_func)(struct bootdev_hunter *info, bool show);
  * @uclass: Uclass ID for the media associated with this bootdev
  * @drv: bootdev driver for the things found by this hunter
  * @hunt: Function to call to hunt for bootdevs of this type (NULL if none)
+ * @start: Function to call to start up the hardware for this hunter without
+ *	waiting for it, e.g. so that disks can spin up, or NULL if none. This
+ *	must return quickly. It lets @hunt, which is still called when the
+ *	scan reaches this hunter, find the hardware ready sooner
  *
  * Some bootdevs are not visible until other devices are enumerated. For
  * example, USB bootdevs only appear when the USB bus is enumerated.
@@ -92,6 +96,7 @@ struct bootdev_hunter {
 	enum uclass_id uclass;
 	struct driver *drv;
 	bootdev_hunter_func hunt;
+	bootdev_hunter_func start;
 };
 
 /* declare a new bootdev hunter */
@@ -320,6 +325,40 @@ int bootdev_hunt(const char *spec, bool show);
  */
 int bootdev_hunt_prio(enum bootdev_prio_t prio, bool show);
 
+/**
+ * bootdev_hunt_bg_start() - Start hunting for bootdevs in the background
+ *
+ * This sets up the hunters needed by a scan to be started ahead of time, in
+ * the order the scan uses them, so that slow hardware, such as a disk which
+ * must spin up, can get ready while earlier bootdevs are being scanned. Only
+ * hunters with a start() method are used. Their hunt() method still runs when
+ * the scan reaches them, so the order in which bootdevs are scanned, and the
+ * bootflows found, do not change.
+ *
+ * Any previous background hunting is stopped first.
+ *
+ * @iter: Iterator for the scan; the hunters used follow iter->labels if set,
+ *	otherwise the bootdev priorities
+ * Return: 0 if OK, -ENOSYS if not supported
+ */
+int bootdev_hunt_bg_start(struct bootflow_iter *iter);
+
+/**
+ * bootdev_hunt_bg_step() - Start the next hunter ahead of the scan
+ *
+ * This is called by the scan each time it is about to look at a bootdev. It
+ * starts at most one hunter, which must not block, so this takes little time.
+ * It does nothing unless bootdev_hunt_bg_start() has been called.
+ */
+void bootdev_hunt_bg_step(void);
+
+/**
+ * bootdev_hunt_bg_stop() - Stop hunting for bootdevs in the background
+ *
+ * This must be called when the scan is finished, and before booting
+ */
+void bootdev_hunt_bg_stop(void);
+
 /**
  * bootdev_hunt_and_find_by_label() - Hunt for bootdevs by label
  *
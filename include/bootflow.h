@@ -118,6 +118,9 @@ struct bootflow {
  * before using it
  * @BOOTFLOWIF_ALL: Return bootflows with errors as well
  * @BOOTFLOWIF_HUNT: Hunt for new bootdevs using the bootdrv hunters
+ * @BOOTFLOWIF_BG_HUNT: Start up the hardware for the hunters while scanning,
+ * rather than waiting until the scan reaches each one (needs
+ * CONFIG_BOOTSTD_BG_HUNT and BOOTFLOWIF_HUNT)
  *
  * Internal flags:
  * @BOOTFLOWIF_SINGLE_DEV: (internal) Just scan one bootdev
@@ -132,6 +135,7 @@ enum bootflow_iter_flags_t {
 	BOOTFLOWIF_SHOW			= 1 << 1,
 	BOOTFLOWIF_ALL			= 1 << 2,
 	BOOTFLOWIF_HUNT			= 1 << 3,
+	BOOTFLOWIF_BG_HUNT		= 1 << 4,
 
 	/*
 	 * flags used internally by standard boot - do not set these when
@@ -11,12 +11,14 @@
 #ifndef _BOOTSTAGE_H
 #define _BOOTSTAGE_H
 
+#include <linux/errno.h>
 #include <linux/kconfig.h>
 
 /* Flags for each bootstage record */
 enum bootstage_flags {
 	BOOTSTAGEF_ERROR	= 1 << 0,	/* Error record */
 	BOOTSTAGEF_ALLOC	= 1 << 1,	/* Allocate an id */
+	BOOTSTAGEF_TIME		= 1 << 2,	/* Added by bootstage_add_time() */
 };
 
 /* bootstate sub-IDs used for kernel and ramdisk ranges */
@@ -211,6 +213,9 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ACCUM_FSP_M,
 	BOOTSTAGE_ID_ACCUM_FSP_S,
 	BOOTSTAGE_ID_ACCUM_MMAP_SPI,
+	BOOTSTAGE_ID_ACCUM_BOOTFLOW_SCAN,
+	BOOTSTAGE_ID_ACCUM_UBI_SCAN,
+	BOOTSTAGE_ID_ACCUM_UBI_FASTMAP,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -331,6 +336,21 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * bootstage_add_time() - Add a record of accumulated time
+ *
+ * This adds a record with a new ID, as with BOOTSTAGE_ID_ALLOC, holding time
+ * measured elsewhere. It is shown with the accumulated time in the report and
+ * passed to the OS in the same way. If a record was added before with the same
+ * name, its time is updated instead.
+ *
+ * @name: Name of the record, which is copied
+ * @time_us: Time to record, in microseconds
+ * Return: 0 if OK, -ENOENT if bootstage is not set up, -ENOSPC if there is no
+ *	space for the record, -ENOMEM if the name cannot be copied
+ */
+int bootstage_add_time(const char *name, ulong time_us);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
@@ -430,6 +450,11 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline int bootstage_add_time(const char *name, ulong time_us)
+{
+	return -ENOSYS;
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
@@ -452,6 +477,176 @@ static inline int bootstage_init(bool first)
 
 #endif /* ENABLE_BOOTSTAGE */
 
+/**
+ * enum bootstage_span_cat - the kind of activity a span records
+ *
+ * This is used to group spans when they are exported
+ *
+ * @BOOTSTAGE_SPAN_OTHER: Anything else
+ * @BOOTSTAGE_SPAN_INITCALL: A function in init_sequence_f or init_sequence_r
+ * @BOOTSTAGE_SPAN_PROBE: Probing a device
+ * @BOOTSTAGE_SPAN_BOOTMETH: A bootmeth reading a bootflow
+ */
+enum bootstage_span_cat {
+	BOOTSTAGE_SPAN_OTHER,
+	BOOTSTAGE_SPAN_INITCALL,
+	BOOTSTAGE_SPAN_PROBE,
+	BOOTSTAGE_SPAN_BOOTMETH,
+};
+
+/* Flags for each span */
+enum bootstage_span_flags {
+	BOOTSTAGE_SPANF_OPEN	= 1 << 0,	/* Not ended yet */
+};
+
+enum {
+	BOOTSTAGE_SPAN_NAME_LEN	= 24,	/* Max length of span name, with nul */
+};
+
+/**
+ * struct bootstage_span - a period of time spent in an activity
+ *
+ * Spans nest, so that each one records the span which was active when it
+ * started, if any.
+ *
+ * @start_us: Start time in microseconds
+ * @end_us: End time in microseconds, if the span has ended
+ * @parent: Index of the parent span plus one, or 0 if none
+ * @cat: Category of the span (enum bootstage_span_cat)
+ * @flags: Flags for the span (enum bootstage_span_flags)
+ * @func: Offset of the function from the start of the code, if @name is empty
+ * @name: Name of the span, truncated if needed, or empty to use @func
+ */
+struct bootstage_span {
+	uint32_t start_us;
+	uint32_t end_us;
+	uint16_t parent;
+	uint8_t cat;
+	uint8_t flags;
+	uint32_t func;
+	char name[BOOTSTAGE_SPAN_NAME_LEN];
+};
+
+#if !defined(USE_HOSTCC) && CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+/**
+ * bootstage_span_begin() - Start a span
+ *
+ * The span is nested inside the current span, if any, and becomes the current
+ * span until it ends
+ *
+ * @cat: Category of the span
+ * @name: Name of the span, which is copied (and truncated if needed)
+ * Return: span number to pass to bootstage_span_end(), -ENOENT if bootstage
+ *	is not set up, -ENOSPC if there is no space for another span
+ */
+int bootstage_span_begin(enum bootstage_span_cat cat, const char *name);
+
+/**
+ * bootstage_span_begin_func() - Start a span named after a function
+ *
+ * This is like bootstage_span_begin() but records the function's address
+ * instead of a name. The name is looked up when needed, if CONFIG_KALLSYMS is
+ * enabled, else the offset of the function is shown.
+ *
+ * @cat: Category of the span
+ * @func: Function to record
+ * Return: span number to pass to bootstage_span_end(), or -ve on error
+ */
+int bootstage_span_begin_func(enum bootstage_span_cat cat, const void *func);
+
+/**
+ * bootstage_span_end() - End a span
+ *
+ * If the span is the current span, or contains it, its parent becomes the
+ * current span
+ *
+ * @span: Span number returned by bootstage_span_begin(); errors are ignored
+ */
+void bootstage_span_end(int span);
+
+/**
+ * bootstage_get_span() - Get a span
+ *
+ * @span: Span number, from 0
+ * Return: the span, or NULL if @span is out of range
+ */
+const struct bootstage_span *bootstage_get_span(int span);
+
+/**
+ * bootstage_span_init_r() - Make space for more spans after relocation
+ *
+ * Before relocation only CONFIG_BOOTSTAGE_SPAN_COUNT_F spans are recorded, to
+ * save memory. This moves them to a new area with space for
+ * CONFIG_BOOTSTAGE_SPAN_COUNT spans.
+ *
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int bootstage_span_init_r(void);
+
+/**
+ * bootstage_span_report() - Show the spans as a tree
+ *
+ * @min_us: Don't show spans (and the spans inside them) which took less time
+ *	than this
+ */
+void bootstage_span_report(uint min_us);
+
+/**
+ * bootstage_trace_json() - Write out the boot timing in Chrome trace format
+ *
+ * This writes a JSON object with a 'traceEvents' array, suitable for
+ * chrome://tracing or Perfetto. Each span becomes a complete ('X') event and
+ * each bootstage mark an instant ('i') event. Times are in microseconds.
+ *
+ * @buf: Buffer to write to, or NULL to just work out the length
+ * @size: Size of buffer
+ * Return: length of the output, not including the terminating nul, which may
+ *	be larger than @size - 1 if the output did not fit
+ */
+int bootstage_trace_json(char *buf, int size);
+
+/**
+ * bootstage_trace_bloblist() - Add the boot timing to the bloblist
+ *
+ * This adds the output of bootstage_trace_json() to the bloblist, with a tag
+ * of BLOBLISTT_U_BOOT_BOOTSTAGE_TRACE, for use by the OS
+ *
+ * Return: 0 if OK, -ENOSPC if there is no space in the bloblist
+ */
+int bootstage_trace_bloblist(void);
+#else
+static inline int bootstage_span_begin(enum bootstage_span_cat cat,
+				       const char *name)
+{
+	return -ENOSYS;
+}
+
+static inline int bootstage_span_begin_func(enum bootstage_span_cat cat,
+					    const void *func)
+{
+	return -ENOSYS;
+}
+
+static inline void bootstage_span_end(int span)
+{
+}
+
+static inline const struct bootstage_span *bootstage_get_span(int span)
+{
+	return NULL;
+}
+
+static inline int bootstage_span_init_r(void)
+{
+	return 0;
+}
+
+static inline int bootstage_trace_bloblist(void)
+{
+	return -ENOSYS;
+}
+#endif
+
 /* Helper macro for adding a bootstage to a line of code */
 #define BOOTSTAGE_MARKER()	\
 		bootstage_mark_code(__FILE__, __func__, __LINE__)
@@ -21,4 +21,23 @@ void btrfs_close(void);
 int btrfs_uuid(char *);
 void btrfs_list_subvols(void);
 
+/**
+ * struct btrfs_decomp_stats - statistics for the decompressed extent cache
+ *
+ * @hits:	Number of times part of a compressed extent was read without
+ *		decompressing it again
+ * @misses:	Number of times a compressed extent was not in the cache
+ */
+struct btrfs_decomp_stats {
+	uint hits;
+	uint misses;
+};
+
+/**
+ * btrfs_decomp_stats() - get statistics for the decompressed extent cache
+ *
+ * @stats:	Returns the statistics
+ */
+void btrfs_decomp_stats(struct btrfs_decomp_stats *stats);
+
 #endif /* __U_BOOT_BTRFS_H__ */
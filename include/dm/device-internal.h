@@ -192,6 +192,99 @@ int device_of_to_plat(struct udevice *dev);
  */
 int device_probe(struct udevice *dev);
 
+/**
+ * device_probe_async() - Start probing a device, without waiting for it
+ *
+ * This is like device_probe() except that if the driver's probe() method
+ * returns -EINPROGRESS, the device is left to finish probing in the background
+ * (see CONFIG_DM_ASYNC_PROBE). Similarly, if a parent is still being probed,
+ * the device is probed once the parent is ready. Calling device_probe() on the
+ * device waits for it to be ready.
+ *
+ * Without CONFIG_DM_ASYNC_PROBE, or before relocation, this is the same as
+ * device_probe()
+ *
+ * @dev: Pointer to device to probe
+ * Return: 0 if OK (the device may still be probing), -ve on error
+ */
+int device_probe_async(struct udevice *dev);
+
+/**
+ * device_probe_finish() - Finish probing a device
+ *
+ * This is called once the driver's probe() (or probe_poll()) method has
+ * finished, to mark the device as activated and tell the uclass about it. If
+ * probing failed, the device is cleaned up instead.
+ *
+ * @dev: Device being probed
+ * @ret: Result of probing the device in the driver
+ * Return: 0 if OK, -ve on error
+ */
+int device_probe_finish(struct udevice *dev, int ret);
+
+/**
+ * device_probe_poll() - Check whether a device has finished probing
+ *
+ * This calls the driver's probe_poll() method, recording the time taken with
+ * CONFIG_DM_TIMING
+ *
+ * @dev: Device being probed, whose probe() method returned -EINPROGRESS
+ * Return: -EAGAIN if the device is not ready yet, else the result of probing
+ */
+int device_probe_poll(struct udevice *dev);
+
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+/**
+ * device_probe_queue() - Probe a device in the background
+ *
+ * @dev: Device to add
+ * @started: true if the driver's probe() method has returned -EINPROGRESS,
+ *	false if the device is waiting for its parent to be probed
+ * Return: 0 if OK, -ENOSYS if not possible yet (before relocation), -ENOMEM if
+ *	out of memory
+ */
+int device_probe_queue(struct udevice *dev, bool started);
+
+/**
+ * device_probe_wait() - Wait for a device being probed in the background
+ *
+ * Other devices continue to be probed while waiting
+ *
+ * @dev: Device to wait for
+ * Return: 0 if the device is ready (or was not being probed), -EDEADLK if
+ *	called from the device's own probe_poll() method, other -ve if probing
+ *	failed
+ */
+int device_probe_wait(struct udevice *dev);
+
+/**
+ * device_probe_cancel() - Stop probing a device in the background
+ *
+ * If the device is waiting for its parent, it is dropped from the list, so is
+ * no longer activated. If its driver has started probing, this waits for it to
+ * finish.
+ *
+ * @dev: Device to cancel
+ * Return: 0 if OK, -ve if probing failed
+ */
+int device_probe_cancel(struct udevice *dev);
+#else
+static inline int device_probe_queue(struct udevice *dev, bool started)
+{
+	return -ENOSYS;
+}
+
+static inline int device_probe_wait(struct udevice *dev)
+{
+	return 0;
+}
+
+static inline int device_probe_cancel(struct udevice *dev)
+{
+	return 0;
+}
+#endif
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
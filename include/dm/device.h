@@ -84,6 +84,12 @@ struct driver_info;
 /* Device must be probed after it was bound */
 #define DM_FLAG_PROBE_AFTER_BIND	(1 << 15)
 
+/*
+ * Device is being probed in the background and is not ready for use yet, so
+ * DM_FLAG_ACTIVATED is clear until it is
+ */
+#define DM_FLAG_PROBE_PENDING		(1 << 16)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -166,6 +172,12 @@ enum {
  * @dma_offset: Offset between the physical address space (CPU's) and the
  *		device's bus address space
  * @iommu: IOMMU device associated with this device
+ * @probe_us: Time taken by the last probe of this device in microseconds,
+ *		not including the time taken to probe its parents. For a probe
+ *		finished in the background, this is the time spent in the
+ *		driver's methods, not the time waited in between
+ * @probe_heap: Change in heap use (see malloc_heap_used()) in bytes caused by
+ *		the last probe of this device, not including its parents
  */
 struct udevice {
 	const struct driver *driver;
@@ -198,6 +210,10 @@ struct udevice {
 #if CONFIG_IS_ENABLED(IOMMU)
 	struct udevice *iommu;
 #endif
+#if CONFIG_IS_ENABLED(DM_TIMING)
+	uint probe_us;
+	int probe_heap;
+#endif
 };
 
 static inline int dm_udevice_size(void)
@@ -341,7 +357,14 @@ struct udevice_id {
  * @of_match: List of compatible strings to match, and any identifying data
  * for each.
  * @bind: Called to bind a device to its driver
- * @probe: Called to probe a device, i.e. activate it
+ * @probe: Called to probe a device, i.e. activate it. This may return
+ * -EINPROGRESS if the driver has a @probe_poll method, to indicate that the
+ * device has started to come up but is not ready yet
+ * @probe_poll: Called to check whether a probe which returned -EINPROGRESS has
+ * finished. This must not wait, but return -EAGAIN if the device is not ready
+ * yet, 0 if it is, or another error if probing failed. With
+ * CONFIG_DM_ASYNC_PROBE this is called from a cyclic function, so that other
+ * devices can be probed in the meantime
  * @remove: Called to remove a device, i.e. de-activate it
  * @unbind: Called to unbind a device from its driver
  * @of_to_plat: Called before probe to decode device tree data
@@ -377,6 +400,7 @@ struct driver {
 	const struct udevice_id *of_match;
 	int (*bind)(struct udevice *dev);
 	int (*probe)(struct udevice *dev);
+	int (*probe_poll)(struct udevice *dev);
 	int (*remove)(struct udevice *dev);
 	int (*unbind)(struct udevice *dev);
 	int (*of_to_plat)(struct udevice *dev);
@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Index of the nodes in a flat device tree
+ *
+ * Before relocation the control FDT is read directly and libfdt finds nodes
+ * by walking the structure block from the start each time. The index records
+ * each node once so that these lookups do not need to walk the tree.
+ */
+
+#ifndef _DM_FDT_INDEX_H
+#define _DM_FDT_INDEX_H
+
+#include <linux/errno.h>
+#include <linux/libfdt.h>
+
+#if CONFIG_IS_ENABLED(FDT_INDEX)
+/**
+ * fdt_index_build() - Build the index for a flat tree
+ *
+ * Only one tree is indexed at a time; building an index for another tree
+ * replaces the existing one. The index is only used in the phase in which
+ * it was built (before or after relocation) and is dropped automatically if
+ * the structure of the tree changes.
+ *
+ * @fdt: Flat tree to index
+ * Return: 0 if OK, -ENOMEM if out of memory, -ENOSPC if the index would take
+ * too much of the pre-relocation malloc() pool, -E2BIG if the tree is too
+ * deep, other -ve value if the tree is invalid
+ */
+int fdt_index_build(const void *fdt);
+
+/**
+ * fdt_index_drop() - Stop using the index for a tree
+ *
+ * This should be called when the tree is changed in a way which may not alter
+ * the size of its structure block, e.g. by rewriting a property in place
+ *
+ * @fdt: Flat tree (nothing is done if it is not the indexed tree)
+ */
+void fdt_index_drop(const void *fdt);
+
+/**
+ * fdt_index_active() - Check whether lookups in a tree use the index
+ *
+ * @fdt: Flat tree to check
+ * Return: true if @fdt has a valid index, false if not
+ */
+bool fdt_index_active(const void *fdt);
+
+/* These behave as the libfdt functions of the same name without fdt_index_ */
+int fdt_index_subnode_offset(const void *fdt, int parentoffset,
+			     const char *name);
+int fdt_index_path_offset(const void *fdt, const char *path);
+int fdt_index_node_offset_by_compatible(const void *fdt, int startoffset,
+					const char *compatible);
+int fdt_index_node_offset_by_phandle(const void *fdt, uint32_t phandle);
+int fdt_index_parent_offset(const void *fdt, int nodeoffset);
+#else
+static inline int fdt_index_build(const void *fdt)
+{
+	return -ENOSYS;
+}
+
+static inline void fdt_index_drop(const void *fdt) {}
+
+static inline bool fdt_index_active(const void *fdt)
+{
+	return false;
+}
+
+static inline int fdt_index_subnode_offset(const void *fdt, int parentoffset,
+					   const char *name)
+{
+	return fdt_subnode_offset(fdt, parentoffset, name);
+}
+
+static inline int fdt_index_path_offset(const void *fdt, const char *path)
+{
+	return fdt_path_offset(fdt, path);
+}
+
+static inline int fdt_index_node_offset_by_compatible(const void *fdt,
+						      int startoffset,
+						      const char *compatible)
+{
+	return fdt_node_offset_by_compatible(fdt, startoffset, compatible);
+}
+
+static inline int fdt_index_node_offset_by_phandle(const void *fdt,
+						   uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(fdt, phandle);
+}
+
+static inline int fdt_index_parent_offset(const void *fdt, int nodeoffset)
+{
+	return fdt_parent_offset(fdt, nodeoffset);
+}
+#endif
+
+#endif
@@ -64,6 +64,38 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   struct driver *drv, bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compat() - Find the driver for a compatible string
+ *
+ * With CONFIG_DM_COMPAT_INDEX this uses a hash table of all compatible
+ * strings, built on first use after relocation. Otherwise all drivers are
+ * searched.
+ *
+ * @compat:	Compatible string to look up
+ * @idp:	Returns the matching entry in the driver's of_match table
+ * Return: first driver in the linker list which matches @compat, or NULL if
+ *	none
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp);
+
+/**
+ * lists_compat_index_set_enabled() - Enable or disable the compatible index
+ *
+ * This is used by tests to compare lookups with and without the index.
+ *
+ * @enable:	true to use the index, false to search all drivers
+ * Return: the previous setting
+ */
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+bool lists_compat_index_set_enabled(bool enable);
+#else
+static inline bool lists_compat_index_set_enabled(bool enable)
+{
+	return false;
+}
+#endif
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
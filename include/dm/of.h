@@ -48,8 +48,12 @@ struct property {
  * @full_name: Full path to node, e.g. "/bus@1/spi@1100" ("/" for the root node)
  * @properties: Pointer to head of list of properties, or NULL if none
  * @parent: Pointer to parent node, or NULL if this is the root node
- * @child: Pointer to head of child node list, or NULL if no children
+ * @child: Pointer to head of child node list, or NULL if no children. Use
+ *	of_node_child() to read this, since it may not be set up yet
  * @sibling: Pointer to the next sibling node, or NULL if this is the last
+ * @offset: Offset of the node in the flat tree it was created from, if
+ *	OF_NODE_FDT is set in @flags
+ * @flags: Flags for lazily created nodes (OF_NODE_...)
  */
 struct device_node {
 	const char *name;
@@ -61,8 +65,56 @@ struct device_node {
 	struct device_node *parent;
 	struct device_node *child;
 	struct device_node *sibling;
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	int offset;
+	uint flags;
+#endif
+};
+
+/**
+ * enum of_node_flags - flags for nodes of a lazily unflattened tree
+ *
+ * @OF_NODE_FDT: Node was created from the flat tree, so @offset is valid
+ * @OF_NODE_UNEXPANDED: Subnodes have not been created yet
+ * @OF_NODE_LAZY_ROOT: Node is the root of a lazily unflattened tree
+ */
+enum of_node_flags {
+	OF_NODE_FDT		= BIT(0),
+	OF_NODE_UNEXPANDED	= BIT(1),
+	OF_NODE_LAZY_ROOT	= BIT(2),
 };
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+/**
+ * of_live_expand() - Create the subnodes of a node from the flat tree
+ *
+ * If there is not enough memory the node is left unexpanded, with no subnodes,
+ * so that expanding it can be tried again later
+ *
+ * @np: Node to expand, which must have OF_NODE_UNEXPANDED set
+ * Return: 0 if OK (or @np is already expanded), -ENOMEM if out of memory
+ */
+int of_live_expand(struct device_node *np);
+#endif
+
+/**
+ * of_node_child() - Get the first subnode of a node
+ *
+ * With OF_LIVE_LAZY, subnodes are only created when first needed, so this
+ * must be used instead of reading @np->child directly
+ *
+ * @np: Node to check
+ * Return: first subnode, or NULL if none
+ */
+static inline struct device_node *of_node_child(const struct device_node *np)
+{
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	if (np->flags & OF_NODE_UNEXPANDED)
+		of_live_expand((struct device_node *)np);
+#endif
+	return np->child;
+}
+
 #define BAD_OF_ROOT	0xdead11e3
 
 #define OF_MAX_PHANDLE_ARGS 16
@@ -266,6 +266,39 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 struct device_node *of_find_node_by_phandle(struct device_node *root,
 					    phandle handle);
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+/**
+ * of_phandle_table_build() - Build a table for finding nodes by phandle
+ *
+ * Once this is done, of_find_node_by_phandle() looks up nodes in this tree
+ * using the table instead of searching the tree. Only one tree has a table;
+ * building one for a different tree replaces it, so this is only done for the
+ * control tree, when it is built after relocation. Other trees, e.g. ones
+ * made temporarily from a flat tree, are searched instead.
+ *
+ * @root:	root node of the tree
+ * Return: 0 if OK, -E2BIG if the tree has a phandle too large for a table,
+ * -ENOMEM if out of memory
+ */
+int of_phandle_table_build(struct device_node *root);
+
+/**
+ * of_phandle_table_free() - Free the phandle table of a tree
+ *
+ * This must be called before freeing a tree, in case it has a table
+ *
+ * @root:	root node of the tree (nothing is done if it has no table)
+ */
+void of_phandle_table_free(struct device_node *root);
+#else
+static inline int of_phandle_table_build(struct device_node *root)
+{
+	return 0;
+}
+
+static inline void of_phandle_table_free(struct device_node *root) {}
+#endif
+
 /**
  * of_read_u8() - Find and read a 8-bit integer from a property
  *
@@ -17,6 +17,7 @@
 /* Enable checks to protect against invalid calls */
 #undef OF_CHECKS
 
+struct abuf;
 struct resource;
 
 #include <dm/ofnode_decl.h>
@@ -362,6 +363,18 @@ static inline oftree oftree_from_np(struct device_node *root)
  */
 void oftree_dispose(oftree tree);
 
+/**
+ * oftree_to_fdt() - Convert an oftree to a flat device tree
+ *
+ * With a live tree this flattens the tree into a newly allocated buffer. With
+ * a flat tree the buffer is set to the tree itself, so nothing is allocated.
+ *
+ * @tree: Tree to convert
+ * @buf: Returns the flat tree, which the caller must free with abuf_uninit()
+ * Return: 0 if OK, -ve on error
+ */
+int oftree_to_fdt(oftree tree, struct abuf *buf);
+
 /**
  * ofnode_name_eq() - Check if the node name is equivalent to a given name
  *                    ignoring the unit address
@@ -576,7 +589,7 @@ static inline ofnode ofnode_first_subnode(ofnode node)
 {
 	assert(ofnode_valid(node));
 	if (ofnode_is_np(node))
-		return np_to_ofnode(node.np->child);
+		return np_to_ofnode(of_node_child(node.np));
 
 	return offset_to_ofnode(
 		fdt_first_subnode(gd->fdt_blob, ofnode_to_offset(node)));
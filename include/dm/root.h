@@ -155,6 +155,20 @@ int dm_init(bool of_live);
  */
 int dm_uninit(void);
 
+#if CONFIG_IS_ENABLED(DM_ASYNC_PROBE)
+/**
+ * dm_probe_wait_all() - Wait for all devices being probed in the background
+ *
+ * This should be called before anything which needs all devices to be ready,
+ * such as booting an OS. Devices which fail to probe are not activated.
+ *
+ * Return: 0 if OK, -EDEADLK if called from a driver's probe_poll() method
+ */
+int dm_probe_wait_all(void);
+#else
+static inline int dm_probe_wait_all(void) { return 0; }
+#endif
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * dm_remove_devices_flags - Call remove function of all drivers with
@@ -61,6 +61,17 @@ void dm_dump_static_driver_info(void);
  */
 void dm_dump_mem(struct dm_stats *stats);
 
+/**
+ * dm_dump_timing() - Dump the devices which took longest to probe
+ *
+ * This needs CONFIG_DM_TIMING
+ *
+ * @count: Maximum number of devices to show
+ * @bootstage: true to also add each device shown to bootstage, as a record of
+ *	accumulated time
+ */
+void dm_dump_timing(int count, bool bootstage);
+
 #if CONFIG_IS_ENABLED(OF_PLATDATA_INST) && CONFIG_IS_ENABLED(READ_ONLY)
 void *dm_priv_to_rw(void *priv);
 #else
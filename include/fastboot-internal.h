@@ -3,6 +3,8 @@
 #ifndef _FASTBOOT_INTERNAL_H_
 #define _FASTBOOT_INTERNAL_H_
 
+#include <linux/errno.h>
+
 /**
  * fastboot_buf_addr - base address of the fastboot download buffer
  */
@@ -33,4 +35,109 @@ extern void (*fastboot_progress_callback)(const char *msg);
  */
 void fastboot_getvar(char *cmd_parameter, char *response);
 
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+/**
+ * fastboot_stream_start() - Stream the next download to a partition
+ *
+ * @part_name: Partition to write to, or NULL or "" to stop streaming
+ * @response: Pointer to fastboot response buffer
+ */
+void fastboot_stream_start(const char *part_name, char *response);
+
+/**
+ * fastboot_stream_armed() - Check if the next download is to be streamed
+ *
+ * Return: true if fastboot_stream_start() selected a partition
+ */
+bool fastboot_stream_armed(void);
+
+/**
+ * fastboot_stream_begin() - Start a download, streaming it if armed
+ *
+ * This forgets the result of any earlier streamed download.
+ *
+ * Return: 0 if the download is to be streamed, -ENOENT if not armed
+ */
+int fastboot_stream_begin(void);
+
+/**
+ * fastboot_stream_active() - Check if a download is being streamed
+ *
+ * Return: true if between fastboot_stream_begin() and
+ * fastboot_stream_finish()
+ */
+bool fastboot_stream_active(void);
+
+/**
+ * fastboot_stream_data() - Handle data received in a streamed download
+ *
+ * The data is added to the download buffer. Each time the buffer fills, what
+ * it holds is written to the partition. Once an error occurs, further data
+ * is ignored and the error is reported by fastboot_stream_finish()
+ *
+ * @data: Data received
+ * @len: Number of bytes received
+ * Return: 0 if OK, -EIO on error
+ */
+int fastboot_stream_data(const void *data, u32 len);
+
+/**
+ * fastboot_stream_finish() - Finish a streamed download
+ *
+ * Writes out the rest of the download and checks that the image was
+ * complete. The result, success or failure, is kept for
+ * fastboot_stream_flashed()
+ *
+ * @response: Pointer to fastboot response buffer, set to FAIL on error
+ * Return: 0 if OK, -EIO on error
+ */
+int fastboot_stream_finish(char *response);
+
+/**
+ * fastboot_stream_flashed() - Report the result of a streamed download
+ *
+ * @part_name: Partition named in the flash command
+ * @response: Pointer to fastboot response buffer
+ * Return: true if the last download was streamed, in which case @response is
+ * set, false if the image must be written as usual
+ */
+bool fastboot_stream_flashed(const char *part_name, char *response);
+#else
+static inline void fastboot_stream_start(const char *part_name,
+					 char *response)
+{
+}
+
+static inline bool fastboot_stream_armed(void)
+{
+	return false;
+}
+
+static inline int fastboot_stream_begin(void)
+{
+	return -ENOENT;
+}
+
+static inline bool fastboot_stream_active(void)
+{
+	return false;
+}
+
+static inline int fastboot_stream_data(const void *data, u32 len)
+{
+	return -ENOSYS;
+}
+
+static inline int fastboot_stream_finish(char *response)
+{
+	return -ENOSYS;
+}
+
+static inline bool fastboot_stream_flashed(const char *part_name,
+					   char *response)
+{
+	return false;
+}
+#endif
+
 #endif
@@ -13,6 +13,7 @@
 #include <asm/u-boot.h>
 #include <linux/libfdt.h>
 #include <abuf.h>
+#include <dm/ofnode_decl.h>
 
 /**
  * arch_fixup_fdt() - Write arch-specific information to fdt
@@ -240,6 +241,55 @@ void set_working_fdt_addr(ulong addr);
  * Return: 0 if ok, or -FDT_ERR_... on error
  */
 int fdt_shrink_to_minimum(void *blob, uint extrasize);
+
+/**
+ * struct fdt_batch - A batch of changes being made to a flat tree
+ *
+ * @fdt: Flat tree being changed
+ * @size: Space available for @fdt, in bytes
+ * @tree: Tree to change with the ofnode API
+ */
+struct fdt_batch {
+	void *fdt;
+	int size;
+	oftree tree;
+};
+
+/**
+ * fdt_batch_start() - Start a batch of changes to a flat tree
+ *
+ * When the live tree is active, @fdt is unflattened so that changes made to
+ * @batch->tree with the ofnode API are cheap, rather than each one moving the
+ * rest of the flat tree. The result is written back to @fdt by
+ * fdt_batch_finish(). Otherwise @batch->tree just refers to @fdt, which is
+ * changed directly.
+ *
+ * @batch: Returns information about the batch
+ * @fdt: Flat tree to change, which may use up to fdt_totalsize(@fdt) bytes
+ * Return: 0 if OK, -EINVAL if the tree cannot be used
+ */
+int fdt_batch_start(struct fdt_batch *batch, void *fdt);
+
+/**
+ * fdt_batch_finish() - Write a batch of changes back to the flat tree
+ *
+ * The memory reservations and boot CPU in the flat tree are kept. The batch is
+ * disposed of, even on error.
+ *
+ * @batch: Batch to finish
+ * Return: 0 if OK, -ENOSPC if the result does not fit in the flat tree, other
+ *	-ve value on error
+ */
+int fdt_batch_finish(struct fdt_batch *batch);
+
+/**
+ * fdt_batch_abort() - Dispose of a batch without writing back any changes
+ *
+ * Note that changes are already in the flat tree if the live tree is not active
+ *
+ * @batch: Batch to dispose of
+ */
+void fdt_batch_abort(struct fdt_batch *batch);
 int fdt_increase_size(void *fdt, int add_len);
 
 int fdt_delete_disabled_nodes(void *blob);
@@ -406,6 +456,20 @@ int fdt_setup_simplefb_node(void *fdt, int node, u64 base_address, u32 width,
 
 int fdt_overlay_apply_verbose(void *fdt, void *fdto);
 
+/**
+ * fdt_overlay_apply_stack() - Apply a list of overlays with one pass
+ *
+ * This gives the same result as calling fdt_overlay_apply_verbose() for each
+ * overlay in turn, but is faster when there are several overlays. On error,
+ * a message is printed and @fdt is left unchanged.
+ *
+ * @fdt: Base tree to update, which may use up to fdt_totalsize(@fdt) bytes
+ * @fdtos: Overlays to apply, which are damaged as with fdt_overlay_apply()
+ * @count: Number of overlays
+ * Return: 0 if OK, -ve FDT_ERR_... on error
+ */
+int fdt_overlay_apply_stack(void *fdt, void *const fdtos[], int count);
+
 int fdt_valid(struct fdt_header **blobp);
 
 /**
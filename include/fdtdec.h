@@ -690,6 +690,19 @@ int fdtdec_get_chosen_node(const void *blob, const char *name);
  */
 const char *fdtdec_get_compatible(enum fdt_compat_id id);
 
+/**
+ * fdtdec_node_offset_by_phandle() - Find the node with a given phandle
+ *
+ * This is the same as fdt_node_offset_by_phandle() but, with
+ * CONFIG_OF_PHANDLE_CACHE, uses a cache for the control FDT after relocation
+ * rather than searching the tree each time
+ *
+ * @fdt:	FDT blob
+ * @phandle:	phandle to look up
+ * Return: offset of the node, or -ve FDT_ERR_... value if not found
+ */
+int fdtdec_node_offset_by_phandle(const void *fdt, uint phandle);
+
 /* Look up a phandle and follow it to its node. Then return the offset
  * of that node.
  *
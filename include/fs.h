@@ -7,6 +7,7 @@
 
 #include <common.h>
 #include <rtc.h>
+#include <linux/errno.h>
 
 struct cmd_tbl;
 
@@ -88,6 +89,9 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
  * Many file functions implicitly call fs_close(), e.g. fs_closedir(),
  * fs_exist(), fs_ln(), fs_ls(), fs_mkdir(), fs_read(), fs_size(), fs_write(),
  * fs_unlink().
+ *
+ * With CONFIG_FS_MOUNT_CACHE the filesystem itself may stay mounted, so that
+ * the next fs_set_blk_dev() for the same partition does not probe it again.
  */
 void fs_close(void);
 
@@ -338,4 +342,154 @@ int fs_load_alloc(const char *ifname, const char *dev_part_str,
 		  const char *fname, ulong max_size, ulong align, void **bufp,
 		  ulong *sizep);
 
+/**
+ * struct fs_lookup_entry - cached result of resolving a path
+ *
+ * @ino:	Filesystem-specific handle for the file, e.g. its inode number,
+ *		or 0 if the filesystem did not supply one
+ * @type:	Type of the file (FS_DT_x)
+ * @size:	Size of the file in bytes
+ */
+struct fs_lookup_entry {
+	u64 ino;
+	unsigned int type;
+	loff_t size;
+};
+
+/**
+ * struct fs_lookup_stats - statistics for the path lookup cache
+ *
+ * @hits:	Number of lookups answered from the cache
+ * @misses:	Number of lookups not found in the cache
+ * @entries:	Number of paths currently cached
+ * @max_entries: Size of the cache
+ * @invalidations: Number of times cached paths were discarded because the
+ *		underlying device or filesystem changed
+ */
+struct fs_lookup_stats {
+	uint hits;
+	uint misses;
+	uint entries;
+	uint max_entries;
+	uint invalidations;
+};
+
+#if CONFIG_IS_ENABLED(FS_LOOKUP_CACHE)
+/**
+ * fs_lookup_cache_find() - look up a path in the current filesystem's cache
+ *
+ * The cache is keyed by the block device and partition set up by
+ * fs_set_blk_dev(), so this must be called after that. Filesystems may use
+ * this to avoid walking directories to find a file they have found before.
+ *
+ * @path:	Path of the file
+ * @ent:	Returns the cached information about the file
+ * Return: 0 if found, -ENOENT if the path is not in the cache
+ */
+int fs_lookup_cache_find(const char *path, struct fs_lookup_entry *ent);
+
+/**
+ * fs_lookup_cache_add() - record the result of resolving a path
+ *
+ * @path:	Path of the file
+ * @ent:	Information about the file
+ */
+void fs_lookup_cache_add(const char *path, const struct fs_lookup_entry *ent);
+
+/**
+ * fs_lookup_cache_invalidate_dev() - discard cached paths for a block device
+ *
+ * This must be called whenever the contents of the device may have changed
+ * other than through the filesystem layer, or the device goes away.
+ *
+ * @desc:	Block device, or NULL to discard everything
+ */
+void fs_lookup_cache_invalidate_dev(struct blk_desc *desc);
+
+/**
+ * fs_lookup_cache_stats() - get statistics for the path lookup cache
+ *
+ * @stats:	Returns the statistics
+ */
+void fs_lookup_cache_stats(struct fs_lookup_stats *stats);
+#else
+static inline int fs_lookup_cache_find(const char *path,
+				       struct fs_lookup_entry *ent)
+{
+	return -ENOENT;
+}
+
+static inline void fs_lookup_cache_add(const char *path,
+				       const struct fs_lookup_entry *ent)
+{
+}
+
+static inline void fs_lookup_cache_invalidate_dev(struct blk_desc *desc)
+{
+}
+
+static inline void fs_lookup_cache_stats(struct fs_lookup_stats *stats)
+{
+	memset(stats, '\0', sizeof(*stats));
+}
+#endif
+
+/**
+ * struct fs_mount_stats - statistics for filesystems kept mounted
+ *
+ * @probes:	Number of times a filesystem was probed (mounted)
+ * @reuses:	Number of times the mounted filesystem was used again without
+ *		probing it
+ * @releases:	Number of times the mounted filesystem was unmounted, because
+ *		a different one was needed or its device changed
+ */
+struct fs_mount_stats {
+	uint probes;
+	uint reuses;
+	uint releases;
+};
+
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * fs_mount_release() - unmount the filesystem kept mounted between operations
+ *
+ * fs_close() leaves the filesystem mounted, so that fs_set_blk_dev() can use
+ * it again for the next operation on the same partition. Filesystem drivers
+ * whose global state may also be set up by callers outside the filesystem
+ * layer call this before changing that state.
+ */
+void fs_mount_release(void);
+
+/**
+ * fs_mount_invalidate_dev() - stop reusing the filesystem on a block device
+ *
+ * The filesystem is unmounted at the next fs_close() or fs_set_blk_dev(), so
+ * this is safe to call while the filesystem is in use, e.g. from the block
+ * layer when the filesystem itself writes to the device.
+ *
+ * @desc:	Block device, or NULL for any device
+ */
+void fs_mount_invalidate_dev(struct blk_desc *desc);
+
+/**
+ * fs_mount_stats() - get statistics for filesystems kept mounted
+ *
+ * @stats:	Returns the statistics
+ */
+void fs_mount_stats(struct fs_mount_stats *stats);
+#else
+static inline void fs_mount_release(void)
+{
+}
+
+static inline void fs_mount_invalidate_dev(struct blk_desc *desc)
+{
+}
+
+static inline void fs_mount_stats(struct fs_mount_stats *stats)
+{
+	memset(stats, '\0', sizeof(*stats));
+}
+#endif
+
 #endif /* _FS_H */
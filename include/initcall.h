@@ -8,11 +8,124 @@
 
 typedef int (*init_fnc_t)(void);
 
+#include <bootstage.h>
 #include <log.h>
 #ifdef CONFIG_EFI_APP
 #include <efi.h>
 #endif
 #include <asm/global_data.h>
+#include <linux/types.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * struct initcall_stat - time taken by an initcall
+ *
+ * @func: Offset of the function from the start of the code
+ * @time_us: Time taken in microseconds
+ * @heap: Change in heap use (see malloc_heap_used()) in bytes, or 0 if
+ *	malloc() was set up by the function
+ * @ret: Value returned by the function
+ */
+struct initcall_stat {
+	u32 func;
+	u32 time_us;
+	int heap;
+	int ret;
+};
+
+/**
+ * struct initcall_timing - information kept while an initcall runs
+ *
+ * @start_us: Time when the initcall started
+ * @heap: Heap use when the initcall started
+ * @flags: Value of gd->flags when the initcall started
+ */
+struct initcall_timing {
+	ulong start_us;
+	ulong heap;
+	ulong flags;
+};
+
+#if CONFIG_IS_ENABLED(INITCALL_STATS)
+/**
+ * initcall_stats_init() - Set up space for the initcall records
+ *
+ * Initcalls which run before this are not recorded
+ *
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int initcall_stats_init(void);
+
+/**
+ * initcall_stats_get_size() - Get the size of the initcall records
+ *
+ * This is used to reserve space for them when U-Boot relocates
+ *
+ * Return: size in bytes
+ */
+int initcall_stats_get_size(void);
+
+/**
+ * initcall_stats_start() - Note the start of an initcall
+ *
+ * @timing: Returns the information needed by initcall_stats_end()
+ */
+void initcall_stats_start(struct initcall_timing *timing);
+
+/**
+ * initcall_stats_end() - Record the time taken by an initcall
+ *
+ * The record is dropped if there is no space for it, and not made at all if
+ * initcall_stats_init() has not been called
+ *
+ * @timing: Information from initcall_stats_start()
+ * @func: Function which was called
+ * @ret: Value returned by @func
+ */
+void initcall_stats_end(const struct initcall_timing *timing, init_fnc_t func,
+			int ret);
+
+/**
+ * initcall_stats_get() - Get the initcall records
+ *
+ * @statsp: Returns a pointer to the records, in the order they were made, or
+ *	NULL if there are none
+ * @droppedp: Returns the number of records dropped since there was no space
+ * Return: number of records
+ */
+int initcall_stats_get(const struct initcall_stat **statsp, uint *droppedp);
+
+/**
+ * initcall_stats_show() - Show the slowest initcalls
+ *
+ * Functions are shown with their symbol name if CONFIG_KALLSYMS is enabled
+ *
+ * @count: Maximum number of initcalls to show
+ * @bootstage: true to also add each one shown to bootstage, as a record of
+ *	accumulated time
+ */
+void initcall_stats_show(int count, bool bootstage);
+#else
+static inline int initcall_stats_init(void)
+{
+	return 0;
+}
+
+static inline int initcall_stats_get_size(void)
+{
+	return 0;
+}
+
+static inline void initcall_stats_start(struct initcall_timing *timing)
+{
+}
+
+static inline void initcall_stats_end(const struct initcall_timing *timing,
+				      init_fnc_t func, int ret)
+{
+}
+#endif
 
 /*
  * To enable debugging. add #define DEBUG at the top of the including file.
@@ -24,8 +137,9 @@ static inline int initcall_run_list(const init_fnc_t init_sequence[])
 	const init_fnc_t *init_fnc_ptr;
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
+		struct initcall_timing timing;
 		unsigned long reloc_ofs = 0;
-		int ret;
+		int ret, span;
 
 		/*
 		 * Sandbox is relocated by the OS, so symbols always appear at
@@ -43,7 +157,12 @@ static inline int initcall_run_list(const init_fnc_t init_sequence[])
 		else
 			debug("initcall: %p\n", (char *)*init_fnc_ptr - reloc_ofs);
 
+		span = bootstage_span_begin_func(BOOTSTAGE_SPAN_INITCALL,
+						 *init_fnc_ptr);
+		initcall_stats_start(&timing);
 		ret = (*init_fnc_ptr)();
+		initcall_stats_end(&timing, *init_fnc_ptr, ret);
+		bootstage_span_end(span);
 		if (ret) {
 			printf("initcall sequence %p failed at call %p (err=%d)\n",
 			       init_sequence,
@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Helper functions for working with the builtin symbol table
+ */
+
+#ifndef __KALLSYMS_H
+#define __KALLSYMS_H
+
+#include <vsprintf.h>
+#include <asm/global_data.h>
+#include <asm/sections.h>
+#include <linux/compiler.h>
+#include <linux/types.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * symbol_lookup() - Find the symbol containing an address
+ *
+ * This needs CONFIG_KALLSYMS
+ *
+ * @addr: Address to look up, as used when linking U-Boot
+ * @caddr: Returns the address of the symbol, or 0 if none
+ * Return: name of the symbol, or NULL if none
+ */
+const char *symbol_lookup(unsigned long addr, unsigned long *caddr);
+
+/**
+ * symbol_lookup_offset() - Find the symbol containing a code offset
+ *
+ * The first symbol in the table is taken to be the start of the code, so this
+ * works regardless of where U-Boot is running. This needs CONFIG_KALLSYMS
+ *
+ * @offset: Offset to look up, from the start of the code
+ * @cofs: Returns the offset of the symbol from the start of the code
+ * Return: name of the symbol, or NULL if none
+ */
+const char *symbol_lookup_offset(unsigned long offset, unsigned long *cofs);
+
+/**
+ * code_offset() - Get the offset of a code address from the start of the code
+ *
+ * This is the offset used by tracing, which is the same whether U-Boot has
+ * relocated or not. It can be passed to symbol_lookup_offset().
+ *
+ * @addr: Code address, e.g. of a function
+ * Return: offset of @addr from the start of the code
+ */
+static inline ulong notrace code_offset(ulong addr)
+{
+#ifdef CONFIG_SANDBOX
+	return addr - (ulong)&_init;
+#else
+	if (gd->flags & GD_FLG_RELOC)
+		return addr - gd->relocaddr;
+	else
+		return addr - CONFIG_TEXT_BASE;
+#endif
+}
+
+#ifdef CONFIG_KALLSYMS
+/**
+ * symbol_name_offset() - Get the name of a function from its code offset
+ *
+ * @offset: Offset of the start of the function, from the start of the code
+ * @buf: Buffer to use if the name is not known
+ * @size: Size of @buf
+ * Return: name of the function, or "func_<offset>" in @buf if there is no
+ *	symbol starting at @offset
+ */
+const char *symbol_name_offset(unsigned long offset, char *buf, int size);
+#else
+static inline const char *symbol_name_offset(unsigned long offset, char *buf,
+					     int size)
+{
+	snprintf(buf, size, "func_%lx", offset);
+
+	return buf;
+}
+#endif
+
+#endif
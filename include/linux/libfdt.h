@@ -10,4 +10,17 @@
 /* U-Boot local hacks */
 extern struct fdt_header *working_fdt;  /* Pointer to the working fdt */
 
+/**
+ * fdt_overlay_prepare() - Shift the phandles of an overlay before merging it
+ *
+ * This does the first steps of fdt_overlay_apply(), adding @delta to each
+ * phandle defined in the overlay and to each reference to one of them, so that
+ * they do not clash with those in the base tree
+ *
+ * @fdto: Device tree overlay blob, which is changed in place
+ * @delta: Amount to add, normally the largest phandle in the base tree
+ * Return: 0 if OK, -ve FDT_ERR_... on error
+ */
+int fdt_overlay_prepare(void *fdto, uint32_t delta);
+
 #endif /* _INCLUDE_LIBFDT_H_ */
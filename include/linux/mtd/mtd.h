@@ -594,6 +594,29 @@ void mtd_get_len_incl_bad(struct mtd_info *mtd, uint64_t offset,
 			  int *truncated);
 bool mtd_dev_list_updated(void);
 
+#if CONFIG_IS_ENABLED(MTD_UBI_ATTACH_CACHE)
+/**
+ * mtd_note_change() - Record a change made to an MTD device
+ *
+ * This is called for every erase, write and mark-bad operation on any MTD
+ * device, including those which call the driver operations directly.
+ */
+void mtd_note_change(void);
+
+/**
+ * mtd_get_change_count() - Get the number of changes made to MTD devices
+ *
+ * This lets callers tell whether what they read earlier may be stale.
+ *
+ * Return: number of calls to mtd_note_change() so far
+ */
+ulong mtd_get_change_count(void);
+#else
+static inline void mtd_note_change(void)
+{
+}
+#endif
+
 /* drivers/mtd/mtd_uboot.c */
 int mtd_search_alternate_name(const char *mtdname, char *altname,
 			      unsigned int max_len);
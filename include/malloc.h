@@ -895,6 +895,109 @@ void malloc_enable_testing(int max_allocs);
 /** malloc_disable_testing() - Put malloc() into normal mode */
 void malloc_disable_testing(void);
 
+/* Largest request served by the slab allocator */
+#define MALLOC_SLAB_MAX		256
+
+/**
+ * struct malloc_slab_stats - statistics for a slab size class
+ *
+ * @size: Object size for this class in bytes
+ * @objs_per_page: Number of objects in each slab page
+ * @allocs: Number of objects allocated
+ * @frees: Number of objects freed
+ * @in_use: Number of objects currently allocated
+ * @peak: Largest value seen for @in_use
+ * @pages: Number of slab pages currently held
+ */
+struct malloc_slab_stats {
+	uint size;
+	uint objs_per_page;
+	ulong allocs;
+	ulong frees;
+	uint in_use;
+	uint peak;
+	uint pages;
+};
+
+/**
+ * malloc_slab_alloc() - Allocate a small object from the slab
+ *
+ * This is called by malloc() for requests of up to MALLOC_SLAB_MAX bytes
+ *
+ * @bytes: Number of bytes required
+ * Return: pointer to the object (aligned to 16 bytes), or NULL if the slab is
+ *	disabled or out of memory, in which case the caller should fall back to
+ *	the normal allocator
+ */
+void *malloc_slab_alloc(size_t bytes);
+
+/**
+ * malloc_slab_free() - Free an object if it belongs to the slab
+ *
+ * @ptr: Pointer to free
+ * Return: true if @ptr was a slab object and has been freed, false if it is
+ *	not a slab object
+ */
+bool malloc_slab_free(void *ptr);
+
+/**
+ * malloc_slab_size() - Get the usable size of a slab object
+ *
+ * @ptr: Pointer to check
+ * Return: size of the object's class, or 0 if @ptr is not a slab object
+ */
+size_t malloc_slab_size(const void *ptr);
+
+/**
+ * malloc_slab_unused() - Get the space in slab pages not allocated to objects
+ *
+ * This allows mallinfo() to report the memory actually in use
+ *
+ * Return: number of bytes held by the slab allocator but not in use
+ */
+size_t malloc_slab_unused(void);
+
+/**
+ * malloc_slab_get_mem() - Allocate memory for use by the slab allocator
+ *
+ * This bypasses the slab and is not counted by malloc_enable_testing()
+ *
+ * @align: Alignment required
+ * @bytes: Number of bytes required
+ * Return: pointer to the memory, or NULL if out of memory
+ */
+void *malloc_slab_get_mem(size_t align, size_t bytes);
+
+/**
+ * malloc_slab_enable() - Enable or disable the slab for new allocations
+ *
+ * Objects already allocated from the slab can still be freed while it is
+ * disabled
+ *
+ * @enable: true to enable, false to disable
+ * Return: previous setting
+ */
+bool malloc_slab_enable(bool enable);
+
+/**
+ * malloc_slab_get_stats() - Get statistics for each size class
+ *
+ * @stats: Returns statistics, one entry per class
+ * @max: Maximum number of entries to write to @stats
+ * Return: number of size classes, which may be more than @max
+ */
+int malloc_slab_get_stats(struct malloc_slab_stats *stats, int max);
+
+/**
+ * malloc_slab_reset() - Forget all slab state
+ *
+ * This is called when the malloc() area is set up
+ */
+void malloc_slab_reset(void);
+
+/** malloc_slab_info() - Show slab statistics */
+void malloc_slab_info(void);
+
 #if CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
 #define malloc malloc_simple
 #define realloc realloc_simple
@@ -999,6 +1102,19 @@ extern ulong mem_malloc_brk;
 
 void mem_malloc_init(ulong start, ulong size);
 
+/**
+ * malloc_heap_used() - Get the amount of the malloc() area taken so far
+ *
+ * Before full malloc() is set up, this is the space used in the early
+ * malloc() area. After that it is the space taken from the malloc() area by
+ * sbrk(), which changes a page at a time and includes space which has been
+ * freed but not given back. This is cheap, so it suits measuring how much an
+ * operation grows the heap, but is not an exact count of bytes allocated.
+ *
+ * Return: number of bytes taken
+ */
+ulong malloc_heap_used(void);
+
 #ifdef __cplusplus
 };  /* end of extern "C" */
 #endif
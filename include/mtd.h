@@ -14,6 +14,61 @@ int mtd_probe_devices(void);
 
 void board_mtdparts_default(const char **mtdids, const char **mtdparts);
 
+/**
+ * struct mtd_update_stats - statistics from mtd_update()
+ *
+ * @written: Number of bytes programmed
+ * @skipped: Number of bytes of the request which were already in the flash
+ * @erased: Number of erase blocks erased
+ * @erase_skipped: Number of changed erase blocks which did not need an erase
+ * @bad: Number of bad blocks skipped
+ * @consumed: Number of bytes of flash covered by the request, including bad
+ *	blocks which were skipped
+ */
+struct mtd_update_stats {
+	u64 written;
+	u64 skipped;
+	uint erased;
+	uint erase_skipped;
+	uint bad;
+	u64 consumed;
+};
+
+/* Flags for mtd_update() */
+enum mtd_update_flags {
+	MTD_UPDATE_VERIFY	= 1 << 0,	/* read back what is written */
+};
+
+/**
+ * mtd_update() - Update a region of flash, only touching what changed
+ *
+ * Each erase block in the region is read back and compared with the new data.
+ * Blocks which already hold that data are left alone. On NOR flash a changed
+ * block is only erased if some change sets bits; other flash, such as NAND,
+ * is always erased before a changed block is programmed. Pages which would be
+ * left erased are not programmed. Erases and writes to
+ * neighbouring blocks are merged into single operations.
+ *
+ * Bad blocks are skipped, the data going into the next good block as with
+ * nand_write_skip_bad().
+ *
+ * @mtd: MTD device to update
+ * @to: Offset to start at, which must be aligned to the write size
+ * @len: Number of bytes to write. If this ends part-way through a page, the
+ *	rest of the page keeps its current contents
+ * @limit: Offset at which the region must end, even if bad blocks were
+ *	skipped, or 0 for the end of the device
+ * @buf: New data, or NULL to erase the region
+ * @flags: Flags (enum mtd_update_flags)
+ * @stats: Returns statistics about the update, or NULL if not needed
+ * Return: 0 if OK, -EINVAL if @to is not aligned or the region does not
+ *	fit before @limit, -ENOSPC if bad blocks pushed the region past
+ *	@limit, -ENOMEM if out of memory, -EIO if verification failed, other
+ *	-ve value on flash error
+ */
+int mtd_update(struct mtd_info *mtd, loff_t to, size_t len, loff_t limit,
+	       const u_char *buf, uint flags, struct mtd_update_stats *stats);
+
 /* compute the max size for the string associated to a dev type */
 #define MTD_NAME_SIZE(type) (sizeof(MTD_DEV_TYPE(type)) +  DM_MAX_SEQ_STR)
 
@@ -9,17 +9,136 @@
 #ifndef _OF_LIVE_H
 #define _OF_LIVE_H
 
+#include <linux/errno.h>
+#include <linux/types.h>
+
+struct abuf;
 struct device_node;
 
+/**
+ * struct of_live_stats - statistics for a lazily unflattened tree
+ *
+ * @nodes: Number of nodes created so far
+ * @total_nodes: Number of nodes in the flat tree
+ * @size: Memory used by the nodes created so far, in bytes
+ */
+struct of_live_stats {
+	uint nodes;
+	uint total_nodes;
+	ulong size;
+};
+
+/**
+ * of_live_match_t - check whether a node matches a search
+ *
+ * This is called either with a live node in @np, or with a node in the flat
+ * tree in @fdt and @offset
+ *
+ * @fdt: Flat tree containing the node, if @np is NULL
+ * @offset: Offset of the node in @fdt, if @np is NULL
+ * @np: Live node, or NULL if the node is in the flat tree
+ * @priv: Private data for the search
+ * Return: true if the node matches
+ */
+typedef bool (*of_live_match_t)(const void *fdt, int offset,
+				const struct device_node *np,
+				const void *priv);
+
 /**
  * of_live_build() - build a live (hierarchical) tree from a flat DT
  *
+ * With OF_LIVE_LAZY the tree is built by of_live_build_lazy()
+ *
  * @fdt_blob: Input tree to convert
  * @rootp: Returns live tree that was created
  * Return: 0 if OK, -ve on error
  */
 int of_live_build(const void *fdt_blob, struct device_node **rootp);
 
+/**
+ * of_live_build_lazy() - build a live tree whose nodes are created on demand
+ *
+ * Only the root node is created at first. The subnodes of each node are
+ * created from the flat tree the first time they are needed, with property
+ * names and values pointing into the flat tree, which must therefore stay in
+ * place and unchanged while the live tree is in use.
+ *
+ * @fdt_blob: Input tree to convert
+ * @rootp: Returns live tree that was created
+ * Return: 0 if OK, -EINVAL if the tree is invalid, -ENOMEM if out of memory
+ */
+int of_live_build_lazy(const void *fdt_blob, struct device_node **rootp);
+
+/**
+ * of_live_node_by_offset() - get the live node for a node in the flat tree
+ *
+ * This creates the node, and any parents, if not done already
+ *
+ * @root: Root of a tree built by of_live_build_lazy()
+ * @offset: Offset of the node in the flat tree
+ * Return: live node, or NULL if not found
+ */
+struct device_node *of_live_node_by_offset(struct device_node *root,
+					   int offset);
+
+/**
+ * of_live_find_phandle() - find a node by phandle in a lazily unflattened tree
+ *
+ * @root: Root of a tree built by of_live_build_lazy()
+ * @handle: phandle to find
+ * Return: node found (which is created if needed), or NULL if none
+ */
+struct device_node *of_live_find_phandle(struct device_node *root,
+					 u32 handle);
+
+/**
+ * of_live_find() - find the next node in a lazily unflattened tree
+ *
+ * Nodes are checked in the same order as for_each_of_allnodes_from(), but
+ * subnodes which have not been created yet are checked in the flat tree, so
+ * that only the node found, and its parents, need to be created
+ *
+ * @from: Node to start after, or NULL to start at gd->of_root, which must be
+ *	in a tree built by of_live_build_lazy()
+ * @match: Function to check each node
+ * @priv: Private data passed to @match
+ * Return: node found, or NULL if none
+ */
+struct device_node *of_live_find(struct device_node *from,
+				 of_live_match_t match, const void *priv);
+
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+/**
+ * of_live_is_lazy() - check whether a node is in a lazily unflattened tree
+ *
+ * @np: Node to check
+ * Return: true if the tree containing @np was built by of_live_build_lazy()
+ */
+bool of_live_is_lazy(const struct device_node *np);
+
+/**
+ * of_live_get_stats() - get statistics for a lazily unflattened tree
+ *
+ * @root: Root of the tree
+ * @stats: Returns the statistics
+ * Return: 0 if OK, -ENOENT if @root is not in a tree built by
+ * of_live_build_lazy()
+ */
+int of_live_get_stats(const struct device_node *root,
+		      struct of_live_stats *stats);
+#else
+static inline bool of_live_is_lazy(const struct device_node *np)
+{
+	return false;
+}
+
+static inline int of_live_get_stats(const struct device_node *root,
+				    struct of_live_stats *stats)
+{
+	return -ENOENT;
+}
+#endif
+
 /**
  * unflatten_device_tree() - create tree of device_nodes from flat blob
  *
@@ -46,4 +165,34 @@ int unflatten_device_tree(const void *blob, struct device_node **mynodes);
  */
 void of_live_free(struct device_node *root);
 
+/**
+ * of_live_flatten() - Create a flat tree from a live tree
+ *
+ * The flat tree is created in one pass, with no memory reservations. It is
+ * allocated by this function and its size is exactly what is needed.
+ *
+ * @root: Root of the live tree
+ * @buf: Returns the flat tree, which the caller must free with abuf_uninit()
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int of_live_flatten(const struct device_node *root, struct abuf *buf);
+
+/**
+ * of_overlay_apply_stack() - Apply a list of overlays to a flat tree
+ *
+ * The tree is unflattened, the overlays are applied in order and the result is
+ * flattened into @buf, with no memory reservations. The result is the same as
+ * calling fdt_overlay_apply() for each overlay, but each one is only searched
+ * once and the tree is only written once.
+ *
+ * @fdt: Base tree, which is not changed
+ * @fdtos: Overlays to apply, which are damaged as with fdt_overlay_apply()
+ * @count: Number of overlays
+ * @buf: Returns the flat tree on success, which the caller must free with
+ *	abuf_uninit()
+ * Return: 0 if OK, -ve FDT_ERR_... on error
+ */
+int of_overlay_apply_stack(const void *fdt, void *const fdtos[], int count,
+			   struct abuf *buf);
+
 #endif
@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Sampling profiler
+ */
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include <linux/types.h>
+
+/**
+ * struct profile_stats - information about the samples collected
+ *
+ * @samples: Number of samples recorded
+ * @stacks: Number of distinct call stacks seen
+ * @max_stacks: Maximum number of distinct call stacks that can be recorded
+ * @dropped: Number of samples dropped since there was no space for their
+ *	call stack
+ * @time_us: Total time covered by the samples, in microseconds
+ */
+struct profile_stats {
+	ulong samples;
+	uint stacks;
+	uint max_stacks;
+	ulong dropped;
+	ulong time_us;
+};
+
+#if CONFIG_IS_ENABLED(PROFILE)
+/**
+ * profile_sample() - Record a sample, if one is due
+ *
+ * This is called from schedule(), so that a sample is taken each time it runs
+ * after at least the sample interval has passed. The time since the last
+ * sample is attributed to the call stack at that point. It may also be called
+ * from an interrupt handler, if the architecture has a suitable timer.
+ *
+ * With PROFILE_CALLCHAIN the call stack is found by following the chain of
+ * frame pointers, starting with @frame
+ *
+ * @pc: Code address to record as the innermost frame
+ * @frame: Stack frame containing @pc as its return address, or NULL to record
+ *	only @pc
+ */
+void profile_sample(void *pc, void *frame);
+
+/**
+ * profile_start() - Start sampling
+ *
+ * Any samples from a previous run are discarded
+ *
+ * @interval_us: Minimum interval between samples in microseconds, or 0 to
+ *	use CONFIG_PROFILE_INTERVAL_US
+ * Return: 0 if OK, -ENOMEM if there is not enough memory for the samples
+ */
+int profile_start(uint interval_us);
+
+/**
+ * profile_stop() - Stop sampling
+ *
+ * The samples are kept, so they can be listed or written out
+ */
+void profile_stop(void);
+
+/**
+ * profile_get_stats() - Get information about the samples collected
+ *
+ * @stats: Returns the information
+ * Return: 0 if OK, -ENOENT if profiling has never been started
+ */
+int profile_get_stats(struct profile_stats *stats);
+
+/**
+ * profile_list_samples() - Write the samples into a buffer
+ *
+ * This writes a struct trace_output_hdr of type TRACE_CHUNK_SAMPLES followed
+ * by a struct trace_sample for each call stack, in the same way as
+ * trace_list_calls(), for use by proftool
+ *
+ * @buff: Buffer in which to place data, or NULL to count size
+ * @buff_size: Size of buffer
+ * @needed: Returns number of bytes used / needed
+ * Return: 0 if OK, -ENOSPC if @buff_size is too small, -ENOENT if profiling
+ *	has never been started
+ */
+int profile_list_samples(void *buff, size_t buff_size, size_t *needed);
+
+/**
+ * profile_print_stats() - Show the samples collected
+ *
+ * This shows a summary and the call stacks using the most time, with their
+ * symbol names if CONFIG_KALLSYMS is enabled
+ *
+ * @count: Maximum number of call stacks to show
+ */
+void profile_print_stats(int count);
+#else
+static inline void profile_sample(void *pc, void *frame)
+{
+}
+#endif
+
+#endif
@@ -165,6 +165,7 @@ static inline int spi_flash_write(struct spi_flash *flash, u32 offset,
 	if (!len)
 		return 0;
 
+	mtd_note_change();
 	return mtd->_write(mtd, offset, len, &retlen, buf);
 }
 
@@ -186,6 +187,7 @@ static inline int spi_flash_erase(struct spi_flash *flash, u32 offset,
 	instr.addr = offset;
 	instr.len = len;
 
+	mtd_note_change();
 	return mtd->_erase(mtd, &instr);
 }
 #endif
@@ -29,11 +29,14 @@ enum {
 	FUNC_SITE_SIZE	= 16,	/* distance between function sites */
 
 	TRACE_VERSION	= 1,
+
+	TRACE_SAMPLE_DEPTH	= 16,	/* max stack frames in a sample */
 };
 
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_SAMPLES,
 };
 
 /* A trace record for a function, as written to the profile output file */
@@ -89,6 +92,18 @@ struct trace_call {
 
 int trace_list_calls(void *buff, size_t buff_size, size_t *needed);
 
+/*
+ * A call stack seen by the sampling profiler, with the number of times it was
+ * seen. The offsets are in bytes from the start of the code, with pc[0] being
+ * the innermost frame
+ */
+struct trace_sample {
+	uint32_t count;			/* Number of samples */
+	uint32_t time_us;		/* Time attributed to this stack */
+	uint32_t depth;			/* Number of valid entries in pc[] */
+	uint32_t pc[TRACE_SAMPLE_DEPTH];	/* Code offset of each frame */
+};
+
 /**
  * Turn function tracing on and off
  *
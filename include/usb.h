@@ -14,6 +14,7 @@
 #include <stdbool.h>
 #include <fdtdec.h>
 #include <usb_defs.h>
+#include <linux/errno.h>
 #include <linux/usb/ch9.h>
 #include <asm/cache.h>
 #include <part.h>
@@ -190,6 +191,18 @@ int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 int submit_int_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 			int transfer_len, int interval, bool nonblock);
 
+#if CONFIG_IS_ENABLED(DM_USB)
+int submit_bulk_stream_msg(struct usb_device *dev, unsigned long pipe,
+			   uint stream_id, void *buffer, int transfer_len);
+#else
+static inline int submit_bulk_stream_msg(struct usb_device *dev,
+					 unsigned long pipe, uint stream_id,
+					 void *buffer, int transfer_len)
+{
+	return -ENOSYS;
+}
+#endif
+
 #if defined CONFIG_USB_EHCI_HCD || defined CONFIG_USB_MUSB_HOST \
 	|| CONFIG_IS_ENABLED(DM_USB)
 struct int_queue *create_int_queue(struct usb_device *dev, unsigned long pipe,
@@ -278,6 +291,27 @@ int usb_control_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, unsigned short size, int timeout);
 int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, int len, int *actual_length, int timeout);
+
+/**
+ * usb_bulk_stream_msg() - Send a bulk message on a stream and wait for it
+ *
+ * This is the same as usb_bulk_msg() except that the transfer is queued on
+ * the given stream of the endpoint, which must have been set up with
+ * usb_alloc_streams()
+ *
+ * @dev: USB device
+ * @pipe: Bulk pipe to use
+ * @stream_id: Stream to use (1 = first), or 0 for an ordinary transfer
+ * @data: Data buffer
+ * @len: Number of bytes to transfer
+ * @actual_length: Returns the number of bytes transferred
+ * @timeout: Timeout in milliseconds
+ * Return: 0 if OK, -ENOSYS if the controller does not support streams, other
+ *	-ve on error
+ */
+int usb_bulk_stream_msg(struct usb_device *dev, unsigned int pipe,
+			uint stream_id, void *data, int len,
+			int *actual_length, int timeout);
 int usb_int_msg(struct usb_device *dev, unsigned long pipe,
 		void *buffer, int transfer_len, int interval, bool nonblock);
 int usb_lock_async(struct usb_device *dev, int lock);
@@ -813,6 +847,34 @@ struct dm_usb_ops {
 	 * driver to do just that.
 	 */
 	int (*lock_async)(struct udevice *udev, int lock);
+
+	/**
+	 * alloc_streams() - Set up bulk streams on endpoints (XHCI)
+	 *
+	 * USB 3.0 bulk endpoints can carry several independent streams of
+	 * transfers, selected by a stream ID. This sets up the same number
+	 * of streams on each of the given endpoints.
+	 *
+	 * @pipes: Bulk pipes for the endpoints to set up
+	 * @num_pipes: Number of entries in @pipes
+	 * @num_streams: Number of streams wanted on each endpoint
+	 * @return number of streams set up (stream IDs 1 to this number can
+	 *	be used), or -ve on error
+	 */
+	int (*alloc_streams)(struct udevice *bus, struct usb_device *udev,
+			     const unsigned long *pipes, int num_pipes,
+			     uint num_streams);
+
+	/**
+	 * bulk_stream() - Send a bulk message on a stream
+	 *
+	 * Parameters are as above.
+	 *
+	 * @stream_id: Stream to use, as set up by alloc_streams()
+	 */
+	int (*bulk_stream)(struct udevice *bus, struct usb_device *udev,
+			   unsigned long pipe, uint stream_id, void *buffer,
+			   int length);
 };
 
 #define usb_get_ops(dev)	((struct dm_usb_ops *)(dev)->driver->ops)
@@ -1002,6 +1064,23 @@ int usb_update_hub_device(struct usb_device *dev);
  */
 int usb_get_max_xfer_size(struct usb_device *dev, size_t *size);
 
+/**
+ * usb_alloc_streams() - Set up bulk streams on endpoints
+ *
+ * Sets up the same number of streams on each of the given bulk endpoints, so
+ * that transfers can be sent on them with usb_bulk_stream_msg(). Streams are
+ * only available on USB 3.0 devices whose endpoints support them.
+ *
+ * @dev:		USB device
+ * @pipes:		Bulk pipes for the endpoints to set up
+ * @num_pipes:		Number of entries in @pipes
+ * @num_streams:	Number of streams wanted on each endpoint
+ * Return: number of streams set up, which may be fewer than requested;
+ *	-ENOSYS if the controller does not support streams, other -ve on error
+ */
+int usb_alloc_streams(struct usb_device *dev, const unsigned long *pipes,
+		      int num_pipes, uint num_streams);
+
 /**
  * usb_emul_setup_device() - Set up a new USB device emulation
  *
@@ -1057,8 +1057,32 @@ struct xhci_scratchpad {
 #define XHCI_STOP_EP_CMD_TIMEOUT	5
 /* XXX: Make these module parameters */
 
+/**
+ * struct xhci_stream_ctx - Stream Context, section 6.2.4.1
+ *
+ * @stream_ring: Dequeue pointer of the stream's ring, with the stream
+ *	context type in bits 3:1 and the dequeue cycle state in bit 0
+ */
+struct xhci_stream_ctx {
+	__le64	stream_ring;
+	/* offset 0x8 - 0xf reserved for HC internal use */
+	__le32	reserved[2];
+};
+
+/* Stream Context Types - section 6.4.1 */
+#define SCT_FOR_CTX(p)		(((p) & 0x7) << 1)
+/* Primary stream array, transfer ring */
+#define SCT_PRI_TR		1
+
 struct xhci_virt_ep {
 	struct xhci_ring		*ring;
+	/* Linear stream array, NULL if the endpoint has no streams */
+	struct xhci_stream_ctx		*stream_ctx;
+	dma_addr_t			stream_ctx_dma;
+	/* Ring for each stream, indexed by stream ID (0 is unused) */
+	struct xhci_ring		**stream_rings;
+	/* Number of stream contexts, including the reserved stream 0 */
+	unsigned int			num_streams;
 	unsigned int			ep_state;
 #define SET_DEQ_PENDING		(1 << 0)
 #define EP_HALTED		(1 << 1)	/* For stall handling */
@@ -1258,7 +1282,7 @@ void xhci_queue_command(struct xhci_ctrl *ctrl, dma_addr_t addr,
 void xhci_acknowledge_event(struct xhci_ctrl *ctrl);
 union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected);
 int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-		 int length, void *buffer);
+		 unsigned int stream_id, int length, void *buffer);
 int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 		 struct devrequest *req, int length, void *buffer);
 int xhci_check_maxpacket(struct usb_device *udev);
@@ -1268,6 +1292,9 @@ void xhci_cleanup(struct xhci_ctrl *ctrl);
 struct xhci_ring *xhci_ring_alloc(struct xhci_ctrl *ctrl, unsigned int num_segs,
 				  bool link_trbs);
 int xhci_alloc_virt_device(struct xhci_ctrl *ctrl, unsigned int slot_id);
+int xhci_alloc_stream_ctx(struct xhci_ctrl *ctrl, struct xhci_virt_ep *ep,
+			  unsigned int num_streams);
+void xhci_free_stream_ctx(struct xhci_ctrl *ctrl, struct xhci_virt_ep *ep);
 int xhci_mem_init(struct xhci_ctrl *ctrl, struct xhci_hccr *hccr,
 		  struct xhci_hcor *hcor);
 
@@ -43,6 +43,30 @@
  */
 #define VIRTIO_RING_F_EVENT_IDX		29
 
+/*
+ * Mark a descriptor as available or used in packed ring.
+ * Notice: they are defined as shifts instead of shifted values.
+ */
+#define VRING_PACKED_DESC_F_AVAIL	7
+#define VRING_PACKED_DESC_F_USED	15
+
+/* Enable events in packed ring */
+#define VRING_PACKED_EVENT_FLAG_ENABLE	0x0
+/* Disable events in packed ring */
+#define VRING_PACKED_EVENT_FLAG_DISABLE	0x1
+/*
+ * Enable events for a specific descriptor in packed ring.
+ * (as specified by Descriptor Ring Change Event Offset/Wrap Counter).
+ * Only valid if VIRTIO_RING_F_EVENT_IDX has been negotiated.
+ */
+#define VRING_PACKED_EVENT_FLAG_DESC	0x2
+
+/*
+ * Wrap counter bit shift in event suppression structure
+ * of packed ring.
+ */
+#define VRING_PACKED_EVENT_F_WRAP_CTR	15
+
 /* Virtio ring descriptors: 16 bytes. These can chain together via "next". */
 struct vring_desc {
 	/* Address (guest-physical) */
@@ -63,6 +87,32 @@ struct vring_desc_shadow {
 	u16 next;
 	/* Metadata about the descriptor. */
 	bool chain_head;
+	/* Number of ring descriptors used by the chain (packed ring) */
+	u16 num;
+	/* Buffer to return from virtqueue_get_buf() for a chain head */
+	void *data;
+	/* Indirect descriptor table used by the chain, or NULL */
+	void *indir;
+};
+
+/* Packed ring descriptor: 16 bytes, always little-endian */
+struct vring_packed_desc {
+	/* Buffer Address */
+	__le64 addr;
+	/* Buffer Length */
+	__le32 len;
+	/* Buffer ID */
+	__le16 id;
+	/* The flags depending on descriptor type */
+	__le16 flags;
+};
+
+/* Packed ring event suppression structure */
+struct vring_packed_desc_event {
+	/* Descriptor Ring Change Event Offset/Wrap Counter */
+	__le16 off_wrap;
+	/* Descriptor Ring Change Event Flags */
+	__le16 flags;
 };
 
 struct vring_avail {
@@ -93,6 +143,19 @@ struct vring {
 	struct vring_used *used;
 };
 
+/**
+ * struct vring_packed - memory layout of a packed virtqueue
+ *
+ * @desc: descriptor ring, shared by driver and device
+ * @driver: driver event suppression area
+ * @device: device event suppression area
+ */
+struct vring_packed {
+	struct vring_packed_desc *desc;
+	struct vring_packed_desc_event *driver;
+	struct vring_packed_desc_event *device;
+};
+
 /**
  * virtqueue - a queue to register buffers for sending or receiving.
  *
@@ -100,14 +163,25 @@ struct vring {
  * @vdev: the virtio device this queue was created for
  * @index: the zero-based ordinal number for this queue
  * @num_free: number of elements we expect to be able to fit
- * @vring: actual memory layout for this queue
- * @vring_desc_shadow: guest-only copy of descriptors
+ * @vring: actual memory layout for this queue (for a packed queue only
+ *	@num and @size are used)
+ * @packed_ring: memory layout for a packed queue
+ * @vring_desc_shadow: guest-only copy of descriptors. For a packed queue this
+ *	is indexed by buffer ID instead
  * @event: host publishes avail event idx
- * @free_head: head of free buffer list
- * @num_added: number we've added since last sync
- * @last_used_idx: last used index we've seen
+ * @packed: this is a packed queue (VIRTIO_F_RING_PACKED)
+ * @indirect: chains may be placed in an indirect descriptor table
+ * @avail_wrap_counter: packed queue: wrap counter for the next descriptor
+ *	to make available
+ * @used_wrap_counter: packed queue: wrap counter for @last_used_idx
+ * @free_head: head of free buffer list (for a packed queue, of free IDs)
+ * @num_added: number we've added since last sync (for a packed queue, in
+ *	descriptors)
+ * @last_used_idx: last used index we've seen (for a packed queue, the
+ *	position in the descriptor ring)
  * @avail_flags_shadow: last written value to avail->flags
  * @avail_idx_shadow: last written value to avail->idx in guest byte order
+ *	(for a packed queue, the next position in the descriptor ring)
  */
 struct virtqueue {
 	struct list_head list;
@@ -115,8 +189,13 @@ struct virtqueue {
 	unsigned int index;
 	unsigned int num_free;
 	struct vring vring;
+	struct vring_packed packed_ring;
 	struct vring_desc_shadow *vring_desc_shadow;
 	bool event;
+	bool packed;
+	bool indirect;
+	bool avail_wrap_counter;
+	bool used_wrap_counter;
 	unsigned int free_head;
 	unsigned int num_added;
 	u16 last_used_idx;
@@ -159,6 +238,13 @@ static inline void vring_init(struct vring *vr, unsigned int num, void *p,
 		   sizeof(__virtio16) + align - 1) & ~(align - 1));
 }
 
+/* Size of a packed virtqueue: descriptors then the two event areas */
+static inline unsigned int vring_packed_size(unsigned int num)
+{
+	return sizeof(struct vring_packed_desc) * num +
+		sizeof(struct vring_packed_desc_event) * 2;
+}
+
 /*
  * The following is used with USED_EVENT_IDX and AVAIL_EVENT_IDX.
  * Assuming a given event_idx value from the other side, if we have just
@@ -34,7 +34,8 @@
  * remainder lookup tables.
  *
  * The final stage of decoding involves the following internal steps:
- * a. Syndrome computation
+ * a. Syndrome computation, 4 ecc bits at a time using lookup tables when
+ *    these are small enough
  * b. Error locator polynomial computation using Berlekamp-Massey algorithm
  * c. Error locator root finding (by far the most expensive step)
  *
@@ -104,6 +105,9 @@
 #define BCH_ECC_WORDS(_p)      DIV_ROUND_UP(GF_M(_p)*GF_T(_p), 32)
 #define BCH_ECC_BYTES(_p)      DIV_ROUND_UP(GF_M(_p)*GF_T(_p), 8)
 
+/* largest syndrome lookup table size in bytes, above this no table is used */
+#define BCH_SYN_TAB_MAX        (64*1024)
+
 #ifndef dbg
 #define dbg(_fmt, args...)     do {} while (0)
 #endif
@@ -399,18 +403,37 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 		ecc[s/32] &= ~((1u << (32-m))-1);
 	memset(syn, 0, 2*t*sizeof(*syn));
 
-	/* compute v(a^j) for j=1 .. 2t-1 */
-	do {
-		poly = *ecc++;
-		s -= 32;
-		while (poly) {
-			i = deg(poly);
-			for (j = 0; j < 2*t; j += 2)
-				syn[j] ^= a_pow(bch, (j+1)*(i+s));
+	if (bch->syn_tab) {
+		/* add up the contributions of each nonzero nibble */
+		const uint16_t *tab = bch->syn_tab;
 
-			poly ^= (1 << i);
-		}
-	} while (s > 0);
+		do {
+			poly = *ecc++;
+			s -= 32;
+			for (i = 28; poly; i -= 4, poly <<= 4) {
+				const uint16_t *v = tab+((28-i)/4*16+
+							 (poly >> 28))*t;
+
+				if (poly >> 28)
+					for (j = 0; j < t; j++)
+						syn[2*j] ^= v[j];
+			}
+			tab += 8*16*t;
+		} while (s > 0);
+	} else {
+		/* compute v(a^j) for j=1 .. 2t-1 */
+		do {
+			poly = *ecc++;
+			s -= 32;
+			while (poly) {
+				i = deg(poly);
+				for (j = 0; j < 2*t; j += 2)
+					syn[j] ^= a_pow(bch, (j+1)*(i+s));
+
+				poly ^= (1 << i);
+			}
+		} while (s > 0);
+	}
 
 	/* v(a^(2j)) = v(a^j)^2 */
 	for (j = 0; j < t; j++)
@@ -1060,14 +1083,14 @@ int decode_bch(struct bch_control *bch, const uint8_t *data, unsigned int len,
 		if (recv_ecc) {
 			load_ecc8(bch, bch->ecc_buf2, recv_ecc);
 			/* XOR received and calculated ecc */
-			for (i = 0, sum = 0; i < (int)ecc_words; i++) {
+			for (i = 0; i < (int)ecc_words; i++)
 				bch->ecc_buf[i] ^= bch->ecc_buf2[i];
-				sum |= bch->ecc_buf[i];
-			}
-			if (!sum)
-				/* no error found */
-				return 0;
 		}
+		for (i = 0, sum = 0; i < (int)ecc_words; i++)
+			sum |= bch->ecc_buf[i];
+		if (!sum)
+			/* no error found */
+			return 0;
 		compute_syndromes(bch, bch->ecc_buf, bch->syn);
 		syn = bch->syn;
 	}
@@ -1155,6 +1178,38 @@ static void build_mod8_tables(struct bch_control *bch, const uint32_t *g)
 	}
 }
 
+/*
+ * compute odd syndrome lookup tables for fast syndrome computation
+ *
+ * For each nibble of the ecc words and each of its 16 values, the table holds
+ * the t values v(a^j), j=1,3,..,2t-1, where v(X) is the polynomial with just
+ * the bits of that nibble set.
+ */
+static void build_syn_tables(struct bch_control *bch)
+{
+	const int t = GF_T(bch);
+	const int nibbles = 8*DIV_ROUND_UP(bch->ecc_bits, 32);
+	int i, j, b, v, e;
+	uint16_t *tab;
+
+	for (i = 0; i < nibbles; i++) {
+		/* degree of the least significant bit in this nibble */
+		e = bch->ecc_bits-32*(i/8+1)+28-4*(i%8);
+		tab = bch->syn_tab+i*16*t;
+		memset(tab, 0, t*sizeof(*tab));
+		for (v = 1; v < 16; v++) {
+			/* add the highest bit of v to the entry for the rest */
+			b = deg(v);
+			for (j = 0; j < t; j++) {
+				tab[v*t+j] = tab[(v ^ (1 << b))*t+j];
+				/* padding bits in the last word are always 0 */
+				if (e+b >= 0)
+					tab[v*t+j] ^= a_pow(bch, (2*j+1)*(e+b));
+			}
+		}
+	}
+}
+
 /*
  * build a base for factoring degree 2 polynomials
  */
@@ -1298,6 +1353,7 @@ struct bch_control *init_bch(int m, int t, unsigned int prim_poly)
 {
 	int err = 0;
 	unsigned int i, words;
+	size_t size;
 	uint32_t *genpoly;
 	struct bch_control *bch = NULL;
 
@@ -1372,6 +1428,14 @@ struct bch_control *init_bch(int m, int t, unsigned int prim_poly)
 	build_mod8_tables(bch, genpoly);
 	kfree(genpoly);
 
+	/* syndrome tables are optional, only use them if they are small */
+	size = 8*DIV_ROUND_UP(bch->ecc_bits, 32)*16*t*sizeof(*bch->syn_tab);
+	if (size <= BCH_SYN_TAB_MAX) {
+		bch->syn_tab = kmalloc(size, GFP_KERNEL);
+		if (bch->syn_tab)
+			build_syn_tables(bch);
+	}
+
 	err = build_deg2_base(bch);
 	if (err)
 		goto fail;
@@ -1395,6 +1459,7 @@ void free_bch(struct bch_control *bch)
 		kfree(bch->a_pow_tab);
 		kfree(bch->a_log_tab);
 		kfree(bch->mod8_tab);
+		kfree(bch->syn_tab);
 		kfree(bch->ecc_buf);
 		kfree(bch->ecc_buf2);
 		kfree(bch->xi_tab);
@@ -7,6 +7,7 @@
 
 #include <common.h>
 #include <bootm.h>
+#include <bootstage.h>
 #include <div64.h>
 #include <dm/device.h>
 #include <dm/root.h>
@@ -2208,6 +2209,11 @@ static efi_status_t EFIAPI efi_exit_boot_services(efi_handle_t image_handle,
 	/* Stop all timer related activities */
 	timers_enabled = false;
 
+	/* The payload may not boot through bootm, so pass on the timing here */
+	if (IS_ENABLED(CONFIG_BOOTSTAGE_TRACE_BLOBLIST) &&
+	    bootstage_trace_bloblist())
+		log_warning("bootstage: Failed to add trace to bloblist\n");
+
 	/* Add related events to the event group */
 	list_for_each_entry(evt, &efi_events, link) {
 		if (evt->type == EVT_SIGNAL_EXIT_BOOT_SERVICES)
@@ -2239,6 +2245,7 @@ static efi_status_t EFIAPI efi_exit_boot_services(efi_handle_t image_handle,
 		bootm_disable_interrupts();
 		if (IS_ENABLED(CONFIG_USB_DEVICE))
 			udc_disconnect();
+		dm_probe_wait_all();
 		board_quiesce_devices();
 		dm_remove_devices_flags(DM_REMOVE_ACTIVE_ALL);
 	}
@@ -27,6 +27,7 @@
 #include <serial.h>
 #include <asm/global_data.h>
 #include <asm/sections.h>
+#include <dm/fdt_index.h>
 #include <dm/ofnode.h>
 #include <dm/of_extra.h>
 #include <linux/ctype.h>
@@ -632,6 +633,90 @@ int fdtdec_check_fdt(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+/* Largest phandle for which a cache is built, to bound the memory used */
+#define PHANDLE_CACHE_MAX	0x10000
+
+/**
+ * struct phandle_cache - node offsets in the control FDT, indexed by phandle
+ *
+ * The flat tree can be changed at any time, moving its nodes around, so
+ * entries are checked before use and the cache is rebuilt if they are stale
+ *
+ * @fdt: Tree the cache belongs to, NULL if none
+ * @offsets: Offset of the node for each phandle plus one, 0 if none
+ * @max: Largest phandle in the cache
+ */
+static struct phandle_cache {
+	const void *fdt;
+	int *offsets;
+	uint max;
+} phandle_cache;
+
+static int phandle_cache_build(const void *fdt)
+{
+	uint32_t max, phandle;
+	int *offsets;
+	int ofs;
+
+	phandle_cache.fdt = NULL;
+	if (fdt_find_max_phandle(fdt, &max) || max > PHANDLE_CACHE_MAX)
+		return -E2BIG;
+	if (max > phandle_cache.max || !phandle_cache.offsets) {
+		offsets = realloc(phandle_cache.offsets,
+				  (max + 1) * sizeof(*offsets));
+		if (!offsets)
+			return -ENOMEM;
+		phandle_cache.offsets = offsets;
+	}
+	offsets = phandle_cache.offsets;
+	memset(offsets, '\0', (max + 1) * sizeof(*offsets));
+	for (ofs = fdt_next_node(fdt, -1, NULL); ofs >= 0;
+	     ofs = fdt_next_node(fdt, ofs, NULL)) {
+		phandle = fdt_get_phandle(fdt, ofs);
+		if (phandle && phandle <= max && !offsets[phandle])
+			offsets[phandle] = ofs + 1;
+	}
+	phandle_cache.fdt = fdt;
+	phandle_cache.max = max;
+
+	return 0;
+}
+
+int fdtdec_node_offset_by_phandle(const void *fdt, uint phandle)
+{
+	int ofs;
+
+	/*
+	 * Before relocation there is little memory to spare and the tree may
+	 * still move, so only cache the control FDT after that
+	 */
+	if (!(gd->flags & GD_FLG_RELOC) || fdt != gd->fdt_blob ||
+	    !phandle || phandle == (uint)-1)
+		return fdt_index_node_offset_by_phandle(fdt, phandle);
+
+	if (phandle_cache.fdt != fdt && phandle_cache_build(fdt))
+		return fdt_node_offset_by_phandle(fdt, phandle);
+	if (phandle <= phandle_cache.max) {
+		ofs = phandle_cache.offsets[phandle] - 1;
+		if (ofs >= 0 && fdt_get_phandle(fdt, ofs) == phandle)
+			return ofs;
+	}
+
+	/* the tree may have changed, so search it and rebuild if needed */
+	ofs = fdt_node_offset_by_phandle(fdt, phandle);
+	if (ofs >= 0)
+		phandle_cache.fdt = NULL;
+
+	return ofs;
+}
+#else
+int fdtdec_node_offset_by_phandle(const void *fdt, uint phandle)
+{
+	return fdt_index_node_offset_by_phandle(fdt, phandle);
+}
+#endif
+
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 {
 	const u32 *phandle;
@@ -642,7 +727,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -773,8 +858,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (node < 0) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -1496,7 +1581,7 @@ int fdtdec_get_carveout(const void *blob, const char *node,
 
 	phandle = fdt32_to_cpu(prop[index]);
 
-	offset = fdt_node_offset_by_phandle(blob, phandle);
+	offset = fdtdec_node_offset_by_phandle(blob, phandle);
 	if (offset < 0) {
 		debug("failed to find node for phandle %u\n", phandle);
 		return offset;
@@ -1700,6 +1785,9 @@ int fdtdec_setup(void)
 	if (!ret)
 		ret = fdtdec_board_setup(gd->fdt_blob);
 	oftree_reset();
+	/* lookups still work without the index, so just carry on */
+	if (!ret)
+		fdt_index_build(gd->fdt_blob);
 
 	return ret;
 }
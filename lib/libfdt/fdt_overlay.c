@@ -1,2 +1,16 @@
 #include <linux/libfdt_env.h>
 #include "../../scripts/dtc/libfdt/fdt_overlay.c"
+
+/* U-Boot addition, for code which merges overlays itself */
+int fdt_overlay_prepare(void *fdto, uint32_t delta)
+{
+	int ret;
+
+	FDT_RO_PROBE(fdto);
+
+	ret = overlay_adjust_local_phandles(fdto, delta);
+	if (ret)
+		return ret;
+
+	return overlay_update_local_references(fdto, delta);
+}
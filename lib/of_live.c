@@ -8,11 +8,14 @@
  * Copyright (c) 2017 Google, Inc
  */
 
+#include <abuf.h>
 #include <common.h>
+#include <fdtdec.h>
 #include <log.h>
 #include <linux/libfdt.h>
 #include <of_live.h>
 #include <malloc.h>
+#include <asm/global_data.h>
 #include <dm/of_access.h>
 #include <linux/err.h>
 
@@ -311,12 +314,298 @@ int unflatten_device_tree(const void *blob, struct device_node **mynodes)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+/**
+ * struct lazy_root - root of a lazily unflattened tree
+ *
+ * @fdt: Flat tree the nodes are created from
+ * @stats: Statistics for the tree
+ * @np: Root node, which must be last since its properties follow it
+ */
+struct lazy_root {
+	const void *fdt;
+	struct of_live_stats stats;
+	struct device_node np;
+};
+
+static struct lazy_root *lazy_root_of(const struct device_node *np)
+{
+	while (np->parent)
+		np = np->parent;
+	if (!(np->flags & OF_NODE_LAZY_ROOT))
+		return NULL;
+
+	return container_of(np, struct lazy_root, np);
+}
+
+/**
+ * lazy_new_node() - Create a node and its properties from the flat tree
+ *
+ * Property names and values point into the flat tree, as with
+ * unflatten_device_tree(). The node, its properties and its full name are
+ * allocated together.
+ *
+ * @fdt: Flat tree
+ * @offset: Offset of the node to create
+ * @dad: Parent node, or NULL to create a root node
+ * @hdr: Number of bytes to allocate before the node
+ * @sizep: Returns the number of bytes allocated
+ * Return: new node, or NULL if out of memory or the node is invalid
+ */
+static struct device_node *lazy_new_node(const void *fdt, int offset,
+					 struct device_node *dad, int hdr,
+					 int *sizep)
+{
+	struct property *pp, **prev_pp;
+	struct device_node *np;
+	const char *name, *pname;
+	int ofs, dad_len, sz, nprops = 0;
+	const void *val;
+	char *fn;
+	void *mem;
+
+	name = fdt_get_name(fdt, offset, NULL);
+	if (!name)
+		return NULL;
+	if (!dad)
+		name = "";
+	fdt_for_each_property_offset(ofs, fdt, offset)
+		nprops++;
+
+	/* the full name is the parent's, a '/' and the node name */
+	dad_len = dad && dad->parent ? strlen(dad->full_name) : 0;
+	*sizep = hdr + sizeof(*np) + nprops * sizeof(*pp) + dad_len + 1 +
+		strlen(name) + 1;
+	mem = calloc(1, *sizep);
+	if (!mem)
+		return NULL;
+	np = mem + hdr;
+	pp = (struct property *)(np + 1);
+	fn = (char *)(pp + nprops);
+	np->full_name = fn;
+	if (dad_len) {
+		strcpy(fn, dad->full_name);
+		fn += dad_len;
+	}
+	*fn++ = '/';
+	strcpy(fn, name);
+
+	prev_pp = &np->properties;
+	fdt_for_each_property_offset(ofs, fdt, offset) {
+		val = fdt_getprop_by_offset(fdt, ofs, &pname, &sz);
+		if (!val || !pname)
+			break;
+		if (!strcmp(pname, "phandle") ||
+		    !strcmp(pname, "linux,phandle")) {
+			if (!np->phandle)
+				np->phandle = be32_to_cpup(val);
+		}
+		if (!strcmp(pname, "ibm,phandle"))
+			np->phandle = be32_to_cpup(val);
+		pp->name = (char *)pname;
+		pp->length = sz;
+		pp->value = (void *)val;
+		*prev_pp = pp;
+		prev_pp = &pp->next;
+		pp++;
+	}
+	np->name = name;
+	np->type = of_get_property(np, "device_type", NULL);
+	if (!np->type)
+		np->type = "<NULL>";
+	np->parent = dad;
+	np->offset = offset;
+	np->flags = OF_NODE_FDT;
+	if (fdt_first_subnode(fdt, offset) >= 0)
+		np->flags |= OF_NODE_UNEXPANDED;
+
+	return np;
+}
+
+int of_live_expand(struct device_node *np)
+{
+	struct device_node *child, *next, **prevp = &np->child;
+	struct lazy_root *lr = lazy_root_of(np);
+	int ofs, size, nodes = 0;
+	ulong total = 0;
+	const void *fdt;
+
+	if (!lr || !(np->flags & OF_NODE_UNEXPANDED))
+		return 0;
+	fdt = lr->fdt;
+	fdt_for_each_subnode(ofs, fdt, np->offset) {
+		child = lazy_new_node(fdt, ofs, np, 0, &size);
+		if (!child) {
+			log_err("Cannot expand node '%s'\n", np->full_name);
+			goto err;
+		}
+		*prevp = child;
+		prevp = &child->sibling;
+		nodes++;
+		total += size;
+	}
+	np->flags &= ~OF_NODE_UNEXPANDED;
+	lr->stats.nodes += nodes;
+	lr->stats.size += total;
+
+	return 0;
+
+err:
+	/* leave the node unexpanded, so that it can be tried again */
+	for (child = np->child; child; child = next) {
+		next = child->sibling;
+		free(child);
+	}
+	np->child = NULL;
+
+	return -ENOMEM;
+}
+
+struct device_node *of_live_node_by_offset(struct device_node *root,
+					   int offset)
+{
+	struct device_node *np = root, *child, *best;
+
+	while (np && np->offset != offset) {
+		best = NULL;
+		for (child = of_node_child(np); child; child = child->sibling) {
+			if (!(child->flags & OF_NODE_FDT))
+				continue;
+			if (child->offset > offset)
+				break;
+			best = child;
+		}
+		np = best;
+	}
+
+	return np;
+}
+
+struct device_node *of_live_find_phandle(struct device_node *root,
+					 u32 handle)
+{
+	struct lazy_root *lr = lazy_root_of(root);
+	int ofs;
+
+	/* nodes are created as needed, so look in the flat tree */
+	ofs = fdtdec_node_offset_by_phandle(lr->fdt, handle);
+	if (ofs < 0)
+		return NULL;
+
+	return of_live_node_by_offset(&lr->np, ofs);
+}
+
+bool of_live_is_lazy(const struct device_node *np)
+{
+	return np && lazy_root_of(np);
+}
+
+struct device_node *of_live_find(struct device_node *from,
+				 of_live_match_t match, const void *priv)
+{
+	struct device_node *np = from, *root;
+	struct lazy_root *lr;
+	int ofs, depth;
+
+	lr = lazy_root_of(from ? from : gd_of_root());
+	root = &lr->np;
+	if (!np) {
+		np = root;
+		if (match(NULL, 0, np, priv))
+			return np;
+	}
+
+	while (np) {
+		/* subnodes not created yet match the flat tree, so search it */
+		if (np->flags & OF_NODE_UNEXPANDED) {
+			depth = 0;
+			for (ofs = fdt_next_node(lr->fdt, np->offset, &depth);
+			     ofs >= 0 && depth > 0;
+			     ofs = fdt_next_node(lr->fdt, ofs, &depth)) {
+				if (match(lr->fdt, ofs, NULL, priv))
+					return of_live_node_by_offset(root,
+								      ofs);
+			}
+		} else if (np->child) {
+			np = np->child;
+			if (match(NULL, 0, np, priv))
+				return np;
+			continue;
+		}
+
+		/* move on to the next sibling, going up as needed */
+		while (np->parent && !np->sibling)
+			np = np->parent;
+		np = np->sibling;
+		if (np && match(NULL, 0, np, priv))
+			return np;
+	}
+
+	return NULL;
+}
+
+int of_live_get_stats(const struct device_node *root,
+		      struct of_live_stats *stats)
+{
+	struct lazy_root *lr = lazy_root_of(root);
+
+	if (!lr)
+		return -ENOENT;
+	*stats = lr->stats;
+
+	return 0;
+}
+
+int of_live_build_lazy(const void *fdt_blob, struct device_node **rootp)
+{
+	struct lazy_root *lr;
+	struct device_node *np;
+	int ofs, size;
+
+	if (fdt_check_header(fdt_blob))
+		return -EINVAL;
+	np = lazy_new_node(fdt_blob, 0, NULL, offsetof(struct lazy_root, np),
+			   &size);
+	if (!np)
+		return -ENOMEM;
+	np->flags |= OF_NODE_LAZY_ROOT;
+	lr = container_of(np, struct lazy_root, np);
+	lr->fdt = fdt_blob;
+	lr->stats.nodes = 1;
+	lr->stats.size = size;
+	for (ofs = 0; ofs >= 0; ofs = fdt_next_node(fdt_blob, ofs, NULL))
+		lr->stats.total_nodes++;
+	*rootp = np;
+
+	return 0;
+}
+
+/* Free the nodes created from the flat tree */
+static void lazy_free(struct device_node *np)
+{
+	struct device_node *child, *next;
+
+	for (child = np->child; child; child = next) {
+		next = child->sibling;
+		if (child->flags & OF_NODE_FDT)
+			lazy_free(child);
+	}
+	if (np->flags & OF_NODE_LAZY_ROOT)
+		free(container_of(np, struct lazy_root, np));
+	else
+		free(np);
+}
+#endif
+
 int of_live_build(const void *fdt_blob, struct device_node **rootp)
 {
 	int ret;
 
 	debug("%s: start\n", __func__);
-	ret = unflatten_device_tree(fdt_blob, rootp);
+	if (CONFIG_IS_ENABLED(OF_LIVE_LAZY))
+		ret = of_live_build_lazy(fdt_blob, rootp);
+	else
+		ret = unflatten_device_tree(fdt_blob, rootp);
 	if (ret) {
 		debug("Failed to create live tree: err=%d\n", ret);
 		return ret;
@@ -328,11 +617,181 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 	}
 	debug("%s: stop\n", __func__);
 
-	return ret;
+	return 0;
 }
 
 void of_live_free(struct device_node *root)
 {
+	of_phandle_table_free(root);
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	if (root && (root->flags & OF_NODE_LAZY_ROOT)) {
+		lazy_free(root);
+		return;
+	}
+#endif
 	/* the tree is stored as a contiguous block of memory */
 	free(root);
 }
+
+/**
+ * struct flatten_info - information used while flattening a tree
+ *
+ * libfdt's sequential-write functions search the whole strings block for each
+ * property name, which is slow with many different names, e.g. a large
+ * __symbols__ node, so the tree is written here with a hash table of names
+ *
+ * @fdt: Flat tree being written
+ * @pos: End of the structure block so far, as an offset into @fdt
+ * @strings: Strings block being written
+ * @strings_size: Size of the strings block so far
+ * @names: Hash table of the offset + 1 of each name in @strings, 0 if unused
+ * @mask: Number of entries in @names, minus one
+ */
+struct flatten_info {
+	void *fdt;
+	int pos;
+	char *strings;
+	int strings_size;
+	int *names;
+	uint mask;
+};
+
+/* Work out the space needed for a node and its subnodes in a flat tree */
+static void flatten_size(const struct device_node *np, int *structp,
+			 int *stringsp, int *propsp)
+{
+	const struct device_node *child;
+	const struct property *pp;
+
+	*structp += 2 * FDT_TAGSIZE + ALIGN(strlen(np->full_name) + 1,
+					   FDT_TAGSIZE);
+	for (pp = np->properties; pp; pp = pp->next) {
+		*structp += sizeof(struct fdt_property) +
+			ALIGN(pp->length, FDT_TAGSIZE);
+		*stringsp += strlen(pp->name) + 1;
+		(*propsp)++;
+	}
+	for (child = of_node_child(np); child; child = child->sibling)
+		flatten_size(child, structp, stringsp, propsp);
+}
+
+/* Add @len bytes to the structure block, padded with zeroes */
+static void *flatten_add(struct flatten_info *info, const void *data, int len)
+{
+	void *ptr = info->fdt + info->pos;
+	int size = ALIGN(len, FDT_TAGSIZE);
+
+	if (len)
+		memcpy(ptr, data, len);
+	memset(ptr + len, '\0', size - len);
+	info->pos += size;
+
+	return ptr;
+}
+
+static void flatten_tag(struct flatten_info *info, u32 tag)
+{
+	fdt32_t val = cpu_to_fdt32(tag);
+
+	flatten_add(info, &val, sizeof(val));
+}
+
+/* Get the offset of a name in the strings block, adding it if needed */
+static int flatten_string(struct flatten_info *info, const char *name)
+{
+	u32 hash = 0x811c9dc5;
+	const char *p;
+	uint i;
+	int len;
+
+	for (p = name; *p; p++)
+		hash = (hash ^ (u8)*p) * 0x01000193;
+	for (i = hash & info->mask; info->names[i]; i = (i + 1) & info->mask) {
+		if (!strcmp(info->strings + info->names[i] - 1, name))
+			return info->names[i] - 1;
+	}
+
+	len = p - name + 1;
+	memcpy(info->strings + info->strings_size, name, len);
+	info->names[i] = info->strings_size + 1;
+	info->strings_size += len;
+
+	return info->names[i] - 1;
+}
+
+static void flatten_node(struct flatten_info *info,
+			 const struct device_node *np)
+{
+	const struct device_node *child;
+	const struct property *pp;
+	const char *name;
+
+	/* the root node has an empty name */
+	name = np->parent ? strrchr(np->full_name, '/') + 1 : "";
+	flatten_tag(info, FDT_BEGIN_NODE);
+	flatten_add(info, name, strlen(name) + 1);
+	for (pp = np->properties; pp; pp = pp->next) {
+		struct fdt_property prop;
+
+		prop.tag = cpu_to_fdt32(FDT_PROP);
+		prop.len = cpu_to_fdt32(pp->length);
+		prop.nameoff = cpu_to_fdt32(flatten_string(info, pp->name));
+		flatten_add(info, &prop, sizeof(prop));
+		flatten_add(info, pp->value, pp->length);
+	}
+	for (child = of_node_child(np); child; child = child->sibling)
+		flatten_node(info, child);
+	flatten_tag(info, FDT_END_NODE);
+}
+
+int of_live_flatten(const struct device_node *root, struct abuf *buf)
+{
+	int struct_size = FDT_TAGSIZE, strings_size = 0, props = 0;
+	int off_rsvmap, off_struct, size;
+	struct flatten_info info;
+	void *fdt;
+
+	flatten_size(root, &struct_size, &strings_size, &props);
+	info.mask = 1;
+	while (info.mask < props * 2)
+		info.mask <<= 1;
+	info.names = calloc(info.mask, sizeof(*info.names));
+	if (!info.names)
+		return -ENOMEM;
+	info.mask--;
+
+	/* the header is padded to align the memory reservations */
+	off_rsvmap = ALIGN(sizeof(struct fdt_header), 8);
+	off_struct = off_rsvmap + sizeof(struct fdt_reserve_entry);
+	size = off_struct + struct_size + strings_size;
+	abuf_init(buf);
+	if (!abuf_realloc(buf, size)) {
+		free(info.names);
+		return -ENOMEM;
+	}
+	fdt = abuf_data(buf);
+	memset(fdt, '\0', off_struct);
+
+	/* write the strings after the largest possible structure block */
+	info.fdt = fdt;
+	info.pos = off_struct;
+	info.strings = fdt + off_struct + struct_size;
+	info.strings_size = 0;
+	flatten_node(&info, root);
+	flatten_tag(&info, FDT_END);
+	free(info.names);
+	memmove(fdt + info.pos, info.strings, info.strings_size);
+
+	fdt_set_magic(fdt, FDT_MAGIC);
+	fdt_set_version(fdt, FDT_LAST_SUPPORTED_VERSION);
+	fdt_set_last_comp_version(fdt, FDT_FIRST_SUPPORTED_VERSION);
+	fdt_set_off_mem_rsvmap(fdt, off_rsvmap);
+	fdt_set_off_dt_struct(fdt, off_struct);
+	fdt_set_size_dt_struct(fdt, info.pos - off_struct);
+	fdt_set_off_dt_strings(fdt, info.pos);
+	fdt_set_size_dt_strings(fdt, info.strings_size);
+	fdt_set_totalsize(fdt, info.pos + info.strings_size);
+	abuf_realloc(buf, fdt_totalsize(fdt));
+
+	return 0;
+}
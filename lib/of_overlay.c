@@ -0,0 +1,665 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Applying a stack of device-tree overlays in one pass
+ *
+ * fdt_overlay_apply() works on the flat tree, so each overlay searches the
+ * whole base tree for its largest phandle, for the target of each fragment
+ * and for the node of each symbol it refers to, and each property it merges
+ * moves the rest of the tree. Here the base tree is unflattened once and its
+ * phandles and symbols are put in hash tables, which are kept up to date as
+ * each overlay is merged, so that an overlay costs time in proportion to its
+ * own size. The tree is flattened again once all overlays are merged.
+ *
+ * The steps and results are the same as for fdt_overlay_apply().
+ */
+
+#define LOG_CATEGORY	LOGC_DT
+
+#include <common.h>
+#include <abuf.h>
+#include <log.h>
+#include <malloc.h>
+#include <of_live.h>
+#include <dm/of_access.h>
+#include <linux/libfdt.h>
+
+/**
+ * struct ov_entry - entry in a hash table
+ *
+ * @key: phandle, or hash of the symbol name
+ * @name: Symbol name, or NULL for a phandle
+ * @path: Path of the node for a symbol, NULL if @np is valid
+ * @np: Node for this entry, or NULL if not looked up yet
+ */
+struct ov_entry {
+	u32 key;
+	const char *name;
+	const char *path;
+	struct device_node *np;
+};
+
+/**
+ * struct ov_table - hash table using open addressing
+ *
+ * @entries: Entries in the table (@size of them)
+ * @size: Number of entries, a power of two, or 0 if none allocated yet
+ * @count: Number of entries in use
+ */
+struct ov_table {
+	struct ov_entry *entries;
+	uint size;
+	uint count;
+};
+
+/**
+ * struct ov_ctx - information about overlays being applied
+ *
+ * @root: Root of the live tree
+ * @symbols: /__symbols__ node, or NULL if none
+ * @aliases: /aliases node, or NULL if none
+ * @phandles: Nodes indexed by phandle
+ * @labels: Nodes indexed by symbol name
+ * @max_phandle: Largest phandle in the tree
+ * @allocs: Memory allocated while merging, freed with the tree
+ * @num_allocs: Number of pointers in @allocs
+ * @max_allocs: Number of pointers @allocs has space for
+ */
+struct ov_ctx {
+	struct device_node *root;
+	struct device_node *symbols;
+	struct device_node *aliases;
+	struct ov_table phandles;
+	struct ov_table labels;
+	u32 max_phandle;
+	void **allocs;
+	uint num_allocs;
+	uint max_allocs;
+};
+
+/* Smallest table to allocate */
+#define OV_TABLE_MIN	64
+
+/* FNV-1a hash of a string */
+static u32 ov_hash(const char *str)
+{
+	u32 hash = 0x811c9dc5;
+
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 0x01000193;
+
+	return hash;
+}
+
+static struct ov_entry *ov_slot(struct ov_table *tab, u32 key,
+				const char *name)
+{
+	uint mask = tab->size - 1;
+	struct ov_entry *ent;
+	uint i;
+
+	for (i = (key * 0x9e3779b1) & mask; ; i = (i + 1) & mask) {
+		ent = &tab->entries[i];
+		if (!ent->np && !ent->path)
+			return ent;
+		if (ent->key == key && (!name || !strcmp(ent->name, name)))
+			return ent;
+	}
+}
+
+static struct ov_entry *ov_find(struct ov_table *tab, u32 key,
+				const char *name)
+{
+	struct ov_entry *ent;
+
+	if (!tab->size)
+		return NULL;
+	ent = ov_slot(tab, key, name);
+
+	return ent->np || ent->path ? ent : NULL;
+}
+
+/**
+ * ov_add() - add or replace an entry in a hash table
+ *
+ * @tab: Table to update
+ * @key: phandle, or hash of @name
+ * @name: Symbol name, or NULL for a phandle
+ * @path: Path of the node for a symbol, or NULL if @np is provided
+ * @np: Node, or NULL if @path is provided
+ * @replace: true to replace any existing entry, false to keep it
+ * Return: 0 if OK, -FDT_ERR_NOSPACE if out of memory
+ */
+static int ov_add(struct ov_table *tab, u32 key, const char *name,
+		  const char *path, struct device_node *np, bool replace)
+{
+	struct ov_entry *ent;
+
+	if ((tab->count + 1) * 4 > tab->size * 3) {
+		struct ov_table new;
+		uint i;
+
+		new.size = max(tab->size * 2, (uint)OV_TABLE_MIN);
+		new.count = tab->count;
+		new.entries = calloc(new.size, sizeof(*new.entries));
+		if (!new.entries)
+			return -FDT_ERR_NOSPACE;
+		for (i = 0; i < tab->size; i++) {
+			ent = &tab->entries[i];
+			if (ent->np || ent->path)
+				*ov_slot(&new, ent->key, ent->name) = *ent;
+		}
+		free(tab->entries);
+		*tab = new;
+	}
+
+	ent = ov_slot(tab, key, name);
+	if (ent->np || ent->path) {
+		if (!replace)
+			return 0;
+	} else {
+		tab->count++;
+	}
+	ent->key = key;
+	ent->name = name;
+	ent->path = path;
+	ent->np = np;
+
+	return 0;
+}
+
+/* Record memory to be freed along with the tree */
+static int ov_track(struct ov_ctx *ctx, const void *ptr)
+{
+	if (ctx->num_allocs == ctx->max_allocs) {
+		uint max = max(ctx->max_allocs * 2, (uint)OV_TABLE_MIN);
+		void **allocs;
+
+		allocs = realloc(ctx->allocs, max * sizeof(*allocs));
+		if (!allocs)
+			return -FDT_ERR_NOSPACE;
+		ctx->allocs = allocs;
+		ctx->max_allocs = max;
+	}
+	ctx->allocs[ctx->num_allocs++] = (void *)ptr;
+
+	return 0;
+}
+
+/* Find a subnode the same way as fdt_subnode_offset_namelen() */
+static struct device_node *ov_find_child(struct device_node *np,
+					 const char *name, int len)
+{
+	struct device_node *child;
+
+	for (child = np->child; child; child = child->sibling) {
+		if (strncmp(child->name, name, len))
+			continue;
+		if (!child->name[len])
+			return child;
+		if (child->name[len] == '@' && !memchr(name, '@', len))
+			return child;
+	}
+
+	return NULL;
+}
+
+/* Find a node the same way as fdt_path_offset_namelen() */
+static struct device_node *ov_find_path(struct ov_ctx *ctx, const char *path,
+					int len)
+{
+	const char *end = path + len, *p = path, *q;
+	struct device_node *np = ctx->root;
+
+	if (*p != '/') {
+		struct property *pp;
+
+		if (!ctx->aliases)
+			return NULL;
+		q = memchr(p, '/', end - p) ?: end;
+		for (pp = ctx->aliases->properties; pp; pp = pp->next) {
+			if (!strncmp(pp->name, p, q - p) && !pp->name[q - p])
+				break;
+		}
+		if (!pp || !pp->length || *(char *)pp->value != '/')
+			return NULL;
+		np = ov_find_path(ctx, pp->value, strnlen(pp->value,
+							  pp->length));
+		p = q;
+	}
+
+	while (np && p < end) {
+		if (*p == '/') {
+			p++;
+			continue;
+		}
+		q = memchr(p, '/', end - p) ?: end;
+		np = ov_find_child(np, p, q - p);
+		p = q;
+	}
+
+	return np;
+}
+
+static struct device_node *ov_find_phandle(struct ov_ctx *ctx, u32 phandle)
+{
+	struct ov_entry *ent = ov_find(&ctx->phandles, phandle, NULL);
+
+	/* the node may have been given a different phandle since */
+	if (!ent || ent->np->phandle != phandle)
+		return NULL;
+
+	return ent->np;
+}
+
+static struct device_node *ov_find_symbol(struct ov_ctx *ctx,
+					  const char *label)
+{
+	struct ov_entry *ent = ov_find(&ctx->labels, ov_hash(label), label);
+
+	if (!ent)
+		return NULL;
+	if (!ent->np) {
+		ent->np = ov_find_path(ctx, ent->path, strlen(ent->path));
+		if (ent->np)
+			ent->path = NULL;
+	}
+
+	return ent->np;
+}
+
+static int ov_add_subnode(struct ov_ctx *ctx, struct device_node *parent,
+			  const char *name, int len, struct device_node **npp)
+{
+	struct device_node *np;
+
+	/* like fdt_add_subnode(), this may use a node with a unit address */
+	np = ov_find_child(parent, name, len);
+	if (!np) {
+		if (of_add_subnode(parent, name, len, &np))
+			return -FDT_ERR_NOSPACE;
+		if (ov_track(ctx, np) || ov_track(ctx, np->name) ||
+		    ov_track(ctx, np->full_name))
+			return -FDT_ERR_NOSPACE;
+	}
+	*npp = np;
+
+	return 0;
+}
+
+/**
+ * ov_write_prop() - set a property in the live tree
+ *
+ * The value is not copied, so must remain valid until the tree is flattened.
+ * A new or changed phandle is added to the phandle table.
+ *
+ * @ctx: Context
+ * @np: Node to update
+ * @name: Property name
+ * @value: Property value
+ * @len: Length of @value in bytes
+ * Return: 0 if OK, -FDT_ERR_NOSPACE if out of memory
+ */
+static int ov_write_prop(struct ov_ctx *ctx, struct device_node *np,
+			 const char *name, const void *value, int len)
+{
+	struct property *pp;
+	bool exists;
+	int ret;
+
+	exists = of_find_property(np, name, NULL);
+	if (of_write_prop(np, name, len, value))
+		return -FDT_ERR_NOSPACE;
+	if (!exists) {
+		for (pp = np->properties; pp->next; pp = pp->next)
+			;
+		ret = ov_track(ctx, pp) ?: ov_track(ctx, pp->name);
+		if (ret)
+			return ret;
+	}
+
+	/* fdt_get_phandle() prefers "phandle" to "linux,phandle" */
+	if (len == sizeof(fdt32_t) && (!strcmp(name, "phandle") ||
+	    (!strcmp(name, "linux,phandle") &&
+	     !of_find_property(np, "phandle", NULL)))) {
+		np->phandle = fdt32_to_cpu(*(fdt32_t *)value);
+		if (np->phandle && np->phandle != (u32)-1) {
+			ctx->max_phandle = max(ctx->max_phandle, np->phandle);
+			return ov_add(&ctx->phandles, np->phandle, NULL, NULL,
+				      np, true);
+		}
+	}
+
+	return 0;
+}
+
+static int ov_init(struct ov_ctx *ctx, struct device_node *root)
+{
+	struct device_node *np;
+	struct property *pp;
+	int ret;
+
+	memset(ctx, '\0', sizeof(*ctx));
+	ctx->root = root;
+	ctx->symbols = ov_find_child(root, "__symbols__", 11);
+	ctx->aliases = ov_find_child(root, "aliases", 7);
+
+	for (np = root; np; np = of_find_all_nodes(np)) {
+		if (!np->phandle || np->phandle == (u32)-1)
+			continue;
+		ctx->max_phandle = max(ctx->max_phandle, np->phandle);
+		ret = ov_add(&ctx->phandles, np->phandle, NULL, NULL, np,
+			     false);
+		if (ret)
+			return ret;
+	}
+
+	/* symbols are looked up when first used */
+	if (ctx->symbols) {
+		for (pp = ctx->symbols->properties; pp; pp = pp->next) {
+			if (!pp->length || ((char *)pp->value)[pp->length - 1])
+				continue;
+			ret = ov_add(&ctx->labels, ov_hash(pp->name), pp->name,
+				     pp->value, NULL, true);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void ov_uninit(struct ov_ctx *ctx)
+{
+	while (ctx->num_allocs)
+		free(ctx->allocs[--ctx->num_allocs]);
+	free(ctx->allocs);
+	free(ctx->phandles.entries);
+	free(ctx->labels.entries);
+}
+
+/* As overlay_get_target(), also returning the target path if used */
+static int ov_get_target(struct ov_ctx *ctx, const void *fdto, int fragment,
+			 struct device_node **npp, const char **pathp)
+{
+	const fdt32_t *val;
+	const char *path;
+	int len;
+
+	*pathp = NULL;
+	val = fdt_getprop(fdto, fragment, "target", &len);
+	if (val) {
+		if (len != sizeof(*val) || fdt32_to_cpu(*val) == (u32)-1)
+			return -FDT_ERR_BADPHANDLE;
+		*npp = ov_find_phandle(ctx, fdt32_to_cpu(*val));
+	} else {
+		path = fdt_getprop(fdto, fragment, "target-path", &len);
+		if (!path)
+			return len == -FDT_ERR_NOTFOUND ? -FDT_ERR_BADOVERLAY :
+				len;
+		*npp = ov_find_path(ctx, path, strnlen(path, len));
+		*pathp = path;
+	}
+
+	return *npp ? 0 : -FDT_ERR_NOTFOUND;
+}
+
+/* As overlay_fixup_phandle(), for a single __fixups__ property */
+static int ov_fixup_phandle(struct ov_ctx *ctx, void *fdto, int property)
+{
+	const char *value, *label;
+	struct device_node *np;
+	int len;
+
+	value = fdt_getprop_by_offset(fdto, property, &label, &len);
+	if (!value)
+		return len == -FDT_ERR_NOTFOUND ? -FDT_ERR_INTERNAL : len;
+
+	np = ov_find_symbol(ctx, label);
+	if (!np)
+		return -FDT_ERR_NOTFOUND;
+	if (!np->phandle)
+		return -FDT_ERR_NOTFOUND;
+
+	do {
+		const char *fixup = value, *fixup_end, *name, *sep;
+		int fixup_len, path_len, name_len, offset, ret;
+		fdt32_t phandle;
+		char *endptr;
+		uint poffset;
+
+		fixup_end = memchr(value, '\0', len);
+		if (!fixup_end)
+			return -FDT_ERR_BADOVERLAY;
+		fixup_len = fixup_end - fixup;
+		len -= fixup_len + 1;
+		value += fixup_len + 1;
+
+		/* each fixup is <path>:<property>:<offset> */
+		sep = memchr(fixup, ':', fixup_len);
+		if (!sep)
+			return -FDT_ERR_BADOVERLAY;
+		path_len = sep - fixup;
+		if (path_len == fixup_len - 1)
+			return -FDT_ERR_BADOVERLAY;
+		name = sep + 1;
+		sep = memchr(name, ':', fixup_end - name);
+		if (!sep)
+			return -FDT_ERR_BADOVERLAY;
+		name_len = sep - name;
+		if (!name_len)
+			return -FDT_ERR_BADOVERLAY;
+		poffset = simple_strtoul(sep + 1, &endptr, 10);
+		if (*endptr || endptr <= sep + 1)
+			return -FDT_ERR_BADOVERLAY;
+
+		offset = fdt_path_offset_namelen(fdto, fixup, path_len);
+		if (offset == -FDT_ERR_NOTFOUND)
+			return -FDT_ERR_BADOVERLAY;
+		if (offset < 0)
+			return offset;
+		phandle = cpu_to_fdt32(np->phandle);
+		ret = fdt_setprop_inplace_namelen_partial(fdto, offset, name,
+							  name_len, poffset,
+							  &phandle,
+							  sizeof(phandle));
+		if (ret)
+			return ret;
+	} while (len > 0);
+
+	return 0;
+}
+
+/* As overlay_apply_node(), merging an overlay node into a live node */
+static int ov_apply_node(struct ov_ctx *ctx, struct device_node *target,
+			 const void *fdto, int node)
+{
+	int property, subnode, ret;
+
+	fdt_for_each_property_offset(property, fdto, node) {
+		const char *name;
+		const void *prop;
+		int len;
+
+		prop = fdt_getprop_by_offset(fdto, property, &name, &len);
+		if (len == -FDT_ERR_NOTFOUND)
+			return -FDT_ERR_INTERNAL;
+		if (len < 0)
+			return len;
+		ret = ov_write_prop(ctx, target, name, prop, len);
+		if (ret)
+			return ret;
+	}
+
+	fdt_for_each_subnode(subnode, fdto, node) {
+		struct device_node *np;
+		const char *name;
+		int len;
+
+		name = fdt_get_name(fdto, subnode, &len);
+		ret = ov_add_subnode(ctx, target, name, len, &np);
+		if (!ret)
+			ret = ov_apply_node(ctx, np, fdto, subnode);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* As overlay_symbol_update(), also adding each symbol to the table */
+static int ov_symbol_update(struct ov_ctx *ctx, const void *fdto)
+{
+	static const char marker[] = "/__overlay__";
+	const int marker_len = sizeof(marker) - 1;
+	int ov_sym, prop, ret;
+
+	ov_sym = fdt_subnode_offset(fdto, 0, "__symbols__");
+	if (ov_sym < 0)
+		return 0;
+
+	if (!ctx->symbols) {
+		ret = ov_add_subnode(ctx, ctx->root, "__symbols__", 11,
+				     &ctx->symbols);
+		if (ret)
+			return ret;
+	}
+
+	fdt_for_each_property_offset(prop, fdto, ov_sym) {
+		const char *path, *name, *s, *rel, *target_path;
+		struct device_node *target;
+		int path_len, fragment;
+		char *buf;
+
+		path = fdt_getprop_by_offset(fdto, prop, &name, &path_len);
+		if (!path)
+			return path_len;
+		if (path_len < 1 || memchr(path, '\0', path_len) !=
+		    &path[path_len - 1])
+			return -FDT_ERR_BADVALUE;
+		if (*path != '/')
+			return -FDT_ERR_BADVALUE;
+
+		/* only /<fragment>/__overlay__[/<rel>] ends up in the tree */
+		s = strchr(path + 1, '/');
+		if (!s || strncmp(s, marker, marker_len))
+			continue;
+		if (s[marker_len] == '/')
+			rel = s + marker_len + 1;
+		else if (!s[marker_len])
+			rel = "";
+		else
+			continue;
+
+		fragment = fdt_subnode_offset_namelen(fdto, 0, path + 1,
+						      s - path - 1);
+		if (fragment < 0)
+			return -FDT_ERR_BADOVERLAY;
+		if (fdt_subnode_offset(fdto, fragment, "__overlay__") < 0)
+			return -FDT_ERR_BADOVERLAY;
+		ret = ov_get_target(ctx, fdto, fragment, &target,
+				    &target_path);
+		if (ret)
+			return ret;
+		if (!target_path)
+			target_path = target->full_name;
+
+		/* this matches fdt_overlay_apply(), e.g. "/" gives "/<rel>" */
+		buf = malloc(strlen(target_path) + 1 + strlen(rel) + 1);
+		if (!buf)
+			return -FDT_ERR_NOSPACE;
+		ret = ov_track(ctx, buf);
+		if (ret) {
+			free(buf);
+			return ret;
+		}
+		strcpy(buf, strcmp(target_path, "/") ? target_path : "");
+		strcat(buf, "/");
+		strcat(buf, rel);
+
+		ret = ov_write_prop(ctx, ctx->symbols, name, buf,
+				    strlen(buf) + 1);
+		if (!ret)
+			ret = ov_add(&ctx->labels, ov_hash(name), name, buf,
+				     NULL, true);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int ov_apply(struct ov_ctx *ctx, void *fdto)
+{
+	int fixups, property, fragment, ret;
+
+	ret = fdt_overlay_prepare(fdto, ctx->max_phandle);
+	if (ret)
+		return ret;
+
+	fixups = fdt_subnode_offset(fdto, 0, "__fixups__");
+	if (fixups >= 0) {
+		fdt_for_each_property_offset(property, fdto, fixups) {
+			ret = ov_fixup_phandle(ctx, fdto, property);
+			if (ret)
+				return ret;
+		}
+	} else if (fixups != -FDT_ERR_NOTFOUND) {
+		return fixups;
+	}
+
+	fdt_for_each_subnode(fragment, fdto, 0) {
+		struct device_node *target;
+		const char *path;
+		int overlay;
+
+		overlay = fdt_subnode_offset(fdto, fragment, "__overlay__");
+		if (overlay == -FDT_ERR_NOTFOUND)
+			continue;
+		if (overlay < 0)
+			return overlay;
+		ret = ov_get_target(ctx, fdto, fragment, &target, &path);
+		if (ret)
+			return ret;
+		ret = ov_apply_node(ctx, target, fdto, overlay);
+		if (ret)
+			return ret;
+	}
+
+	return ov_symbol_update(ctx, fdto);
+}
+
+int of_overlay_apply_stack(const void *fdt, void *const fdtos[], int count,
+			   struct abuf *buf)
+{
+	struct device_node *root;
+	struct ov_ctx ctx;
+	int ret, i;
+
+	ret = fdt_check_header(fdt);
+	if (ret)
+		return ret;
+	for (i = 0; i < count; i++) {
+		ret = fdt_check_header(fdtos[i]);
+		if (ret)
+			return ret;
+	}
+
+	if (unflatten_device_tree(fdt, &root))
+		return -FDT_ERR_BADSTRUCTURE;
+	ret = ov_init(&ctx, root);
+	for (i = 0; !ret && i < count; i++) {
+		ret = ov_apply(&ctx, fdtos[i]);
+		if (ret)
+			log_debug("Overlay %d failed (err=%d)\n", i, ret);
+	}
+	if (!ret && of_live_flatten(root, buf))
+		ret = -FDT_ERR_NOSPACE;
+	ov_uninit(&ctx);
+	free(root);
+
+	/* the overlays have been changed, as with fdt_overlay_apply() */
+	for (i = 0; i < count; i++)
+		fdt_set_magic(fdtos[i], ~0);
+
+	return ret;
+}
@@ -0,0 +1,372 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling profiler
+ *
+ * Function tracing (lib/trace.c) records every call, which needs a special
+ * build and slows U-Boot down considerably. Here the call stack is sampled
+ * instead: each time schedule() runs after the sample interval has passed, the
+ * time since the previous sample is attributed to the current call stack.
+ * Identical call stacks are merged in a hash table, so the memory needed
+ * depends only on the number of different stacks seen.
+ *
+ * U-Boot does not generally have a timer interrupt, so time spent in code which
+ * does not call schedule() is attributed to the stack at the next call. Such
+ * code is normally waiting for hardware (e.g. udelay(), console input or a
+ * slow transfer) so this still shows where the time goes.
+ */
+
+#include <common.h>
+#include <kallsyms.h>
+#include <malloc.h>
+#include <profile.h>
+#include <sort.h>
+#include <time.h>
+#include <trace.h>
+#include <asm/global_data.h>
+#include <linux/errno.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+enum {
+	/* Largest stack frame which is followed when finding the call chain */
+	PROFILE_MAX_FRAME	= SZ_64K,
+};
+
+/*
+ * Get the caller's frame pointer and the return address from a frame pointer.
+ * On RISC-V the frame pointer points just above the two saved values; on other
+ * architectures it points to a record holding them in the opposite order.
+ */
+#ifdef __riscv
+#define FRAME_NEXT(fp)	((ulong *)(fp)[-2])
+#define FRAME_RET(fp)	((fp)[-1])
+#else
+#define FRAME_NEXT(fp)	((ulong *)(fp)[0])
+#define FRAME_RET(fp)	((fp)[1])
+#endif
+
+/**
+ * struct profile_info - state of the profiler
+ *
+ * @enabled: true if samples are being taken
+ * @busy: true while a sample is being recorded, to avoid recursion
+ * @interval_us: Minimum time between samples in microseconds
+ * @last_us: Time of the last sample
+ * @samples: Number of samples recorded
+ * @dropped: Number of samples dropped since the table was full
+ * @time_us: Total time attributed to the recorded samples
+ * @stacks: Number of entries used in @table
+ * @max_stacks: Number of entries which can be used in @table, which is kept
+ *	below @size so that lookups stay short
+ * @size: Number of entries in @table, a power of two
+ * @table: Hash table of call stacks, with unused entries having a depth of 0
+ */
+struct profile_info {
+	bool enabled;
+	bool busy;
+	uint interval_us;
+	ulong last_us;
+	ulong samples;
+	ulong dropped;
+	ulong time_us;
+	uint stacks;
+	uint max_stacks;
+	uint size;
+	struct trace_sample *table;
+};
+
+/* This is used by schedule(), which may run before BSS is available */
+static struct profile_info *prof __section(".data");
+
+/**
+ * profile_backtrace() - Find the call stack for a sample
+ *
+ * The walk stops at the first frame which does not look valid, i.e. with a
+ * return address outside U-Boot or a frame pointer which does not move up the
+ * stack by a sensible amount
+ *
+ * @pc: Innermost code address
+ * @fp: Frame containing @pc as its return address, or NULL
+ * @pcs: Returns the offset of each code address, innermost first
+ * Return: number of entries in @pcs
+ */
+static int notrace profile_backtrace(void *pc, ulong *fp, uint32_t pcs[])
+{
+	ulong limit = gd->mon_len ? gd->mon_len : U32_MAX;
+	ulong offset = code_offset((ulong)pc);
+	int depth = 0;
+
+	while (offset < limit) {
+		ulong *next;
+
+		pcs[depth++] = offset;
+		if (!IS_ENABLED(CONFIG_PROFILE_CALLCHAIN) || !fp ||
+		    depth == TRACE_SAMPLE_DEPTH)
+			break;
+		next = FRAME_NEXT(fp);
+		if (next <= fp || (ulong)next - (ulong)fp > PROFILE_MAX_FRAME ||
+		    ((ulong)next & (sizeof(ulong) - 1)))
+			break;
+		fp = next;
+		offset = code_offset(FRAME_RET(fp));
+	}
+
+	return depth;
+}
+
+static uint notrace profile_hash(const uint32_t pcs[], int depth)
+{
+	uint hash = depth;
+	int i;
+
+	for (i = 0; i < depth; i++)
+		hash = (hash ^ pcs[i]) * 0x9e3779b1;
+
+	return hash;
+}
+
+/**
+ * profile_add() - Add a sample to the hash table
+ *
+ * @info: Profiler state
+ * @pcs: Call stack, innermost first
+ * @depth: Number of entries in @pcs, which must be at least 1
+ * @time_us: Time to attribute to the sample
+ */
+static void notrace profile_add(struct profile_info *info,
+				const uint32_t pcs[], int depth, ulong time_us)
+{
+	uint mask = info->size - 1;
+	uint pos = profile_hash(pcs, depth) & mask;
+	struct trace_sample *rec;
+
+	for (;; pos = (pos + 1) & mask) {
+		rec = &info->table[pos];
+		if (!rec->depth)
+			break;
+		if (rec->depth == depth &&
+		    !memcmp(rec->pc, pcs, depth * sizeof(*pcs)))
+			goto found;
+	}
+	if (info->stacks == info->max_stacks) {
+		info->dropped++;
+		return;
+	}
+	info->stacks++;
+	rec->depth = depth;
+	memcpy(rec->pc, pcs, depth * sizeof(*pcs));
+found:
+	rec->count++;
+	rec->time_us += time_us;
+	info->samples++;
+	info->time_us += time_us;
+}
+
+void notrace profile_sample(void *pc, void *frame)
+{
+	struct profile_info *info = prof;
+	uint32_t pcs[TRACE_SAMPLE_DEPTH];
+	ulong now, elapsed;
+	int depth;
+
+	if (!info || !info->enabled || info->busy)
+		return;
+	now = timer_get_us();
+	elapsed = now - info->last_us;
+	if (elapsed < info->interval_us)
+		return;
+	info->busy = true;
+	info->last_us = now;
+	depth = profile_backtrace(pc, frame, pcs);
+	if (depth)
+		profile_add(info, pcs, depth, elapsed);
+	else
+		info->dropped++;
+	info->busy = false;
+}
+
+int profile_start(uint interval_us)
+{
+	struct profile_info *info = prof;
+
+	if (!info) {
+		uint size;
+
+		info = calloc(1, sizeof(*info));
+		if (!info)
+			return -ENOMEM;
+		size = roundup_pow_of_two(CONFIG_PROFILE_MAX_STACKS * 4 / 3 + 1);
+		info->table = calloc(size, sizeof(struct trace_sample));
+		if (!info->table) {
+			free(info);
+			return -ENOMEM;
+		}
+		info->size = size;
+		info->max_stacks = CONFIG_PROFILE_MAX_STACKS;
+		prof = info;
+	}
+
+	info->enabled = false;
+	memset(info->table, '\0', info->size * sizeof(struct trace_sample));
+	info->samples = 0;
+	info->dropped = 0;
+	info->time_us = 0;
+	info->stacks = 0;
+	info->interval_us = interval_us ?: CONFIG_PROFILE_INTERVAL_US;
+	info->last_us = timer_get_us();
+	info->enabled = true;
+
+	return 0;
+}
+
+void profile_stop(void)
+{
+	if (prof)
+		prof->enabled = false;
+}
+
+int profile_get_stats(struct profile_stats *stats)
+{
+	struct profile_info *info = prof;
+
+	if (!info)
+		return -ENOENT;
+	stats->samples = info->samples;
+	stats->stacks = info->stacks;
+	stats->max_stacks = info->max_stacks;
+	stats->dropped = info->dropped;
+	stats->time_us = info->time_us;
+
+	return 0;
+}
+
+int profile_list_samples(void *buff, size_t buff_size, size_t *needed)
+{
+	struct trace_output_hdr *output_hdr = NULL;
+	struct profile_info *info = prof;
+	void *end, *ptr = buff;
+	size_t upto;
+	bool was_enabled;
+	uint pos;
+
+	if (!info)
+		return -ENOENT;
+	end = buff ? buff + buff_size : NULL;
+
+	/* Place some header information */
+	if (ptr + sizeof(struct trace_output_hdr) <= end)
+		output_hdr = ptr;
+	ptr += sizeof(struct trace_output_hdr);
+
+	/* Stop the table changing while it is copied */
+	was_enabled = info->enabled;
+	info->enabled = false;
+	for (pos = upto = 0; pos < info->size; pos++) {
+		const struct trace_sample *rec = &info->table[pos];
+
+		if (!rec->depth)
+			continue;
+		if (ptr + sizeof(struct trace_sample) <= end) {
+			memcpy(ptr, rec, sizeof(struct trace_sample));
+			upto++;
+		}
+		ptr += sizeof(struct trace_sample);
+	}
+	info->enabled = was_enabled;
+
+	/* Update the header */
+	if (output_hdr) {
+		memset(output_hdr, '\0', sizeof(*output_hdr));
+		output_hdr->rec_count = upto;
+		output_hdr->type = TRACE_CHUNK_SAMPLES;
+		output_hdr->version = TRACE_VERSION;
+		output_hdr->text_base = CONFIG_TEXT_BASE;
+	}
+
+	/* Work out how much of the buffer we used */
+	*needed = ptr - buff;
+	if (ptr > end)
+		return -ENOSPC;
+
+	return 0;
+}
+
+static int h_cmp_time(const void *v1, const void *v2)
+{
+	const struct trace_sample *s1 = *(struct trace_sample **)v1;
+	const struct trace_sample *s2 = *(struct trace_sample **)v2;
+
+	if (s1->time_us != s2->time_us)
+		return s1->time_us < s2->time_us ? 1 : -1;
+
+	return s2->count - s1->count;
+}
+
+static void profile_print_pc(uint32_t offset)
+{
+	const char *name = NULL;
+	ulong base;
+
+	if (IS_ENABLED(CONFIG_KALLSYMS))
+		name = symbol_lookup_offset(offset, &base);
+	if (name)
+		printf(" %08x %s+%#lx\n", offset, name, offset - base);
+	else
+		printf(" %08x\n", offset);
+}
+
+void profile_print_stats(int count)
+{
+	struct profile_info *info = prof;
+	struct trace_sample **list;
+	bool was_enabled;
+	uint pos, num;
+	int i, j;
+
+	if (!info) {
+		printf("Profiling has not been started\n");
+		return;
+	}
+	print_grouped_ull(info->samples, 10);
+	puts(" samples\n");
+	print_grouped_ull(info->time_us, 10);
+	puts(" microseconds sampled\n");
+	print_grouped_ull(info->stacks, 10);
+	printf(" call stacks (max %u)\n", info->max_stacks);
+	print_grouped_ull(info->dropped, 10);
+	puts(" samples dropped\n");
+	if (!info->stacks || count <= 0)
+		return;
+
+	list = malloc(info->stacks * sizeof(*list));
+	if (!list) {
+		printf("Out of memory\n");
+		return;
+	}
+	was_enabled = info->enabled;
+	info->enabled = false;
+	for (pos = num = 0; pos < info->size; pos++) {
+		if (info->table[pos].depth)
+			list[num++] = &info->table[pos];
+	}
+	qsort(list, num, sizeof(*list), h_cmp_time);
+
+	printf("\n%8s %10s %8s  %s\n", "%time", "time_us", "samples", "stack");
+	for (i = 0; i < min((uint)count, num); i++) {
+		const struct trace_sample *rec = list[i];
+		ulong pct = info->time_us ?
+			(ulong)rec->time_us * 1000 / info->time_us : 0;
+
+		printf("%5lu.%lu%% %10u %8u ", pct / 10, pct % 10,
+		       rec->time_us, rec->count);
+		for (j = 0; j < rec->depth; j++) {
+			if (j)
+				printf("%29s", "");
+			profile_print_pc(rec->pc[j]);
+		}
+	}
+	info->enabled = was_enabled;
+	free(list);
+}
@@ -11,8 +11,12 @@
 #include <dm.h>
 #include <bootdev.h>
 #include <bootflow.h>
+#include <env.h>
 #include <mapmem.h>
 #include <os.h>
+#include <asm/test.h>
+#include <dm/device-internal.h>
+#include <dm/uclass-internal.h>
 #include <test/suites.h>
 #include <test/ut.h>
 #include "bootstd_common.h"
@@ -436,6 +440,78 @@ static int bootdev_test_hunt_scan(struct unit_test_state *uts)
 }
 BOOTSTD_TEST(bootdev_test_hunt_scan, UT_TESTF_DM | UT_TESTF_SCAN_FDT);
 
+/* Time taken by the emulated disk to spin up */
+#define SCSI_SPINUP_MS	20
+
+/* Check that hunters are started ahead of the scan reaching them */
+static int bootdev_test_hunt_bg(struct unit_test_state *uts)
+{
+	int line, start_line = 0, hunt_line = 0, starts = 0, hunts = 0;
+	int mmc_scans = 0, scsi_scans = 0;
+	struct bootflow_iter iter;
+	struct bootstd_priv *std;
+	struct bootflow bflow;
+	struct udevice *dev;
+	char buf[256];
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_BOOTSTD_BG_HUNT))
+		return -EAGAIN;
+
+	test_set_eth_enable(false);
+	sandbox_scsi_set_spinup(SCSI_SPINUP_MS);
+	ut_assertok(env_set("boot_targets", "mmc1 scsi"));
+
+	/* power down the disk, so that it must spin up again */
+	ut_assertok(uclass_find_first_device(UCLASS_SCSI, &dev));
+	ut_assertnonnull(dev);
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(bootstd_get_priv(&std));
+	std->hunters_used = 0;
+
+	console_record_reset_enable();
+	ret = bootflow_scan_first(NULL, NULL, &iter, BOOTFLOWIF_SHOW |
+				  BOOTFLOWIF_HUNT | BOOTFLOWIF_SKIP_GLOBAL |
+				  BOOTFLOWIF_BG_HUNT, &bflow);
+	while (ret != -ENODEV) {
+		bootflow_free(&bflow);
+		ret = bootflow_scan_next(&iter, &bflow);
+	}
+	bootflow_iter_uninit(&iter);
+
+	sandbox_scsi_set_spinup(0);
+	ut_assertok(env_set("boot_targets", NULL));
+
+	/* the SCSI hunter shows when it scans the bus */
+	for (line = 0; console_record_avail(); line++) {
+		ut_assert(console_record_readline(buf, sizeof(buf)) >= 0);
+		if (!strcmp("Starting hunter: scsi", buf)) {
+			start_line = line;
+			starts++;
+		} else if (!strcmp("scanning bus for devices...", buf)) {
+			hunt_line = line;
+			hunts++;
+		} else if (!strcmp("Scanning bootdev 'mmc1.bootdev':", buf)) {
+			mmc_scans++;
+		} else if (!strcmp("Scanning bootdev 'scsi.id0lun0.bootdev':",
+				   buf)) {
+			scsi_scans++;
+		}
+	}
+
+	/* SCSI is started before it is hunted, and nothing is done twice */
+	ut_asserteq(1, starts);
+	ut_asserteq(1, hunts);
+	ut_assert(start_line < hunt_line);
+	ut_asserteq(1, mmc_scans);
+	ut_asserteq(1, scsi_scans);
+	ut_asserteq(BIT(MMC_HUNTER) | BIT(1) | BIT(6), std->hunters_used);
+	ut_assert(device_active(dev));
+
+	return 0;
+}
+BOOTSTD_TEST(bootdev_test_hunt_bg, UT_TESTF_DM | UT_TESTF_SCAN_FDT);
+
 /* Check that only bootable partitions are processed */
 static int bootdev_test_bootable(struct unit_test_state *uts)
 {
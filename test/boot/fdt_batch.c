@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for making a batch of device-tree fix-ups
+ */
+
+#include <common.h>
+#include <fdt_support.h>
+#include <malloc.h>
+#include <asm/global_data.h>
+#include <dm/ofnode.h>
+#include <linux/libfdt.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include "bootstd_common.h"
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Maximum length of a node path in the test */
+#define PATH_LEN	128
+
+/* Count the properties in a node */
+static int count_props(const void *fdt, int node)
+{
+	int prop, count = 0;
+
+	fdt_for_each_property_offset(prop, fdt, node)
+		count++;
+
+	return count;
+}
+
+/*
+ * Check that two flat trees have the same nodes, in order, with the same
+ * properties. Property order is not checked, since libfdt adds new properties
+ * at the start of a node and the live tree adds them at the end
+ */
+static int check_same_tree(struct unit_test_state *uts, const void *fdt1,
+			   const void *fdt2)
+{
+	int node1, node2, depth1 = 0, depth2 = 0;
+
+	/* the depth goes negative after the end of the root node */
+	for (node1 = 0, node2 = 0; depth1 >= 0;
+	     node1 = fdt_next_node(fdt1, node1, &depth1),
+	     node2 = fdt_next_node(fdt2, node2, &depth2)) {
+		int prop;
+
+		ut_asserteq(depth1, depth2);
+		ut_asserteq_str(fdt_get_name(fdt1, node1, NULL),
+				fdt_get_name(fdt2, node2, NULL));
+		ut_asserteq(count_props(fdt1, node1), count_props(fdt2, node2));
+		fdt_for_each_property_offset(prop, fdt1, node1) {
+			const void *val1, *val2;
+			const char *name;
+			int len1, len2;
+
+			val1 = fdt_getprop_by_offset(fdt1, prop, &name, &len1);
+			val2 = fdt_getprop(fdt2, node2, name, &len2);
+			ut_assertnonnull(val2);
+			ut_asserteq(len1, len2);
+			ut_asserteq_mem(val1, val2, len1);
+		}
+	}
+	ut_asserteq(depth1, depth2);
+
+	return 0;
+}
+
+/*
+ * Add a property to every node in a copy of the control FDT, first with libfdt
+ * and then with a batch, checking that the resulting trees are the same
+ */
+static int bootstd_test_fdt_batch(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	struct fdt_batch batch;
+	void *flat, *fdt;
+	int count, offset, size, i;
+	fdt32_t *vals;
+	char *paths;
+
+	count = 0;
+	for (offset = 0; offset >= 0; offset = fdt_next_node(blob, offset, NULL))
+		count++;
+	paths = calloc(count, PATH_LEN);
+	vals = calloc(count, sizeof(*vals));
+	ut_assertnonnull(paths);
+	ut_assertnonnull(vals);
+	/*
+	 * Skip nodes which libfdt cannot find by path, e.g. /bootcount, which
+	 * matches an earlier /bootcount@0
+	 */
+	for (i = 0, offset = 0; offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		char *path = paths + i * PATH_LEN;
+
+		ut_assertok(fdt_get_path(blob, offset, path, PATH_LEN));
+		if (fdt_path_offset(blob, path) != offset)
+			continue;
+		vals[i] = cpu_to_fdt32(i);
+		i++;
+	}
+	count = i;
+
+	size = fdt_totalsize(blob) + count * 32;
+	flat = malloc(size);
+	fdt = malloc(size);
+	ut_assertnonnull(flat);
+	ut_assertnonnull(fdt);
+	ut_assertok(fdt_open_into(blob, flat, size));
+	ut_assertok(fdt_open_into(blob, fdt, size));
+	fdt_set_boot_cpuid_phys(flat, 3);
+	fdt_set_boot_cpuid_phys(fdt, 3);
+
+	for (i = 0; i < count; i++) {
+		offset = fdt_path_offset(flat, paths + i * PATH_LEN);
+		ut_assert(offset >= 0);
+		ut_assertok(fdt_setprop(flat, offset, "u-boot,fixup", &vals[i],
+					sizeof(*vals)));
+	}
+
+	ut_assertok(fdt_batch_start(&batch, fdt));
+	for (i = 0; i < count; i++) {
+		ofnode node = oftree_path(batch.tree, paths + i * PATH_LEN);
+
+		ut_assert(ofnode_valid(node));
+		ut_assertok(ofnode_write_prop(node, "u-boot,fixup", &vals[i],
+					      sizeof(*vals), false));
+	}
+	ut_assertok(fdt_batch_finish(&batch));
+
+	ut_assertok(check_same_tree(uts, flat, fdt));
+	ut_asserteq(3, fdt_boot_cpuid_phys(fdt));
+	ut_asserteq(fdt_num_mem_rsv(blob), fdt_num_mem_rsv(fdt));
+
+	free(fdt);
+	free(flat);
+	free(vals);
+	free(paths);
+
+	return 0;
+}
+BOOTSTD_TEST(bootstd_test_fdt_batch, 0);
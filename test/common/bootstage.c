@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for bootstage spans
+ */
+
+#include <common.h>
+#include <bootstage.h>
+#include <malloc.h>
+#include <asm/global_data.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Check spans using new records, so that the results are predictable */
+static int check_bootstage_spans(struct unit_test_state *uts)
+{
+	const struct bootstage_span *span;
+	int outer, inner, func, after;
+	char *buf;
+	int len;
+
+	/* The second ID uses the same hash-table slot as the first */
+	bootstage_mark_name(BOOTSTAGE_ID_MAIN_LOOP, "first");
+	bootstage_mark_name(BOOTSTAGE_ID_MAIN_LOOP, "second");
+	bootstage_mark_name(BOOTSTAGE_ID_MAIN_LOOP +
+			    CONFIG_BOOTSTAGE_RECORD_COUNT * 2, "collide");
+
+	outer = bootstage_span_begin(BOOTSTAGE_SPAN_OTHER, "outer");
+	ut_asserteq(0, outer);
+	inner = bootstage_span_begin(BOOTSTAGE_SPAN_PROBE, "inner \"dev\"");
+	ut_asserteq(1, inner);
+	bootstage_span_end(inner);
+	func = bootstage_span_begin_func(BOOTSTAGE_SPAN_INITCALL,
+					 check_bootstage_spans);
+	ut_asserteq(2, func);
+
+	/* Ending the outer span leaves the one inside it open */
+	bootstage_span_end(outer);
+	after = bootstage_span_begin(BOOTSTAGE_SPAN_OTHER, "after");
+	ut_asserteq(3, after);
+	bootstage_span_end(after);
+	ut_assertnull(bootstage_get_span(4));
+
+	span = bootstage_get_span(outer);
+	ut_assertnonnull(span);
+	ut_asserteq_str("outer", span->name);
+	ut_asserteq(0, span->parent);
+	ut_asserteq(0, span->flags);
+
+	span = bootstage_get_span(inner);
+	ut_asserteq_str("inner \"dev\"", span->name);
+	ut_asserteq(BOOTSTAGE_SPAN_PROBE, span->cat);
+	ut_asserteq(outer + 1, span->parent);
+	ut_assert(span->start_us >= bootstage_get_span(outer)->start_us);
+	ut_assert(span->end_us <= bootstage_get_span(outer)->end_us);
+
+	span = bootstage_get_span(func);
+	ut_asserteq_str("", span->name);
+	ut_assert(span->func);
+	ut_asserteq(outer + 1, span->parent);
+	ut_asserteq(BOOTSTAGE_SPANF_OPEN, span->flags);
+
+	ut_asserteq(0, bootstage_get_span(after)->parent);
+
+	/* Check the length, then write out the trace */
+	len = bootstage_trace_json(NULL, 0);
+	buf = malloc(len + 1);
+	ut_assertnonnull(buf);
+	ut_asserteq(len, bootstage_trace_json(buf, 10));
+	ut_asserteq(9, strlen(buf));
+	ut_asserteq(len, bootstage_trace_json(buf, len + 1));
+	ut_asserteq(len, strlen(buf));
+
+	ut_asserteq_mem("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", buf,
+			39);
+	ut_assertnonnull(strstr(buf, "\"name\":\"first\""));
+	ut_assertnull(strstr(buf, "\"name\":\"second\""));
+	ut_assertnonnull(strstr(buf, "\"name\":\"collide\""));
+	ut_assertnonnull(strstr(buf, "{\"name\":\"inner \\\"dev\\\"\",\"cat\":\"probe\",\"ph\":\"X\""));
+	ut_assertnonnull(strstr(buf, "\"args\":{\"span\":1,\"parent\":0}}"));
+	ut_assertnonnull(strstr(buf, "\"args\":{\"span\":2,\"parent\":0,\"open\":true}}"));
+	ut_assertnonnull(strstr(buf, "\"args\":{\"span\":3,\"parent\":-1}}"));
+	ut_asserteq_str("\n]}\n", buf + len - 4);
+	free(buf);
+
+	return 0;
+}
+
+/* Check that spans nest and are written out with the records */
+static int common_test_bootstage_spans(struct unit_test_state *uts)
+{
+	struct bootstage_data *old = gd->bootstage;
+	int ret;
+
+	/* Put back the real records, even if the test fails */
+	ret = bootstage_init(false);
+	if (!ret) {
+		ret = check_bootstage_spans(uts);
+		free(gd->bootstage);
+	}
+	gd->bootstage = old;
+
+	return ret;
+}
+COMMON_TEST(common_test_bootstage_spans, 0);
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for initcall timing
+ */
+
+#include <common.h>
+#include <initcall.h>
+#include <asm/sections.h>
+#include <linux/delay.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Time taken by the slow initcall */
+#define INITCALL_TEST_US	10000
+
+static int test_initcall_slow(void)
+{
+	udelay(INITCALL_TEST_US);
+
+	return 0;
+}
+
+static int test_initcall_quick(void)
+{
+	return 0;
+}
+
+/* Check that the time taken by each initcall is recorded */
+static int common_test_initcall_stats(struct unit_test_state *uts)
+{
+	static const init_fnc_t seq[] = {
+		test_initcall_slow,
+		test_initcall_quick,
+		NULL,
+	};
+	const struct initcall_stat *stats;
+	uint dropped;
+	int before;
+
+	/* Records cannot be removed, so skip this if there is no space */
+	before = initcall_stats_get(&stats, &dropped);
+	if (before + 2 > CONFIG_INITCALL_STATS_COUNT)
+		return -EAGAIN;
+
+	ut_assertok(initcall_run_list(seq));
+	ut_asserteq(before + 2, initcall_stats_get(&stats, &dropped));
+	ut_asserteq(0, dropped);
+
+	ut_asserteq((ulong)test_initcall_slow - (ulong)&_init,
+		    stats[before].func);
+	ut_assert(stats[before].time_us >= INITCALL_TEST_US);
+	ut_asserteq(0, stats[before].ret);
+
+	ut_asserteq((ulong)test_initcall_quick - (ulong)&_init,
+		    stats[before + 1].func);
+	ut_asserteq(0, stats[before + 1].ret);
+
+	return 0;
+}
+COMMON_TEST(common_test_initcall_stats, 0);
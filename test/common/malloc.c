@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the slab front end to malloc()
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <time.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define BENCH_OBJS	4000
+#define BENCH_ROUNDS	5
+
+/* Sizes typical of driver-model allocations */
+static const int bench_sizes[] = { 24, 40, 16, 96, 56, 128, 200, 32 };
+
+static void *bench_ptrs[BENCH_OBJS];
+
+/* Get the bytes actually taken from the heap, including unused slab space */
+static ulong heap_used(void)
+{
+	return mallinfo().uordblks + malloc_slab_unused();
+}
+
+/* Test that small allocations come from the slab and behave normally */
+static int common_test_malloc_slab(struct unit_test_state *uts)
+{
+	struct malloc_slab_stats before[2], after[2];
+	ulong start;
+	u8 *ptr, *other;
+	bool old;
+	int i;
+
+	old = malloc_slab_enable(true);
+	free(malloc(16));	/* make sure the slab is set up */
+	start = ut_check_free();
+	malloc_slab_get_stats(before, ARRAY_SIZE(before));
+
+	/* 20 bytes is rounded up to the 32-byte class */
+	ptr = malloc(20);
+	ut_assertnonnull(ptr);
+	ut_asserteq(32, malloc_slab_size(ptr));
+	ut_asserteq(32, malloc_usable_size(ptr));
+	ut_asserteq(32, ut_check_delta(start));
+	ut_asserteq(0, (ulong)ptr & 15);
+	malloc_slab_get_stats(after, ARRAY_SIZE(after));
+	ut_asserteq(before[1].allocs + 1, after[1].allocs);
+	ut_asserteq(before[1].in_use + 1, after[1].in_use);
+
+	/* growing within the class keeps the object, beyond it moves it */
+	memset(ptr, 0xaa, 20);
+	ut_asserteq_ptr(ptr, realloc(ptr, 32));
+	other = realloc(ptr, 1000);
+	ut_assertnonnull(other);
+	ut_asserteq(0, malloc_slab_size(other));
+	for (i = 0; i < 20; i++)
+		ut_asserteq(0xaa, other[i]);
+	free(other);
+	ut_assertok(ut_check_delta(start));
+
+	/* calloc() clears objects which are reused */
+	ptr = malloc(64);
+	memset(ptr, 0xff, 64);
+	free(ptr);
+	ptr = calloc(1, 64);
+	ut_assertnonnull(ptr);
+	for (i = 0; i < 64; i++)
+		ut_asserteq(0, ptr[i]);
+	free(ptr);
+
+	/* large requests and aligned requests bypass the slab */
+	ptr = malloc(MALLOC_SLAB_MAX + 1);
+	ut_asserteq(0, malloc_slab_size(ptr));
+	free(ptr);
+	ptr = memalign(64, 32);
+	ut_asserteq(0, (ulong)ptr & 63);
+	free(ptr);
+
+	/* nothing is left behind */
+	ut_assertok(ut_check_delta(start));
+	malloc_slab_enable(old);
+
+	return 0;
+}
+COMMON_TEST(common_test_malloc_slab, 0);
+
+/* Allocate and free many small objects, returning the peak heap usage */
+static int bench_run(struct unit_test_state *uts, bool slab, ulong *peakp,
+		     ulong *usp)
+{
+	ulong start, peak, base;
+	bool old;
+	int i, j;
+
+	old = malloc_slab_enable(slab);
+	start = ut_check_free();
+	base = heap_used();
+	peak = 0;
+	*usp = timer_get_us();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < BENCH_OBJS; i++) {
+			bench_ptrs[i] = malloc(bench_sizes[i %
+						ARRAY_SIZE(bench_sizes)]);
+			ut_assertnonnull(bench_ptrs[i]);
+		}
+		if (!j)
+			peak = heap_used() - base;
+
+		/* free every other object, then the rest, to mix things up */
+		for (i = 0; i < BENCH_OBJS; i += 2)
+			free(bench_ptrs[i]);
+		for (i = 1; i < BENCH_OBJS; i += 2)
+			free(bench_ptrs[i]);
+	}
+	*usp = timer_get_us() - *usp;
+	*peakp = peak;
+	malloc_slab_enable(old);
+	ut_assertok(ut_check_delta(start));
+
+	return 0;
+}
+
+/* Compare allocation throughput and heap usage with and without the slab */
+static int common_test_malloc_bench(struct unit_test_state *uts)
+{
+	ulong slab_peak, slab_us, dl_peak, dl_us;
+	int ops = BENCH_OBJS * BENCH_ROUNDS * 2;
+
+	ut_assertok(bench_run(uts, false, &dl_peak, &dl_us));
+	ut_assertok(bench_run(uts, true, &slab_peak, &slab_us));
+
+	printf("%d allocs/frees: dlmalloc %lu us, peak %lu bytes\n", ops,
+	       dl_us, dl_peak);
+	printf("%d allocs/frees: slab     %lu us, peak %lu bytes\n", ops,
+	       slab_us, slab_peak);
+
+	return 0;
+}
+COMMON_TEST(common_test_malloc_bench, 0);
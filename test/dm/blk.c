@@ -4,6 +4,8 @@
  */
 
 #include <common.h>
+#include <blk.h>
+#include <command.h>
 #include <dm.h>
 #include <part.h>
 #include <sandbox_host.h>
@@ -334,3 +336,72 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test measuring a block device */
+static int dm_test_blk_bench(struct unit_test_state *uts)
+{
+	struct blk_bench_params params = {
+		.start		= 16,
+		.count		= 64,
+		.xfer		= 16,
+		.duration_ms	= 10000,
+		.max_ops	= 10,
+	};
+	struct blk_bench_result res;
+	struct blk_desc *desc;
+
+	if (!IS_ENABLED(CONFIG_BLK_BENCH))
+		return -EAGAIN;
+	ut_asserteq(0, blk_get_device_by_str("mmc", "0", &desc));
+
+	ut_assertok(blk_bench(desc, &params, &res));
+	ut_asserteq(10, res.ops);
+	ut_asserteq(10 * 16 * desc->blksz, res.bytes);
+	ut_assert(res.lat_min <= res.lat_p50);
+	ut_assert(res.lat_p50 <= res.lat_p90);
+	ut_assert(res.lat_p90 <= res.lat_p99);
+	ut_assert(res.lat_p99 <= res.lat_max);
+
+	params.write = true;
+	params.random = true;
+	ut_assertok(blk_bench(desc, &params, &res));
+	ut_asserteq(10, res.ops);
+
+	/* the region must be inside the device and hold a transfer */
+	params.xfer = 128;
+	ut_asserteq(-EINVAL, blk_bench(desc, &params, &res));
+	params.xfer = 16;
+	params.count = desc->lba;
+	ut_asserteq(-EINVAL, blk_bench(desc, &params, &res));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_bench, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test the blk bench command */
+static int dm_test_blk_bench_cmd(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_CMD_BLK_BENCH))
+		return -EAGAIN;
+	ut_assertok(console_record_reset_enable());
+	ut_assertok(run_command("blk bench -n 4 mmc 0", 0));
+	ut_assert_nextline("mmc 0: sequential read, 8 blocks of 512 bytes per transfer");
+	ut_assert_nextlinen("4 transfers, 16384 bytes in ");
+	ut_assert_skipline();
+	ut_assert_nextlinen("latency (us): min ");
+	ut_assert_console_end();
+
+	/* writing needs an explicit region */
+	ut_asserteq(1, run_command("blk bench -w mmc 0", 0));
+	console_record_reset();
+	ut_assertok(run_command("blk bench -w -r -b 4 -n 4 mmc 0 10 20", 0));
+	ut_assert_nextline("mmc 0: random write, 4 blocks of 512 bytes per transfer");
+	ut_assert_nextlinen("4 transfers, 8192 bytes in ");
+	ut_assert_skipline();
+	ut_assert_nextlinen("latency (us): min ");
+	ut_assert_console_end();
+
+	return 0;
+}
+DM_TEST(dm_test_blk_bench_cmd, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT |
+	UT_TESTF_CONSOLE_REC);
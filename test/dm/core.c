@@ -13,6 +13,7 @@
 #include <malloc.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -506,6 +507,28 @@ static int dm_test_remove(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_remove, UT_TESTF_SCAN_PDATA | UT_TESTF_PROBE_TEST);
 
+#if CONFIG_IS_ENABLED(DM_TIMING)
+/* Test that the time taken to probe a device is recorded */
+static int dm_test_probe_timing(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+
+	ut_assertok(uclass_find_device(UCLASS_TEST, 0, &dev));
+	ut_assert(!(dev_get_flags(dev) & DM_FLAG_ACTIVATED));
+	dev->probe_us = UINT_MAX;
+	ut_assertok(device_probe(dev));
+	ut_assert(dev->probe_us < 1000000);
+
+	/* Nothing is recorded if the device is already probed */
+	dev->probe_us = 123;
+	ut_assertok(device_probe(dev));
+	ut_asserteq(123, dev->probe_us);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_timing, UT_TESTF_SCAN_PDATA);
+#endif
+
 /* Remove and recreate everything, check for memory leaks */
 static int dm_test_leak(struct unit_test_state *uts)
 {
@@ -1353,3 +1376,42 @@ static int dm_test_dev_get_mem(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_dev_get_mem, UT_TESTF_SCAN_FDT);
+
+/* Test that the compatible-string index finds what a search would */
+static int dm_test_compat_index(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *expect, *found;
+	struct driver *drv;
+	bool old;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(DM_COMPAT_INDEX))
+		return -EAGAIN;
+
+	old = lists_compat_index_set_enabled(false);
+	for (i = 0; i < n_ents; i++) {
+		for (id = driver[i].of_match; id && id->compatible; id++) {
+			lists_compat_index_set_enabled(false);
+			drv = lists_driver_lookup_compat(id->compatible,
+							 &expect);
+			ut_assertnonnull(drv);
+
+			lists_compat_index_set_enabled(true);
+			ut_asserteq_ptr(drv,
+					lists_driver_lookup_compat(id->compatible,
+								   &found));
+			ut_asserteq_ptr(expect, found);
+		}
+	}
+	ut_assertnull(lists_driver_lookup_compat("sandbox,no-such-thing",
+						 &found));
+	lists_compat_index_set_enabled(false);
+	ut_assertnull(lists_driver_lookup_compat("sandbox,no-such-thing",
+						 &found));
+	lists_compat_index_set_enabled(old);
+
+	return 0;
+}
+DM_TEST(dm_test_compat_index, 0);
@@ -7,9 +7,11 @@
 #include <dm.h>
 #include <fastboot.h>
 #include <fb_mmc.h>
+#include <malloc.h>
 #include <mmc.h>
 #include <part.h>
 #include <part_efi.h>
+#include <sparse_format.h>
 #include <dm/test.h>
 #include <test/ut.h>
 #include <linux/stringify.h>
@@ -93,3 +95,172 @@ static int dm_test_fastboot_mmc_part(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_fastboot_mmc_part, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#define STREAM_BUF_SIZE	2048
+#define STREAM_PIECE	100
+
+/* Add a sparse chunk header to @p, returning a pointer to its data */
+static u8 *add_chunk(u8 *p, u16 type, u32 blks, u32 data_len)
+{
+	chunk_header_t chunk = {
+		.chunk_type = type,
+		.chunk_sz = blks,
+		.total_sz = sizeof(chunk) + data_len,
+	};
+
+	memcpy(p, &chunk, sizeof(chunk));
+
+	return p + sizeof(chunk);
+}
+
+/* Download @len bytes of @data in small pieces, then send @flash */
+static int stream_image(struct unit_test_state *uts, const u8 *data, u32 len,
+			char *response)
+{
+	char cmd[32];
+	u32 n;
+
+	snprintf(cmd, sizeof(cmd), "download:%08x", len);
+	ut_asserteq(FASTBOOT_COMMAND_DOWNLOAD,
+		    fastboot_handle_command(cmd, response));
+	ut_asserteq_strn("DATA", response);
+	for (; len; data += n, len -= n) {
+		n = min(len, (u32)STREAM_PIECE);
+		fastboot_data_download(data, n, response);
+		ut_asserteq_str("", response);
+	}
+	fastboot_data_complete(response);
+
+	return 0;
+}
+
+/* Test writing images larger than the download buffer while they arrive */
+static int dm_test_fastboot_stream(struct unit_test_state *uts)
+{
+	char response[FASTBOOT_RESPONSE_LEN] = {0};
+	char str_disk_guid[UUID_STR_LEN + 1];
+	struct blk_desc *mmc_dev_desc;
+	struct disk_partition parts[1] = {
+		{
+			.start = 48,
+			.size = 64,
+			.name = "test1",
+		},
+	};
+	sparse_header_t hdr = {
+		.magic = SPARSE_HEADER_MAGIC,
+		.major_version = 1,
+		.file_hdr_sz = sizeof(hdr),
+		.chunk_hdr_sz = sizeof(chunk_header_t),
+		.blk_sz = 1024,
+		.total_blks = 6,
+		.total_chunks = 5,
+	};
+	u8 *image, *p, *raw1, *raw2, *buf, *expect;
+	u32 fill = 0xdeadbeef;
+	char cmd[32];
+	int i;
+
+	if (!IS_ENABLED(CONFIG_FASTBOOT_STREAM))
+		return -EAGAIN;
+	ut_assertok(blk_get_device_by_str("mmc", "0", &mmc_dev_desc));
+	if (CONFIG_IS_ENABLED(RANDOM_UUID)) {
+		gen_rand_uuid_str(parts[0].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(str_disk_guid, UUID_STR_FORMAT_STD);
+	}
+	ut_assertok(gpt_restore(mmc_dev_desc, str_disk_guid, parts,
+				ARRAY_SIZE(parts)));
+
+	buf = malloc(STREAM_BUF_SIZE);
+	image = calloc(1, 4 * STREAM_BUF_SIZE);
+	expect = malloc(16 * 512);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(image);
+	ut_assertnonnull(expect);
+	fastboot_init(buf, STREAM_BUF_SIZE);
+
+	/* the partition starts out with a pattern, kept by 'don't care' */
+	memset(expect, 0x55, 16 * 512);
+	ut_asserteq(16, blk_dwrite(mmc_dev_desc, 48, 16, expect));
+
+	/* raw, don't care, fill, raw and CRC32 chunks */
+	memcpy(image, &hdr, sizeof(hdr));
+	p = add_chunk(image + sizeof(hdr), CHUNK_TYPE_RAW, 2, 2048);
+	raw1 = p;
+	for (i = 0; i < 2048; i++)
+		raw1[i] = i * 7;
+	p = add_chunk(p + 2048, CHUNK_TYPE_DONT_CARE, 1, 0);
+	p = add_chunk(p, CHUNK_TYPE_FILL, 2, sizeof(fill));
+	memcpy(p, &fill, sizeof(fill));
+	p = add_chunk(p + sizeof(fill), CHUNK_TYPE_RAW, 1, 1024);
+	raw2 = p;
+	for (i = 0; i < 1024; i++)
+		raw2[i] = i * 3 + 1;
+	p = add_chunk(p + 1024, CHUNK_TYPE_CRC32, 0, sizeof(u32));
+	p += sizeof(u32);
+	ut_assert(p - image > STREAM_BUF_SIZE);
+
+	/* without streaming, the image does not fit */
+	snprintf(cmd, sizeof(cmd), "download:%08x", (u32)(p - image));
+	fastboot_handle_command(cmd, response);
+	ut_asserteq_strn("FAIL", response);
+
+	strcpy(cmd, "oem stream:test1");
+	ut_asserteq(FASTBOOT_COMMAND_OEM_STREAM,
+		    fastboot_handle_command(cmd, response));
+	ut_asserteq_str("OKAY", response);
+	ut_assertok(stream_image(uts, image, p - image, response));
+	ut_asserteq_str("OKAY", response);
+
+	/* the image has been written before the flash command */
+	memcpy(expect, raw1, 2048);
+	for (i = 0; i < 512; i++)
+		((u32 *)(expect + 3072))[i] = fill;
+	memcpy(expect + 5120, raw2, 1024);
+	memset(buf, '\0', STREAM_BUF_SIZE);
+	for (i = 0; i < 16; i++) {
+		ut_asserteq(1, blk_dread(mmc_dev_desc, 48 + i, 1, buf));
+		ut_asserteq_mem(expect + i * 512, buf, 512);
+	}
+	strcpy(cmd, "flash:test1");
+	ut_asserteq(FASTBOOT_COMMAND_FLASH,
+		    fastboot_handle_command(cmd, response));
+	ut_asserteq_str("OKAY", response);
+
+	/* a truncated image fails the download */
+	strcpy(cmd, "oem stream:test1");
+	fastboot_handle_command(cmd, response);
+	ut_assertok(stream_image(uts, image, p - image - 1000, response));
+	ut_asserteq_str("FAILsparse image is truncated", response);
+
+	/* flashing then reports the failure, rather than writing the buffer */
+	memset(expect, 0xaa, 512);
+	ut_asserteq(1, blk_dwrite(mmc_dev_desc, 48, 1, expect));
+	strcpy(cmd, "flash:test1");
+	ut_asserteq(FASTBOOT_COMMAND_FLASH,
+		    fastboot_handle_command(cmd, response));
+	ut_asserteq_str("FAILsparse image is truncated", response);
+	ut_asserteq(1, blk_dread(mmc_dev_desc, 48, 1, buf));
+	ut_asserteq_mem(expect, buf, 512);
+
+	/* a raw image is padded to a whole block */
+	strcpy(cmd, "oem stream:test1");
+	fastboot_handle_command(cmd, response);
+	ut_assertok(stream_image(uts, raw1, 1000, response));
+	ut_asserteq_str("OKAY", response);
+	strcpy(cmd, "flash:test1");
+	fastboot_handle_command(cmd, response);
+	ut_asserteq_str("OKAY", response);
+	ut_asserteq(2, blk_dread(mmc_dev_desc, 48, 2, expect));
+	ut_asserteq_mem(raw1, expect, 1000);
+	for (i = 1000; i < 1024; i++)
+		ut_asserteq(0, expect[i]);
+
+	fastboot_init(NULL, 0);
+	free(expect);
+	free(image);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_fastboot_stream, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -4,9 +4,12 @@
  */
 
 #include <common.h>
+#include <command.h>
+#include <console.h>
 #include <dm.h>
 #include <mmc.h>
 #include <part.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -52,3 +55,75 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that multiple-block transfers use CMD23 rather than CMD12 */
+static int dm_test_mmc_cmd23(struct unit_test_state *uts)
+{
+	char write[16 * 512], read[16 * 512];
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	uint sbc, stop;
+	int i;
+
+	ut_assertok(uclass_get_device_by_seq(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+	sbc = sandbox_mmc_get_cmd_count(dev, MMC_CMD_SET_BLOCK_COUNT);
+	stop = sandbox_mmc_get_cmd_count(dev, MMC_CMD_STOP_TRANSMISSION);
+
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i * 3;
+	ut_asserteq(16, blk_dwrite(dev_desc, 10, 16, write));
+	ut_asserteq(16, blk_dread(dev_desc, 10, 16, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+	ut_asserteq(sbc + 2,
+		    sandbox_mmc_get_cmd_count(dev, MMC_CMD_SET_BLOCK_COUNT));
+	ut_asserteq(stop,
+		    sandbox_mmc_get_cmd_count(dev, MMC_CMD_STOP_TRANSMISSION));
+
+	/* single blocks need neither */
+	ut_asserteq(1, blk_dread(dev_desc, 40, 1, read));
+	ut_asserteq(sbc + 2,
+		    sandbox_mmc_get_cmd_count(dev, MMC_CMD_SET_BLOCK_COUNT));
+	ut_asserteq(stop,
+		    sandbox_mmc_get_cmd_count(dev, MMC_CMD_STOP_TRANSMISSION));
+
+	/* without host support, the transfer is stopped with CMD12 */
+	mmc->host_caps &= ~MMC_CAP_CMD23;
+	ut_asserteq(16, blk_dread(dev_desc, 10, 16, read));
+	mmc->host_caps |= MMC_CAP_CMD23;
+	ut_asserteq_mem(write, read, sizeof(write));
+	ut_asserteq(sbc + 2,
+		    sandbox_mmc_get_cmd_count(dev, MMC_CMD_SET_BLOCK_COUNT));
+	ut_asserteq(stop + 1,
+		    sandbox_mmc_get_cmd_count(dev, MMC_CMD_STOP_TRANSMISSION));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cmd23, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test the mmc bench command */
+static int dm_test_mmc_bench(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+
+	if (!IS_ENABLED(CONFIG_CMD_MMC_BENCH))
+		return -EAGAIN;
+	ut_assertok(uclass_get_device_by_seq(UCLASS_MMC, 0, &dev));
+	ut_assertok(run_command("mmc dev 0", 0));
+	ut_assertok(console_record_reset_enable());
+	ut_assertok(run_command("mmc bench 1000 0 c", 0));
+	ut_assert_nextline("Reading 12 blocks from block 0 in transfers of:");
+	ut_assert_nextline("    blocks    time (us)        KiB/s");
+	ut_assert_nextlinen("         1 ");
+	ut_assert_nextlinen("         2 ");
+	ut_assert_nextlinen("         4 ");
+	ut_assert_nextlinen("         8 ");
+	ut_assert_nextlinen("        12 ");
+	ut_assert_console_end();
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_bench, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT |
+	UT_TESTF_CONSOLE_REC);
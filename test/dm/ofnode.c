@@ -19,8 +19,11 @@
 #include <common.h>
 #include <dm.h>
 #include <log.h>
+#include <malloc.h>
 #include <of_live.h>
+#include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/fdt_index.h>
 #include <dm/lists.h>
 #include <dm/of_extra.h>
 #include <dm/root.h>
@@ -29,6 +32,8 @@
 #include <test/test.h>
 #include <test/ut.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /**
  * get_other_oftree() - Convert a flat tree into an oftree object
  *
@@ -134,6 +139,145 @@ static int dm_test_ofnode_get_by_phandle(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_ofnode_get_by_phandle, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* Check that each phandle gives the same node as searching the tree */
+static int check_phandles(struct unit_test_state *uts, uint max)
+{
+	struct device_node *np;
+	uint phandle;
+	ofnode node;
+
+	for (phandle = 1; phandle <= max; phandle++) {
+		node = ofnode_get_by_phandle(phandle);
+		if (of_live_active()) {
+			for_each_of_allnodes(np) {
+				if (np->phandle == phandle)
+					break;
+			}
+			ut_asserteq_ptr(np, ofnode_to_np(node));
+		} else {
+			ut_asserteq(fdt_node_offset_by_phandle(gd->fdt_blob,
+							       phandle),
+				    ofnode_to_offset(node));
+		}
+	}
+	ut_assert(!ofnode_valid(ofnode_get_by_phandle(max + 1)));
+
+	return 0;
+}
+
+static int dm_test_ofnode_phandle_cache(struct unit_test_state *uts)
+{
+	char padding[64] = {};
+	uint32_t max;
+	int ofs;
+
+	if (!CONFIG_IS_ENABLED(OF_PHANDLE_CACHE))
+		return -EAGAIN;
+
+	ut_assertok(fdt_find_max_phandle(gd->fdt_blob, &max));
+	ut_assert(max > 1);
+	ut_assertok(check_phandles(uts, max));
+	if (of_live_active())
+		return 0;
+
+	/* grow the root node so that every other node moves */
+	ofs = ofnode_to_offset(ofnode_get_by_phandle(max));
+	ut_assertok(ofnode_write_prop(ofnode_root(), "padding", padding,
+				      sizeof(padding), false));
+	ut_assert(fdt_node_offset_by_phandle(gd->fdt_blob, max) != ofs);
+	ut_assertok(check_phandles(uts, max));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_cache, UT_TESTF_SCAN_FDT);
+
+/* Check that lookups for a node give the same results as libfdt */
+static int check_fdt_index_node(struct unit_test_state *uts, const void *fdt,
+				int ofs)
+{
+	const char *name, *compat;
+	char path[256];
+	int parent;
+	uint phandle;
+
+	parent = fdt_parent_offset(fdt, ofs);
+	ut_asserteq(parent, fdt_index_parent_offset(fdt, ofs));
+	ut_assertok(fdt_get_path(fdt, ofs, path, sizeof(path)));
+	/* a name without a unit address may match an earlier sibling */
+	ut_asserteq(fdt_path_offset(fdt, path), fdt_index_path_offset(fdt, path));
+	if (parent >= 0) {
+		name = fdt_get_name(fdt, ofs, NULL);
+		ut_asserteq(fdt_subnode_offset(fdt, parent, name),
+			    fdt_index_subnode_offset(fdt, parent, name));
+	}
+
+	compat = fdt_getprop(fdt, ofs, "compatible", NULL);
+	if (compat) {
+		ut_asserteq(fdt_node_offset_by_compatible(fdt, -1, compat),
+			    fdt_index_node_offset_by_compatible(fdt, -1,
+								compat));
+		ut_asserteq(fdt_node_offset_by_compatible(fdt, ofs, compat),
+			    fdt_index_node_offset_by_compatible(fdt, ofs,
+								compat));
+	}
+	phandle = fdt_get_phandle(fdt, ofs);
+	if (phandle)
+		ut_asserteq(ofs, fdt_index_node_offset_by_phandle(fdt, phandle));
+
+	return 0;
+}
+
+static int dm_test_ofnode_fdt_index(struct unit_test_state *uts)
+{
+	const void *fdt = gd->fdt_blob;
+	const char *alias, *compat;
+	int ofs, prop, len;
+	char buf[64];
+	ofnode node;
+
+	if (!CONFIG_IS_ENABLED(FDT_INDEX))
+		return -EAGAIN;
+
+	ut_assertok(fdt_index_build(fdt));
+	ut_assert(fdt_index_active(fdt));
+	for (ofs = 0; ofs >= 0; ofs = fdt_next_node(fdt, ofs, NULL))
+		ut_assertok(check_fdt_index_node(uts, fdt, ofs));
+
+	/* aliases */
+	ofs = fdt_path_offset(fdt, "/aliases");
+	fdt_for_each_property_offset(prop, fdt, ofs) {
+		fdt_getprop_by_offset(fdt, prop, &alias, NULL);
+		ut_asserteq(fdt_path_offset(fdt, alias),
+			    fdt_index_path_offset(fdt, alias));
+	}
+
+	/* names without and with a unit address, and missing nodes */
+	ut_asserteq(fdt_path_offset(fdt, "/i2c/rtc"),
+		    fdt_index_path_offset(fdt, "/i2c/rtc"));
+	ut_asserteq(fdt_path_offset(fdt, "/i2c@0/rtc@43"),
+		    fdt_index_path_offset(fdt, "/i2c@0/rtc@43"));
+	ut_asserteq(-FDT_ERR_NOTFOUND, fdt_index_path_offset(fdt, "/missing"));
+	ut_asserteq(-FDT_ERR_BADPATH, fdt_index_path_offset(fdt, "missing"));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdt_index_node_offset_by_compatible(fdt, -1, "missing"));
+	node = ofnode_path("/i2c@0");
+	ut_assert(ofnode_valid(node));
+
+	/* the index must not be used once the tree changes */
+	compat = ofnode_read_prop(node, "compatible", &len);
+	ut_assertnonnull(compat);
+	ut_assert(len <= sizeof(buf));
+	memcpy(buf, compat, len);
+	ut_assertok(ofnode_write_prop(node, "compatible", buf, len, false));
+	ut_assert(!fdt_index_active(fdt));
+	ut_assertok(fdt_index_build(fdt));
+	ut_assertok(fdt_setprop_string((void *)fdt, 0, "padding", "extra"));
+	ut_assert(!fdt_index_active(fdt));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_fdt_index, UT_TESTF_SCAN_FDT | UT_TESTF_FLAT_TREE);
+
 static int dm_test_ofnode_get_by_phandle_ot(struct unit_test_state *uts)
 {
 	oftree otree = get_other_oftree(uts);
@@ -1267,6 +1411,81 @@ static int dm_test_livetree_align(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_livetree_align, UT_TESTF_LIVE_TREE);
 
+/* check that a lazy livetree only creates the nodes which are used */
+static int dm_test_livetree_lazy(struct unit_test_state *uts)
+{
+	const char *compat = "denx,u-boot-fdt-test";
+	const void *fdt = gd->fdt_blob;
+	struct device_node *root, *np;
+	struct of_live_stats stats;
+	char path[256];
+	int ofs, count;
+	oftree tree;
+	ofnode node;
+	u32 phandle;
+
+	if (!CONFIG_IS_ENABLED(OF_LIVE_LAZY))
+		return -EAGAIN;
+
+	ut_assertok(of_live_build_lazy(fdt, &root));
+	ut_assert(of_live_is_lazy(root));
+	ut_assertok(of_live_get_stats(root, &stats));
+	ut_asserteq(1, stats.nodes);
+
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	/* running out of memory leaves the node to be expanded later */
+	malloc_enable_testing(1);
+	ut_asserteq(-ENOMEM, of_live_expand(root));
+	malloc_disable_testing();
+	ut_assertnull(root->child);
+	ut_assert(root->flags & OF_NODE_UNEXPANDED);
+	ut_assertok(of_live_get_stats(root, &stats));
+	ut_asserteq(1, stats.nodes);
+#endif
+	tree = oftree_from_np(root);
+
+	/* a path lookup only expands the nodes along the path */
+	node = oftree_path(tree, "/i2c@0/rtc@43");
+	ut_assert(ofnode_valid(node));
+	ut_asserteq_str("/i2c@0/rtc@43", ofnode_to_np(node)->full_name);
+	ut_asserteq_str("rtc@43", ofnode_get_name(node));
+	ut_assertok(of_live_get_stats(root, &stats));
+	ut_assert(stats.nodes < stats.total_nodes);
+
+	/* searches must find the same nodes as in the flat tree */
+	np = root;
+	for (ofs = fdt_node_offset_by_compatible(fdt, -1, compat); ofs >= 0;
+	     ofs = fdt_node_offset_by_compatible(fdt, ofs, compat)) {
+		np = of_find_compatible_node(np, NULL, compat);
+		ut_assertnonnull(np);
+		ut_assertok(fdt_get_path(fdt, ofs, path, sizeof(path)));
+		ut_asserteq_str(path, np->full_name);
+	}
+	ut_assertnull(of_find_compatible_node(np, NULL, compat));
+
+	for (ofs = 0; ofs >= 0; ofs = fdt_next_node(fdt, ofs, NULL)) {
+		phandle = fdt_get_phandle(fdt, ofs);
+		if (!phandle)
+			continue;
+		np = of_find_node_by_phandle(root, phandle);
+		ut_assertnonnull(np);
+		ut_asserteq(phandle, np->phandle);
+		ut_assertok(fdt_get_path(fdt, ofs, path, sizeof(path)));
+		ut_asserteq_str(path, np->full_name);
+	}
+
+	/* walking the whole tree creates every node */
+	for (np = root, count = 0; np; np = of_find_all_nodes(np))
+		count++;
+	ut_assertok(of_live_get_stats(root, &stats));
+	ut_asserteq(stats.total_nodes, count);
+	ut_asserteq(stats.total_nodes, stats.nodes);
+	of_live_free(root);
+
+	return 0;
+}
+DM_TEST(dm_test_livetree_lazy, UT_TESTF_LIVE_TREE);
+
 /* check that it is possible to load an arbitrary livetree */
 static int dm_test_livetree_ensure(struct unit_test_state *uts)
 {
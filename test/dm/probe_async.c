@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for probing devices in the background
+ */
+
+#include <common.h>
+#include <cyclic.h>
+#include <dm.h>
+#include <time.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+/* Number of polls before a test device is ready */
+#define ASYNC_TEST_POLLS	3
+
+struct async_test_priv {
+	int polls;
+};
+
+static int async_test_probe(struct udevice *dev)
+{
+	return -EINPROGRESS;
+}
+
+static int async_test_probe_poll(struct udevice *dev)
+{
+	struct async_test_priv *priv = dev_get_priv(dev);
+
+	if (++priv->polls < ASYNC_TEST_POLLS)
+		return -EAGAIN;
+
+	return strcmp(dev->name, "fail") ? 0 : -EIO;
+}
+
+U_BOOT_DRIVER(async_test_drv) = {
+	.name		= "async_test",
+	.id		= UCLASS_NOP,
+	.probe		= async_test_probe,
+	.probe_poll	= async_test_probe_poll,
+	.priv_auto	= sizeof(struct async_test_priv),
+};
+
+static int bind_async(struct udevice *parent, const char *name,
+		      struct udevice **devp)
+{
+	return device_bind(parent, DM_DRIVER_GET(async_test_drv), name, NULL,
+			   ofnode_null(), devp);
+}
+
+static bool probe_pending(struct udevice *dev)
+{
+	return dev_get_flags(dev) & DM_FLAG_PROBE_PENDING;
+}
+
+static int polls(struct udevice *dev)
+{
+	struct async_test_priv *priv = dev_get_priv(dev);
+
+	return priv ? priv->polls : -1;
+}
+
+/* Test that devices probe together and that a child waits for its parent */
+static int dm_test_probe_async(struct unit_test_state *uts)
+{
+	struct udevice *dev1, *dev2, *child;
+
+	ut_assertok(bind_async(dm_root(), "async1", &dev1));
+	ut_assertok(bind_async(dm_root(), "async2", &dev2));
+	ut_assertok(bind_async(dev1, "child", &child));
+
+	ut_assertok(device_probe_async(dev1));
+	ut_assertok(device_probe_async(dev2));
+	ut_assertok(device_probe_async(child));
+	ut_assert(probe_pending(dev1));
+	ut_assert(probe_pending(dev2));
+	ut_assert(probe_pending(child));
+	ut_assert(!device_active(dev1));
+	ut_assert(!device_active(dev2));
+	ut_assert(!device_active(child));
+	ut_asserteq(0, polls(dev1));
+	ut_asserteq(0, polls(dev2));
+
+	/* the child has not started probing since its parent is not ready */
+	ut_asserteq(-1, polls(child));
+
+	/* waiting for one device lets the others make progress */
+	ut_assertok(device_probe(dev1));
+	ut_assert(!probe_pending(dev1));
+	ut_assert(device_active(dev1));
+	ut_asserteq(ASYNC_TEST_POLLS, polls(dev1));
+	ut_assert(polls(dev2) > 0);
+	ut_assert(probe_pending(child));
+
+	ut_assertok(dm_probe_wait_all());
+	ut_assert(!probe_pending(dev2));
+	ut_assert(!probe_pending(child));
+	ut_assert(device_active(dev2));
+	ut_assert(device_active(child));
+	ut_asserteq(ASYNC_TEST_POLLS, polls(dev2));
+	ut_asserteq(ASYNC_TEST_POLLS, polls(child));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async, 0);
+
+/* Test that devices finish probing from the cyclic function */
+static int dm_test_probe_async_cyclic(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	ulong start;
+
+	ut_assertok(bind_async(dm_root(), "async", &dev));
+	ut_assertok(device_probe_async(dev));
+	ut_assert(probe_pending(dev));
+
+	start = get_timer(0);
+	while (probe_pending(dev) && get_timer(start) < 1000)
+		schedule();
+	ut_assert(!probe_pending(dev));
+	ut_assert(device_active(dev));
+	ut_asserteq(ASYNC_TEST_POLLS, polls(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_cyclic, 0);
+
+/* Test failure to probe and removing devices which are still probing */
+static int dm_test_probe_async_remove(struct unit_test_state *uts)
+{
+	struct udevice *dev, *child;
+
+	ut_assertok(bind_async(dm_root(), "fail", &dev));
+	ut_assertok(device_probe_async(dev));
+	ut_asserteq(-EIO, device_probe(dev));
+	ut_assert(!probe_pending(dev));
+	ut_assert(!device_active(dev));
+
+	/* removing a device waits for it, so that its driver can stop it */
+	ut_assertok(bind_async(dm_root(), "async", &dev));
+	ut_assertok(bind_async(dev, "child", &child));
+	ut_assertok(device_probe_async(child));
+	ut_assert(probe_pending(dev));
+	ut_assert(probe_pending(child));
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assert(!probe_pending(dev));
+	ut_assert(!probe_pending(child));
+	ut_assert(!device_active(dev));
+	ut_assert(!device_active(child));
+	ut_asserteq(-1, polls(child));
+
+	/* a device waiting for its parent can be unbound */
+	ut_assertok(device_probe_async(child));
+	ut_assert(probe_pending(child));
+	ut_assertok(device_unbind(child));
+	ut_assertok(dm_probe_wait_all());
+	ut_assert(device_active(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_remove, 0);
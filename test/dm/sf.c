@@ -7,14 +7,18 @@
 #include <command.h>
 #include <dm.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <mtd.h>
 #include <os.h>
 #include <spi.h>
 #include <spi_flash.h>
+#include <time.h>
 #include <asm/state.h>
 #include <asm/test.h>
 #include <dm/test.h>
 #include <dm/util.h>
+#include <linux/mtd/spi-nor.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -75,6 +79,265 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_spi_flash, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* Test that reads go through the controller's direct mapping */
+static int dm_test_spi_flash_dirmap(struct unit_test_state *uts)
+{
+	int full_size = 0x200000;
+	int size = 0x20000;
+	struct spi_flash *flash;
+	struct udevice *dev;
+	u8 *src, *dst;
+	uint reads;
+
+	if (!CONFIG_IS_ENABLED(SPI_DIRMAP))
+		return -EAGAIN;
+
+	src = map_sysmem(0x20000, full_size);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	flash = dev_get_uclass_priv(dev);
+
+	/* sandbox maps reads only, so writes fall back to plain operations */
+	ut_assertnonnull(flash->dirmap.rdesc);
+	ut_assert(!flash->dirmap.rdesc->nodirmap);
+	ut_assertnonnull(flash->dirmap.wdesc);
+	ut_assert(flash->dirmap.wdesc->nodirmap);
+
+	/* 0x8000-0x27fff spans three 64KB windows, so needs three mapped reads */
+	reads = sandbox_spi_get_dirmap_reads(dev->parent);
+	dst = map_sysmem(0x20000 + full_size, full_size);
+	ut_assertok(spi_flash_read_dm(dev, 0x8000, size, dst));
+	ut_asserteq_mem(src + 0x8000, dst, size);
+	ut_asserteq(reads + 3, sandbox_spi_get_dirmap_reads(dev->parent));
+
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_dirmap, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/*
+ * Read @size bytes from the flash, setting @kbps to the throughput in KB/s.
+ * Returns 0 on success, or -ve error from the read
+ */
+static int bench_read(struct udevice *dev, int size, void *dst, ulong *kbps)
+{
+	ulong start, us;
+	int ret;
+
+	memset(dst, '\0', size);
+	start = timer_get_us();
+	ret = spi_flash_read_dm(dev, 0, size, dst);
+	if (ret)
+		return ret;
+	us = max(timer_get_us() - start, 1UL);
+	*kbps = (ulong)size * 1000 / 1024 * 1000 / us;
+
+	return 0;
+}
+
+/* Compare read throughput for each way of reading the flash */
+static int dm_test_spi_flash_bench(struct unit_test_state *uts)
+{
+	struct spi_mem_dirmap_desc *rdesc;
+	int full_size = 0x200000;
+	int size = 0x100000;
+	struct spi_flash *flash;
+	struct udevice *dev;
+	u8 opcode, dummy;
+	u8 *src, *dst;
+	ulong kbps;
+	int ret;
+
+	src = map_sysmem(0x20000, full_size);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	flash = dev_get_uclass_priv(dev);
+	dst = map_sysmem(0x20000 + full_size, full_size);
+	opcode = flash->read_opcode;
+	dummy = flash->read_dummy;
+	rdesc = flash->dirmap.rdesc;
+
+	flash->read_opcode = SPINOR_OP_READ;
+	flash->read_dummy = 0;
+	ut_assertok(bench_read(dev, size, dst, &kbps));
+	ut_asserteq_mem(src, dst, size);
+	printf("read:                 %lu KB/s\n", kbps);
+	flash->read_opcode = SPINOR_OP_READ_FAST;
+	flash->read_dummy = 8;
+	ut_assertok(bench_read(dev, size, dst, &kbps));
+	ut_asserteq_mem(src, dst, size);
+	printf("fast read:            %lu KB/s\n", kbps);
+	if (rdesc) {
+		flash->dirmap.rdesc = NULL;
+		ret = bench_read(dev, size, dst, &kbps);
+		flash->dirmap.rdesc = rdesc;
+		ut_assertok(ret);
+		ut_asserteq_mem(src, dst, size);
+		printf("fast read, no dirmap: %lu KB/s\n", kbps);
+	}
+
+	flash->read_opcode = opcode;
+	flash->read_dummy = dummy;
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_bench, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that updating the flash only erases and writes what changed */
+static int dm_test_spi_flash_update(struct unit_test_state *uts)
+{
+	struct mtd_update_stats stats;
+	int full_size = 0x200000;
+	int size = 0x10000;
+	struct spi_flash *flash;
+	struct mtd_info *mtd;
+	struct udevice *dev;
+	u8 *buf, *dst;
+	int i, sectors;
+
+	buf = calloc(1, full_size);
+	ut_assertnonnull(buf);
+	ut_assertok(os_write_file("spi.bin", buf, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	flash = dev_get_uclass_priv(dev);
+	mtd = &flash->mtd;
+	sectors = size / mtd->erasesize;
+	for (i = 0; i < size; i++)
+		buf[i] = i * 7;
+
+	/* everything must be erased the first time */
+	ut_assertok(mtd_update(mtd, 0, size, 0, buf, MTD_UPDATE_VERIFY,
+			       &stats));
+	ut_asserteq(sectors, stats.erased);
+	ut_asserteq(0, stats.erase_skipped);
+	ut_asserteq(size, stats.written);
+
+	/* now nothing needs doing */
+	ut_assertok(mtd_update(mtd, 0, size, 0, buf, 0, &stats));
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(0, stats.written);
+	ut_asserteq(size, stats.skipped);
+
+	/* clearing bits just programs the page */
+	buf[0x1234] = 0;
+	ut_assertok(mtd_update(mtd, 0, size, 0, buf, 0, &stats));
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(1, stats.erase_skipped);
+	ut_asserteq(mtd->writebufsize, stats.written);
+
+	/* setting bits needs the sector erased and rewritten */
+	buf[0x5678] = 0xff;
+	ut_assertok(mtd_update(mtd, 0, size, 0, buf, 0, &stats));
+	ut_asserteq(1, stats.erased);
+	ut_asserteq(mtd->erasesize, stats.written);
+
+	dst = malloc(size);
+	ut_assertnonnull(dst);
+	ut_assertok(spi_flash_read_dm(dev, 0, size, dst));
+	ut_asserteq_mem(buf, dst, size);
+
+	/* erasing skips sectors which are already erased */
+	ut_assertok(mtd_update(mtd, 0, size, 0, NULL, 0, &stats));
+	ut_asserteq(sectors, stats.erased);
+	ut_asserteq(0, stats.written);
+	ut_assertok(mtd_update(mtd, 0, size, 0, NULL, 0, &stats));
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(size, stats.skipped);
+
+	/* and writing to erased sectors needs no erase */
+	ut_assertok(mtd_update(mtd, 0, size, 0, buf, 0, &stats));
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(sectors, stats.erase_skipped);
+	ut_assertok(spi_flash_read_dm(dev, 0, size, dst));
+	ut_asserteq_mem(buf, dst, size);
+
+	/* flash which is not bit-writeable, like NAND, is always erased */
+	mtd->flags &= ~MTD_BIT_WRITEABLE;
+	ut_assertok(mtd_update(mtd, 0, size, 0, NULL, 0, &stats));
+	buf[0x1234] = 0x55;
+	ut_assertok(mtd_update(mtd, 0, size, 0, buf, 0, &stats));
+	mtd->flags |= MTD_BIT_WRITEABLE;
+	ut_asserteq(sectors, stats.erased);
+	ut_asserteq(0, stats.erase_skipped);
+	ut_assertok(spi_flash_read_dm(dev, 0, size, dst));
+	ut_asserteq_mem(buf, dst, size);
+
+	free(dst);
+	free(buf);
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_update, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Attach UBI to the flash, checking whether it scans or uses the cache */
+static int attach_ubi(struct unit_test_state *uts, const char *name,
+		      const char *opt, bool scan)
+{
+	ut_assertok(run_command("ubi detach", 0));
+	console_record_reset_enable();
+	ut_assertok(run_commandf("ubi part %s%s", name, opt));
+	if (scan)
+		ut_assert_skip_to_line("ubi0: scanning is finished");
+	else
+		ut_assert_skip_to_line("ubi0: attached from cache of earlier scan");
+	console_record_reset();
+
+	return 0;
+}
+
+/* Test that attaching UBI again uses the result of the earlier scan */
+static int dm_test_spi_flash_ubi_cache(struct unit_test_state *uts)
+{
+	int full_size = 0x200000;
+	struct spi_flash *flash;
+	struct udevice *dev;
+	const char *name;
+	u8 *buf;
+
+	if (!CONFIG_IS_ENABLED(CMD_UBI) ||
+	    !CONFIG_IS_ENABLED(MTD_UBI_ATTACH_CACHE) ||
+	    !CONFIG_IS_ENABLED(SPI_FLASH_MTD))
+		return -EAGAIN;
+
+	buf = malloc(full_size);
+	ut_assertnonnull(buf);
+	memset(buf, '\xff', full_size);
+	ut_assertok(os_write_file("spi.bin", buf, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	flash = dev_get_uclass_priv(dev);
+	name = flash->mtd.name;
+
+	/* the file was written behind MTD's back, so drop anything cached */
+	ut_assertok(spi_flash_erase_dm(dev, 0, flash->mtd.erasesize));
+
+	/* the first attach formats the flash, so the second must scan too */
+	ut_assertok(attach_ubi(uts, name, "", true));
+	ut_assertok(attach_ubi(uts, name, "", true));
+	ut_assertok(attach_ubi(uts, name, "", false));
+
+	/* a forced scan ignores the cache, but refreshes it */
+	ut_assertok(attach_ubi(uts, name, " --scan", true));
+	ut_assertok(attach_ubi(uts, name, "", false));
+
+	/* rewriting a sector through SPI flash discards the cache */
+	ut_assertok(run_command("ubi detach", 0));
+	ut_assertok(spi_flash_read_dm(dev, 0, flash->mtd.erasesize, buf));
+	ut_assertok(spi_flash_erase_dm(dev, 0, flash->mtd.erasesize));
+	ut_assertok(spi_flash_write_dm(dev, 0, flash->mtd.erasesize, buf));
+	ut_assertok(attach_ubi(uts, name, "", true));
+	ut_assertok(attach_ubi(uts, name, "", false));
+
+	ut_assertok(run_command("ubi detach", 0));
+	free(buf);
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_ubi_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
 /* Functional test that sandbox SPI flash works correctly */
 static int dm_test_spi_flash_func(struct unit_test_state *uts)
 {
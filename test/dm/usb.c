@@ -6,6 +6,7 @@
 #include <common.h>
 #include <console.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <usb.h>
 #include <asm/io.h>
@@ -85,6 +86,80 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_flash, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* Test that a flash stick offering UAS uses it, queuing several commands */
+static int dm_test_usb_uas(struct unit_test_state *uts)
+{
+	struct udevice *emul, *dev, *blk;
+	const int count = 4096;
+	char *buf, *cmp;
+
+	if (!IS_ENABLED(CONFIG_USB_STORAGE_UAS))
+		return -EAGAIN;
+
+	buf = malloc(count * 512);
+	cmp = malloc(count * 512);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(cmp);
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					      &emul));
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(device_find_first_child_by_uclass(dev, UCLASS_BLK, &blk));
+
+	/* large enough that it needs more than one command */
+	ut_asserteq(count, blk_read(blk, 0, count, buf));
+	ut_asserteq_str("this is a test", buf);
+	ut_assert(sandbox_flash_get_uas_depth(emul) >= 2);
+
+	/* the same data must come back in pieces, in any order */
+	ut_asserteq(count / 2, blk_read(blk, count / 2, count / 2, cmp));
+	ut_asserteq_mem(buf + count / 2 * 512, cmp, count / 2 * 512);
+
+	strcpy(cmp, "uas test");
+	ut_asserteq(1, blk_write(blk, 1, 1, cmp));
+	memset(cmp, '\0', 1024);
+	ut_asserteq(2, blk_read(blk, 0, 2, cmp));
+	ut_asserteq_str("this is a test", cmp);
+	ut_asserteq_str("uas test", cmp + 512);
+	ut_asserteq(1, blk_write(blk, 1, 1, buf + 512));
+	ut_assertok(usb_stop());
+
+	free(cmp);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_usb_uas, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that Bulk-Only Transport is used if the stick will not select UAS */
+static int dm_test_usb_uas_fallback(struct unit_test_state *uts)
+{
+	struct udevice *emul, *dev, *blk;
+	char cmp[1024];
+
+	if (!IS_ENABLED(CONFIG_USB_STORAGE_UAS))
+		return -EAGAIN;
+
+	ut_assertok(uclass_find_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					       &emul));
+	sandbox_flash_refuse_uas(emul, true);
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(device_find_first_child_by_uclass(dev, UCLASS_BLK, &blk));
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_read(blk, 0, 2, cmp));
+	ut_asserteq_str("this is a test", cmp);
+	ut_asserteq(0, sandbox_flash_get_uas_depth(emul));
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_uas_fallback, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
 /* test that we can handle multiple storage devices */
 static int dm_test_usb_multi(struct unit_test_state *uts)
 {
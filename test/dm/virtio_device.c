@@ -5,6 +5,7 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
@@ -196,3 +197,167 @@ static int dm_test_virtio_ring(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_virtio_ring, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test indirect descriptors with a split virtqueue */
+static int dm_test_virtio_ring_indirect(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct virtqueue *vq;
+	struct vring_desc *indir;
+	struct virtio_sg sg[2];
+	struct virtio_sg *sgs[2], *long_sgs[5];
+	unsigned int len;
+	u8 buffer[2][32];
+	int i, ret;
+
+	ut_assertok(uclass_first_device_err(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+
+	sg[0].addr = buffer[0];
+	sg[0].length = sizeof(buffer[0]);
+	sg[1].addr = buffer[1];
+	sg[1].length = sizeof(buffer[1]);
+	sgs[0] = &sg[0];
+	sgs[1] = &sg[1];
+
+	__virtio_set_bit(bus, VIRTIO_RING_F_INDIRECT_DESC);
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_asserteq(true, vq->indirect);
+
+	/* the chain takes a single ring entry */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 1));
+	ut_asserteq(3, vq->num_free);
+	ut_asserteq(VRING_DESC_F_INDIRECT,
+		    virtio16_to_cpu(dev, vq->vring.desc[0].flags));
+	ut_asserteq(2 * sizeof(struct vring_desc),
+		    virtio32_to_cpu(dev, vq->vring.desc[0].len));
+	indir = (void *)(uintptr_t)virtio64_to_cpu(dev, vq->vring.desc[0].addr);
+	ut_asserteq_ptr(buffer[0], (void *)(uintptr_t)
+			virtio64_to_cpu(dev, indir[0].addr));
+	ut_asserteq(VRING_DESC_F_NEXT, virtio16_to_cpu(dev, indir[0].flags));
+	ut_asserteq_ptr(buffer[1], (void *)(uintptr_t)
+			virtio64_to_cpu(dev, indir[1].addr));
+	ut_asserteq(VRING_DESC_F_WRITE, virtio16_to_cpu(dev, indir[1].flags));
+
+	vq->vring.used->idx = 1;
+	vq->vring.used->ring[0].id = 0;
+	vq->vring.used->ring[0].len = 32;
+	ut_asserteq_ptr(buffer, virtqueue_get_buf(vq, &len));
+	ut_asserteq(32, len);
+	ut_asserteq(4, vq->num_free);
+
+	/* without memory for a table, a chain longer than the ring is refused */
+	for (i = 0; i < ARRAY_SIZE(long_sgs); i++)
+		long_sgs[i] = &sg[i & 1];
+	malloc_enable_testing(0);
+	ret = virtqueue_add(vq, long_sgs, 3, 2);
+	malloc_disable_testing();
+	ut_asserteq(-ENOSPC, ret);
+	ut_asserteq(4, vq->num_free);
+	ut_assertok(virtio_del_vqs(dev));
+	__virtio_clear_bit(bus, VIRTIO_RING_F_INDIRECT_DESC);
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_indirect, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Mark a packed descriptor as used by the device */
+static void packed_desc_used(struct virtqueue *vq, uint idx, u16 id, u32 len,
+			     bool wrap)
+{
+	u16 flags = wrap ? BIT(VRING_PACKED_DESC_F_AVAIL) |
+		BIT(VRING_PACKED_DESC_F_USED) : 0;
+
+	vq->packed_ring.desc[idx].id = cpu_to_le16(id);
+	vq->packed_ring.desc[idx].len = cpu_to_le32(len);
+	vq->packed_ring.desc[idx].flags = cpu_to_le16(flags);
+}
+
+/* Test a packed virtqueue */
+static int dm_test_virtio_ring_packed(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct vring_packed_desc *desc;
+	struct virtqueue *vq;
+	struct virtio_sg sg[2];
+	struct virtio_sg *sgs[2];
+	unsigned int len;
+	u8 buffer[2][32];
+
+	ut_assertok(uclass_first_device_err(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+
+	sg[0].addr = buffer[0];
+	sg[0].length = sizeof(buffer[0]);
+	sg[1].addr = buffer[1];
+	sg[1].length = sizeof(buffer[1]);
+	sgs[0] = &sg[0];
+	sgs[1] = &sg[1];
+
+	__virtio_set_bit(bus, VIRTIO_F_RING_PACKED);
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_asserteq(true, vq->packed);
+	ut_asserteq(4, virtqueue_get_vring_size(vq));
+	desc = vq->packed_ring.desc;
+	ut_asserteq(virtqueue_get_desc_addr(vq), (ulong)desc);
+	ut_asserteq(VRING_PACKED_EVENT_FLAG_DISABLE,
+		    le16_to_cpu(vq->packed_ring.driver->flags));
+
+	/* a single buffer is made available with the wrap counter set */
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	ut_asserteq(BIT(VRING_PACKED_DESC_F_AVAIL) | VRING_DESC_F_WRITE,
+		    le16_to_cpu(desc[0].flags));
+	ut_asserteq_ptr(buffer[0], (void *)(uintptr_t)le64_to_cpu(desc[0].addr));
+	ut_assertnull(virtqueue_get_buf(vq, &len));
+	packed_desc_used(vq, 0, 0, 0x53355885, true);
+	ut_asserteq_ptr(buffer[0], virtqueue_get_buf(vq, &len));
+	ut_asserteq(0x53355885, len);
+	ut_asserteq(4, vq->num_free);
+
+	/* a chain uses consecutive descriptors with the same ID */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 1));
+	ut_asserteq(BIT(VRING_PACKED_DESC_F_AVAIL) | VRING_DESC_F_NEXT,
+		    le16_to_cpu(desc[1].flags));
+	ut_asserteq(BIT(VRING_PACKED_DESC_F_AVAIL) | VRING_DESC_F_WRITE,
+		    le16_to_cpu(desc[2].flags));
+	ut_asserteq(le16_to_cpu(desc[1].id), le16_to_cpu(desc[2].id));
+	packed_desc_used(vq, 1, le16_to_cpu(desc[1].id), 6, true);
+	ut_asserteq_ptr(buffer[0], virtqueue_get_buf(vq, &len));
+	ut_asserteq(6, len);
+
+	/* the next chain wraps around the end of the ring */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 1));
+	ut_asserteq(false, vq->avail_wrap_counter);
+	ut_asserteq(BIT(VRING_PACKED_DESC_F_USED) | VRING_DESC_F_WRITE,
+		    le16_to_cpu(desc[0].flags));
+	packed_desc_used(vq, 3, le16_to_cpu(desc[3].id), 7, true);
+	ut_asserteq_ptr(buffer[0], virtqueue_get_buf(vq, &len));
+	ut_asserteq(7, len);
+	ut_asserteq(1, vq->last_used_idx);
+	ut_asserteq(false, vq->used_wrap_counter);
+
+	/* used flags from the previous lap are not mistaken for new ones */
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	ut_assertnull(virtqueue_get_buf(vq, &len));
+	packed_desc_used(vq, 1, le16_to_cpu(desc[1].id), 8, false);
+	ut_asserteq_ptr(buffer[0], virtqueue_get_buf(vq, &len));
+	ut_asserteq(8, len);
+	ut_asserteq(4, vq->num_free);
+
+	/* IDs out of range are rejected */
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	packed_desc_used(vq, 2, 4, 0, false);
+	ut_assertnull(virtqueue_get_buf(vq, &len));
+
+	ut_assertok(virtio_del_vqs(dev));
+	__virtio_clear_bit(bus, VIRTIO_F_RING_PACKED);
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_packed, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
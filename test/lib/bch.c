@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests and benchmark for BCH error correction
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <rand.h>
+#include <time.h>
+#include <linux/bch.h>
+#include <test/lib.h>
+#include <test/ut.h>
+
+#define SECTOR_SIZE	512
+#define BENCH_SECTORS	2000
+
+/* (m, t) pairs as used by NAND drivers */
+static const struct {
+	int m;
+	int t;
+} bch_params[] = {
+	{ 13, 4 },
+	{ 13, 8 },
+	{ 14, 16 },
+	{ 14, 24 },
+};
+
+/* Flip @count different random bits in @data */
+static void add_errors(u8 *data, int len, int count)
+{
+	int flipped[64];
+	int i, j, bit;
+
+	for (i = 0; i < count; i++) {
+		do {
+			bit = rand() % (len * 8);
+			for (j = 0; j < i && flipped[j] != bit; j++)
+				;
+		} while (j < i);
+		flipped[i] = bit;
+		data[bit / 8] ^= 1 << (bit % 8);
+	}
+}
+
+/* Apply the corrections reported by decode_bch() */
+static void correct(u8 *data, int len, const uint *errloc, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (errloc[i] < len * 8)
+			data[errloc[i] / 8] ^= 1 << (errloc[i] % 8);
+	}
+}
+
+static int check_params(struct unit_test_state *uts, int m, int t)
+{
+	u8 orig[SECTOR_SIZE], data[SECTOR_SIZE];
+	u8 ecc[64], calc[64];
+	struct bch_control *bch;
+	uint errloc[64];
+	int i, nerr, ret;
+
+	bch = init_bch(m, t, 0);
+	ut_assertnonnull(bch);
+
+	for (i = 0; i < SECTOR_SIZE; i++)
+		orig[i] = rand();
+	memset(ecc, '\0', bch->ecc_bytes);
+	encode_bch(bch, orig, SECTOR_SIZE, ecc);
+
+	for (nerr = 0; nerr <= t; nerr++) {
+		/* let the decoder compute the ecc */
+		memcpy(data, orig, SECTOR_SIZE);
+		add_errors(data, SECTOR_SIZE, nerr);
+		ret = decode_bch(bch, data, SECTOR_SIZE, ecc, NULL, NULL,
+				 errloc);
+		ut_asserteq(nerr, ret);
+		correct(data, SECTOR_SIZE, errloc, ret);
+		ut_asserteq_mem(orig, data, SECTOR_SIZE);
+
+		/* provide the ecc XORed with the received ecc */
+		add_errors(data, SECTOR_SIZE, nerr);
+		memset(calc, '\0', bch->ecc_bytes);
+		encode_bch(bch, data, SECTOR_SIZE, calc);
+		for (i = 0; i < bch->ecc_bytes; i++)
+			calc[i] ^= ecc[i];
+		ret = decode_bch(bch, NULL, SECTOR_SIZE, NULL, calc, NULL,
+				 errloc);
+		ut_asserteq(nerr, ret);
+		correct(data, SECTOR_SIZE, errloc, ret);
+		ut_asserteq_mem(orig, data, SECTOR_SIZE);
+	}
+	free_bch(bch);
+
+	return 0;
+}
+
+/* Test that errors are found and corrected for various code parameters */
+static int lib_test_bch(struct unit_test_state *uts)
+{
+	int i;
+
+	srand(1234);
+	for (i = 0; i < ARRAY_SIZE(bch_params); i++) {
+		ut_assertok(check_params(uts, bch_params[i].m,
+					 bch_params[i].t));
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_bch, 0);
+
+/* Decode @BENCH_SECTORS sectors with @nerr errors, returning the time in us */
+static ulong bench_decode(struct bch_control *bch, const u8 *orig,
+			  const u8 *ecc, int nerr)
+{
+	u8 data[SECTOR_SIZE];
+	uint errloc[64];
+	ulong start, total = 0;
+	int i;
+
+	for (i = 0; i < BENCH_SECTORS; i++) {
+		memcpy(data, orig, SECTOR_SIZE);
+		add_errors(data, SECTOR_SIZE, nerr);
+		start = timer_get_us();
+		decode_bch(bch, data, SECTOR_SIZE, ecc, NULL, NULL, errloc);
+		total += timer_get_us() - start;
+	}
+
+	return total;
+}
+
+/* Compare decoding time with and without the syndrome tables */
+static int lib_test_bch_bench(struct unit_test_state *uts)
+{
+	u8 orig[SECTOR_SIZE], ecc[64];
+	struct bch_control *bch;
+	uint16_t *syn_tab;
+	ulong clean, tab_us, bit_us;
+	int i, p;
+
+	srand(5678);
+	for (i = 0; i < SECTOR_SIZE; i++)
+		orig[i] = rand();
+
+	for (p = 0; p < ARRAY_SIZE(bch_params); p++) {
+		int t = bch_params[p].t;
+
+		bch = init_bch(bch_params[p].m, t, 0);
+		ut_assertnonnull(bch);
+		memset(ecc, '\0', bch->ecc_bytes);
+		encode_bch(bch, orig, SECTOR_SIZE, ecc);
+
+		clean = bench_decode(bch, orig, ecc, 0);
+		tab_us = bench_decode(bch, orig, ecc, t / 2);
+
+		/* decode again the bit-at-a-time way, for comparison */
+		syn_tab = bch->syn_tab;
+		bch->syn_tab = NULL;
+		bit_us = bench_decode(bch, orig, ecc, t / 2);
+		bch->syn_tab = syn_tab;
+
+		printf("BCH m=%d t=%2d, %d sectors: clean %lu us, %d errors %lu us (%lu us without tables)\n",
+		       bch_params[p].m, t, BENCH_SECTORS, clean, t / 2, tab_us,
+		       bit_us);
+		free_bch(bch);
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_bch_bench, 0);
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for the sampling profiler
+ */
+
+#include <common.h>
+#include <cyclic.h>
+#include <malloc.h>
+#include <profile.h>
+#include <time.h>
+#include <trace.h>
+#include <asm/sections.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Time to spend taking samples */
+#define PROFILE_TEST_US		20000
+
+static noinline void profile_test_busy(void)
+{
+	schedule();
+}
+
+/* Check that samples are taken from schedule() and can be written out */
+static int lib_test_profile(struct unit_test_state *uts)
+{
+	struct trace_output_hdr *hdr;
+	struct trace_sample *sample;
+	struct profile_stats stats;
+	size_t size, needed;
+	ulong start, busy;
+	bool found;
+	int i;
+
+	start = timer_get_us();
+	ut_assertok(profile_start(100));
+	while (timer_get_us() - start < PROFILE_TEST_US)
+		profile_test_busy();
+	profile_stop();
+
+	ut_assertok(profile_get_stats(&stats));
+	ut_assert(stats.samples > 0);
+	ut_assert(stats.stacks > 0);
+	ut_asserteq(0, stats.dropped);
+	ut_assert(stats.time_us <= timer_get_us() - start);
+
+	/* Work out the size needed, then write the samples out */
+	ut_asserteq(-ENOSPC, profile_list_samples(NULL, 0, &size));
+	ut_asserteq(sizeof(*hdr) + stats.stacks * sizeof(*sample), size);
+	hdr = malloc(size);
+	ut_assertnonnull(hdr);
+	ut_assertok(profile_list_samples(hdr, size, &needed));
+	ut_asserteq(size, needed);
+	ut_asserteq(TRACE_CHUNK_SAMPLES, hdr->type);
+	ut_asserteq(TRACE_VERSION, hdr->version);
+	ut_asserteq(stats.stacks, hdr->rec_count);
+
+	/* Most of the time should be spent in the loop above */
+	busy = (ulong)profile_test_busy - (ulong)_init;
+	found = false;
+	sample = (struct trace_sample *)(hdr + 1);
+	for (i = 0; i < hdr->rec_count; i++, sample++) {
+		ut_assert(sample->depth > 0);
+		ut_assert(sample->depth <= TRACE_SAMPLE_DEPTH);
+		if (sample->pc[0] > busy && sample->pc[0] < busy + 0x100)
+			found = true;
+	}
+	ut_assert(found);
+	free(hdr);
+
+	return 0;
+}
+LIB_TEST(lib_test_profile, 0);
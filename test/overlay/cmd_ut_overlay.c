@@ -211,6 +211,108 @@ static int fdt_overlay_stacked(struct unit_test_state *uts)
 }
 OVERLAY_TEST(fdt_overlay_stacked, 0);
 
+/* Number of times to apply the test overlays when applying a stack */
+#define STACK_REPEAT	10
+#define STACK_COUNT	(2 * STACK_REPEAT)
+#define STACK_SIZE	(16 * SZ_1K)
+
+/* Make fresh copies of the test overlays, since applying them damages them */
+static int copy_overlays(struct unit_test_state *uts, char *buf,
+			 void *fdtos[])
+{
+	void *src[] = {
+		&__dtb_test_fdt_overlay_begin,
+		&__dtb_test_fdt_overlay_stacked_begin,
+	};
+	int i;
+
+	for (i = 0; i < STACK_COUNT; i++) {
+		fdtos[i] = buf + i * FDT_COPY_SIZE;
+		ut_assertok(fdt_open_into(src[i % 2], fdtos[i], FDT_COPY_SIZE));
+	}
+
+	return 0;
+}
+
+/* Check that every node and property in @fdt is the same in @other */
+static int compare_trees(struct unit_test_state *uts, void *fdt, void *other)
+{
+	int node, prop, other_node, count, other_count;
+	char path[256];
+
+	for (node = 0; node >= 0; node = fdt_next_node(fdt, node, NULL)) {
+		ut_assertok(fdt_get_path(fdt, node, path, sizeof(path)));
+		other_node = fdt_path_offset(other, path);
+		ut_assert(other_node >= 0);
+
+		count = 0;
+		fdt_for_each_property_offset(prop, fdt, node) {
+			const void *val, *other_val;
+			int len, other_len;
+			const char *name;
+
+			val = fdt_getprop_by_offset(fdt, prop, &name, &len);
+			other_val = fdt_getprop(other, other_node, name,
+						&other_len);
+			ut_assertnonnull(other_val);
+			ut_asserteq(len, other_len);
+			ut_asserteq_mem(val, other_val, len);
+			count++;
+		}
+		other_count = 0;
+		fdt_for_each_property_offset(prop, other, other_node)
+			other_count++;
+		ut_asserteq(count, other_count);
+	}
+
+	return 0;
+}
+
+/*
+ * Apply the test overlays a number of times, one at a time and as a stack,
+ * checking that the resulting trees are the same
+ */
+static int fdt_overlay_stack(struct unit_test_state *uts)
+{
+	void *fdt_base = &__dtb_test_fdt_base_begin;
+	void *fdtos[STACK_COUNT], *seq, *stack;
+	char *buf;
+	u32 val;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_OF_LIBFDT_OVERLAY_STACK))
+		return -EAGAIN;
+
+	buf = malloc(STACK_COUNT * FDT_COPY_SIZE);
+	seq = malloc(STACK_SIZE);
+	stack = malloc(STACK_SIZE);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(seq);
+	ut_assertnonnull(stack);
+	ut_assertok(fdt_open_into(fdt_base, seq, STACK_SIZE));
+	ut_assertok(fdt_open_into(fdt_base, stack, STACK_SIZE));
+
+	ut_assertok(copy_overlays(uts, buf, fdtos));
+	for (i = 0; i < STACK_COUNT; i++)
+		ut_assertok(fdt_overlay_apply(seq, fdtos[i]));
+
+	ut_assertok(copy_overlays(uts, buf, fdtos));
+	ut_assertok(fdt_overlay_apply_stack(stack, fdtos, STACK_COUNT));
+
+	ut_assertok(compare_trees(uts, seq, stack));
+	ut_assertok(compare_trees(uts, stack, seq));
+	ut_assertok(ut_fdt_getprop_u32(stack, "/new-local-node",
+				       "stacked-test-int-property", &val));
+	ut_asserteq(43, val);
+
+	free(stack);
+	free(seq);
+	free(buf);
+
+	return CMD_RET_SUCCESS;
+}
+OVERLAY_TEST(fdt_overlay_stack, 0);
+
 int do_ut_overlay(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 {
 	struct unit_test *tests = UNIT_TEST_SUITE_START(overlay_test);
@@ -0,0 +1,96 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# U-Boot File System: ext4 hashed directory lookup test
+
+"""
+This test verifies that files in ext4 directories using a hash tree (htree)
+index are found, and that names absent from such a directory are not.
+"""
+
+import os
+import pytest
+import shutil
+import subprocess
+
+HTREE_SRC_DIR = 'ext4_htree_src_dir'
+HTREE_IMAGE_NAME = 'ext4_htree.img'
+HTREE_NUM_FILES = 3000
+
+def make_htree_image(build_dir):
+    """
+    Makes an ext4 image with one large, indexed directory.
+
+    The image is generated at build_dir with the following structure:
+    ext4_htree_src_dir/
+    └── big/
+        ├── file1.txt
+        ├── ...
+        └── file3000.txt
+
+    Each file contains its own name. e2fsck -D is run afterwards to build the
+    directory index, since mkfs.ext4 -d does not create one.
+    """
+    root = os.path.join(build_dir, HTREE_SRC_DIR)
+    big = os.path.join(root, 'big')
+    os.makedirs(big)
+    for i in range(1, HTREE_NUM_FILES + 1):
+        name = 'file%d.txt' % i
+        with open(os.path.join(big, name), 'w') as fd:
+            fd.write(name)
+
+    image_path = os.path.join(build_dir, HTREE_IMAGE_NAME)
+    subprocess.run(['mkfs.ext4 -q -b 1024 -d %s %s 16M' % (root, image_path)],
+                   shell=True, check=True, stdout=subprocess.DEVNULL)
+    # e2fsck returns 1 when it has modified the filesystem
+    ret = subprocess.run(['e2fsck -fyD %s' % image_path], shell=True,
+                         stdout=subprocess.DEVNULL).returncode
+    assert ret in (0, 1)
+    out = subprocess.run(['debugfs -R "stat big" %s' % image_path],
+                         shell=True, check=True, capture_output=True,
+                         text=True).stdout
+    assert 'Flags: 0x81000' in out or 'Flags: 0x1000' in out
+
+def clean_htree_image(build_dir):
+    """
+    Deletes the image and src_dir at build_dir.
+    """
+    shutil.rmtree(os.path.join(build_dir, HTREE_SRC_DIR))
+    os.remove(os.path.join(build_dir, HTREE_IMAGE_NAME))
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('cmd_ext4')
+@pytest.mark.buildconfigspec('ext4_dir_index')
+@pytest.mark.requiredtool('mkfs.ext4')
+@pytest.mark.requiredtool('e2fsck')
+@pytest.mark.requiredtool('debugfs')
+def test_ext4_htree(u_boot_console):
+    """
+    Loads files from an indexed directory and checks negative lookups.
+    """
+    build_dir = u_boot_console.config.build_dir
+
+    try:
+        make_htree_image(build_dir)
+        image_path = os.path.join(build_dir, HTREE_IMAGE_NAME)
+        u_boot_console.run_command('host bind 0 %s' % image_path)
+
+        for i in (1, 2, 77, 1234, 2999, HTREE_NUM_FILES):
+            name = 'file%d.txt' % i
+            u_boot_console.run_command('setenv filesize')
+            out = u_boot_console.run_command(
+                'load host 0 $kernel_addr_r /big/%s' % name)
+            assert '%d bytes read' % len(name) in out
+
+            # the same lookup again is answered from the lookup cache
+            out = u_boot_console.run_command(
+                'size host 0 /big/%s; printenv filesize' % name)
+            assert 'filesize=%x' % len(name) in out
+
+        for name in ('file0.txt', 'file3001.txt', 'missing'):
+            out = u_boot_console.run_command(
+                'load host 0 $kernel_addr_r /big/%s' % name)
+            assert 'Failed to load' in out
+    finally:
+        u_boot_console.run_command('host unbind 0')
+        clean_htree_image(build_dir)
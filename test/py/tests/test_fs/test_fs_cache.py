@@ -0,0 +1,291 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# U-Boot File System: path lookup cache test
+
+"""
+This test verifies that the generic filesystem layer answers repeated lookups
+from its cache and discards cached paths when the filesystem is written or the
+medium changes, and that btrfs reuses compressed extents it decompressed
+recently.
+"""
+
+import os
+import pytest
+import re
+import shutil
+import subprocess
+import zlib
+
+CACHE_SRC_DIR = 'fs_cache_src_dir'
+CACHE_IMAGE_NAME = 'fs_cache.img'
+BTRFS_IMAGE_NAME = 'fs_cache_btrfs.img'
+
+def make_cache_image(build_dir, image_name=CACHE_IMAGE_NAME, size=1000):
+    """
+    Makes an ext4 image with a file of the given size in a subdirectory.
+    """
+    root = os.path.join(build_dir, CACHE_SRC_DIR)
+    os.makedirs(os.path.join(root, 'boot'), exist_ok=True)
+    with open(os.path.join(root, 'boot', 'vmlinuz'), 'w') as fd:
+        fd.write('x' * size)
+
+    image_path = os.path.join(build_dir, image_name)
+    subprocess.run(['mkfs.ext4 -q -O ^metadata_csum -d %s %s 4M' %
+                    (root, image_path)],
+                   shell=True, check=True, stdout=subprocess.DEVNULL)
+
+def clean_cache_image(build_dir, image_name=CACHE_IMAGE_NAME):
+    """
+    Deletes the image and src_dir at build_dir.
+    """
+    shutil.rmtree(os.path.join(build_dir, CACHE_SRC_DIR), ignore_errors=True)
+    image_path = os.path.join(build_dir, image_name)
+    if os.path.exists(image_path):
+        os.remove(image_path)
+
+def make_btrfs_image(build_dir, data):
+    """
+    Makes a btrfs image holding data in a compressed file.
+
+    Returns the path to the image, or None if mkfs.btrfs cannot compress
+    files it adds to the image.
+    """
+    root = os.path.join(build_dir, CACHE_SRC_DIR)
+    os.makedirs(os.path.join(root, 'boot'), exist_ok=True)
+    with open(os.path.join(root, 'boot', 'vmlinuz'), 'wb') as fd:
+        fd.write(data)
+
+    image_path = os.path.join(build_dir, BTRFS_IMAGE_NAME)
+    with open(image_path, 'wb') as fd:
+        fd.truncate(128 << 20)
+    try:
+        subprocess.run(['mkfs.btrfs -q --compress zstd --rootdir %s %s' %
+                        (root, image_path)],
+                       shell=True, check=True, stdout=subprocess.DEVNULL,
+                       stderr=subprocess.DEVNULL)
+    except subprocess.CalledProcessError:
+        return None
+    return image_path
+
+def check_crc(u_boot_console, data):
+    """
+    Checks that the data loaded at $kernel_addr_r matches the expected data
+    """
+    out = u_boot_console.run_command('crc32 $kernel_addr_r $filesize')
+    assert '==> %08x' % zlib.crc32(data) in out
+
+def get_stats(u_boot_console):
+    """
+    Returns the fscache statistics as a dict
+    """
+    out = u_boot_console.run_command('fscache')
+    return {m.group(1): int(m.group(2))
+            for m in re.finditer(r'^([a-z ]+): (\d+)', out, re.MULTILINE)}
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('fs_lookup_cache')
+@pytest.mark.buildconfigspec('cmd_ext4_write')
+@pytest.mark.requiredtool('mkfs.ext4')
+def test_fs_cache(u_boot_console):
+    """
+    Checks cache hits, use of the cache for loading and invalidation
+    """
+    build_dir = u_boot_console.config.build_dir
+
+    try:
+        make_cache_image(build_dir)
+        image_path = os.path.join(build_dir, CACHE_IMAGE_NAME)
+        u_boot_console.run_command('fscache flush')
+        u_boot_console.run_command('host bind 0 %s' % image_path)
+
+        out = u_boot_console.run_command(
+            'size host 0 /boot/vmlinuz; printenv filesize')
+        assert 'filesize=3e8' in out
+        before = get_stats(u_boot_console)
+        assert before['entries'] == 1
+
+        # The same path, with or without a leading slash, is a hit
+        out = u_boot_console.run_command(
+            'size host 0 boot/vmlinuz; printenv filesize')
+        assert 'filesize=3e8' in out
+        out = u_boot_console.run_command(
+            'load host 0 $kernel_addr_r /boot/vmlinuz')
+        assert '1000 bytes read' in out
+        after = get_stats(u_boot_console)
+        assert after['hits'] > before['hits']
+        assert after['entries'] == 1
+
+        # Writing to the filesystem discards what was cached
+        u_boot_console.run_command('mw.b $kernel_addr_r 55 10')
+        u_boot_console.run_command(
+            'save host 0 $kernel_addr_r /boot/vmlinuz 10')
+        stats = get_stats(u_boot_console)
+        assert stats['entries'] == 0
+        assert stats['invalidations'] > after['invalidations']
+
+        out = u_boot_console.run_command(
+            'size host 0 /boot/vmlinuz; printenv filesize')
+        assert 'filesize=10' in out
+
+        # So does removing the device
+        u_boot_console.run_command('host unbind 0')
+        assert get_stats(u_boot_console)['entries'] == 0
+    finally:
+        u_boot_console.run_command('host unbind 0')
+        clean_cache_image(build_dir)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('fs_lookup_cache')
+@pytest.mark.buildconfigspec('fs_mount_cache')
+@pytest.mark.buildconfigspec('cmd_ext4_write')
+@pytest.mark.requiredtool('mkfs.ext4')
+def test_fs_mount_cache(u_boot_console):
+    """
+    Checks that a filesystem stays mounted until it or its device changes
+    """
+    build_dir = u_boot_console.config.build_dir
+
+    try:
+        make_cache_image(build_dir)
+        image_path = os.path.join(build_dir, CACHE_IMAGE_NAME)
+        u_boot_console.run_command('fscache flush')
+        u_boot_console.run_command('host bind 0 %s' % image_path)
+
+        before = get_stats(u_boot_console)
+        for _ in range(3):
+            out = u_boot_console.run_command(
+                'load host 0 $kernel_addr_r /boot/vmlinuz')
+            assert '1000 bytes read' in out
+        out = u_boot_console.run_command('ls host 0 /boot')
+        assert 'vmlinuz' in out
+        # The first load sets up the device twice, the others once each
+        stats = get_stats(u_boot_console)
+        assert stats['mounts'] == before['mounts'] + 1
+        assert stats['mount reuses'] == before['mount reuses'] + 4
+
+        # Writing unmounts the filesystem, the next load probes it again
+        u_boot_console.run_command(
+            'save host 0 $kernel_addr_r /boot/vmlinuz 10')
+        after = get_stats(u_boot_console)
+        assert after['unmounts'] > stats['unmounts']
+        out = u_boot_console.run_command(
+            'load host 0 $kernel_addr_r /boot/vmlinuz')
+        assert '16 bytes read' in out
+        assert get_stats(u_boot_console)['mounts'] == after['mounts'] + 1
+
+        # So does flushing
+        u_boot_console.run_command('fscache flush')
+        after = get_stats(u_boot_console)
+        u_boot_console.run_command('size host 0 /boot/vmlinuz')
+        assert get_stats(u_boot_console)['mounts'] == after['mounts'] + 1
+    finally:
+        u_boot_console.run_command('host unbind 0')
+        clean_cache_image(build_dir)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('cmd_mmc')
+@pytest.mark.buildconfigspec('fs_lookup_cache')
+@pytest.mark.buildconfigspec('fs_mount_cache')
+@pytest.mark.requiredtool('mkfs.ext4')
+def test_fs_cache_medium_change(u_boot_console):
+    """
+    Checks that nothing cached is used once the medium in a device changes
+    """
+    cons = u_boot_console
+    build_dir = cons.config.build_dir
+    new_name = 'fs_cache_new.img'
+    mmc_image = os.path.join(cons.config.source_dir, 'mmc1.img')
+    saved = mmc_image + '.save'
+
+    try:
+        make_cache_image(build_dir)
+        make_cache_image(build_dir, new_name, 2000)
+
+        # mmc1 uses mmc1.img, which is only picked up when U-Boot starts
+        if os.path.exists(mmc_image):
+            os.rename(mmc_image, saved)
+        shutil.copyfile(os.path.join(build_dir, CACHE_IMAGE_NAME), mmc_image)
+        cons.restart_uboot()
+
+        out = cons.run_command('load mmc 1 $kernel_addr_r /boot/vmlinuz')
+        assert '1000 bytes read' in out
+        before = get_stats(cons)
+        assert before['entries'] == 1
+
+        # Swap the medium under the same device, as if a card were changed.
+        # The device maps the file, so it must be rewritten in place.
+        with open(os.path.join(build_dir, new_name), 'rb') as inf:
+            with open(mmc_image, 'r+b') as outf:
+                outf.write(inf.read())
+
+        # Naming an MMC device re-reads its partition table, which drops
+        # both the cached paths and the mount
+        out = cons.run_command('load mmc 1 $kernel_addr_r /boot/vmlinuz')
+        assert '2000 bytes read' in out
+        stats = get_stats(cons)
+        assert stats['invalidations'] > before['invalidations']
+        assert stats['mounts'] == before['mounts'] + 1
+    finally:
+        if os.path.exists(mmc_image):
+            os.remove(mmc_image)
+        if os.path.exists(saved):
+            os.rename(saved, mmc_image)
+        cons.restart_uboot()
+        clean_cache_image(build_dir)
+        clean_cache_image(build_dir, new_name)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('fs_lookup_cache')
+@pytest.mark.buildconfigspec('fs_mount_cache')
+@pytest.mark.buildconfigspec('fs_btrfs')
+@pytest.mark.requiredtool('mkfs.btrfs')
+def test_fs_cache_btrfs(u_boot_console):
+    """
+    Checks that a compressed btrfs extent is not decompressed again when it
+    is read a second time
+    """
+    cons = u_boot_console
+    build_dir = cons.config.build_dir
+    # Compressible, but with each part different, and not a whole number of
+    # sectors, so that the tail of the file is read on its own
+    data = b''.join(b'line %05d\n' % i for i in range(5000))[:50000]
+
+    try:
+        image_path = make_btrfs_image(build_dir, data)
+        if not image_path:
+            pytest.skip('mkfs.btrfs cannot make compressed files')
+        cons.run_command('fscache flush')
+        cons.run_command('host bind 0 %s' % image_path)
+
+        out = cons.run_command('load host 0 $kernel_addr_r /boot/vmlinuz')
+        assert '%d bytes read' % len(data) in out
+        check_crc(cons, data)
+        before = get_stats(cons)
+        assert before['btrfs extent misses']
+
+        # The filesystem is still mounted, so the extent is still cached
+        out = cons.run_command('load host 0 $kernel_addr_r /boot/vmlinuz')
+        assert '%d bytes read' % len(data) in out
+        check_crc(cons, data)
+        stats = get_stats(cons)
+        assert stats['mount reuses'] > before['mount reuses']
+        assert stats['btrfs extent hits'] > before['btrfs extent hits']
+        assert stats['btrfs extent misses'] == before['btrfs extent misses']
+
+        # Read part of the file, starting within a sector
+        offset, size = 0x2345, 0x1000
+        out = cons.run_command(
+            'load host 0 $kernel_addr_r /boot/vmlinuz %x %x' % (size, offset))
+        assert '%d bytes read' % size in out
+        check_crc(cons, data[offset:offset + size])
+        before = stats
+        stats = get_stats(cons)
+        assert stats['btrfs extent hits'] > before['btrfs extent hits']
+        assert stats['btrfs extent misses'] == before['btrfs extent misses']
+    finally:
+        cons.run_command('host unbind 0')
+        clean_cache_image(build_dir, BTRFS_IMAGE_NAME)
@@ -70,6 +70,9 @@ enum {
  * @OUT_FMT_FLAMEGRAPH_CALLS: Write a file suitable for flamegraph.pl
  * @OUT_FMT_FLAMEGRAPH_TIMING: Write a file suitable for flamegraph.pl with the
  * counts set to the number of microseconds used by each function
+ * @OUT_FMT_FLAMEGRAPH_SAMPLES: Write a file suitable for flamegraph.pl from the
+ * sampling profiler, with the counts set to the number of microseconds
+ * attributed to each call stack
  */
 enum out_format_t {
 	OUT_FMT_DEFAULT,
@@ -77,6 +80,7 @@ enum out_format_t {
 	OUT_FMT_FUNCGRAPH,
 	OUT_FMT_FLAMEGRAPH_CALLS,
 	OUT_FMT_FLAMEGRAPH_TIMING,
+	OUT_FMT_FLAMEGRAPH_SAMPLES,
 };
 
 /* Section types for v7 format (trace-cmd format) */
@@ -254,6 +258,8 @@ struct func_info *func_list;
 int func_count;			/* number of functions */
 struct trace_call *call_list;	/* list of all calls in the input trace file */
 int call_count;			/* number of calls */
+struct trace_sample *sample_list;	/* list of call stacks from profiler */
+int sample_count;		/* number of call stacks */
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 ulong text_offset;		/* text address of first function */
 ulong text_base;		/* CONFIG_TEXT_BASE from trace file */
@@ -292,7 +298,8 @@ static void usage(void)
 		"   -f <subtype>\tSpecify output subtype\n"
 		"   -m <map>\tSpecify Systen.map file\n"
 		"   -o <fname>\tSpecify output file\n"
-		"   -t <fname>\tSpecify trace data file (from U-Boot 'trace calls')\n"
+		"   -t <fname>\tSpecify trace data file (from U-Boot 'trace calls'\n"
+		"\t\tand/or 'profile dump')\n"
 		"   -v <0-4>\tSpecify verbosity\n"
 		"\n"
 		"Subtypes for dump-ftrace:\n"
@@ -301,7 +308,8 @@ static void usage(void)
 		"\n"
 		"Subtypes for dump-flamegraph\n"
 		"   calls - create a flamegraph of stack frames\n"
-		"   timing - create a flamegraph of microseconds for each stack frame\n");
+		"   timing - create a flamegraph of microseconds for each stack frame\n"
+		"   samples - create a flamegraph of microseconds from profiler samples\n");
 	exit(EXIT_FAILURE);
 }
 
@@ -483,6 +491,40 @@ static int read_calls(FILE *fin, size_t count)
 	return 0;
 }
 
+/**
+ * read_samples() - Read the list of call stacks from the trace data
+ *
+ * These are written by the sampling profiler, one after the other
+ *
+ * @fin: File to read from
+ * @count: Number of call stacks to read
+ * Returns: 0 if OK, -1 on error
+ */
+static int read_samples(FILE *fin, size_t count)
+{
+	struct trace_sample *sample;
+	int i;
+
+	notice("sample count: %zu\n", count);
+	sample_list = calloc(count, sizeof(*sample));
+	if (!sample_list) {
+		error("Cannot allocate sample_list\n");
+		return -1;
+	}
+	sample_count = count;
+
+	for (i = 0, sample = sample_list; i < count; i++, sample++) {
+		if (read_data(fin, sample, sizeof(*sample)))
+			return -1;
+		if (sample->depth > TRACE_SAMPLE_DEPTH) {
+			error("Sample %d has invalid depth %u\n", i,
+			      sample->depth);
+			return -1;
+		}
+	}
+	return 0;
+}
+
 /**
  * read_trace() - Read the U-Boot trace file
  *
@@ -515,6 +557,11 @@ static int read_trace(FILE *fin)
 			if (read_calls(fin, hdr.rec_count))
 				return 1;
 			break;
+
+		case TRACE_CHUNK_SAMPLES:
+			if (read_samples(fin, hdr.rec_count))
+				return 1;
+			break;
 		}
 	}
 	return 0;
@@ -1849,6 +1896,59 @@ static int output_tree(FILE *fout, enum out_format_t out_format,
 	return 0;
 }
 
+/**
+ * output_samples() - Output the call stacks from the sampling profiler
+ *
+ * Each call stack is written on a line with the outermost function first, in
+ * the same form as output_tree(), e.g.:
+ *
+ * board_init_r;run_main_loop;cli_loop;run_command_list;do_sleep;udelay 1234
+ *
+ * where the value is the number of microseconds attributed to the call stack.
+ * Call stacks which differ only in the call sites within each function produce
+ * identical lines, which flamegraph.pl adds together.
+ *
+ * @fout: Output file
+ * Returns 0 if OK, -1 on error
+ */
+static int output_samples(FILE *fout)
+{
+	struct trace_sample *sample;
+	char str[MAX_LINE_LEN];
+	int i;
+
+	for (i = 0, sample = sample_list; i < sample_count; i++, sample++) {
+		int j, pos = 0;
+
+		for (j = sample->depth - 1; j >= 0; j--) {
+			struct func_info *func;
+			int len;
+
+			func = find_caller_by_offset(sample->pc[j]);
+			if (!func) {
+				warn("Cannot find function at %lx\n",
+				     text_offset + sample->pc[j]);
+				continue;
+			}
+			len = strlen(func->name);
+			if (pos + len + 2 >= sizeof(str)) {
+				fprintf(stderr, "String too short (%zd chars)\n",
+					sizeof(str));
+				return -1;
+			}
+			if (pos)
+				str[pos++] = ';';
+			strcpy(str + pos, func->name);
+			pos += len;
+		}
+		if (pos)
+			fprintf(fout, "%s %u\n", str,
+				sample->time_us ? sample->time_us : 1);
+	}
+
+	return 0;
+}
+
 /**
  * make_flamegraph() - Write out a flame graph
  *
@@ -1861,6 +1961,14 @@ static int make_flamegraph(FILE *fout, enum out_format_t out_format)
 	struct flame_node *tree;
 	char str[500];
 
+	if (out_format == OUT_FMT_FLAMEGRAPH_SAMPLES) {
+		if (!sample_count) {
+			fprintf(stderr, "No samples in trace file\n");
+			return -1;
+		}
+		return output_samples(fout);
+	}
+
 	if (make_flame_tree(out_format, &tree))
 		return -1;
 
@@ -1918,8 +2026,13 @@ static int prof_tool(int argc, char *const argv[],
 			FILE *fout;
 
 			if (out_format != OUT_FMT_FLAMEGRAPH_CALLS &&
-			    out_format != OUT_FMT_FLAMEGRAPH_TIMING)
-				out_format = OUT_FMT_FLAMEGRAPH_CALLS;
+			    out_format != OUT_FMT_FLAMEGRAPH_TIMING &&
+			    out_format != OUT_FMT_FLAMEGRAPH_SAMPLES) {
+				if (sample_count && !call_count)
+					out_format = OUT_FMT_FLAMEGRAPH_SAMPLES;
+				else
+					out_format = OUT_FMT_FLAMEGRAPH_CALLS;
+			}
 			fout = fopen(out_fname, "w");
 			if (!fout) {
 				fprintf(stderr, "Cannot write file '%s'\n",
@@ -1960,9 +2073,11 @@ int main(int argc, char *argv[])
 				out_format = OUT_FMT_FLAMEGRAPH_CALLS;
 			} else if (!strcmp("timing", optarg)) {
 				out_format = OUT_FMT_FLAMEGRAPH_TIMING;
+			} else if (!strcmp("samples", optarg)) {
+				out_format = OUT_FMT_FLAMEGRAPH_SAMPLES;
 			} else {
 				fprintf(stderr,
-					"Invalid format: use function, funcgraph, calls, timing\n");
+					"Invalid format: use function, funcgraph, calls, timing, samples\n");
 				exit(1);
 			}
 			break;